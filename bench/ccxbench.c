@@ -0,0 +1,394 @@
+/* ccxbench: throughput benchmark for ccextractor.
+ *
+ * Generates deterministic synthetic inputs (see gen_streams.c), then runs a
+ * ccextractor binary on each of them, once per stage:
+ *
+ *   demux       input -> raw caption data (-out=bin), no caption decoding
+ *   decode      raw caption data -> .srt, no demuxing
+ *   end_to_end  input -> .srt
+ *
+ * and prints the results as JSON: wall and CPU time, MB/s and demuxer
+ * units (transport stream packets, MP4 samples or MXF frames) per second, heap
+ * allocations as counted by alloc_count.so, and peak RSS.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <dirent.h>
+
+#include "gen_streams.h"
+
+#define STAGE_DEMUX      (1 << 0)
+#define STAGE_DECODE     (1 << 1)
+#define STAGE_END_TO_END (1 << 2)
+#define STAGE_ALL        (STAGE_DEMUX | STAGE_DECODE | STAGE_END_TO_END)
+
+#define EXIT_NO_CAPTIONS 10 // As in ccextractor
+
+struct bench_input
+{
+	const char *name;
+	const char *extension;
+	gen_stream_fn generate;
+	const char *unit;
+	const char *args;    // Extra ccextractor arguments for every stage
+	const char *output;  // end_to_end output format
+	int stages;
+};
+
+/* Raw caption data (-out=bin) holds 608/708 and teletext only. The MP4 files
+ * are small, and with binary concatenation an input shorter than the stream
+ * detection window is taken to go on in a next file, hence -ve. */
+static const struct bench_input inputs[] = {
+	{ "ts_608",      "ts",  gen_ts_608,      "ts_packets", "",           "srt",    STAGE_ALL },
+	{ "ts_708",      "ts",  gen_ts_708,      "ts_packets", "-svc 1",     "srt",    STAGE_ALL },
+	{ "ts_h264",     "ts",  gen_ts_h264,     "ts_packets", "",           "srt",    STAGE_ALL },
+	{ "ts_teletext", "ts",  gen_ts_teletext, "ts_packets", "",           "srt",    STAGE_ALL },
+	{ "ts_dvb",      "ts",  gen_ts_dvb,      "ts_packets", "",           "spupng", STAGE_END_TO_END },
+	{ "mp4_c608",    "mp4", gen_mp4_c608,    "samples",    "-ve",        "srt",    STAGE_END_TO_END },
+	{ "mp4_c708",    "mp4", gen_mp4_c708,    "samples",    "-ve -svc 1", "srt",    STAGE_END_TO_END },
+	{ "mp4_h264",    "mp4", gen_mp4_h264,    "samples",    "-ve",        "srt",    STAGE_END_TO_END },
+	{ "fmp4_c608",   "mp4", gen_fmp4_c608,   "samples",    "-in=fmp4",   "srt",    STAGE_END_TO_END },
+	{ "fmp4_c708",   "mp4", gen_fmp4_c708,   "samples",    "-in=fmp4 -svc 1", "srt", STAGE_END_TO_END },
+	{ "fmp4_h264",   "mp4", gen_fmp4_h264,   "samples",    "-in=fmp4",   "srt",    STAGE_END_TO_END },
+	{ "mxf_anc",     "mxf", gen_mxf_anc,     "frames",     "",           "srt",    STAGE_END_TO_END },
+};
+
+struct run_result
+{
+	int exit_code;
+	double seconds;
+	double user_seconds;
+	double sys_seconds;
+	long peak_rss_kb;
+	long long allocations;
+	long long allocated_bytes;
+	long long output_bytes;
+};
+
+static const char *workdir = "bench_data";
+static const char *alloc_lib;
+static int runs = 3;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: ccxbench [options] <ccextractor binary>\n"
+		"  -o dir      Directory for the generated streams and outputs (default: bench_data)\n"
+		"  -s seconds  Duration of every stream (default: 120)\n"
+		"  -p pids     Elementary streams in the 608/708 transport streams (default: 4)\n"
+		"  -c count    cc_data triplets per video frame, 1-31 (default: 20)\n"
+		"  -v bytes    Video slice data per frame (default: 4000)\n"
+		"  -V bytes    H.264 slice data and MXF picture per frame (default: 40000)\n"
+		"  -r runs     Runs of every test, the fastest one is reported (default: 3)\n"
+		"  -t name     Only the inputs whose name contains name (ts, 708, mp4...)\n"
+		"  -a path     Allocation counter library (default: alloc_count.so next to ccxbench)\n"
+		"  -g          Only generate the streams\n");
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long long file_size(const char *path)
+{
+	struct stat st;
+	return stat(path, &st) ? -1 : (long long) st.st_size;
+}
+
+/* Size of the files named <stem>.*, and of the files in a <stem>.d directory
+ * (708 services and images get output files of their own), which are removed
+ * if remove is set. */
+static long long outputs(const char *dir, const char *stem, int remove)
+{
+	size_t stem_len = strlen(stem);
+	long long total = 0;
+	struct dirent *e;
+	char path[PATH_MAX];
+	struct stat st;
+	DIR *d = opendir(dir);
+
+	if (!d)
+		return 0;
+	while ((e = readdir(d)))
+	{
+		if (stem_len ? strncmp(e->d_name, stem, stem_len) || e->d_name[stem_len] != '.' : e->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+		if (stat(path, &st))
+			continue;
+		if (S_ISDIR(st.st_mode))
+		{
+			total += outputs(path, "", remove);
+			if (remove)
+				rmdir(path);
+			continue;
+		}
+		total += st.st_size;
+		if (remove)
+			unlink(path);
+	}
+	closedir(d);
+	return total;
+}
+
+static int generate(const struct bench_input *in, const struct gen_params *p, const char *path, uint64_t *units)
+{
+	FILE *f = fopen(path, "wb");
+	int ret;
+
+	if (!f)
+	{
+		fprintf(stderr, "Unable to create %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	ret = in->generate(f, p, units);
+	if (fclose(f))
+		ret = -1;
+	if (ret)
+		fprintf(stderr, "Unable to write %s\n", path);
+	return ret;
+}
+
+/* Split args on spaces into argv, which must have room for them */
+static int split_args(char *args, char **argv, int argc)
+{
+	for (char *tok = strtok(args, " "); tok; tok = strtok(NULL, " "))
+		argv[argc++] = tok;
+	return argc;
+}
+
+static void run_once(const char *ccx, const char *stage_args, const char *extra_args,
+		const char *input, const char *stem, const char *output, const char *log, struct run_result *r)
+{
+	char stage_buf[256], extra_buf[256], alloc_file[PATH_MAX];
+	char *argv[32];
+	int argc = 0, status = 0, fd;
+	struct rusage ru;
+	double start;
+	pid_t pid;
+	FILE *f;
+
+	memset(r, 0, sizeof(*r));
+	r->allocations = r->allocated_bytes = -1;
+	snprintf(alloc_file, sizeof(alloc_file), "%s/allocations.txt", workdir);
+	unlink(alloc_file);
+	outputs(workdir, stem, 1);
+
+	snprintf(stage_buf, sizeof(stage_buf), "%s", stage_args);
+	snprintf(extra_buf, sizeof(extra_buf), "%s", extra_args);
+	argv[argc++] = (char *) ccx;
+	argc = split_args(stage_buf, argv, argc);
+	argc = split_args(extra_buf, argv, argc);
+	argv[argc++] = "--no_progress_bar";
+	argv[argc++] = "-o";
+	argv[argc++] = (char *) output;
+	argv[argc++] = (char *) input;
+	argv[argc] = NULL;
+
+	start = now();
+	pid = fork();
+	if (pid < 0)
+	{
+		fprintf(stderr, "fork: %s\n", strerror(errno));
+		exit(2);
+	}
+	if (pid == 0)
+	{
+		fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd >= 0)
+		{
+			dup2(fd, 1);
+			dup2(fd, 2);
+			close(fd);
+		}
+		if (alloc_lib)
+		{
+			setenv("LD_PRELOAD", alloc_lib, 1);
+			setenv("CCXBENCH_ALLOC_FILE", alloc_file, 1);
+		}
+		execv(ccx, argv);
+		fprintf(stderr, "Unable to run %s: %s\n", ccx, strerror(errno));
+		_exit(127);
+	}
+	while (wait4(pid, &status, 0, &ru) < 0)
+	{
+		if (errno != EINTR)
+		{
+			fprintf(stderr, "wait4: %s\n", strerror(errno));
+			exit(2);
+		}
+	}
+	r->seconds = now() - start;
+	r->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	r->user_seconds = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+	r->sys_seconds = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+	r->peak_rss_kb = ru.ru_maxrss;
+	r->output_bytes = outputs(workdir, stem, 0);
+
+	f = fopen(alloc_file, "r");
+	if (f)
+	{
+		if (fscanf(f, "%lld %lld", &r->allocations, &r->allocated_bytes) != 2)
+			r->allocations = r->allocated_bytes = -1;
+		fclose(f);
+	}
+}
+
+static void print_result(int *first, const struct bench_input *in, const char *stage,
+		long long bytes, uint64_t units, const struct run_result *r)
+{
+	double secs = r->seconds > 0 ? r->seconds : 1e-9;
+
+	printf("%s\n    {\n", *first ? "" : ",");
+	printf("      \"input\": \"%s\",\n", in->name);
+	printf("      \"stage\": \"%s\",\n", stage);
+	printf("      \"exit_code\": %d,\n", r->exit_code);
+	printf("      \"input_bytes\": %lld,\n", bytes);
+	printf("      \"output_bytes\": %lld,\n", r->output_bytes);
+	printf("      \"%s\": %llu,\n", in->unit, (unsigned long long) units);
+	printf("      \"seconds\": %.4f,\n", r->seconds);
+	printf("      \"user_seconds\": %.4f,\n", r->user_seconds);
+	printf("      \"sys_seconds\": %.4f,\n", r->sys_seconds);
+	printf("      \"mb_per_s\": %.2f,\n", bytes / 1e6 / secs);
+	printf("      \"%s_per_s\": %.0f,\n", in->unit, units / secs);
+	printf("      \"allocations\": %lld,\n", r->allocations);
+	printf("      \"allocated_bytes\": %lld,\n", r->allocated_bytes);
+	printf("      \"peak_rss_kb\": %ld\n", r->peak_rss_kb);
+	printf("    }");
+	fflush(stdout);
+	*first = 0;
+}
+
+/* Outputs go to <workdir>/<input name>_<stage>.<extension> */
+static void run_stage(const char *ccx, const struct bench_input *in, const char *stage,
+		const char *stage_args, const char *input, const char *extension, uint64_t units, int *first)
+{
+	struct run_result best = { 0 }, r;
+	char stem[256], output[PATH_MAX], log[PATH_MAX];
+	long long bytes = file_size(input);
+
+	snprintf(stem, sizeof(stem), "%s_%s", in->name, stage);
+	snprintf(output, sizeof(output), "%s/%s.%s", workdir, stem, extension);
+	snprintf(log, sizeof(log), "%s/%s_log.txt", workdir, stem);
+	fprintf(stderr, "%s %s", in->name, stage);
+	for (int i = 0; i < runs; i++)
+	{
+		run_once(ccx, stage_args, in->args, input, stem, output, log, &r);
+		if (i == 0 || r.seconds < best.seconds)
+			best = r;
+		fprintf(stderr, " %.3fs", r.seconds);
+	}
+	fprintf(stderr, "\n");
+	// 708 services and bitmaps are written without counting as captions found
+	if (best.exit_code != 0 && best.exit_code != EXIT_NO_CAPTIONS)
+		fprintf(stderr, "Warning: %s %s exited with %d, see %s\n", in->name, stage, best.exit_code, log);
+	print_result(first, in, stage, bytes, units, &best);
+}
+
+int main(int argc, char *argv[])
+{
+	struct gen_params p = { 120, 4, 20, 4000, 40000 };
+	const char *filter = NULL, *ccx = NULL;
+	char default_alloc_lib[PATH_MAX];
+	int only_generate = 0, first = 1, c;
+
+	while ((c = getopt(argc, argv, "o:s:p:c:v:V:r:t:a:g")) != -1)
+	{
+		switch (c)
+		{
+			case 'o': workdir = optarg; break;
+			case 's': p.seconds = atoi(optarg); break;
+			case 'p': p.pids = atoi(optarg); break;
+			case 'c': p.cc_count = atoi(optarg); break;
+			case 'v': p.video_size = atoi(optarg); break;
+			case 'V': p.avc_size = atoi(optarg); break;
+			case 'r': runs = atoi(optarg); break;
+			case 't': filter = optarg; break;
+			case 'a': alloc_lib = optarg; break;
+			case 'g': only_generate = 1; break;
+			default: usage();
+		}
+	}
+	if (optind < argc)
+		ccx = argv[optind];
+	if ((!ccx && !only_generate) || p.seconds < 1 || runs < 1 || p.cc_count < 1 || p.cc_count > 31 || p.video_size < 0 || p.avc_size < 0)
+		usage();
+	if (mkdir(workdir, 0755) && errno != EEXIST)
+	{
+		fprintf(stderr, "Unable to create %s: %s\n", workdir, strerror(errno));
+		return 2;
+	}
+	if (!alloc_lib)
+	{
+		char self[PATH_MAX];
+		ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+		if (n > 0)
+		{
+			self[n] = 0;
+			snprintf(default_alloc_lib, sizeof(default_alloc_lib), "%s/alloc_count.so", dirname(self));
+			if (!access(default_alloc_lib, R_OK))
+				alloc_lib = default_alloc_lib;
+		}
+	}
+	if (!alloc_lib && !only_generate)
+		fprintf(stderr, "alloc_count.so not found, allocations are reported as -1\n");
+
+	if (!only_generate)
+	{
+		printf("{\n");
+		printf("  \"ccextractor\": \"%s\",\n", ccx);
+		printf("  \"seconds\": %d,\n  \"pids\": %d,\n  \"cc_count\": %d,\n  \"video_size\": %d,\n  \"avc_size\": %d,\n  \"runs\": %d,\n",
+				p.seconds, p.pids, p.cc_count, p.video_size, p.avc_size, runs);
+		printf("  \"results\": [");
+	}
+	for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+	{
+		const struct bench_input *in = &inputs[i];
+		char input[PATH_MAX], raw[PATH_MAX], args[64];
+		uint64_t units = 0;
+
+		if (filter && !strstr(in->name, filter))
+			continue;
+		snprintf(input, sizeof(input), "%s/%s.%s", workdir, in->name, in->extension);
+		snprintf(raw, sizeof(raw), "%s/%s_demux.bin", workdir, in->name);
+		if (generate(in, &p, input, &units))
+			return 2;
+		if (only_generate)
+		{
+			printf("%s %llu %s\n", input, (unsigned long long) units, in->unit);
+			continue;
+		}
+
+		if (in->stages & (STAGE_DEMUX | STAGE_DECODE))
+			run_stage(ccx, in, "demux", "-out=bin", input, "bin", units, &first);
+		if (in->stages & STAGE_DECODE)
+			run_stage(ccx, in, "decode", "-in=bin -out=srt", raw, "srt", units, &first);
+		if (in->stages & STAGE_END_TO_END)
+		{
+			snprintf(args, sizeof(args), "-out=%s", in->output);
+			run_stage(ccx, in, "end_to_end", args, input, in->output, units, &first);
+		}
+	}
+	if (!only_generate)
+		printf("\n  ]\n}\n");
+	return 0;
+}
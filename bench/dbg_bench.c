@@ -0,0 +1,190 @@
+/* Microbenchmark of the cost of debug messages with debug output off: the
+ * messages of the TS demuxer and of the caption block decoder for a packet
+ * carrying captions, through the dbg_print() and ccx_debug() macros of
+ * src/lib_ccx/ccx_common_common.h, through them in a build with
+ * CCX_NO_VERBOSE_DEBUG, and as a plain function call as dbg_print() was
+ * before, which evaluated every argument (time stamps formatted, caption
+ * bytes decoded) before looking at the mask.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ccx_common_common.h"
+
+#define PACKETS 20000000
+#define TRIPLETS 3 // cc_data triplets in a packet
+
+LLONG ccx_dbg_mask = CCX_DMT_GENERIC_NOTICES; // The default, no debug option
+struct ccx_common_logging_t ccx_common_logging;
+static int messages_target = 1, temp_debug;
+static LLONG debug_mask = CCX_DMT_GENERIC_NOTICES, debug_mask_on_debug = CCX_DMT_VERBOSE;
+static FILE *out;
+
+void (dbg_print)(LLONG mask, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(out, fmt, args);
+	va_end(args);
+}
+
+// dbg_print() before the macro
+__attribute__((noinline)) static void former_dbg_print(LLONG mask, const char *fmt, ...)
+{
+	va_list args;
+	LLONG t;
+	if (!messages_target)
+		return;
+	t = temp_debug ? (debug_mask_on_debug | debug_mask) : debug_mask;
+	if (mask & t)
+	{
+		va_start(args, fmt);
+		vfprintf(out, fmt, args);
+		fflush(out);
+		va_end(args);
+	}
+}
+
+// Same work as print_mstime_static() and debug_608_to_ASC()
+static char *mstime(LLONG ms)
+{
+	static char buf[15];
+	unsigned h = ms / 3600000, m = ms / 60000 % 60, s = ms / 1000 % 60;
+	sprintf(buf, "%02u:%02u:%02u%c%03u", h, m, s, ',', (unsigned) (ms % 1000));
+	return buf;
+}
+
+static char *cc_to_ascii(const unsigned char *cc, int channel)
+{
+	static char buf[8];
+	unsigned char c1 = cc[1] & 0x7f, c2 = cc[2] & 0x7f;
+	buf[0] = channel ? 'F' : 'f';
+	buf[1] = c1 >= 0x20 ? c1 : '.';
+	buf[2] = c2 >= 0x20 ? c2 : '.';
+	buf[3] = '\0';
+	return buf;
+}
+
+/* The messages of ts_readpacket(), process_cc_data() and do_cb() for a
+   packet, with the given print statement */
+#define PACKET_MESSAGES(print, debug, pkt, i) \
+	do { \
+		print(CCX_DMT_PARSE, "TS pid: %d  PES start: %d  counter: %u  payload length: %u  adapt length: %d\n", \
+				(pkt)[1] & 0x1f, (pkt)[1] >> 6 & 1, (pkt)[3] & 0xf, 184u, 0); \
+		for (int t = 0; t < TRIPLETS; t++) \
+		{ \
+			const unsigned char *cc = (pkt) + 8 + 3 * t; \
+			print(CCX_DMT_CBRAW, "%s   %d   %02X:%c%c:%02X", mstime((i) * 33 + t), 0, \
+					cc[1], cc[1] & 0x7f, cc[2] & 0x7f, cc[2]); \
+			print(CCX_DMT_CBRAW, "    %s   ..   ..\n", cc_to_ascii(cc, 0)); \
+			debug(CCX_DMT_DECODER_608, "\r%s\n", cc_to_ascii(cc, t & 1)); \
+		} \
+	} while (0)
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned checksum(const unsigned char *pkt, long i)
+{
+	return pkt[(i & 7) + 8] ^ (unsigned) i;
+}
+
+static double run_none(const unsigned char *pkt, unsigned *sum)
+{
+	double start = now();
+	for (long i = 0; i < PACKETS; i++)
+		*sum += checksum(pkt, i);
+	return now() - start;
+}
+
+static double run_former(const unsigned char *pkt, unsigned *sum)
+{
+	double start = now();
+	for (long i = 0; i < PACKETS; i++)
+	{
+		PACKET_MESSAGES(former_dbg_print, former_dbg_print, pkt, i);
+		*sum += checksum(pkt, i);
+	}
+	return now() - start;
+}
+
+static double run_macro(const unsigned char *pkt, unsigned *sum)
+{
+	double start = now();
+	for (long i = 0; i < PACKETS; i++)
+	{
+		PACKET_MESSAGES(dbg_print, ccx_debug, pkt, i);
+		*sum += checksum(pkt, i);
+	}
+	return now() - start;
+}
+
+// What the macros become in a build with CCX_NO_VERBOSE_DEBUG
+#undef CCX_DMT_COMPILED_OUT
+#define CCX_DMT_COMPILED_OUT CCX_DMT_VERBOSE_CATEGORIES
+
+static double run_compiled_out(const unsigned char *pkt, unsigned *sum)
+{
+	double start = now();
+	for (long i = 0; i < PACKETS; i++)
+	{
+		PACKET_MESSAGES(dbg_print, ccx_debug, pkt, i);
+		*sum += checksum(pkt, i);
+	}
+	return now() - start;
+}
+
+static void debug_ftn(LLONG mask, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(out, fmt, args);
+	va_end(args);
+}
+
+int main(void)
+{
+	unsigned char pkt[188];
+	unsigned sum = 0;
+	double none, former, macro, compiled_out;
+
+	out = fopen("/dev/null", "w");
+	if (!out)
+		return 2;
+	ccx_common_logging.debug_ftn = debug_ftn;
+	ccx_common_logging.debug_mask = debug_mask;
+	memset(pkt, 0xff, sizeof(pkt));
+	pkt[0] = 0x47;
+	pkt[1] = 0x41;
+	pkt[2] = 0x00;
+	pkt[3] = 0x10;
+	for (int t = 0; t < TRIPLETS; t++)
+	{
+		pkt[8 + 3 * t] = 0xfc;
+		pkt[9 + 3 * t] = 0xc8 + t;
+		pkt[10 + 3 * t] = 0xe5;
+	}
+
+	none = run_none(pkt, &sum);
+	former = run_former(pkt, &sum);
+	macro = run_macro(pkt, &sum);
+	compiled_out = run_compiled_out(pkt, &sum);
+
+	printf("{\n");
+	printf("  \"packets\": %d,\n", PACKETS);
+	printf("  \"messages_per_packet\": %d,\n", 1 + 3 * TRIPLETS);
+	printf("  \"ns_per_packet_no_messages\": %.2f,\n", none * 1e9 / PACKETS);
+	printf("  \"ns_per_packet_former\": %.2f,\n", former * 1e9 / PACKETS);
+	printf("  \"ns_per_packet_macro\": %.2f,\n", macro * 1e9 / PACKETS);
+	printf("  \"ns_per_packet_compiled_out\": %.2f,\n", compiled_out * 1e9 / PACKETS);
+	printf("  \"checksum\": %u\n", sum);
+	printf("}\n");
+	fclose(out);
+	return 0;
+}
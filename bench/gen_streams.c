@@ -0,0 +1,1820 @@
+/* Deterministic synthetic streams for ccxbench, see gen_streams.h.
+ *
+ * Every stream carries a caption every few seconds, so that the decoders and
+ * encoders have as much to do as the demuxers: MPEG-2 and H.264 video with
+ * ATSC A/53 cc_data, EBU teletext subtitles (page 888), DVB bitmap subtitles,
+ * MP4, plain or fragmented, with a QuickTime c608 or c708 closed caption
+ * track or H.264 video, and MXF with SMPTE 436 ANC captions.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "gen_streams.h"
+
+#define TS_PACKET_SIZE 188
+#define PID_PMT 0x100
+#define PID_VIDEO 0x101 // Other elementary streams take the PIDs right after
+#define PSI_INTERVAL 10 // Frames between two PAT/PMT
+#define AUDIO_FRAME_SIZE 480
+
+#define CAPTION_FRAMES 90   // A caption every 3 seconds at 29.97 fps ...
+#define CAPTION_SHOWN 60    // ... shown for 2 seconds
+#define SUBTITLE_FRAMES 75  // A subtitle every 3 seconds at 25 fps ...
+#define SUBTITLE_SHOWN 50   // ... shown for 2 seconds
+
+#define DVB_REGION_WIDTH 480
+#define DVB_REGION_HEIGHT 60
+
+/* Growing byte buffer the streams are put together in */
+struct gbuf
+{
+	uint8_t *data;
+	size_t len;
+	size_t size;
+};
+
+static void gbuf_reserve(struct gbuf *b, size_t n)
+{
+	if (b->len + n <= b->size)
+		return;
+	while (b->len + n > b->size)
+		b->size = b->size ? b->size * 2 : 4096;
+	b->data = realloc(b->data, b->size);
+	if (!b->data)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+}
+
+static void put8(struct gbuf *b, uint8_t v)
+{
+	gbuf_reserve(b, 1);
+	b->data[b->len++] = v;
+}
+
+static void put16(struct gbuf *b, uint16_t v)
+{
+	put8(b, v >> 8);
+	put8(b, v & 0xff);
+}
+
+static void put32(struct gbuf *b, uint32_t v)
+{
+	put16(b, v >> 16);
+	put16(b, v & 0xffff);
+}
+
+static void put_bytes(struct gbuf *b, const void *data, size_t n)
+{
+	gbuf_reserve(b, n);
+	memcpy(b->data + b->len, data, n);
+	b->len += n;
+}
+
+static void put_fill(struct gbuf *b, uint8_t v, size_t n)
+{
+	gbuf_reserve(b, n);
+	memset(b->data + b->len, v, n);
+	b->len += n;
+}
+
+static void patch16(struct gbuf *b, size_t pos, uint16_t v)
+{
+	b->data[pos] = v >> 8;
+	b->data[pos + 1] = v & 0xff;
+}
+
+static void patch32(struct gbuf *b, size_t pos, uint32_t v)
+{
+	patch16(b, pos, v >> 16);
+	patch16(b, pos + 2, v & 0xffff);
+}
+
+static uint8_t odd_parity(uint8_t c)
+{
+	uint8_t p = c & 0x7f, v = p;
+	v ^= v >> 4;
+	v ^= v >> 2;
+	v ^= v >> 1;
+	return (v & 1) ? p : p | 0x80;
+}
+
+static uint8_t reverse8(uint8_t b)
+{
+	b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+	b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+	b = (b & 0xaa) >> 1 | (b & 0x55) << 1;
+	return b;
+}
+
+static uint32_t crc32_mpeg(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0xffffffff;
+	while (len--)
+	{
+		crc ^= (uint32_t) *data++ << 24;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+static void caption_text(char *text, size_t size, int idx)
+{
+	static const char *words[] = { "THE", "QUICK", "BROWN", "FOX", "JUMPS", "OVER", "LAZY", "DOGS" };
+	snprintf(text, size, "%s %s CAPTION %d", words[idx % 8], words[(idx / 8) % 8], idx);
+}
+
+/*------------------------------------------------------------------------*/
+/* Transport stream                                                        */
+/*------------------------------------------------------------------------*/
+
+struct ts_writer
+{
+	FILE *f;
+	uint8_t cc[8192];
+	uint64_t packets;
+	int error;
+};
+
+/* Split data into transport stream packets, the first one with PCR if pcr >= 0 */
+static void ts_put(struct ts_writer *w, int pid, const uint8_t *data, size_t len, int pusi, int64_t pcr)
+{
+	uint8_t pkt[TS_PACKET_SIZE];
+	int first = 1;
+
+	do
+	{
+		uint8_t af[TS_PACKET_SIZE];
+		size_t af_len = 0, room, pos = 4;
+		int has_af = 0;
+
+		if (first && pcr >= 0)
+		{
+			af[0] = 0x10; // PCR_flag
+			af[1] = pcr >> 25;
+			af[2] = pcr >> 17;
+			af[3] = pcr >> 9;
+			af[4] = pcr >> 1;
+			af[5] = ((pcr & 1) << 7) | 0x7e;
+			af[6] = 0;
+			af_len = 7;
+			has_af = 1;
+		}
+		room = 184 - (has_af ? 1 + af_len : 0);
+		if (len < room)
+		{
+			size_t need = room - len;
+			if (!has_af)
+			{
+				has_af = 1;
+				need--;
+				if (need > 0)
+				{
+					af[0] = 0;
+					af_len = 1;
+					need--;
+				}
+			}
+			memset(af + af_len, 0xff, need);
+			af_len += need;
+			room = len;
+		}
+
+		pkt[0] = 0x47;
+		pkt[1] = (first && pusi ? 0x40 : 0) | (pid >> 8);
+		pkt[2] = pid & 0xff;
+		pkt[3] = (has_af ? 0x30 : 0x10) | w->cc[pid];
+		w->cc[pid] = (w->cc[pid] + 1) & 0xf;
+		if (has_af)
+		{
+			pkt[pos++] = af_len;
+			memcpy(pkt + pos, af, af_len);
+			pos += af_len;
+		}
+		memcpy(pkt + pos, data, room);
+		data += room;
+		len -= room;
+
+		if (fwrite(pkt, TS_PACKET_SIZE, 1, w->f) != 1)
+			w->error = 1;
+		w->packets++;
+		first = 0;
+	} while (len > 0);
+}
+
+/* Section s starts with table_id, its length and CRC are filled in here */
+static void ts_put_section(struct ts_writer *w, int pid, struct gbuf *s)
+{
+	uint8_t pointer_field = 0;
+	struct gbuf pkt = { 0 };
+
+	patch16(s, 1, 0xb000 | (s->len - 3 + 4));
+	put32(s, crc32_mpeg(s->data, s->len));
+	put_bytes(&pkt, &pointer_field, 1);
+	put_bytes(&pkt, s->data, s->len);
+	ts_put(w, pid, pkt.data, pkt.len, 1, -1);
+	free(pkt.data);
+	s->len = 0;
+}
+
+struct es_info
+{
+	uint8_t stream_type;
+	int pid;
+	const uint8_t *descriptor;
+	size_t descriptor_len;
+};
+
+static void ts_put_psi(struct ts_writer *w, const struct es_info *es, int nb_es)
+{
+	struct gbuf s = { 0 };
+
+	// PAT, a single program
+	put8(&s, 0x00);
+	put16(&s, 0);
+	put16(&s, 1);   // transport_stream_id
+	put8(&s, 0xc1);
+	put8(&s, 0);
+	put8(&s, 0);
+	put16(&s, 1);   // program_number
+	put16(&s, 0xe000 | PID_PMT);
+	ts_put_section(w, 0, &s);
+
+	// PMT
+	put8(&s, 0x02);
+	put16(&s, 0);
+	put16(&s, 1);
+	put8(&s, 0xc1);
+	put8(&s, 0);
+	put8(&s, 0);
+	put16(&s, 0xe000 | PID_VIDEO); // PCR_PID
+	put16(&s, 0xf000);
+	for (int i = 0; i < nb_es; i++)
+	{
+		put8(&s, es[i].stream_type);
+		put16(&s, 0xe000 | es[i].pid);
+		put16(&s, 0xf000 | es[i].descriptor_len);
+		if (es[i].descriptor_len)
+			put_bytes(&s, es[i].descriptor, es[i].descriptor_len);
+	}
+	ts_put_section(w, PID_PMT, &s);
+	free(s.data);
+}
+
+static void put_pts(struct gbuf *b, uint64_t pts)
+{
+	put8(b, 0x21 | ((pts >> 29) & 0x0e));
+	put16(b, ((pts >> 14) & 0xfffe) | 1);
+	put16(b, ((pts << 1) & 0xfffe) | 1);
+}
+
+/* PES header with PTS and stuffing bytes, PES_packet_length is 0 if it doesn't fit */
+static void put_pes_header(struct gbuf *b, uint8_t stream_id, size_t payload_len, uint64_t pts, int stuffing)
+{
+	size_t len = 3 + 5 + stuffing + payload_len;
+
+	put8(b, 0);
+	put8(b, 0);
+	put8(b, 1);
+	put8(b, stream_id);
+	put16(b, len > 0xffff ? 0 : len);
+	put8(b, 0x84); // data_alignment_indicator
+	put8(b, 0x80); // PTS only
+	put8(b, 5 + stuffing);
+	put_pts(b, pts);
+	put_fill(b, 0xff, stuffing);
+}
+
+/* MPEG-2 video frame, with cc_count cc_data triplets in GA94 user data if cc is set */
+static void put_video_frame(struct gbuf *b, int n, const uint8_t *cc, int cc_count, const uint8_t *slice, size_t slice_len)
+{
+	static const uint8_t seq_header[] = { 0, 0, 1, 0xb3, 0x2d, 0x01, 0xe0, 0x24, 0xff, 0xff, 0xe0, 0x00 };
+	static const uint8_t seq_ext[] = { 0, 0, 1, 0xb5, 0x14, 0x8a, 0x00, 0x01, 0x00, 0x00 };
+	static const uint8_t gop[] = { 0, 0, 1, 0xb8, 0x00, 0x08, 0x00, 0x40 };
+	static const uint8_t pic_ext[] = { 0, 0, 1, 0xb5, 0x8f, 0xff, 0xf3, 0x41, 0x80 };
+	static const uint8_t ga94[] = { 0, 0, 1, 0xb2, 'G', 'A', '9', '4', 0x03 };
+	int tref = n % 15;
+
+	if (tref == 0)
+	{
+		put_bytes(b, seq_header, sizeof(seq_header));
+		put_bytes(b, seq_ext, sizeof(seq_ext));
+		put_bytes(b, gop, sizeof(gop));
+	}
+	// Picture header, I frame
+	put8(b, 0);
+	put8(b, 0);
+	put8(b, 1);
+	put8(b, 0x00);
+	put8(b, tref >> 2);
+	put8(b, ((tref & 3) << 6) | (1 << 3) | 0x7);
+	put8(b, 0xff);
+	put8(b, 0xf8);
+	put_bytes(b, pic_ext, sizeof(pic_ext));
+	if (cc)
+	{
+		put_bytes(b, ga94, sizeof(ga94));
+		put8(b, 0x40 | cc_count); // process_cc_data_flag
+		put8(b, 0xff);
+		put_bytes(b, cc, cc_count * 3);
+		put8(b, 0xff);
+	}
+	put8(b, 0);
+	put8(b, 0);
+	put8(b, 1);
+	put8(b, 0x01);
+	put_bytes(b, slice, slice_len);
+}
+
+/* Pseudo random slice data without zero bytes, so without start code emulation */
+static uint8_t *make_payload(size_t len, uint32_t seed)
+{
+	uint8_t *p = malloc(len ? len : 1);
+	if (!p)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+	for (size_t i = 0; i < len; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		p[i] = (seed >> 16) | 1;
+	}
+	return p;
+}
+
+/* EIA-608 pop-on caption on field 1, one byte pair per frame */
+static void cc608_pair(int frame, uint8_t pair[2])
+{
+	static const uint8_t RCL[] = { 0x14, 0x20 }, PAC[] = { 0x14, 0x70 };
+	static const uint8_t EOC[] = { 0x14, 0x2f }, EDM[] = { 0x14, 0x2c };
+	int off = frame % CAPTION_FRAMES;
+	char text[40];
+	int len, text_pairs;
+
+	pair[0] = pair[1] = 0x80;
+	if (off == CAPTION_SHOWN || off == CAPTION_SHOWN + 1)
+	{
+		pair[0] = odd_parity(EDM[0]);
+		pair[1] = odd_parity(EDM[1]);
+		return;
+	}
+
+	caption_text(text, sizeof(text), frame / CAPTION_FRAMES);
+	len = strlen(text);
+	text_pairs = (len + 1) / 2;
+	if (off < 2)
+		memcpy(pair, RCL, 2);
+	else if (off < 4)
+		memcpy(pair, PAC, 2);
+	else if (off < 4 + text_pairs)
+	{
+		pair[0] = text[(off - 4) * 2];
+		pair[1] = (off - 4) * 2 + 1 < len ? text[(off - 4) * 2 + 1] : 0;
+	}
+	else if (off < 6 + text_pairs)
+		memcpy(pair, EOC, 2);
+	else
+		return;
+	pair[0] = odd_parity(pair[0]);
+	pair[1] = pair[1] ? odd_parity(pair[1]) : 0x80;
+}
+
+/* CEA-708 caption in service 1, as DTVCC packets going out two bytes at a time */
+struct dtvcc_gen
+{
+	uint8_t packet[128];
+	int len;
+	int pos;
+	int seq;
+};
+
+static void dtvcc_queue(struct dtvcc_gen *g, const uint8_t *block, int block_len)
+{
+	int size = 2 + block_len;
+
+	if (size & 1)
+		size++; // Null service block header as padding
+	memset(g->packet, 0, sizeof(g->packet));
+	g->packet[0] = (g->seq << 6) | (size / 2);
+	g->packet[1] = (1 << 5) | block_len;
+	memcpy(g->packet + 2, block, block_len);
+	g->len = size;
+	g->pos = 0;
+	g->seq = (g->seq + 1) & 3;
+}
+
+static void dtvcc_frame(struct dtvcc_gen *g, int frame)
+{
+	int off = frame % CAPTION_FRAMES;
+	uint8_t block[31];
+
+	if (off == 0)
+	{
+		// DefineWindow 0: visible, 2 rows of 32 columns, pen and window style 1
+		static const uint8_t df0[] = { 0x98, 0x20, 12, 10, 0x01, 31, 0x09 };
+		char text[40];
+		int len;
+
+		caption_text(text, sizeof(text), frame / CAPTION_FRAMES);
+		len = strlen(text);
+		if (len > (int) (sizeof(block) - sizeof(df0)))
+			len = sizeof(block) - sizeof(df0);
+		memcpy(block, df0, sizeof(df0));
+		memcpy(block + sizeof(df0), text, len);
+		dtvcc_queue(g, block, sizeof(df0) + len);
+	}
+	else if (off == CAPTION_SHOWN)
+	{
+		block[0] = 0x8c; // DeleteWindows
+		block[1] = 0x01;
+		dtvcc_queue(g, block, 2);
+	}
+}
+
+/* Fill cc_count triplets: 608 field 1 in the first one, 708 in the others */
+static void cc_data_frame(uint8_t *cc, int cc_count, int frame, int with_608, struct dtvcc_gen *g)
+{
+	uint8_t pair[2] = { 0x80, 0x80 };
+
+	if (with_608)
+		cc608_pair(frame, pair);
+	cc[0] = 0xfc;
+	cc[1] = pair[0];
+	cc[2] = pair[1];
+	for (int i = 1; i < cc_count; i++)
+	{
+		uint8_t *t = cc + i * 3;
+		if (g && g->pos < g->len)
+		{
+			t[0] = g->pos ? 0xfe : 0xff;
+			t[1] = g->packet[g->pos];
+			t[2] = g->packet[g->pos + 1];
+			g->pos += 2;
+		}
+		else
+		{
+			t[0] = 0xfa; // Not valid, ends the DTVCC packet
+			t[1] = 0;
+			t[2] = 0;
+		}
+	}
+}
+
+static int gen_ts_cc(FILE *f, const struct gen_params *p, uint64_t *units, int with_708)
+{
+	struct ts_writer *w = calloc(1, sizeof(struct ts_writer));
+	struct es_info es[32];
+	struct dtvcc_gen dtvcc = { { 0 } };
+	struct gbuf pes = { 0 }, es_data = { 0 };
+	uint8_t cc[31 * 3];
+	uint8_t *slice = make_payload(p->video_size, 1);
+	uint8_t *audio = make_payload(AUDIO_FRAME_SIZE, 2);
+	int nb_es = p->pids < 1 ? 1 : p->pids > 32 ? 32 : p->pids;
+	int frames = p->seconds * 30;
+	int ret;
+
+	if (!w)
+		return -1;
+	w->f = f;
+	es[0].stream_type = 0x02;
+	es[0].pid = PID_VIDEO;
+	es[0].descriptor_len = 0;
+	for (int i = 1; i < nb_es; i++)
+	{
+		es[i].stream_type = 0x04; // MPEG-2 audio, skipped by the demuxer
+		es[i].pid = PID_VIDEO + i;
+		es[i].descriptor_len = 0;
+	}
+
+	for (int n = 0; n < frames && !w->error; n++)
+	{
+		uint64_t pts = 90000 + (uint64_t) n * 3003;
+
+		if (n % PSI_INTERVAL == 0)
+			ts_put_psi(w, es, nb_es);
+
+		if (with_708)
+			dtvcc_frame(&dtvcc, n);
+		cc_data_frame(cc, p->cc_count, n, !with_708, with_708 ? &dtvcc : NULL);
+		es_data.len = 0;
+		put_video_frame(&es_data, n, cc, p->cc_count, slice, p->video_size);
+		pes.len = 0;
+		put_pes_header(&pes, 0xe0, es_data.len, pts, 0);
+		patch16(&pes, 4, 0); // Unbounded, as usual for video
+		put_bytes(&pes, es_data.data, es_data.len);
+		ts_put(w, PID_VIDEO, pes.data, pes.len, 1, pts - 9000);
+
+		for (int i = 1; i < nb_es; i++)
+		{
+			pes.len = 0;
+			put_pes_header(&pes, 0xc0 + i - 1, AUDIO_FRAME_SIZE, pts, 0);
+			put_bytes(&pes, audio, AUDIO_FRAME_SIZE);
+			ts_put(w, PID_VIDEO + i, pes.data, pes.len, 1, -1);
+		}
+	}
+
+	*units = w->packets;
+	ret = w->error ? -1 : 0;
+	free(pes.data);
+	free(es_data.data);
+	free(slice);
+	free(audio);
+	free(w);
+	return ret;
+}
+
+int gen_ts_608(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_ts_cc(f, p, units, 0);
+}
+
+int gen_ts_708(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_ts_cc(f, p, units, 1);
+}
+
+/*------------------------------------------------------------------------*/
+/* H.264 video                                                             */
+/*------------------------------------------------------------------------*/
+
+#define AVC_GOP 30 // An IDR picture every second, P pictures in between
+
+/* Bit writer for the RBSP of a NAL unit */
+struct bitw
+{
+	struct gbuf *b;
+	uint32_t acc;
+	int bits;
+};
+
+static void put_bits(struct bitw *w, uint32_t v, int n)
+{
+	while (n--)
+	{
+		w->acc = (w->acc << 1) | ((v >> n) & 1);
+		if (++w->bits == 8)
+		{
+			put8(w->b, w->acc);
+			w->acc = 0;
+			w->bits = 0;
+		}
+	}
+}
+
+/* Unsigned Exp-Golomb code */
+static void put_ue(struct bitw *w, uint32_t v)
+{
+	int len = 0;
+
+	for (uint32_t t = v + 1; t > 1; t >>= 1)
+		len++;
+	put_bits(w, 0, len);
+	put_bits(w, v + 1, len + 1);
+}
+
+static void put_trailing_bits(struct bitw *w)
+{
+	put_bits(w, 1, 1);
+	if (w->bits)
+		put_bits(w, 0, 8 - w->bits);
+}
+
+/* NAL unit with a 4 byte start code, emulation prevention bytes inserted in rbsp */
+static void put_nal(struct gbuf *b, uint8_t header, const uint8_t *rbsp, size_t len)
+{
+	int zeros = 0;
+
+	put32(b, 1);
+	put8(b, header);
+	for (size_t i = 0; i < len; i++)
+	{
+		if (zeros == 2 && rbsp[i] <= 3)
+		{
+			put8(b, 3);
+			zeros = 0;
+		}
+		put8(b, rbsp[i]);
+		zeros = rbsp[i] ? 0 : zeros + 1;
+	}
+}
+
+/* SPS: Main profile 1920x1080, 29.97 fps, POC type 0 with 8 bits, frame_num 4 bits */
+static void put_avc_sps(struct gbuf *b, struct gbuf *rbsp)
+{
+	struct bitw w = { rbsp, 0, 0 };
+
+	rbsp->len = 0;
+	put_bits(&w, 77, 8); // profile_idc
+	put_bits(&w, 0, 8);  // constraint flags
+	put_bits(&w, 40, 8); // level_idc
+	put_ue(&w, 0);       // seq_parameter_set_id
+	put_ue(&w, 0);       // log2_max_frame_num_minus4
+	put_ue(&w, 0);       // pic_order_cnt_type
+	put_ue(&w, 4);       // log2_max_pic_order_cnt_lsb_minus4
+	put_ue(&w, 1);       // max_num_ref_frames
+	put_bits(&w, 0, 1);  // gaps_in_frame_num_value_allowed_flag
+	put_ue(&w, 119);     // pic_width_in_mbs_minus1
+	put_ue(&w, 67);      // pic_height_in_map_units_minus1
+	put_bits(&w, 1, 1);  // frame_mbs_only_flag
+	put_bits(&w, 1, 1);  // direct_8x8_inference_flag
+	put_bits(&w, 1, 1);  // frame_cropping_flag, 1088 to 1080 lines
+	put_ue(&w, 0);
+	put_ue(&w, 0);
+	put_ue(&w, 0);
+	put_ue(&w, 4);
+	put_bits(&w, 1, 1);  // vui_parameters_present_flag
+	put_bits(&w, 0, 4);  // aspect_ratio, overscan, video_signal_type, chroma_loc
+	put_bits(&w, 1, 1);  // timing_info_present_flag
+	put_bits(&w, 1001, 32);
+	put_bits(&w, 60000, 32);
+	put_bits(&w, 1, 1);  // fixed_frame_rate_flag
+	put_bits(&w, 0, 5);  // HRD, pic_struct, bitstream_restriction
+	put_trailing_bits(&w);
+	put_nal(b, 0x67, rbsp->data, rbsp->len);
+
+	rbsp->len = 0;
+	put_ue(&w, 0);       // pic_parameter_set_id
+	put_ue(&w, 0);       // seq_parameter_set_id
+	put_bits(&w, 0, 2);  // entropy_coding_mode_flag, bottom_field_pic_order_in_frame_present_flag
+	put_ue(&w, 0);       // num_slice_groups_minus1
+	put_ue(&w, 0);       // num_ref_idx_l0_default_active_minus1
+	put_ue(&w, 0);       // num_ref_idx_l1_default_active_minus1
+	put_bits(&w, 0, 3);  // weighted_pred_flag, weighted_bipred_idc
+	put_ue(&w, 0);       // pic_init_qp_minus26, as se(v)
+	put_ue(&w, 0);       // pic_init_qs_minus26
+	put_ue(&w, 0);       // chroma_qp_index_offset
+	put_bits(&w, 4, 3);  // deblocking_filter_control_present_flag, constrained_intra_pred, redundant_pic_cnt_present
+	put_trailing_bits(&w);
+	put_nal(b, 0x68, rbsp->data, rbsp->len);
+}
+
+/* Access unit: delimiter, SPS and PPS on IDR pictures, cc_data SEI, one slice
+ * with slice_len bytes of data after its header */
+static void put_avc_frame(struct gbuf *b, struct gbuf *rbsp, int n, const uint8_t *cc, int cc_count,
+		const uint8_t *slice, size_t slice_len)
+{
+	static const uint8_t aud[] = { 0xf0 };
+	int idr = n % AVC_GOP == 0;
+	struct bitw w = { rbsp, 0, 0 };
+
+	put_nal(b, 0x09, aud, sizeof(aud));
+	if (idr)
+		put_avc_sps(b, rbsp);
+
+	// SEI, user_data_registered_itu_t_t35 with ATSC A/53 cc_data
+	rbsp->len = 0;
+	put8(rbsp, 4);
+	put8(rbsp, 11 + cc_count * 3);
+	put8(rbsp, 0xb5);
+	put16(rbsp, 0x0031);
+	put_bytes(rbsp, "GA94", 4);
+	put8(rbsp, 0x03);
+	put8(rbsp, 0x40 | cc_count);
+	put8(rbsp, 0xff);
+	put_bytes(rbsp, cc, cc_count * 3);
+	put8(rbsp, 0xff);
+	put8(rbsp, 0x80);
+	put_nal(b, 0x06, rbsp->data, rbsp->len);
+
+	rbsp->len = 0;
+	put_ue(&w, 0);                 // first_mb_in_slice
+	put_ue(&w, idr ? 7 : 5);       // slice_type, I or P
+	put_ue(&w, 0);                 // pic_parameter_set_id
+	put_bits(&w, n % AVC_GOP, 4);  // frame_num
+	if (idr)
+		put_ue(&w, 0);             // idr_pic_id
+	put_bits(&w, (n % AVC_GOP) * 2, 8); // pic_order_cnt_lsb
+	put_trailing_bits(&w);         // Stands for the rest of the header
+	put_bytes(rbsp, slice, slice_len);
+	put_nal(b, idr ? 0x65 : 0x41, rbsp->data, rbsp->len);
+}
+
+/* Pseudo random slice data with a zero byte pair every 64 bytes on average,
+ * so with emulation prevention bytes as in real streams */
+static uint8_t *make_slice_data(size_t len, uint32_t seed)
+{
+	uint8_t *p = make_payload(len, seed);
+
+	for (size_t i = 0; i + 2 < len; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 16) % 64 == 0)
+		{
+			p[i] = p[i + 1] = 0;
+			p[i + 2] = 1 + (seed >> 24) % 3;
+			i += 2;
+		}
+	}
+	return p;
+}
+
+int gen_ts_h264(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	struct ts_writer *w = calloc(1, sizeof(struct ts_writer));
+	struct es_info es = { 0x1b, PID_VIDEO, NULL, 0 };
+	struct gbuf pes = { 0 }, es_data = { 0 }, rbsp = { 0 };
+	uint8_t cc[31 * 3];
+	uint8_t *slice = make_slice_data(p->avc_size, 3);
+	int frames = p->seconds * 30;
+	int ret;
+
+	if (!w)
+		return -1;
+	w->f = f;
+	for (int n = 0; n < frames && !w->error; n++)
+	{
+		uint64_t pts = 90000 + (uint64_t) n * 3003;
+
+		if (n % PSI_INTERVAL == 0)
+			ts_put_psi(w, &es, 1);
+
+		cc_data_frame(cc, p->cc_count, n, 1, NULL);
+		es_data.len = 0;
+		put_avc_frame(&es_data, &rbsp, n, cc, p->cc_count, slice, p->avc_size);
+		pes.len = 0;
+		put_pes_header(&pes, 0xe0, es_data.len, pts, 0);
+		patch16(&pes, 4, 0);
+		put_bytes(&pes, es_data.data, es_data.len);
+		ts_put(w, PID_VIDEO, pes.data, pes.len, 1, pts - 9000);
+	}
+
+	*units = w->packets;
+	ret = w->error ? -1 : 0;
+	free(pes.data);
+	free(es_data.data);
+	free(rbsp.data);
+	free(slice);
+	free(w);
+	return ret;
+}
+
+/*------------------------------------------------------------------------*/
+/* Teletext and DVB subtitles, with 25 fps video without captions         */
+/*------------------------------------------------------------------------*/
+
+static const uint8_t HAM_8_4[16] = {
+	0x15, 0x02, 0x49, 0x5e, 0x64, 0x73, 0x38, 0x2f,
+	0xd0, 0xc7, 0x8c, 0x9b, 0xa1, 0xb6, 0xfd, 0xea
+};
+
+/* EBU teletext subtitle data unit for row y of magazine 8, ETS 300 706 */
+static void put_telx_unit(struct gbuf *b, int y, const uint8_t data[40])
+{
+	uint8_t unit[44];
+
+	unit[0] = 0x55; // Clock run-in
+	unit[1] = 0x27; // Framing code
+	unit[2] = HAM_8_4[((y & 1) << 3) | 0]; // Magazine 8 is sent as 0
+	unit[3] = HAM_8_4[y >> 1];
+	memcpy(unit + 4, data, 40);
+
+	put8(b, 0x03); // data_unit_id: EBU teletext subtitle
+	put8(b, 44);
+	for (int i = 0; i < 44; i++)
+		put8(b, reverse8(unit[i])); // Sent LSB first
+}
+
+static void put_telx_header(struct gbuf *b)
+{
+	uint8_t data[40];
+
+	data[0] = HAM_8_4[8]; // Page 88
+	data[1] = HAM_8_4[8];
+	data[2] = HAM_8_4[0];
+	data[3] = HAM_8_4[0x8]; // C4: erase page
+	data[4] = HAM_8_4[0];
+	data[5] = HAM_8_4[0x8]; // C6: subtitle
+	data[6] = HAM_8_4[0];
+	data[7] = HAM_8_4[0]; // Parallel transmission, Latin charset
+	for (int i = 8; i < 40; i++)
+		data[i] = odd_parity(' ');
+	put_telx_unit(b, 0, data);
+}
+
+static void put_telx_row(struct gbuf *b, int y, const char *text)
+{
+	uint8_t data[40];
+	int col = 4, len = strlen(text);
+
+	for (int i = 0; i < 40; i++)
+		data[i] = odd_parity(' ');
+	data[col++] = odd_parity(0x0d); // Double height
+	data[col++] = odd_parity(0x0b); // Start box
+	data[col++] = odd_parity(0x0b);
+	for (int i = 0; i < len && col < 36; i++)
+		data[col++] = odd_parity(text[i]);
+	data[col++] = odd_parity(0x0a); // End box
+	data[col++] = odd_parity(0x0a);
+	put_telx_unit(b, y, data);
+}
+
+static void put_telx_stuffing(struct gbuf *b)
+{
+	put8(b, 0xff);
+	put8(b, 44);
+	put_fill(b, 0xff, 44);
+}
+
+/* DVB subtitle segment, EN 300 743 */
+static size_t dvb_segment_start(struct gbuf *b, uint8_t type)
+{
+	put8(b, 0x0f);
+	put8(b, type);
+	put16(b, 1); // page_id
+	put16(b, 0);
+	return b->len;
+}
+
+static void dvb_segment_end(struct gbuf *b, size_t start)
+{
+	patch16(b, start - 2, b->len - start);
+}
+
+/* One field of the object, 4-bit pixel code strings of runs of the CLUT entries 0-3 */
+static void put_dvb_field(struct gbuf *b, int idx, int field)
+{
+	for (int y = field; y < DVB_REGION_HEIGHT; y += 2)
+	{
+		uint8_t nibbles[DVB_REGION_WIDTH * 5 / 25 + 64];
+		int n = 0, x = 0, k = 0;
+
+		while (x < DVB_REGION_WIDTH)
+		{
+			int run = 25 + (k * 7 + idx * 3 + y / 6) % 40;
+			int colour = (k + idx + y / 6) % 4;
+			if (run > DVB_REGION_WIDTH - x)
+				run = DVB_REGION_WIDTH - x;
+			if (run >= 25)
+			{
+				// 0000 11 11 LLLLLLLL CCCC: run - 25 pixels of colour
+				nibbles[n++] = 0x0;
+				nibbles[n++] = 0xf;
+				nibbles[n++] = (run - 25) >> 4;
+				nibbles[n++] = (run - 25) & 0xf;
+				nibbles[n++] = colour;
+			}
+			else
+			{
+				for (int i = 0; i < run; i++)
+					nibbles[n++] = 1; // One pixel each
+			}
+			x += run;
+			k++;
+		}
+		nibbles[n++] = 0; // End of string
+		nibbles[n++] = 0;
+		if (n & 1)
+			nibbles[n++] = 0;
+
+		put8(b, 0x11); // 4-bit pixel code string
+		for (int i = 0; i < n; i += 2)
+			put8(b, (nibbles[i] << 4) | nibbles[i + 1]);
+		put8(b, 0xf0); // End of object line
+	}
+}
+
+static void put_dvb_display_set(struct gbuf *b, int idx, int show)
+{
+	static const uint8_t clut[4][4] = {
+		{ 16, 128, 128, 255 }, // Transparent
+		{ 235, 128, 128, 0 },  // White
+		{ 16, 128, 128, 0 },   // Black
+		{ 125, 128, 128, 0 }   // Grey
+	};
+	uint8_t version = (idx * 2 + !show) & 0xf;
+	size_t start, field_start, lengths;
+
+	put8(b, 0x20); // data_identifier
+	put8(b, 0x00); // subtitle_stream_id
+
+	start = dvb_segment_start(b, 0x10); // Page composition
+	put8(b, 10); // page_time_out
+	put8(b, (version << 4) | ((show ? 2 : 0) << 2) | 0x3); // Mode change to show
+	if (show)
+	{
+		put8(b, 0); // region_id
+		put8(b, 0xff);
+		put16(b, 120);
+		put16(b, 440);
+	}
+	dvb_segment_end(b, start);
+
+	if (show)
+	{
+		start = dvb_segment_start(b, 0x11); // Region composition
+		put8(b, 0);
+		put8(b, (version << 4) | 0x7);
+		put16(b, DVB_REGION_WIDTH);
+		put16(b, DVB_REGION_HEIGHT);
+		put8(b, (2 << 5) | (2 << 2) | 0x3); // 4-bit
+		put8(b, 0); // CLUT_id
+		put8(b, 0);
+		put8(b, 0x03);
+		put16(b, 0); // object_id
+		put8(b, 0x00);
+		put8(b, 0);
+		put8(b, 0xf0);
+		put8(b, 0);
+		dvb_segment_end(b, start);
+
+		start = dvb_segment_start(b, 0x12); // CLUT definition
+		put8(b, 0);
+		put8(b, (version << 4) | 0xf);
+		for (int i = 0; i < 4; i++)
+		{
+			put8(b, i);
+			put8(b, 0x40 | 0x1e | 0x01); // 4-bit entry, full range
+			put_bytes(b, clut[i], 4);
+		}
+		dvb_segment_end(b, start);
+
+		start = dvb_segment_start(b, 0x13); // Object data
+		put16(b, 0);
+		put8(b, (version << 4) | 0x1); // Coding of pixels
+		lengths = b->len;
+		put16(b, 0); // top_field_data_block_length
+		put16(b, 0); // bottom_field_data_block_length
+		field_start = b->len;
+		put_dvb_field(b, idx, 0);
+		patch16(b, lengths, b->len - field_start);
+		field_start = b->len;
+		put_dvb_field(b, idx, 1);
+		patch16(b, lengths + 2, b->len - field_start);
+		dvb_segment_end(b, start);
+	}
+
+	start = dvb_segment_start(b, 0x80); // End of display set
+	dvb_segment_end(b, start);
+	put8(b, 0xff); // end_of_PES_data_field_marker
+}
+
+enum sub_kind { SUB_TELETEXT, SUB_DVB };
+
+static int gen_ts_sub(FILE *f, const struct gen_params *p, uint64_t *units, enum sub_kind kind)
+{
+	static const uint8_t telx_desc[] = { 0x56, 5, 'e', 'n', 'g', (0x02 << 3) | 0, 0x88 };
+	static const uint8_t dvb_desc[] = { 0x59, 8, 'e', 'n', 'g', 0x10, 0, 1, 0, 1 };
+	struct ts_writer *w = calloc(1, sizeof(struct ts_writer));
+	struct es_info es[2];
+	struct gbuf pes = { 0 }, es_data = { 0 };
+	uint8_t *slice = make_payload(p->video_size, 1);
+	int frames = p->seconds * 25;
+	int ret;
+
+	if (!w)
+		return -1;
+	w->f = f;
+	es[0].stream_type = 0x02;
+	es[0].pid = PID_VIDEO;
+	es[0].descriptor_len = 0;
+	es[1].stream_type = 0x06;
+	es[1].pid = PID_VIDEO + 1;
+	es[1].descriptor = kind == SUB_TELETEXT ? telx_desc : dvb_desc;
+	es[1].descriptor_len = kind == SUB_TELETEXT ? sizeof(telx_desc) : sizeof(dvb_desc);
+
+	for (int n = 0; n < frames && !w->error; n++)
+	{
+		uint64_t pts = 90000 + (uint64_t) n * 3600;
+		int off = n % SUBTITLE_FRAMES, idx = n / SUBTITLE_FRAMES;
+
+		if (n % PSI_INTERVAL == 0)
+			ts_put_psi(w, es, 2);
+
+		es_data.len = 0;
+		put_video_frame(&es_data, n, NULL, 0, slice, p->video_size);
+		pes.len = 0;
+		put_pes_header(&pes, 0xe0, es_data.len, pts, 0);
+		patch16(&pes, 4, 0);
+		put_bytes(&pes, es_data.data, es_data.len);
+		ts_put(w, PID_VIDEO, pes.data, pes.len, 1, pts - 9000);
+
+		es_data.len = 0;
+		if (kind == SUB_TELETEXT)
+		{
+			// EN 300 472: one TS packet per PES, a header and two rows, or stuffing
+			char text[40];
+			put8(&es_data, 0x10); // data_identifier
+			if (off == 0)
+			{
+				put_telx_header(&es_data);
+				caption_text(text, sizeof(text), idx);
+				put_telx_row(&es_data, 20, text);
+				put_telx_row(&es_data, 22, "SYNTHETIC TELETEXT");
+			}
+			else if (off == SUBTITLE_SHOWN)
+			{
+				put_telx_header(&es_data);
+				put_telx_stuffing(&es_data);
+				put_telx_stuffing(&es_data);
+			}
+			else
+			{
+				for (int i = 0; i < 3; i++)
+					put_telx_stuffing(&es_data);
+			}
+			pes.len = 0;
+			put_pes_header(&pes, 0xbd, es_data.len, pts, 31);
+		}
+		else
+		{
+			if (off != 0 && off != SUBTITLE_SHOWN)
+				continue;
+			put_dvb_display_set(&es_data, idx, off == 0);
+			pes.len = 0;
+			put_pes_header(&pes, 0xbd, es_data.len, pts, 0);
+		}
+		put_bytes(&pes, es_data.data, es_data.len);
+		ts_put(w, PID_VIDEO + 1, pes.data, pes.len, 1, -1);
+	}
+
+	*units = w->packets;
+	ret = w->error ? -1 : 0;
+	free(pes.data);
+	free(es_data.data);
+	free(slice);
+	free(w);
+	return ret;
+}
+
+int gen_ts_teletext(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_ts_sub(f, p, units, SUB_TELETEXT);
+}
+
+int gen_ts_dvb(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_ts_sub(f, p, units, SUB_DVB);
+}
+
+/*------------------------------------------------------------------------*/
+/* MP4 with a QuickTime closed caption track or an H.264 video track      */
+/*------------------------------------------------------------------------*/
+
+#define MP4_CHUNK_FRAMES 15 // Samples per chunk of the H.264 track, half a second
+
+static size_t box_start(struct gbuf *b, const char *type)
+{
+	size_t start = b->len;
+	put32(b, 0);
+	put_bytes(b, type, 4);
+	return start;
+}
+
+static void box_end(struct gbuf *b, size_t start)
+{
+	patch32(b, start, b->len - start);
+}
+
+static size_t full_box_start(struct gbuf *b, const char *type, uint32_t flags)
+{
+	size_t start = box_start(b, type);
+	put32(b, flags);
+	return start;
+}
+
+static void put_matrix(struct gbuf *b)
+{
+	static const uint32_t unity[9] = { 0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000 };
+	for (int i = 0; i < 9; i++)
+		put32(b, unity[i]);
+}
+
+/* The one track of an MP4 file, 29.97 fps, a sample per frame */
+struct mp4_track
+{
+	const char *brand;
+	const char *handler;
+	const char *handler_name;
+	int video;                 // vmhd and the visual sample entry fields, else nmhd
+	const char *entry_type;
+	struct gbuf entry_boxes;   // Boxes at the end of the sample entry
+	uint32_t frames;
+	uint32_t *sizes;           // Size of every sample, NULL if they are all of mdat.len / frames
+	uint32_t chunk_frames;     // Samples per chunk
+	int fragmented;            // Empty sample tables, a moof and an mdat per chunk
+	struct gbuf mdat;
+};
+
+static uint32_t mp4_sample_size(const struct mp4_track *t, uint32_t n)
+{
+	return t->sizes ? t->sizes[n] : t->mdat.len / t->frames;
+}
+
+/* The moof for the samples first to first + count - 1 and the header of
+ * their mdat.
+ *
+ * @return the size of the samples */
+static uint32_t put_fragment(struct gbuf *b, const struct mp4_track *t, uint32_t first, uint32_t count)
+{
+	size_t moof = box_start(b, "moof"), traf, box, data_offset;
+	uint32_t len = 0;
+
+	box = full_box_start(b, "mfhd", 0);
+	put32(b, first / t->chunk_frames + 1); // sequence_number
+	box_end(b, box);
+	traf = box_start(b, "traf");
+	box = full_box_start(b, "tfhd", 0x020000); // default_base_is_moof
+	put32(b, 1);
+	box_end(b, box);
+	box = full_box_start(b, "tfdt", 0x01000000);
+	put32(b, 0);
+	put32(b, first * 1001);
+	box_end(b, box);
+	box = full_box_start(b, "trun", 0x000201); // data_offset, sample_size
+	put32(b, count);
+	data_offset = b->len;
+	put32(b, 0);
+	for (uint32_t n = first; n < first + count; n++)
+	{
+		put32(b, mp4_sample_size(t, n));
+		len += mp4_sample_size(t, n);
+	}
+	box_end(b, box);
+	box_end(b, traf);
+	box_end(b, moof);
+	patch32(b, data_offset, b->len - moof + 8);
+
+	put32(b, 8 + len);
+	put_bytes(b, "mdat", 4);
+	return len;
+}
+
+static int write_mp4(FILE *f, struct mp4_track *t)
+{
+	struct gbuf head = { 0 };
+	uint32_t duration = t->frames * 1001;
+	uint32_t chunks = t->frames && !t->fragmented ? (t->frames + t->chunk_frames - 1) / t->chunk_frames : 0;
+	uint32_t frames = t->fragmented ? 0 : t->frames; // In the sample tables
+	size_t moov, trak, mdia, minf, stbl, box, stco;
+	int ret = 0;
+
+	box = box_start(&head, "ftyp");
+	put_bytes(&head, t->brand, 4);
+	put32(&head, 0x200);
+	put_bytes(&head, t->brand, 4);
+	box_end(&head, box);
+
+	moov = box_start(&head, "moov");
+	box = full_box_start(&head, "mvhd", 0);
+	put32(&head, 0);
+	put32(&head, 0);
+	put32(&head, 30000);
+	put32(&head, duration);
+	put32(&head, 0x10000);
+	put16(&head, 0x100);
+	put_fill(&head, 0, 10);
+	put_matrix(&head);
+	put_fill(&head, 0, 24);
+	put32(&head, 2); // next_track_ID
+	box_end(&head, box);
+
+	trak = box_start(&head, "trak");
+	box = full_box_start(&head, "tkhd", 0x7);
+	put32(&head, 0);
+	put32(&head, 0);
+	put32(&head, 1); // track_ID
+	put32(&head, 0);
+	put32(&head, duration);
+	put_fill(&head, 0, 8);
+	put16(&head, 0);
+	put16(&head, 0);
+	put16(&head, 0);
+	put16(&head, 0);
+	put_matrix(&head);
+	put32(&head, t->video ? 1920 << 16 : 0);
+	put32(&head, t->video ? 1080 << 16 : 0);
+	box_end(&head, box);
+
+	mdia = box_start(&head, "mdia");
+	box = full_box_start(&head, "mdhd", 0);
+	put32(&head, 0);
+	put32(&head, 0);
+	put32(&head, 30000);
+	put32(&head, duration);
+	put16(&head, 0x55c4); // und
+	put16(&head, 0);
+	box_end(&head, box);
+	box = full_box_start(&head, "hdlr", 0);
+	put32(&head, 0);
+	put_bytes(&head, t->handler, 4);
+	put_fill(&head, 0, 12);
+	put_bytes(&head, t->handler_name, strlen(t->handler_name) + 1);
+	box_end(&head, box);
+
+	minf = box_start(&head, "minf");
+	if (t->video)
+	{
+		box = full_box_start(&head, "vmhd", 1);
+		put_fill(&head, 0, 8);
+	}
+	else
+		box = full_box_start(&head, "nmhd", 0);
+	box_end(&head, box);
+	box = box_start(&head, "dinf");
+	{
+		size_t dref = full_box_start(&head, "dref", 0), url;
+		put32(&head, 1);
+		url = full_box_start(&head, "url ", 1); // Self contained
+		box_end(&head, url);
+		box_end(&head, dref);
+	}
+	box_end(&head, box);
+
+	stbl = box_start(&head, "stbl");
+	box = full_box_start(&head, "stsd", 0);
+	put32(&head, 1);
+	{
+		size_t entry = box_start(&head, t->entry_type);
+		put_fill(&head, 0, 6);
+		put16(&head, 1); // data_reference_index
+		if (t->video)
+		{
+			put_fill(&head, 0, 16);
+			put16(&head, 1920);
+			put16(&head, 1080);
+			put32(&head, 0x480000); // 72 dpi
+			put32(&head, 0x480000);
+			put32(&head, 0);
+			put16(&head, 1); // frame_count
+			put_fill(&head, 0, 32); // compressorname
+			put16(&head, 0x18); // depth
+			put16(&head, 0xffff);
+		}
+		put_bytes(&head, t->entry_boxes.data, t->entry_boxes.len);
+		box_end(&head, entry);
+	}
+	box_end(&head, box);
+	box = full_box_start(&head, "stts", 0);
+	put32(&head, frames ? 1 : 0);
+	if (frames)
+	{
+		put32(&head, frames);
+		put32(&head, 1001);
+	}
+	box_end(&head, box);
+	box = full_box_start(&head, "stsc", 0);
+	put32(&head, frames ? 1 : 0);
+	if (frames)
+	{
+		put32(&head, 1);
+		put32(&head, t->chunk_frames);
+		put32(&head, 1);
+	}
+	box_end(&head, box);
+	box = full_box_start(&head, "stsz", 0);
+	put32(&head, t->sizes || !frames ? 0 : t->mdat.len / frames);
+	put32(&head, frames);
+	for (uint32_t n = 0; t->sizes && n < frames; n++)
+		put32(&head, t->sizes[n]);
+	box_end(&head, box);
+	box = full_box_start(&head, "stco", 0);
+	put32(&head, chunks);
+	stco = head.len;
+	put_fill(&head, 0, chunks * 4);
+	box_end(&head, box);
+	box_end(&head, stbl);
+	box_end(&head, minf);
+	box_end(&head, mdia);
+	box_end(&head, trak);
+	if (t->fragmented)
+	{
+		size_t mvex = box_start(&head, "mvex");
+		box = full_box_start(&head, "trex", 0);
+		put32(&head, 1); // track_ID
+		put32(&head, 1); // default_sample_description_index
+		put32(&head, 1001); // default_sample_duration
+		put32(&head, 0);
+		put32(&head, 0);
+		box_end(&head, box);
+		box_end(&head, mvex);
+	}
+	box_end(&head, moov);
+
+	if (t->fragmented)
+	{
+		size_t data = 0;
+		for (uint32_t n = 0; n < t->frames && ret == 0; n += t->chunk_frames)
+		{
+			uint32_t count = t->frames - n < t->chunk_frames ? t->frames - n : t->chunk_frames;
+			uint32_t len = put_fragment(&head, t, n, count);
+			if (fwrite(head.data, head.len, 1, f) != 1 || (len && fwrite(t->mdat.data + data, len, 1, f) != 1))
+				ret = -1;
+			data += len;
+			head.len = 0;
+		}
+		if (ret == 0 && head.len && fwrite(head.data, head.len, 1, f) != 1)
+			ret = -1;
+		free(head.data);
+		return ret;
+	}
+
+	// The chunks follow each other in mdat
+	{
+		uint32_t offset = head.len + 8;
+		for (uint32_t n = 0; n < t->frames; n++)
+		{
+			if (n % t->chunk_frames == 0)
+				patch32(&head, stco + n / t->chunk_frames * 4, offset);
+			offset += mp4_sample_size(t, n);
+		}
+	}
+	put32(&head, 8 + t->mdat.len);
+	put_bytes(&head, "mdat", 4);
+
+	if (fwrite(head.data, head.len, 1, f) != 1 || (t->mdat.len && fwrite(t->mdat.data, t->mdat.len, 1, f) != 1))
+		ret = -1;
+	free(head.data);
+	return ret;
+}
+
+/* CEA-708 caption distribution packet of 20 triplets, for 29.97 fps */
+static void put_cdp(struct gbuf *b, int frame, int with_608, struct dtvcc_gen *g)
+{
+	uint8_t cc[20 * 3];
+	size_t cdp = b->len;
+	uint8_t sum = 0;
+
+	dtvcc_frame(g, frame);
+	cc_data_frame(cc, 20, frame, with_608, g);
+	put16(b, 0x9669);
+	put8(b, 0); // cdp_length
+	put8(b, (4 << 4) | 0xf); // 29.97 fps
+	put8(b, 0x43); // ccdata_present, caption_service_active
+	put16(b, frame & 0xffff);
+	put8(b, 0x72);
+	put8(b, 0xe0 | 20);
+	put_bytes(b, cc, sizeof(cc));
+	put8(b, 0x74);
+	put16(b, frame & 0xffff);
+	b->data[cdp + 2] = b->len - cdp + 1;
+	for (size_t i = cdp; i < b->len; i++)
+		sum += b->data[i];
+	put8(b, -sum);
+}
+
+/* One sample per frame at 29.97 fps */
+static void put_clcp_sample(struct gbuf *b, int frame, int c708, struct dtvcc_gen *g)
+{
+	if (!c708)
+	{
+		uint8_t pair[2];
+		size_t start = box_start(b, "cdat");
+		cc608_pair(frame, pair);
+		put_bytes(b, pair, 2);
+		box_end(b, start);
+	}
+	else
+	{
+		size_t start = box_start(b, "ccdp");
+		put_cdp(b, frame, 0, g);
+		box_end(b, start);
+	}
+}
+
+
+static int gen_mp4_clcp(FILE *f, const struct gen_params *p, uint64_t *units, int c708, int fragmented)
+{
+	struct mp4_track t = { "qt  ", "clcp", "Closed Caption", 0, c708 ? "c708" : "c608" };
+	struct dtvcc_gen dtvcc = { { 0 } };
+	int ret;
+
+	t.frames = p->seconds * 30;
+	t.chunk_frames = t.frames ? t.frames : 1; // All in one chunk
+	if (fragmented)
+	{
+		t.fragmented = 1;
+		t.chunk_frames = MP4_CHUNK_FRAMES;
+	}
+	for (uint32_t n = 0; n < t.frames; n++)
+		put_clcp_sample(&t.mdat, n, c708, &dtvcc);
+
+	ret = write_mp4(f, &t);
+	*units = t.frames;
+	free(t.mdat.data);
+	return ret;
+}
+
+int gen_mp4_c608(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_clcp(f, p, units, 0, 0);
+}
+
+int gen_mp4_c708(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_clcp(f, p, units, 1, 0);
+}
+
+int gen_fmp4_c608(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_clcp(f, p, units, 0, 1);
+}
+
+int gen_fmp4_c708(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_clcp(f, p, units, 1, 1);
+}
+
+/* Replace the 4 byte start codes of the NAL units put_nal() wrote from start
+ * on by their length. The emulation prevention bytes keep 00 00 01 out of
+ * the NAL units. */
+static void annexb_to_length_prefixed(struct gbuf *b, size_t start)
+{
+	size_t prev = start;
+
+	for (size_t i = start + 4; i + 3 <= b->len; i++)
+	{
+		if (b->data[i] == 0 && b->data[i + 1] == 0 && b->data[i + 2] == 1)
+		{
+			// Part of the 4 byte start code at i - 1
+			patch32(b, prev, i - 1 - prev - 4);
+			prev = i - 1;
+			i += 2;
+		}
+	}
+	patch32(b, prev, b->len - prev - 4);
+}
+
+/* avcC with the SPS and PPS put_avc_sps() writes, 4 byte NAL unit lengths */
+static void put_avcc(struct gbuf *b)
+{
+	struct gbuf ps = { 0 }, rbsp = { 0 };
+	size_t box = box_start(b, "avcC"), sps_len, pps;
+
+	put_avc_sps(&ps, &rbsp);
+	annexb_to_length_prefixed(&ps, 0);
+	sps_len = (ps.data[0] << 24) | (ps.data[1] << 16) | (ps.data[2] << 8) | ps.data[3];
+	pps = 4 + sps_len;
+
+	put8(b, 1); // configurationVersion
+	put_bytes(b, ps.data + 5, 3); // profile, constraint flags and level from the SPS
+	put8(b, 0xfc | 3); // lengthSizeMinusOne
+	put8(b, 0xe0 | 1);
+	put16(b, sps_len);
+	put_bytes(b, ps.data + 4, sps_len);
+	put8(b, 1);
+	put16(b, ps.len - pps - 4);
+	put_bytes(b, ps.data + pps + 4, ps.len - pps - 4);
+	box_end(b, box);
+	free(ps.data);
+	free(rbsp.data);
+}
+
+static int gen_mp4_avc(FILE *f, const struct gen_params *p, uint64_t *units, int fragmented)
+{
+	struct mp4_track t = { "isom", "vide", "Video", 1, "avc1" };
+	struct gbuf rbsp = { 0 };
+	uint8_t cc[31 * 3];
+	uint8_t *slice = make_slice_data(p->avc_size, 3);
+	int ret = -1;
+
+	t.frames = p->seconds * 30;
+	t.chunk_frames = MP4_CHUNK_FRAMES;
+	t.fragmented = fragmented;
+	t.sizes = malloc((t.frames ? t.frames : 1) * sizeof(uint32_t));
+	if (!t.sizes)
+		goto end;
+	put_avcc(&t.entry_boxes);
+	for (uint32_t n = 0; n < t.frames; n++)
+	{
+		size_t start = t.mdat.len;
+
+		cc_data_frame(cc, p->cc_count, n, 1, NULL);
+		put_avc_frame(&t.mdat, &rbsp, n, cc, p->cc_count, slice, p->avc_size);
+		annexb_to_length_prefixed(&t.mdat, start);
+		t.sizes[n] = t.mdat.len - start;
+	}
+
+	ret = write_mp4(f, &t);
+	*units = t.frames;
+end:
+	free(t.sizes);
+	free(t.entry_boxes.data);
+	free(t.mdat.data);
+	free(rbsp.data);
+	free(slice);
+	return ret;
+}
+
+int gen_mp4_h264(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_avc(f, p, units, 0);
+}
+
+int gen_fmp4_h264(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	return gen_mp4_avc(f, p, units, 1);
+}
+
+/*------------------------------------------------------------------------*/
+/* MXF OP1a, frame wrapped picture and SMPTE 436 ANC with CEA-708 CDPs    */
+/*------------------------------------------------------------------------*/
+
+#define MXF_SEGMENT_UNITS 4000 // Index entries of a segment, under the 64 KB of a local set item
+#define MXF_ENTRY_SIZE 15      // Index entry with one slice offset
+#define MXF_GOP 30             // Larger picture every second
+
+static const uint8_t mxf_partition_key[16] = { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x02,0x04,0x00 };
+static const uint8_t mxf_primer_key[16]    = { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x05,0x01,0x00 };
+static const uint8_t mxf_track_key[16]     = { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x01,0x01,0x01,0x01,0x3b,0x00 };
+static const uint8_t mxf_vanc_desc_key[16] = { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x01,0x01,0x01,0x01,0x5c,0x00 };
+static const uint8_t mxf_index_key[16]     = { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x10,0x01,0x00 };
+static const uint8_t mxf_rip_key[16]       = { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x11,0x01,0x00 };
+static const uint8_t mxf_element_key[16]   = { 0x06,0x0e,0x2b,0x34,0x01,0x02,0x01,0x01,0x0d,0x01,0x03,0x01,0x00,0x00,0x00,0x00 };
+static const uint8_t mxf_op1a_ul[16]       = { 0x06,0x0e,0x2b,0x34,0x04,0x01,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x01,0x09,0x00 };
+static const uint8_t mxf_mpeg_ec_ul[16]    = { 0x06,0x0e,0x2b,0x34,0x04,0x01,0x01,0x02,0x0d,0x01,0x03,0x01,0x02,0x04,0x60,0x01 };
+static const uint8_t mxf_anc_ec_ul[16]     = { 0x06,0x0e,0x2b,0x34,0x04,0x01,0x01,0x09,0x0d,0x01,0x03,0x01,0x02,0x0e,0x00,0x00 };
+static const uint8_t mxf_picture_track[4]  = { 0x15,0x01,0x05,0x01 };
+static const uint8_t mxf_anc_track[4]      = { 0x17,0x01,0x02,0x01 };
+
+enum mxf_partition_kind
+{
+	MXF_HEADER = 0x02,
+	MXF_BODY = 0x03,
+	MXF_FOOTER = 0x04,
+};
+
+struct mxf_partition
+{
+	enum mxf_partition_kind kind;
+	uint64_t this_partition;
+	uint64_t previous;
+	uint64_t footer;
+	uint64_t header_bytes;
+	uint64_t index_bytes;
+	uint32_t index_sid;
+	uint32_t body_sid;
+};
+
+static void put64(struct gbuf *b, uint64_t v)
+{
+	put32(b, v >> 32);
+	put32(b, v);
+}
+
+/* Key and a 4 byte BER length, set by mxf_klv_end() */
+static size_t mxf_klv_start(struct gbuf *b, const uint8_t *key, const uint8_t *track)
+{
+	size_t start = b->len;
+	put_bytes(b, key, track ? 12 : 16);
+	if (track)
+		put_bytes(b, track, 4);
+	put32(b, 0x83000000);
+	return start;
+}
+
+static void mxf_klv_end(struct gbuf *b, size_t start)
+{
+	patch32(b, start + 16, 0x83000000 | (b->len - start - 20));
+}
+
+static void mxf_local_tag(struct gbuf *b, uint16_t tag, uint16_t len)
+{
+	put16(b, tag);
+	put16(b, len);
+}
+
+static void mxf_instance_uid(struct gbuf *b, int n)
+{
+	mxf_local_tag(b, 0x3c0a, 16);
+	put32(b, 0x4343582d); // CCX-
+	put_fill(b, 0, 8);
+	put32(b, n);
+}
+
+static void put_mxf_partition(struct gbuf *b, const struct mxf_partition *p)
+{
+	uint8_t key[16];
+	size_t klv;
+
+	memcpy(key, mxf_partition_key, 16);
+	key[13] = p->kind;
+	klv = mxf_klv_start(b, key, NULL);
+	put16(b, 1); // major_version
+	put16(b, 3);
+	put32(b, 1); // KAG size
+	put64(b, p->this_partition);
+	put64(b, p->previous);
+	put64(b, p->footer);
+	put64(b, p->header_bytes);
+	put64(b, p->index_bytes);
+	put32(b, p->index_sid);
+	put64(b, 0); // body_offset, the essence is in one body partition
+	put32(b, p->body_sid);
+	put_bytes(b, mxf_op1a_ul, 16);
+	put32(b, 2); // Essence containers
+	put32(b, 16);
+	put_bytes(b, mxf_mpeg_ec_ul, 16);
+	put_bytes(b, mxf_anc_ec_ul, 16);
+	mxf_klv_end(b, klv);
+}
+
+static void put_mxf_track(struct gbuf *b, int n, uint32_t track_id, const uint8_t *track_number)
+{
+	size_t klv = mxf_klv_start(b, mxf_track_key, NULL);
+	mxf_instance_uid(b, n);
+	mxf_local_tag(b, 0x4801, 4);
+	put32(b, track_id);
+	mxf_local_tag(b, 0x4804, 4);
+	put_bytes(b, track_number, 4);
+	mxf_local_tag(b, 0x4b01, 8); // Edit rate
+	put32(b, 30000);
+	put32(b, 1001);
+	mxf_local_tag(b, 0x4b02, 8); // Origin
+	put64(b, 0);
+	mxf_klv_end(b, klv);
+}
+
+/* Header metadata: the picture track and the ANC track with its descriptor.
+ * Only what ccextractor reads, no packages. */
+static void put_mxf_header_metadata(struct gbuf *b)
+{
+	size_t klv = mxf_klv_start(b, mxf_primer_key, NULL);
+	put32(b, 0);
+	put32(b, 18);
+	mxf_klv_end(b, klv);
+	put_mxf_track(b, 1, 1, mxf_picture_track);
+	put_mxf_track(b, 2, 2, mxf_anc_track);
+	klv = mxf_klv_start(b, mxf_vanc_desc_key, NULL);
+	mxf_instance_uid(b, 3);
+	mxf_local_tag(b, 0x3006, 4); // Linked track
+	put32(b, 2);
+	mxf_local_tag(b, 0x3001, 8); // Sample rate
+	put32(b, 30000);
+	put32(b, 1001);
+	mxf_local_tag(b, 0x3004, 16);
+	put_bytes(b, mxf_anc_ec_ul, 16);
+	mxf_klv_end(b, klv);
+}
+
+static uint32_t mxf_picture_size(const struct gen_params *p, uint32_t n)
+{
+	return p->avc_size + (n % MXF_GOP ? (n % 7) * 64 : 2 * p->avc_size);
+}
+
+/* SMPTE 436 ANC element, one VANC packet with a CDP */
+static void put_mxf_anc(struct gbuf *b, int frame, struct dtvcc_gen *g)
+{
+	size_t klv = mxf_klv_start(b, mxf_element_key, mxf_anc_track), array, payload;
+
+	put16(b, 1); // Packets
+	put16(b, 9); // Line
+	put8(b, 1); // VANC frame
+	put8(b, 4); // 8 bit luma samples
+	put16(b, 0); // Sample count
+	array = b->len;
+	put32(b, 0); // Array count
+	put32(b, 1); // Array element size
+	payload = b->len;
+	put8(b, 0x61); // DID
+	put8(b, 0x01); // SDID, CEA-708
+	put8(b, 0); // Data count
+	put_cdp(b, frame, 1, g);
+	b->data[payload + 2] = b->len - payload - 3;
+	patch16(b, array - 2, b->len - payload);
+	patch32(b, array, b->len - payload);
+	while ((b->len - payload) % 4)
+		put8(b, 0);
+	mxf_klv_end(b, klv);
+}
+
+/* Index table segment for the frames first to first + count - 1: the ANC
+ * element is in slice 1, after the picture of variable size */
+static void put_mxf_index(struct gbuf *b, int n, uint32_t first, uint32_t count, const uint64_t *offsets,
+		const uint32_t *picture_klv)
+{
+	size_t klv = mxf_klv_start(b, mxf_index_key, NULL);
+
+	mxf_instance_uid(b, n);
+	mxf_local_tag(b, 0x3f0b, 8); // Index edit rate
+	put32(b, 30000);
+	put32(b, 1001);
+	mxf_local_tag(b, 0x3f0c, 8); // Index start position
+	put64(b, first);
+	mxf_local_tag(b, 0x3f0d, 8); // Index duration
+	put64(b, count);
+	mxf_local_tag(b, 0x3f05, 4); // Edit unit byte count, 0 for variable
+	put32(b, 0);
+	mxf_local_tag(b, 0x3f06, 4); // Index SID
+	put32(b, 1);
+	mxf_local_tag(b, 0x3f07, 4); // Body SID
+	put32(b, 1);
+	mxf_local_tag(b, 0x3f08, 1); // Slice count
+	put8(b, 1);
+	mxf_local_tag(b, 0x3f0e, 1); // Pos table count
+	put8(b, 0);
+	mxf_local_tag(b, 0x3f09, 8 + 2 * 6); // Delta entries: picture, then ANC at the start of slice 1
+	put32(b, 2);
+	put32(b, 6);
+	put8(b, 0);
+	put8(b, 0);
+	put32(b, 0);
+	put8(b, 0);
+	put8(b, 1);
+	put32(b, 0);
+	mxf_local_tag(b, 0x3f0a, 8 + count * MXF_ENTRY_SIZE);
+	put32(b, count);
+	put32(b, MXF_ENTRY_SIZE);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		put8(b, 0); // Temporal offset
+		put8(b, -(int) (i % MXF_GOP)); // Key frame offset
+		put8(b, i % MXF_GOP ? 0x22 : 0xc0); // P or I frame
+		put64(b, offsets[i]);
+		put32(b, picture_klv[i]); // Slice 1
+	}
+	mxf_klv_end(b, klv);
+}
+
+int gen_mxf_anc(FILE *f, const struct gen_params *p, uint64_t *units)
+{
+	struct gbuf b = { 0 };
+	struct dtvcc_gen dtvcc = { { 0 } };
+	struct mxf_partition header = { MXF_HEADER }, body = { MXF_BODY }, footer = { MXF_FOOTER };
+	uint32_t frames = p->seconds * 30;
+	uint64_t *offsets = malloc((frames + 1) * sizeof(uint64_t));
+	uint32_t *picture_klv = malloc((frames + 1) * sizeof(uint32_t));
+	uint8_t *picture = make_payload(3 * p->avc_size + 7 * 64, 5);
+	size_t metadata, rip;
+	int ret = 0;
+
+	if (!offsets || !picture_klv)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+
+	// The content packages, written as they come, are measured first to
+	// know where the footer goes
+	offsets[0] = 0;
+	for (uint32_t n = 0; n < frames; n++)
+	{
+		size_t start = b.len;
+		put_mxf_anc(&b, n, &dtvcc);
+		picture_klv[n] = 20 + mxf_picture_size(p, n);
+		offsets[n + 1] = offsets[n] + picture_klv[n] + b.len - start;
+	}
+	b.len = 0;
+	memset(&dtvcc, 0, sizeof(dtvcc));
+
+	put_mxf_partition(&b, &header);
+	metadata = b.len;
+	put_mxf_header_metadata(&b);
+	header.header_bytes = b.len - metadata;
+	body.this_partition = b.len;
+	body.body_sid = 1;
+	put_mxf_partition(&b, &body);
+	footer.previous = body.this_partition;
+	footer.this_partition = footer.footer = b.len + offsets[frames];
+	header.footer = body.footer = footer.footer;
+	b.len = 0;
+	put_mxf_partition(&b, &header);
+	put_mxf_header_metadata(&b);
+	put_mxf_partition(&b, &body);
+
+	for (uint32_t n = 0; n < frames && ret == 0; n++)
+	{
+		size_t klv = mxf_klv_start(&b, mxf_element_key, mxf_picture_track);
+		put_bytes(&b, picture, mxf_picture_size(p, n));
+		mxf_klv_end(&b, klv);
+		put_mxf_anc(&b, n, &dtvcc);
+		if (fwrite(b.data, b.len, 1, f) != 1)
+			ret = -1;
+		b.len = 0;
+	}
+
+	{
+		struct gbuf index = { 0 };
+		for (uint32_t n = 0; n < frames; n += MXF_SEGMENT_UNITS)
+			put_mxf_index(&index, 4 + n / MXF_SEGMENT_UNITS, n,
+					frames - n < MXF_SEGMENT_UNITS ? frames - n : MXF_SEGMENT_UNITS, offsets, picture_klv);
+		footer.index_bytes = index.len;
+		footer.index_sid = 1;
+		put_mxf_partition(&b, &footer);
+		put_bytes(&b, index.data, index.len);
+		free(index.data);
+	}
+
+	// Random index pack: body SID and offset of every partition
+	rip = mxf_klv_start(&b, mxf_rip_key, NULL);
+	put32(&b, 0);
+	put64(&b, 0);
+	put32(&b, 1);
+	put64(&b, body.this_partition);
+	put32(&b, 0);
+	put64(&b, footer.this_partition);
+	put32(&b, b.len - rip + 4);
+	mxf_klv_end(&b, rip);
+	if (ret == 0 && fwrite(b.data, b.len, 1, f) != 1)
+		ret = -1;
+
+	*units = frames;
+	free(b.data);
+	free(offsets);
+	free(picture_klv);
+	free(picture);
+	return ret;
+}
@@ -0,0 +1,44 @@
+#ifndef GEN_STREAMS_H
+#define GEN_STREAMS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Deterministic synthetic inputs for the benchmark. The same parameters
+ * always give byte-identical files, so that numbers from different builds
+ * can be compared.
+ */
+struct gen_params
+{
+	int seconds;  // Duration of every stream
+	int pids;     // Elementary streams in the 608/708 transport streams, the first one has the captions
+	int cc_count; // cc_data triplets per video frame (1-31), the first one is 608 field 1, the rest 708
+	int video_size; // Bytes of slice data per video frame
+	int avc_size; // Bytes of slice data per H.264 frame, and of an MXF picture element
+};
+
+/**
+ * Write one stream to f.
+ *
+ * @param units set to the number of demuxer units written: transport stream
+ *              packets, MP4 samples or MXF frames.
+ *
+ * @return 0 on success, -1 on write error.
+ */
+typedef int (*gen_stream_fn)(FILE *f, const struct gen_params *p, uint64_t *units);
+
+int gen_ts_608(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_ts_708(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_ts_h264(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_ts_teletext(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_ts_dvb(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_mp4_c608(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_mp4_c708(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_mp4_h264(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_fmp4_c608(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_fmp4_c708(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_fmp4_h264(FILE *f, const struct gen_params *p, uint64_t *units);
+int gen_mxf_anc(FILE *f, const struct gen_params *p, uint64_t *units);
+
+#endif
@@ -0,0 +1,138 @@
+/* Microbenchmark of the teletext error protection decoding in
+ * src/lib_ccx/hamming.c, against the byte at a time code it replaced.
+ *
+ * Every 24/18 triplet and every byte is checked to decode the same before
+ * anything is timed, the exit code is 1 if one doesn't.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "hamming.h"
+
+#define ROUNDS 200
+#define BUF_SIZE (42 * 1024) // 1024 teletext packets
+
+// Former unham_24_18() of telxcc.c
+static uint32_t unham_24_18_loop(uint32_t a)
+{
+	uint8_t test = 0;
+
+	for (uint8_t i = 0; i < 23; i++) test ^= ((a >> i) & 0x01) * (i + 33);
+	test ^= ((a >> 23) & 0x01) * 32;
+
+	if ((test & 0x1f) != 0x1f)
+	{
+		if ((test & 0x20) == 0x20)
+			return 0xffffffff;
+		a ^= 1 << (30 - test);
+	}
+
+	return (a & 0x000004) >> 2 | (a & 0x000070) >> 3 | (a & 0x007f00) >> 4 | (a & 0x7f0000) >> 5;
+}
+
+// Parity check of telx_to_ucs2() a byte at a time
+static int odd_parity_bytes(const uint8_t *in, uint8_t *out, size_t n)
+{
+	int errors = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (PARITY_8[in[i]] == 0)
+		{
+			out[i] = PARITY_ERROR;
+			errors++;
+		}
+		else
+			out[i] = in[i] & 0x7f;
+	}
+	return errors;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check(void)
+{
+	uint8_t in[256], a[256], b[256];
+	int bad = 0;
+
+	for (uint32_t t = 0; t < (1 << 24); t++)
+	{
+		if (unham_24_18(t) != unham_24_18_loop(t))
+		{
+			fprintf(stderr, "unham_24_18(%06x): %08x, expected %08x\n", t, unham_24_18(t), unham_24_18_loop(t));
+			bad = 1;
+			break;
+		}
+	}
+	for (int i = 0; i < 256; i++)
+		in[i] = i;
+	// Odd lengths to go through the tail of the SIMD version
+	for (size_t n = 1; n <= 256; n += 7)
+	{
+		if (odd_parity_block(in, a, n) != odd_parity_bytes(in, b, n) || memcmp(a, b, n))
+		{
+			fprintf(stderr, "odd_parity_block() differs for %zu bytes\n", n);
+			bad = 1;
+			break;
+		}
+	}
+	return bad;
+}
+
+int main(void)
+{
+	uint8_t *in = malloc(BUF_SIZE), *out = malloc(BUF_SIZE);
+	uint32_t *triplets = malloc(BUF_SIZE / 3 * sizeof(uint32_t));
+	volatile uint32_t sink = 0;
+	double t, loop_s, table_s, bytes_s, block_s;
+	int r;
+
+	if (!in || !out || !triplets)
+		return 2;
+	if (check())
+		return 1;
+
+	srand(1);
+	for (int i = 0; i < BUF_SIZE; i++)
+		in[i] = rand();
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (int i = 0; i + 3 <= BUF_SIZE; i += 3)
+			sink += unham_24_18_loop((in[i + 2] << 16) | (in[i + 1] << 8) | in[i]);
+	loop_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		sink += unham_24_18_block(in, triplets, BUF_SIZE / 3);
+	table_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		sink += odd_parity_bytes(in, out, BUF_SIZE) + out[r];
+	bytes_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		sink += odd_parity_block(in, out, BUF_SIZE) + out[r];
+	block_s = now() - t;
+
+	printf("{\n");
+	printf("  \"unham_24_18_loop_mtriplets_per_s\": %.1f,\n", ROUNDS * (BUF_SIZE / 3) / loop_s / 1e6);
+	printf("  \"unham_24_18_table_mtriplets_per_s\": %.1f,\n", ROUNDS * (BUF_SIZE / 3) / table_s / 1e6);
+	printf("  \"parity_bytes_mb_per_s\": %.1f,\n", ROUNDS * (double) BUF_SIZE / bytes_s / 1e6);
+	printf("  \"parity_block_mb_per_s\": %.1f\n", ROUNDS * (double) BUF_SIZE / block_s / 1e6);
+	printf("}\n");
+
+	free(in);
+	free(out);
+	free(triplets);
+	return sink == 0x12345678; // Keeps sink alive
+}
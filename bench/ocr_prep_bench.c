@@ -0,0 +1,277 @@
+/* Microbenchmark of the preparation of DVB bitmaps for OCR in
+ * src/lib_ccx/ocr_prep.c, against what ocr_bitmap() did before: 32 bpp
+ * images of the quantized and unquantized bitmaps, the crop searched a
+ * column at a time on both, the histogram of quantize_map(), the copy of the
+ * bitmap and the gray conversion of the crop.
+ *
+ * Bitmaps of many sizes are checked to give the same crop and gray image
+ * before anything is timed, the exit code is 1 if one doesn't.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "ocr_prep.h"
+
+#define ROUNDS 200
+#define WIDTH 1920 // HD region with two lines of text
+#define HEIGHT 160
+
+struct bitmap
+{
+	int w, h, nb_colors;
+	uint8_t *data;
+	uint8_t rgb[256 * 3];
+	uint8_t alpha[256];
+};
+
+struct former_out
+{
+	int x, y, w, h;
+	uint8_t *gray; // w * h
+};
+
+// composeRGBPixel() and SET_DATA_BYTE(L_ALPHA_CHANNEL) of Leptonica
+static void expand(const struct bitmap *b, uint32_t *pix)
+{
+	for (int i = 0; i < b->w * b->h; i++)
+	{
+		const uint8_t *c = b->rgb + 3 * b->data[i];
+		pix[i] = ((uint32_t) c[0] << 24) | (c[1] << 16) | (c[2] << 8) | b->alpha[b->data[i]];
+	}
+}
+
+// Former ignore_alpha_at_edge()
+static void crop_columns(const struct bitmap *b, int *x, int *w)
+{
+	int start_y = 0, end_y = 0, found = 0;
+
+	for (int j = 1; j < b->w - 1; j++)
+		for (int i = 0; i < b->h; i++)
+			if (b->alpha[b->data[i * b->w + j]] != 0)
+			{
+				if (!found)
+				{
+					start_y = j;
+					found = 1;
+				}
+				else
+					end_y = j;
+			}
+	*x = start_y;
+	*w = end_y - start_y;
+}
+
+static void former(const struct bitmap *b, uint32_t *pix, uint32_t *color_pix, uint8_t *copy,
+		uint32_t *histogram, struct former_out *out)
+{
+	int cx, cw;
+
+	memcpy(copy, b->data, b->w * b->h);
+	memset(histogram, 0, 256 * sizeof(uint32_t));
+	for (int i = 0; i < b->w * b->h; i++)
+		histogram[b->data[i]]++;
+	expand(b, pix);
+	crop_columns(b, &out->x, &out->w);
+	expand(b, color_pix);
+	crop_columns(b, &cx, &cw);
+	out->y = 0;
+	out->h = b->h - 1;
+	if (out->w <= 0 || out->h <= 0)
+	{
+		out->w = out->h = 0;
+		return;
+	}
+	// pixClipRectangle() then pixConvertRGBToGray(pix, 0, 0, 0)
+	for (int i = 0; i < out->h; i++)
+		for (int j = 0; j < out->w; j++)
+		{
+			uint32_t p = pix[i * b->w + out->x + j];
+			out->gray[i * out->w + j] = (int) (0.3f * (p >> 24) + 0.5f * ((p >> 16) & 0xff) + 0.2f * ((p >> 8) & 0xff) + 0.5);
+		}
+	histogram[cx & 0xff] += cw & 1; // Keeps the second crop alive
+}
+
+static void prepare(struct ocr_prep *prep, const struct bitmap *b, struct ocr_prep_crop *crop, const uint8_t **gray)
+{
+	struct ocr_prep_crop crop_points;
+	uint8_t lut[256];
+
+	ocr_prep_scan(prep, b->data, b->w, b->h);
+	ocr_prep_crop(prep, b->alpha, b->nb_colors, crop);
+	ocr_prep_crop(prep, b->alpha, b->nb_colors, &crop_points);
+	ocr_prep_gray_lut(b->rgb, b->nb_colors, lut);
+	*gray = crop->w ? ocr_prep_gray(prep, b->data, lut, crop) : NULL;
+}
+
+// Text like bitmap: transparent background, filled strokes with an outline
+static void make_bitmap(struct bitmap *b, int w, int h, int nb_colors, unsigned seed)
+{
+	srand(seed);
+	b->w = w;
+	b->h = h;
+	b->nb_colors = nb_colors;
+	b->data = malloc(w * h);
+	for (int i = 0; i < nb_colors; i++)
+	{
+		b->rgb[3 * i] = rand();
+		b->rgb[3 * i + 1] = rand();
+		b->rgb[3 * i + 2] = rand();
+		b->alpha[i] = i ? 0xff : 0;
+	}
+	memset(b->data, 0, w * h);
+	for (int i = 0; i < h; i++)
+	{
+		for (int j = w / 8; j < w - w / 8; j++)
+		{
+			int stroke = ((j / 3) ^ (i / 5)) % 7;
+			if (stroke == 0)
+				b->data[i * w + j] = 1 % nb_colors;
+			else if (stroke < 3)
+				b->data[i * w + j] = (stroke + rand() % 2 * (nb_colors - 3)) % nb_colors;
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check(void)
+{
+	struct ocr_prep prep;
+	int bad = 0;
+
+	ocr_prep_init(&prep);
+	for (int w = 1; w <= 70 && !bad; w += 3)
+	{
+		for (int h = 1; h <= 9 && !bad; h += 2)
+		{
+			for (int colors = 4; colors <= 256 && !bad; colors *= 4)
+			{
+				struct bitmap b;
+				struct former_out out;
+				struct ocr_prep_crop crop;
+				const uint8_t *gray;
+				uint32_t *pix = malloc(w * h * sizeof(uint32_t)), *color_pix = malloc(w * h * sizeof(uint32_t));
+				uint32_t histogram[256];
+				uint8_t *copy = malloc(w * h);
+
+				make_bitmap(&b, w, h, colors, w * 100 + h);
+				// Some pixels alone in their column, to go through the odd crops
+				if (w > 4 && h > 2)
+					b.data[w + w / 3] = 2;
+				out.gray = malloc(w * h);
+				former(&b, pix, color_pix, copy, histogram, &out);
+				prepare(&prep, &b, &crop, &gray);
+
+				if (crop.x != out.x || crop.y != out.y || crop.w != out.w || crop.h != out.h)
+				{
+					fprintf(stderr, "%dx%d, %d colors: crop %d,%d %dx%d, expected %d,%d %dx%d\n", w, h, colors,
+							crop.x, crop.y, crop.w, crop.h, out.x, out.y, out.w, out.h);
+					bad = 1;
+				}
+				for (int i = 0; i < crop.h && !bad; i++)
+				{
+					for (int j = 0; j < crop.w; j++)
+					{
+						// 8 bpp PIX layout, GET_DATA_BYTE()
+						uint32_t word = ((const uint32_t *) (gray + i * prep.stride))[j / 4];
+						if (((word >> (24 - 8 * (j % 4))) & 0xff) != out.gray[i * out.w + j])
+						{
+							fprintf(stderr, "%dx%d, %d colors: gray differs at %d,%d\n", w, h, colors, j, i);
+							bad = 1;
+							break;
+						}
+					}
+				}
+				free(b.data);
+				free(out.gray);
+				free(pix);
+				free(color_pix);
+				free(copy);
+			}
+		}
+	}
+	ocr_prep_free(&prep);
+	return bad;
+}
+
+int main(void)
+{
+	struct bitmap b4, b256;
+	struct former_out out;
+	struct ocr_prep prep;
+	struct ocr_prep_crop crop;
+	const uint8_t *gray;
+	uint32_t *pix = malloc(WIDTH * HEIGHT * sizeof(uint32_t)), *color_pix = malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+	uint32_t histogram[256];
+	uint8_t *copy = malloc(WIDTH * HEIGHT);
+	volatile uint32_t sink = 0;
+	double t, former4_s, prep4_s, former256_s, prep256_s;
+	int r;
+
+	out.gray = malloc(WIDTH * HEIGHT);
+	if (!pix || !color_pix || !copy || !out.gray)
+		return 2;
+	if (check())
+		return 1;
+
+	make_bitmap(&b4, WIDTH, HEIGHT, 4, 1);
+	make_bitmap(&b256, WIDTH, HEIGHT, 256, 1);
+	ocr_prep_init(&prep);
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+	{
+		former(&b4, pix, color_pix, copy, histogram, &out);
+		sink += out.gray[r];
+	}
+	former4_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+	{
+		prepare(&prep, &b4, &crop, &gray);
+		sink += gray[r];
+	}
+	prep4_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+	{
+		former(&b256, pix, color_pix, copy, histogram, &out);
+		sink += out.gray[r];
+	}
+	former256_s = now() - t;
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+	{
+		prepare(&prep, &b256, &crop, &gray);
+		sink += gray[r];
+	}
+	prep256_s = now() - t;
+
+	printf("{\n");
+	printf("  \"bitmap\": \"%dx%d\",\n", WIDTH, HEIGHT);
+	printf("  \"former_4_colors_mpixels_per_s\": %.1f,\n", ROUNDS * (double) WIDTH * HEIGHT / former4_s / 1e6);
+	printf("  \"prep_4_colors_mpixels_per_s\": %.1f,\n", ROUNDS * (double) WIDTH * HEIGHT / prep4_s / 1e6);
+	printf("  \"former_256_colors_mpixels_per_s\": %.1f,\n", ROUNDS * (double) WIDTH * HEIGHT / former256_s / 1e6);
+	printf("  \"prep_256_colors_mpixels_per_s\": %.1f\n", ROUNDS * (double) WIDTH * HEIGHT / prep256_s / 1e6);
+	printf("}\n");
+
+	ocr_prep_free(&prep);
+	free(b4.data);
+	free(b256.data);
+	free(pix);
+	free(color_pix);
+	free(copy);
+	free(out.gray);
+	return sink == 0x12345678; // Keeps sink alive
+}
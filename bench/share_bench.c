@@ -0,0 +1,241 @@
+/* Loopback benchmark of the caption sharing publisher of
+ * src/lib_ccx/ccx_share.c: captions are published with ccx_share_send() and
+ * received by a subscriber thread of the same process, which checks them
+ * and measures the latency of each.
+ *
+ * The publisher writes the time a caption is sent in its start_time, in
+ * microseconds. Needs libnanomsg, see README.md.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <nanomsg/nn.h>
+#include <nanomsg/pubsub.h>
+#include "ccx_share.h"
+#include "ccx_common_option.h"
+
+struct ccx_s_options ccx_options;
+
+// What ccx_share.c needs from the rest of lib_ccx
+LLONG ccx_dbg_mask;
+
+void (dbg_print)(LLONG mask, const char *fmt, ...)
+{
+}
+
+void mprint(const char *fmt, ...)
+{
+}
+
+void fatal(int exit_code, const char *fmt, ...)
+{
+	fprintf(stderr, "fatal: %s", fmt);
+	exit(2);
+}
+
+void freep(void *arg)
+{
+	void **ptr = (void **) arg;
+	free(*ptr);
+	*ptr = NULL;
+}
+
+static const char *url = "tcp://127.0.0.1:3270";
+static int nb_messages = 100000;
+static int batch = 1;
+
+static int64_t now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct subscriber
+{
+	int sock;
+	long received;
+	long frames;
+	long bad;
+	int64_t first_us, last_us;
+	int64_t *latencies;
+};
+
+static int got_message(struct subscriber *s, const uint8_t *data, size_t len)
+{
+	CcxSubEntryMessage *msg = ccx_sub_entry_message__unpack(NULL, len, data);
+	int eos;
+
+	if (!msg)
+	{
+		s->bad++;
+		return 0;
+	}
+	eos = msg->eos;
+	if (!eos)
+	{
+		if (msg->n_lines != 2 || strcmp(msg->lines[1], "SECOND LINE OF THE CAPTION"))
+			s->bad++;
+		if (s->received < nb_messages)
+			s->latencies[s->received] = now_us() - msg->start_time;
+		s->received++;
+	}
+	ccx_sub_entry_message__free_unpacked(msg, NULL);
+	return eos;
+}
+
+static void *subscriber_main(void *arg)
+{
+	struct subscriber *s = arg;
+	int eos = 0;
+
+	while (!eos)
+	{
+		uint8_t *frame = NULL;
+		int len = nn_recv(s->sock, &frame, NN_MSG, 0);
+
+		if (len < 0)
+			break;
+		if (!s->frames++)
+			s->first_us = now_us();
+		if (batch == 1)
+			eos = got_message(s, frame, len);
+		else
+		{
+			// Messages after their length as a varint
+			for (int i = 0; i < len && !eos;)
+			{
+				uint32_t n = 0;
+				for (int shift = 0; i < len; shift += 7)
+				{
+					n |= (uint32_t) (frame[i] & 0x7f) << shift;
+					if (!(frame[i++] & 0x80))
+						break;
+				}
+				if (n > len - i)
+				{
+					s->bad++;
+					break;
+				}
+				eos = got_message(s, frame + i, n);
+				i += n;
+			}
+		}
+		nn_freemsg(frame);
+	}
+	s->last_us = now_us();
+	return NULL;
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	struct subscriber s;
+	struct eia608_screen *screens;
+	struct cc_subtitle sub;
+	pthread_t thread;
+	int64_t t, sent_us;
+	int timeout = 2000;
+	double avg = 0;
+
+	for (int i = 1; i < argc - 1; i += 2)
+	{
+		if (!strcmp(argv[i], "-n"))
+			nb_messages = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-b"))
+			batch = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-u"))
+			url = argv[i + 1];
+		else
+		{
+			fprintf(stderr, "Usage: %s [-n messages] [-b messages per frame] [-u url]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (nb_messages < 1 || batch < 1)
+		return 2;
+
+	memset(&ccx_options, 0, sizeof(ccx_options));
+	ccx_options.sharing_url = (char *) url;
+	ccx_options.sharing_batch = batch;
+	ccx_options.sharing_wait = 300;
+
+	memset(&s, 0, sizeof(s));
+	s.latencies = malloc(nb_messages * sizeof(int64_t));
+	s.sock = nn_socket(AF_SP, NN_SUB);
+	if (!s.latencies || s.sock < 0 || nn_setsockopt(s.sock, NN_SUB, NN_SUB_SUBSCRIBE, "", 0) < 0 ||
+			nn_setsockopt(s.sock, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+		return 2;
+
+	ccx_share_start("bench");
+	if (nn_connect(s.sock, url) < 0)
+		return 2;
+	pthread_create(&thread, NULL, subscriber_main, &s);
+
+	// A subtitle brings as many captions as fit in a message
+	screens = calloc(batch, sizeof(struct eia608_screen));
+	for (int i = 0; i < batch; i++)
+	{
+		screens[i].format = SFORMAT_CC_SCREEN;
+		screens[i].row_used[13] = screens[i].row_used[14] = 1;
+		strcpy((char *) screens[i].characters[13], "FIRST LINE OF THE CAPTION");
+		strcpy((char *) screens[i].characters[14], "SECOND LINE OF THE CAPTION");
+	}
+	memset(&sub, 0, sizeof(sub));
+	sub.type = CC_608;
+	sub.data = screens;
+
+	// The first message waits for the subscriber, out of the timing
+	sub.nb_data = 1;
+	screens[0].start_time = now_us();
+	ccx_share_send(&sub, 0);
+	sub.nb_data = batch;
+
+	t = now_us();
+	for (int sent = 1; sent < nb_messages; sent += batch)
+	{
+		int64_t us = now_us();
+		for (int i = 0; i < batch; i++)
+			screens[i].start_time = us;
+		if (sent + batch > nb_messages)
+			sub.nb_data = nb_messages - sent;
+		ccx_share_send(&sub, 0);
+	}
+	sent_us = now_us() - t;
+	ccx_share_stream_done("bench");
+	pthread_join(thread, NULL);
+	ccx_share_stop();
+	nn_close(s.sock);
+
+	long n = s.received < nb_messages ? s.received : nb_messages;
+	qsort(s.latencies, n, sizeof(int64_t), cmp_int64);
+	for (long i = 0; i < n; i++)
+		avg += s.latencies[i];
+
+	printf("{\n");
+	printf("  \"url\": \"%s\",\n", url);
+	printf("  \"batch\": %d,\n", batch);
+	printf("  \"sent\": %d,\n", nb_messages);
+	printf("  \"received\": %ld,\n", s.received);
+	printf("  \"frames\": %ld,\n", s.frames);
+	printf("  \"send_messages_per_s\": %.0f,\n", (nb_messages - 1) / (sent_us / 1e6));
+	printf("  \"receive_messages_per_s\": %.0f,\n",
+			s.last_us > s.first_us ? s.received / ((s.last_us - s.first_us) / 1e6) : 0.0);
+	printf("  \"latency_avg_us\": %.1f,\n", n ? avg / n : 0.0);
+	printf("  \"latency_p50_us\": %lld,\n", n ? (long long) s.latencies[n / 2] : 0LL);
+	printf("  \"latency_p99_us\": %lld\n", n ? (long long) s.latencies[n * 99 / 100] : 0LL);
+	printf("}\n");
+
+	free(screens);
+	free(s.latencies);
+	return s.bad != 0;
+}
@@ -0,0 +1,194 @@
+/* Microbenchmark of the start code search of src/lib_ccx/start_code.c on
+ * video-like data, through each of its paths, against the memchr() loop
+ * that search_start_code() and process_avc() used before: stop at every
+ * zero byte and look at the two after it.
+ *
+ * The file is included to get at the paths the CPU doesn't pick.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/lib_ccx/start_code.c"
+
+#define BUF_SIZE (32 << 20)
+#define SLICE_SIZE 2000 // Bytes between two start codes, about a slice per macroblock row
+#define ROUNDS 8
+#define MAX_CODES (BUF_SIZE / SLICE_SIZE + 16)
+
+typedef const uint8_t *(*find_fn)(const uint8_t *p, const uint8_t *end);
+
+static const uint8_t *find_memchr(const uint8_t *p, const uint8_t *end)
+{
+	while (end - p > 2 && (p = memchr(p, 0x00, end - p - 2)) != NULL)
+	{
+		if (p[1] == 0x00 && p[2] == 0x01)
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Random bytes with zero_share zeros out of 256 and no 0x01, so no start
+ * code prefix but the ones put every SLICE_SIZE bytes */
+static void fill(uint8_t *buf, size_t len, int zero_share)
+{
+	uint32_t seed = 1;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (seed >> 16) & 0xff;
+		if ((int) ((seed >> 8) & 0xff) < zero_share)
+			buf[i] = 0;
+		else if (buf[i] == 1)
+			buf[i] = 2;
+	}
+	for (size_t i = 0; i + 4 <= len; i += SLICE_SIZE)
+	{
+		buf[i] = buf[i + 1] = 0;
+		buf[i + 2] = 1;
+		buf[i + 3] = 0x01 + (i / SLICE_SIZE) % 0xaf;
+	}
+}
+
+static size_t count_with(find_fn find, const uint8_t *buf, size_t len, size_t *offsets)
+{
+	const uint8_t *p = buf, *end = buf + len;
+	size_t n = 0;
+
+	while ((p = find(p, end)) != NULL)
+	{
+		if (n < MAX_CODES)
+			offsets[n] = p - buf;
+		n++;
+		p += 3;
+	}
+	return n;
+}
+
+/* Every path has to find what the memchr() loop finds, also in short
+ * buffers with the start code at SLICE_SIZE anywhere in them */
+static int check(find_fn find, const char *name, const uint8_t *buf, size_t len)
+{
+	static size_t want[MAX_CODES], got[MAX_CODES];
+	size_t n_want, n_got;
+
+	for (size_t l = 0; l < 100; l++)
+	{
+		for (size_t off = 0; off < 40; off++)
+		{
+			const uint8_t *p = buf + SLICE_SIZE - off, *end = p + l;
+			const uint8_t *a = find_memchr(p, end), *b = find(p, end);
+			if (a != b)
+			{
+				fprintf(stderr, "%s: length %zu at %zu found %td, memchr %td\n", name, l, off,
+						b ? b - p : -1, a ? a - p : -1);
+				return 1;
+			}
+		}
+	}
+	n_want = count_with(find_memchr, buf, len, want);
+	n_got = count_with(find, buf, len, got);
+	if (n_want != n_got || memcmp(want, got, (n_want < MAX_CODES ? n_want : MAX_CODES) * sizeof(size_t)))
+	{
+		fprintf(stderr, "%s: found %zu start codes, memchr %zu\n", name, n_got, n_want);
+		return 1;
+	}
+	return 0;
+}
+
+static double run(find_fn find, const uint8_t *buf, size_t len, size_t *found)
+{
+	static size_t offsets[MAX_CODES];
+	double best = 0;
+
+	for (int r = 0; r < ROUNDS; r++)
+	{
+		double start = now(), t;
+		*found = count_with(find, buf, len, offsets);
+		t = now() - start;
+		if (r == 0 || t < best)
+			best = t;
+	}
+	return len / best / 1e6;
+}
+
+static double run_batch(const uint8_t *buf, size_t len, size_t *found)
+{
+	static size_t offsets[256];
+	double best = 0;
+
+	for (int r = 0; r < ROUNDS; r++)
+	{
+		double start = now(), t;
+		size_t pos = 0, n;
+		*found = 0;
+		while ((n = find_start_codes(buf + pos, len - pos, offsets, 256)) > 0)
+		{
+			*found += n;
+			pos += offsets[n - 1] + 3;
+			if (n < 256)
+				break;
+		}
+		t = now() - start;
+		if (r == 0 || t < best)
+			best = t;
+	}
+	return len / best / 1e6;
+}
+
+int main(void)
+{
+	static const int zero_shares[] = { 8, 32, 64 }; // Zeros in 256 bytes
+	uint8_t *buf = malloc(BUF_SIZE);
+	struct { const char *name; find_fn find; } paths[] = {
+		{ "memchr", find_memchr },
+		{ "scalar", find_scalar },
+#ifdef START_CODE_SSE2
+		{ "sse2", find_sse2 },
+#endif
+#ifdef START_CODE_NEON
+		{ "neon", find_neon },
+#endif
+#ifdef START_CODE_AVX2
+		{ "avx2", have_avx2() ? find_avx2 : NULL },
+#endif
+		{ "find_start_code", find_start_code },
+	};
+	int npaths = sizeof(paths) / sizeof(paths[0]);
+
+	if (!buf)
+		return 2;
+	printf("{\n  \"buffer_bytes\": %d,\n  \"slice_bytes\": %d,\n  \"results\": [", BUF_SIZE, SLICE_SIZE);
+	for (size_t z = 0; z < sizeof(zero_shares) / sizeof(zero_shares[0]); z++)
+	{
+		size_t found;
+
+		fill(buf, BUF_SIZE, zero_shares[z]);
+		for (int i = 0; i < npaths; i++)
+		{
+			if (!paths[i].find)
+				continue;
+			if (check(paths[i].find, paths[i].name, buf, BUF_SIZE))
+				return 1;
+			double mb_s = run(paths[i].find, buf, BUF_SIZE, &found);
+			printf("%s\n    { \"zero_share\": %d, \"path\": \"%s\", \"start_codes\": %zu, \"mb_per_s\": %.0f }",
+					z || i ? "," : "", zero_shares[z], paths[i].name, found, mb_s);
+		}
+		double mb_s = run_batch(buf, BUF_SIZE, &found);
+		printf(",\n    { \"zero_share\": %d, \"path\": \"find_start_codes\", \"start_codes\": %zu, \"mb_per_s\": %.0f }",
+				zero_shares[z], found, mb_s);
+	}
+	printf("\n  ]\n}\n");
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,116 @@
+/* Sends a transport stream to ccextractor -udp: 7 TS packets a datagram, as
+ * IPTV sources do, at a given rate or as fast as possible. Multicast groups
+ * are looped back so a stream can be sent to a ccextractor of the same host:
+ *
+ *     ccextractor -udp 239.0.0.1:1234 -o out.srt &
+ *     ./udp_send -r 40 stream.ts 239.0.0.1:1234
+ *     kill -TERM %1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define DATAGRAM_SIZE (7 * 188)
+
+static int64_t now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_in to;
+	double mbits = 0;
+	int loops = 1, i;
+	unsigned char loop = 1, ttl = 1;
+	long sent = 0;
+	int64_t start, bytes = 0;
+	char *colon;
+	FILE *f;
+	int sock;
+	unsigned char buf[DATAGRAM_SIZE];
+
+	for (i = 1; i < argc - 2; i += 2)
+	{
+		if (!strcmp(argv[i], "-r"))
+			mbits = atof(argv[i + 1]);
+		else if (!strcmp(argv[i], "-l"))
+			loops = atoi(argv[i + 1]);
+		else
+			break;
+	}
+	if (i != argc - 2 || !(colon = strchr(argv[argc - 1], ':')))
+	{
+		fprintf(stderr, "Usage: %s [-r Mbit/s] [-l loops] file.ts host:port\n", argv[0]);
+		return 2;
+	}
+	*colon = '\0';
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(atoi(colon + 1));
+	if (inet_pton(AF_INET, argv[argc - 1], &to.sin_addr) != 1)
+	{
+		fprintf(stderr, "Bad IPv4 address %s\n", argv[argc - 1]);
+		return 2;
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0 ||
+			setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+			setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+	{
+		perror("socket");
+		return 2;
+	}
+
+	start = now_us();
+	for (int l = 0; l < loops; l++)
+	{
+		size_t len;
+
+		f = fopen(argv[argc - 2], "rb");
+		if (!f)
+		{
+			perror(argv[argc - 2]);
+			return 2;
+		}
+		while ((len = fread(buf, 1, DATAGRAM_SIZE, f)) > 0)
+		{
+			if (mbits > 0)
+			{
+				// Paced on the bytes sent so far
+				int64_t due = start + (int64_t) (bytes * 8 / mbits);
+				int64_t t = now_us();
+				if (due > t)
+					usleep(due - t);
+			}
+			if (sendto(sock, buf, len, 0, (struct sockaddr *) &to, sizeof(to)) < 0)
+			{
+				perror("sendto");
+				return 1;
+			}
+			bytes += len;
+			sent++;
+		}
+		fclose(f);
+	}
+
+	double s = (now_us() - start) / 1e6;
+	printf("{\n");
+	printf("  \"datagrams\": %ld,\n", sent);
+	printf("  \"bytes\": %lld,\n", (long long) bytes);
+	printf("  \"seconds\": %.3f,\n", s);
+	printf("  \"mbits_per_s\": %.1f\n", s > 0 ? bytes * 8 / s / 1e6 : 0.0);
+	printf("}\n");
+	close(sock);
+	return 0;
+}
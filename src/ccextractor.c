@@ -4,6 +4,9 @@ Credits: See AUTHORS.TXT
 License: GPL 2.0
 */
 #include "ccextractor.h"
+#include "lib_ccx/batch_jobs.h"
+#include "lib_ccx/ccx_metrics.h"
+#include "lib_ccx/program_pipeline.h"
 #include <stdio.h>
 
 volatile int terminate_asap = 0;
@@ -14,6 +17,11 @@ void sigusr1_handler(int sig)
     change_filename_requested = 1;
 }
 
+void sigusr2_handler(int sig)
+{
+    ccx_metrics_request_dump();
+}
+
 
 void sigterm_handler(int sig)
 {
@@ -38,6 +46,130 @@ void print_end_msg(void)
 }
 
 
+/* Report on a decoder at the end of a file, in the thread it runs in with
+   -programthreads as the timing globals are thread local there */
+static void print_decoder_stats(struct lib_cc_decode *dec_ctx, void *arg)
+{
+    struct lib_ccx_ctx *ctx = arg;
+    enum ccx_stream_mode_enum stream_mode = ctx->demux_ctx->get_stream_mode(ctx->demux_ctx);
+
+    mprint("\n");
+    dbg_print(CCX_DMT_DECODER_608, "\nTime stamps after last caption block was written:\n");
+    dbg_print(CCX_DMT_DECODER_608, "GOP: %s	  \n", print_mstime_static(gop_time.ms) );
+
+    dbg_print(CCX_DMT_DECODER_608, "GOP: %s (%+3dms incl.)\n",
+              print_mstime_static((LLONG)(gop_time.ms
+                  -first_gop_time.ms
+                  +get_fts_max(dec_ctx->timing)-fts_at_gop_start)),
+              (int)(get_fts_max(dec_ctx->timing)-fts_at_gop_start));
+    // When padding is active the CC block time should be within
+    // 1000/29.97 us of the differences.
+    dbg_print(CCX_DMT_DECODER_608, "Max. FTS:	   %s  (without caption blocks since then)\n",
+              print_mstime_static(get_fts_max(dec_ctx->timing)));
+
+    if (dec_ctx->codec == CCX_CODEC_ATSC_CC)
+    {
+        mprint ("\nTotal frames time:	  %s  (%u frames at %.2ffps)\n",
+                print_mstime_static( (LLONG)(total_frames_count*1000/current_fps) ),
+                total_frames_count, current_fps);
+    }
+
+    if (ctx->stat_hdtv)
+    {
+        mprint ("\rCC type 0: %d (%s)\n", dec_ctx->cc_stats[0], cc_types[0]);
+        mprint ("CC type 1: %d (%s)\n", dec_ctx->cc_stats[1], cc_types[1]);
+        mprint ("CC type 2: %d (%s)\n", dec_ctx->cc_stats[2], cc_types[2]);
+        mprint ("CC type 3: %d (%s)\n", dec_ctx->cc_stats[3], cc_types[3]);
+    }
+    // Add one frame as fts_max marks the beginning of the last frame,
+    // but we need the end.
+    dec_ctx->timing->fts_global += dec_ctx->timing->fts_max + (LLONG) (1000.0/current_fps);
+    // CFS: At least in Hauppage mode, cb_field can be responsible for ALL the
+    // timing (cb_fields having a huge number and fts_now and fts_global being 0 all
+    // the time), so we need to take that into account in fts_global before resetting
+    // counters.
+    if (cb_field1!=0)
+        dec_ctx->timing->fts_global += cb_field1*1001/3;
+    else if (cb_field2!=0)
+        dec_ctx->timing->fts_global += cb_field2*1001/3;
+    else
+        dec_ctx->timing->fts_global += cb_708*1001/3;
+    // Reset counters - This is needed if some captions are still buffered
+    // and need to be written after the last file is processed.
+    cb_field1 = 0; cb_field2 = 0; cb_708 = 0;
+    dec_ctx->timing->fts_now = 0;
+    dec_ctx->timing->fts_max = 0;
+
+    if (dec_ctx->total_pulldownframes)
+        mprint ("incl. pulldown frames:  %s  (%u frames at %.2ffps)\n",
+                print_mstime_static( (LLONG)(dec_ctx->total_pulldownframes*1000/current_fps) ),
+                dec_ctx->total_pulldownframes, current_fps);
+    if (dec_ctx->timing->pts_set >= 1 && dec_ctx->timing->min_pts != 0x01FFFFFFFFLL)
+    {
+        LLONG postsyncms = (LLONG) (dec_ctx->frames_since_last_gop*1000/current_fps);
+        mprint ("\nMin PTS:				%s\n",
+                print_mstime_static( dec_ctx->timing->min_pts/(MPEG_CLOCK_FREQ/1000) - dec_ctx->timing->fts_offset));
+        if (pts_big_change)
+            mprint ("(Reference clock was reset at some point, Min PTS is approximated)\n");
+        mprint ("Max PTS:				%s\n",
+                print_mstime_static( dec_ctx->timing->sync_pts/(MPEG_CLOCK_FREQ/1000) + postsyncms));
+
+        mprint ("Length:				 %s\n",
+                print_mstime_static( dec_ctx->timing->sync_pts/(MPEG_CLOCK_FREQ/1000) + postsyncms
+                                         - dec_ctx->timing->min_pts/(MPEG_CLOCK_FREQ/1000) + dec_ctx->timing->fts_offset ));
+    }
+
+
+    // dvr-ms files have invalid GOPs
+    if (gop_time.inited && first_gop_time.inited && stream_mode != CCX_SM_ASF)
+    {
+        mprint ("\nInitial GOP time:	   %s\n",
+                print_mstime_static(first_gop_time.ms));
+        mprint ("Final GOP time:		 %s%+3dF\n",
+                print_mstime_static(gop_time.ms),
+                dec_ctx->frames_since_last_gop);
+        mprint ("Diff. GOP length:	   %s%+3dF",
+                print_mstime_static(gop_time.ms - first_gop_time.ms),
+                dec_ctx->frames_since_last_gop);
+        mprint ("	(%s)\n\n",
+                print_mstime_static(gop_time.ms - first_gop_time.ms
+                                        +(LLONG) ((dec_ctx->frames_since_last_gop)*1000/29.97)) );
+    }
+
+    if (dec_ctx->false_pict_header)
+        mprint ("Number of likely false picture headers (discarded): %d\n",dec_ctx->false_pict_header);
+    if (dec_ctx->num_key_frames)
+        mprint("Number of key frames: %d\n", dec_ctx->num_key_frames);
+
+    if (dec_ctx->stat_numuserheaders)
+        mprint("Total user data fields: %d\n", dec_ctx->stat_numuserheaders);
+    if (dec_ctx->stat_dvdccheaders)
+        mprint("DVD-type user data fields: %d\n", dec_ctx->stat_dvdccheaders);
+    if (dec_ctx->stat_scte20ccheaders)
+        mprint("SCTE-20 type user data fields: %d\n", dec_ctx->stat_scte20ccheaders);
+    if (dec_ctx->stat_replay4000headers)
+        mprint("ReplayTV 4000 user data fields: %d\n", dec_ctx->stat_replay4000headers);
+    if (dec_ctx->stat_replay5000headers)
+        mprint("ReplayTV 5000 user data fields: %d\n", dec_ctx->stat_replay5000headers);
+    if (dec_ctx->stat_hdtv)
+        mprint("HDTV type user data fields: %d\n", dec_ctx->stat_hdtv);
+    if (dec_ctx->stat_dishheaders)
+        mprint("Dish Network user data fields: %d\n", dec_ctx->stat_dishheaders);
+    if (dec_ctx->stat_divicom)
+    {
+        mprint("CEA608/Divicom user data fields: %d\n", dec_ctx->stat_divicom);
+
+        mprint("\n\nNOTE! The CEA 608 / Divicom standard encoding for closed\n");
+        mprint("caption is not well understood!\n\n");
+        mprint("Please submit samples to the developers.\n\n\n");
+    }
+}
+
+static int batch_job_start(struct ccx_s_options *opt)
+{
+    return api_start(*opt);
+}
+
 int api_start(struct ccx_s_options api_options)
 {
     struct lib_ccx_ctx *ctx;
@@ -57,6 +189,15 @@ int api_start(struct ccx_s_options api_options)
 	}
 #endif
 
+#ifndef _WIN32
+    if (api_options.jobs > 1 && api_options.num_input_files > 1)
+    {
+        // Each job runs api_start() again, for one input file
+        m_signal(SIGTERM, sigterm_handler);
+        return run_batch_jobs(&ccx_options, batch_job_start);
+    }
+#endif
+
     // Initialize CCExtractor libraries
     ctx = init_libraries(&api_options);
 #ifdef ENABLE_PYTHON
@@ -100,6 +241,11 @@ int api_start(struct ccx_s_options api_options)
         // dec to BCD, magazine pages numbers are in BCD (ETSI 300 706)
         tlt_config.page = ((tlt_config.page / 100) << 8) | (((tlt_config.page / 10) % 10) << 4) | (tlt_config.page % 10);
     }
+    for (int i = 0; i < tlt_config.num_extra_pages; i++)
+    {
+        uint16_t p = tlt_config.extra_pages[i];
+        tlt_config.extra_pages[i] = ((p / 100) << 8) | (((p / 10) % 10) << 4) | (p % 10);
+    }
 
     if (api_options.transcript_settings.xds)
     {
@@ -140,7 +286,9 @@ int api_start(struct ccx_s_options api_options)
     m_signal(SIGINT, sigint_handler);
     m_signal(SIGTERM, sigterm_handler);
     m_signal(SIGUSR1, sigusr1_handler);
+    m_signal(SIGUSR2, sigusr2_handler);
 #endif
+    ccx_metrics_start();
     terminate_asap = 0;
 
 #ifdef ENABLE_SHARING
@@ -175,6 +323,7 @@ int api_start(struct ccx_s_options api_options)
             case CCX_SM_MCPOODLESRAW:
             case CCX_SM_RCWT:
             case CCX_SM_MP4:
+            case CCX_SM_FMP4:
 #ifdef WTV_DEBUG
                 case CCX_SM_HEX_DUMP:
 #endif
@@ -198,6 +347,7 @@ int api_start(struct ccx_s_options api_options)
             case CCX_SM_WTV:
             case CCX_SM_GXF:
             case CCX_SM_MXF:
+            case CCX_SM_FMP4:
 #ifdef ENABLE_FFMPEG
                 case CCX_SM_FFMPEG:
 #endif
@@ -261,125 +411,13 @@ int api_start(struct ccx_s_options api_options)
         }
         list_for_each_entry(dec_ctx, &ctx->dec_ctx_head, list, struct lib_cc_decode)
         {
-            mprint("\n");
-            dbg_print(CCX_DMT_DECODER_608, "\nTime stamps after last caption block was written:\n");
-            dbg_print(CCX_DMT_DECODER_608, "GOP: %s	  \n", print_mstime_static(gop_time.ms) );
-
-            dbg_print(CCX_DMT_DECODER_608, "GOP: %s (%+3dms incl.)\n",
-                      print_mstime_static((LLONG)(gop_time.ms
-                          -first_gop_time.ms
-                          +get_fts_max(dec_ctx->timing)-fts_at_gop_start)),
-                      (int)(get_fts_max(dec_ctx->timing)-fts_at_gop_start));
-            // When padding is active the CC block time should be within
-            // 1000/29.97 us of the differences.
-            dbg_print(CCX_DMT_DECODER_608, "Max. FTS:	   %s  (without caption blocks since then)\n",
-                      print_mstime_static(get_fts_max(dec_ctx->timing)));
-
-            if (dec_ctx->codec == CCX_CODEC_ATSC_CC)
-            {
-                mprint ("\nTotal frames time:	  %s  (%u frames at %.2ffps)\n",
-                        print_mstime_static( (LLONG)(total_frames_count*1000/current_fps) ),
-                        total_frames_count, current_fps);
-            }
-
-            if (ctx->stat_hdtv)
-            {
-                mprint ("\rCC type 0: %d (%s)\n", dec_ctx->cc_stats[0], cc_types[0]);
-                mprint ("CC type 1: %d (%s)\n", dec_ctx->cc_stats[1], cc_types[1]);
-                mprint ("CC type 2: %d (%s)\n", dec_ctx->cc_stats[2], cc_types[2]);
-                mprint ("CC type 3: %d (%s)\n", dec_ctx->cc_stats[3], cc_types[3]);
-            }
-            // Add one frame as fts_max marks the beginning of the last frame,
-            // but we need the end.
-            dec_ctx->timing->fts_global += dec_ctx->timing->fts_max + (LLONG) (1000.0/current_fps);
-            // CFS: At least in Hauppage mode, cb_field can be responsible for ALL the
-            // timing (cb_fields having a huge number and fts_now and fts_global being 0 all
-            // the time), so we need to take that into account in fts_global before resetting
-            // counters.
-            if (cb_field1!=0)
-                dec_ctx->timing->fts_global += cb_field1*1001/3;
-            else if (cb_field2!=0)
-                dec_ctx->timing->fts_global += cb_field2*1001/3;
-            else
-                dec_ctx->timing->fts_global += cb_708*1001/3;
-            // Reset counters - This is needed if some captions are still buffered
-            // and need to be written after the last file is processed.
-            cb_field1 = 0; cb_field2 = 0; cb_708 = 0;
-            dec_ctx->timing->fts_now = 0;
-            dec_ctx->timing->fts_max = 0;
-
+            program_pipeline_call(ctx->pipeline, dec_ctx, print_decoder_stats, ctx);
 #ifdef ENABLE_SHARING
             if (api_options.sharing_enabled)
 			{
 				ccx_share_stream_done(ctx->basefilename);
-				ccx_share_stop();
 			}
 #endif //ENABLE_SHARING
-
-            if (dec_ctx->total_pulldownframes)
-                mprint ("incl. pulldown frames:  %s  (%u frames at %.2ffps)\n",
-                        print_mstime_static( (LLONG)(dec_ctx->total_pulldownframes*1000/current_fps) ),
-                        dec_ctx->total_pulldownframes, current_fps);
-            if (dec_ctx->timing->pts_set >= 1 && dec_ctx->timing->min_pts != 0x01FFFFFFFFLL)
-            {
-                LLONG postsyncms = (LLONG) (dec_ctx->frames_since_last_gop*1000/current_fps);
-                mprint ("\nMin PTS:				%s\n",
-                        print_mstime_static( dec_ctx->timing->min_pts/(MPEG_CLOCK_FREQ/1000) - dec_ctx->timing->fts_offset));
-                if (pts_big_change)
-                    mprint ("(Reference clock was reset at some point, Min PTS is approximated)\n");
-                mprint ("Max PTS:				%s\n",
-                        print_mstime_static( dec_ctx->timing->sync_pts/(MPEG_CLOCK_FREQ/1000) + postsyncms));
-
-                mprint ("Length:				 %s\n",
-                        print_mstime_static( dec_ctx->timing->sync_pts/(MPEG_CLOCK_FREQ/1000) + postsyncms
-                                                 - dec_ctx->timing->min_pts/(MPEG_CLOCK_FREQ/1000) + dec_ctx->timing->fts_offset ));
-            }
-
-
-            // dvr-ms files have invalid GOPs
-            if (gop_time.inited && first_gop_time.inited && stream_mode != CCX_SM_ASF)
-            {
-                mprint ("\nInitial GOP time:	   %s\n",
-                        print_mstime_static(first_gop_time.ms));
-                mprint ("Final GOP time:		 %s%+3dF\n",
-                        print_mstime_static(gop_time.ms),
-                        dec_ctx->frames_since_last_gop);
-                mprint ("Diff. GOP length:	   %s%+3dF",
-                        print_mstime_static(gop_time.ms - first_gop_time.ms),
-                        dec_ctx->frames_since_last_gop);
-                mprint ("	(%s)\n\n",
-                        print_mstime_static(gop_time.ms - first_gop_time.ms
-                                                +(LLONG) ((dec_ctx->frames_since_last_gop)*1000/29.97)) );
-            }
-
-            if (dec_ctx->false_pict_header)
-                mprint ("Number of likely false picture headers (discarded): %d\n",dec_ctx->false_pict_header);
-            if (dec_ctx->num_key_frames)
-                mprint("Number of key frames: %d\n", dec_ctx->num_key_frames);
-
-            if (dec_ctx->stat_numuserheaders)
-                mprint("Total user data fields: %d\n", dec_ctx->stat_numuserheaders);
-            if (dec_ctx->stat_dvdccheaders)
-                mprint("DVD-type user data fields: %d\n", dec_ctx->stat_dvdccheaders);
-            if (dec_ctx->stat_scte20ccheaders)
-                mprint("SCTE-20 type user data fields: %d\n", dec_ctx->stat_scte20ccheaders);
-            if (dec_ctx->stat_replay4000headers)
-                mprint("ReplayTV 4000 user data fields: %d\n", dec_ctx->stat_replay4000headers);
-            if (dec_ctx->stat_replay5000headers)
-                mprint("ReplayTV 5000 user data fields: %d\n", dec_ctx->stat_replay5000headers);
-            if (dec_ctx->stat_hdtv)
-                mprint("HDTV type user data fields: %d\n", dec_ctx->stat_hdtv);
-            if (dec_ctx->stat_dishheaders)
-                mprint("Dish Network user data fields: %d\n", dec_ctx->stat_dishheaders);
-            if (dec_ctx->stat_divicom)
-            {
-                mprint("CEA608/Divicom user data fields: %d\n", dec_ctx->stat_divicom);
-
-                mprint("\n\nNOTE! The CEA 608 / Divicom standard encoding for closed\n");
-                mprint("caption is not well understood!\n\n");
-                mprint("Please submit samples to the developers.\n\n\n");
-            }
-
         }
 
         if(is_decoder_processed_enough(ctx) == CCX_TRUE)
@@ -418,6 +456,11 @@ int api_start(struct ccx_s_options api_options)
   	curl_global_cleanup();
 #endif
     dinit_libraries(&ctx);
+    ccx_metrics_stop();
+#ifdef ENABLE_SHARING
+    if (api_options.sharing_enabled)
+		ccx_share_stop();
+#endif //ENABLE_SHARING
 
     if (!ret)
         mprint("\nNo captions were found in input.\n");
@@ -62,7 +62,7 @@ static int process_avc_sample(struct lib_ccx_ctx *ctx, u32 timescale, GF_AVCConf
 		s_nalu_stats.total += 1;
 		s_nalu_stats.type[s->data[i] & 0x1F] += 1;
 
-		temp_debug=0;
+		set_temp_debug(0);
 
 		if (nal_length>0)
 			do_NAL (dec_ctx, (unsigned char *) &(s->data[i]) ,nal_length, sub);
@@ -72,6 +72,145 @@ static int process_avc_sample(struct lib_ccx_ctx *ctx, u32 timescale, GF_AVCConf
 
 	return status;
 }
+/* The samples of an AVC track with their data in the file itself are not
+ * read whole: all that's needed from them are the SEI NAL units with the
+ * captions, the SPS and the head of every slice, which slice_header() takes
+ * the timing and order of the captions from. The rest of the slices, most of
+ * the file, is skipped.
+ *
+ * What is read comes through a window on the file. Refilling it reads
+ * MP4_READ_SIZE bytes at once, which holds the heads of all the small samples
+ * of a chunk, written one after the other. */
+#define MP4_WINDOW_SIZE (64 * 1024) // Larger NAL units are read on their own
+#define MP4_READ_SIZE (16 * 1024)
+
+struct mp4_window
+{
+	FILE *f;
+	u64 start;           // File offset of data[0]
+	u32 len;
+	unsigned char *large; // For NAL units larger than the window
+	u32 large_size;
+	unsigned char data[MP4_WINDOW_SIZE];
+};
+
+static struct mp4_window *open_mp4_window(const char *path)
+{
+	struct mp4_window *w = malloc(sizeof(struct mp4_window));
+
+	if (w == NULL)
+		return NULL;
+	if ((w->f = fopen(path, "rb")) == NULL)
+	{
+		free(w);
+		return NULL;
+	}
+	setvbuf(w->f, NULL, _IONBF, 0); // The window is the buffer
+	w->start = 0;
+	w->len = 0;
+	w->large = NULL;
+	w->large_size = 0;
+	return w;
+}
+
+static void close_mp4_window(struct mp4_window *w)
+{
+	fclose(w->f);
+	free(w->large);
+	free(w);
+}
+
+// size bytes at offset of the file, NULL if they can't be read
+static unsigned char *read_mp4_window(struct mp4_window *w, u64 offset, u32 size)
+{
+	if (size > MP4_WINDOW_SIZE)
+	{
+		if (size > w->large_size)
+		{
+			unsigned char *large = realloc(w->large, size);
+			if (large == NULL)
+				return NULL;
+			w->large = large;
+			w->large_size = size;
+		}
+		if (FSEEK(w->f, offset, SEEK_SET) || fread(w->large, 1, size, w->f) != size)
+			return NULL;
+		return w->large;
+	}
+	if (offset < w->start || offset + size > w->start + w->len)
+	{
+		u32 want = size > MP4_READ_SIZE ? size : MP4_READ_SIZE;
+
+		w->len = 0;
+		if (FSEEK(w->f, offset, SEEK_SET))
+			return NULL;
+		w->start = offset;
+		w->len = fread(w->data, 1, want, w->f);
+		if (w->len < size)
+			return NULL;
+	}
+	return w->data + (offset - w->start);
+}
+
+static u32 read_nal_length(const unsigned char *p, int nal_unit_size)
+{
+	switch(nal_unit_size)
+	{
+		case 1:
+			return p[0];
+		case 2:
+			return (p[0] << 8) | p[1];
+		case 4:
+			return ((u32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+	return 0;
+}
+
+/* process_avc_sample() for a sample s got with gf_isom_get_sample_info(),
+ * its data at offset in the file */
+static int process_avc_sample_heads(struct lib_ccx_ctx *ctx, u32 timescale, GF_AVCConfig* c, GF_ISOSample* s,
+		u64 offset, struct mp4_window *w, struct cc_subtitle *sub)
+{
+	u32 i;
+	s32 signed_cts=(s32) s->CTS_Offset; // Convert from unsigned to signed. GPAC uses u32 but unsigned values are legal.
+	struct lib_cc_decode *dec_ctx = NULL;
+
+	dec_ctx = update_decoder_list(ctx);
+
+	set_current_pts(dec_ctx->timing, (s->DTS + signed_cts)*MPEG_CLOCK_FREQ/timescale);
+	set_fts(dec_ctx->timing);
+
+	for(i = 0; i + c->nal_unit_size < s->dataLength; )
+	{
+		u32 nal_length, read_length;
+		unsigned char *p = read_mp4_window(w, offset + i, c->nal_unit_size + 1);
+
+		if (p == NULL)
+			return -1;
+		nal_length = read_nal_length(p, c->nal_unit_size);
+		i += c->nal_unit_size;
+		if (nal_length > s->dataLength - i)
+			nal_length = s->dataLength - i;
+
+		s_nalu_stats.total += 1;
+		if (nal_length == 0)
+			continue;
+		s_nalu_stats.type[p[c->nal_unit_size] & 0x1F] += 1;
+
+		read_length = avc_nal_bytes_read(p[c->nal_unit_size], nal_length);
+		if (read_length > 0)
+		{
+			if ((p = read_mp4_window(w, offset + i, read_length)) == NULL)
+				return -1;
+			set_temp_debug(0);
+			do_NAL (dec_ctx, p, read_length, sub);
+		}
+		i += nal_length;
+	}
+
+	return 0;
+}
+
 static int process_xdvb_track(struct lib_ccx_ctx *ctx, const char* basename, GF_ISOFile* f, u32 track, struct cc_subtitle *sub)
 {
 	u32 timescale, i, sample_count;
@@ -122,8 +261,10 @@ static int process_avc_track(struct lib_ccx_ctx *ctx, const char* basename, GF_I
 {
 	u32 timescale, i, sample_count, last_sdi = 0;
 	int status;
+	int self_contained = 0;
 	GF_AVCConfig* c = NULL;
 	struct lib_cc_decode *dec_ctx = NULL;
+	struct mp4_window *w = NULL;
 
 	dec_ctx = update_decoder_list(ctx);
 	
@@ -134,13 +275,19 @@ static int process_avc_track(struct lib_ccx_ctx *ctx, const char* basename, GF_I
 
 	timescale = gf_isom_get_media_timescale(f, track);
 
+	// With -debug -vides the whole samples are read, for the NAL unit lengths
+	if (!ccx_dbg_enabled(CCX_DMT_VIDES))
+		w = open_mp4_window(basename);
+
 	status = 0;
 
 	for(i = 0; i < sample_count; i++)
 	{
 		u32 sdi;
+		u64 offset;
 		
-		GF_ISOSample* s = gf_isom_get_sample(f, track, i + 1, &sdi);
+		GF_ISOSample* s = w != NULL ? gf_isom_get_sample_info(f, track, i + 1, &sdi, &offset) :
+			gf_isom_get_sample(f, track, i + 1, &sdi);
 
 		if(s != NULL)
 		{
@@ -159,10 +306,25 @@ static int process_avc_track(struct lib_ccx_ctx *ctx, const char* basename, GF_I
 					break;
 				}
 
+				self_contained = gf_isom_is_self_contained(f, track, sdi);
 				last_sdi = sdi;
 			}
 
-			status = process_avc_sample(ctx, timescale, c, s, sub);
+			if (w != NULL && self_contained)
+			{
+				if (process_avc_sample_heads(ctx, timescale, c, s, offset, w, sub) != 0)
+					mprint("\rWarning: Could not read sample %u of the AVC track, skipped.\n", i + 1);
+			}
+			else
+			{
+				if (w != NULL) // Its data is in another file, leave it to GPAC
+				{
+					gf_isom_sample_del(&s);
+					s = gf_isom_get_sample(f, track, i + 1, &sdi);
+				}
+				if (s != NULL)
+					status = process_avc_sample(ctx, timescale, c, s, sub);
+			}
 
 			gf_isom_sample_del(&s);
 
@@ -188,6 +350,8 @@ static int process_avc_track(struct lib_ccx_ctx *ctx, const char* basename, GF_I
 		gf_odf_avc_cfg_del(c);
 		c = NULL;
 	}
+	if (w != NULL)
+		close_mp4_window(w);
 
 	return status;
 }
@@ -3,6 +3,7 @@ relevant events. */
 
 #include "lib_ccx.h"
 #include "ccx_common_option.h"
+#include "batch_jobs.h"
 
 static int credits_shown=0;
 unsigned long net_activity_gui=0;
@@ -10,6 +11,12 @@ unsigned long net_activity_gui=0;
 /* Print current progress. For percentage, -1 -> streaming mode */
 void activity_progress (int percentage, int cur_min, int cur_sec)
 {
+	if (batch_job_fd >= 0 && percentage >= 0)
+	{
+		unsigned char p = percentage > 100 ? 100 : percentage;
+		if (write (batch_job_fd, &p, 1) < 0)
+			batch_job_fd = -1; // The batch is gone, go on anyway
+	}
 	if (!ccx_options.no_progress_bar)
 	{
 		if (percentage==-1)
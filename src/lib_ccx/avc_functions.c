@@ -2,13 +2,17 @@
 #include "ccx_common_option.h"
 #include "utility.h"
 #include <math.h>
+#include <limits.h>
 #include "avc_functions.h"
+#include "start_code.h"
 
 #define dvprint(...) dbg_print( CCX_DMT_VIDES, __VA_ARGS__)
+#define AVC_START_CODE_BATCH 64 // Start codes found by one find_start_codes() call
 // Functions to parse a AVC/H.264 data stream, see ISO/IEC 14496-10
 
 // local functions
 static unsigned char *remove_03emu(unsigned char *from, unsigned char *to);
+static int ebsp_to_rbsp_head(unsigned char *rbsp, int size, const unsigned char *from, const unsigned char *to);
 static void sei_rbsp (struct avc_ctx *ctx, unsigned char *seibuf, unsigned char *seiend);
 static unsigned char *sei_message (struct avc_ctx *ctx, unsigned char *seibuf, unsigned char *seiend);
 static void user_data_registered_itu_t_t35 (struct avc_ctx *ctx, unsigned char *userbuf, unsigned char *userend);
@@ -89,16 +93,35 @@ struct avc_ctx *init_avc(void)
 
 void do_NAL (struct lib_cc_decode *ctx, unsigned char *NAL_start, LLONG NAL_length, struct cc_subtitle *sub)
 {
-	unsigned char *NAL_stop;
+	unsigned char *NAL_stop = NAL_start + NAL_length;
+	unsigned char *rbsp = NAL_start + 1, *rbsp_stop = rbsp;
+	unsigned char rbsp_head[AVC_RBSP_HEAD_SIZE];
 	enum ccx_avc_nal_types nal_unit_type = *NAL_start & 0x1F;
+	int is_slice = nal_unit_type == CCX_NAL_TYPE_CODED_SLICE_NON_IDR_PICTURE_1 ||
+		nal_unit_type == CCX_NAL_TYPE_CODED_SLICE_IDR_PICTURE;
+	int rbsp_length = -1;
 
-	NAL_stop = NAL_length+NAL_start;
-	NAL_stop = remove_03emu(NAL_start+1, NAL_stop); // Add +1 to NAL_stop for TS, without it for MP4. Still don't know why
-
+	if (ccx_dbg_enabled(CCX_DMT_VIDES))
+		rbsp_length = ebsp_to_rbsp_head(NULL, INT_MAX, NAL_start + 1, NAL_stop);
 	dvprint("BEGIN NAL unit type: %d length %d ref_idc: %d - Buffered captions before: %d\n",
-				nal_unit_type,  NAL_stop-NAL_start-1, ctx->avc_ctx->nal_ref_idc, !ctx->avc_ctx->cc_buffer_saved);
+				nal_unit_type, rbsp_length, ctx->avc_ctx->nal_ref_idc, !ctx->avc_ctx->cc_buffer_saved);
+
+	// Emulation prevention bytes are only removed from what gets parsed: all
+	// of a SPS or SEI, in place, and the head of a slice, into rbsp_head. The
+	// slice data, most of the stream, is never read.
+	if (nal_unit_type == CCX_NAL_TYPE_SEQUENCE_PARAMETER_SET_7 ||
+			(ctx->avc_ctx->got_seq_para && nal_unit_type == CCX_NAL_TYPE_SEI))
+	{
+		rbsp_stop = remove_03emu(rbsp, NAL_stop); // Add +1 to NAL_stop for TS, without it for MP4. Still don't know why
+	}
+	else if ((ctx->avc_ctx->got_seq_para && is_slice) || temp_debug)
+	{
+		int len = ebsp_to_rbsp_head(rbsp_head, sizeof(rbsp_head), rbsp, NAL_stop);
+		rbsp = rbsp_head;
+		rbsp_stop = len < 0 ? NULL : rbsp_head + len;
+	}
 
-	if (NAL_stop==NULL) // remove_03emu failed.
+	if (rbsp_stop==NULL) // remove_03emu failed.
 	{
 		mprint ("\rNotice: NAL of type %u had to be skipped because remove_03emu failed.\n", nal_unit_type);
 		return;
@@ -113,22 +136,21 @@ void do_NAL (struct lib_cc_decode *ctx, unsigned char *NAL_start, LLONG NAL_leng
 		// Found sequence parameter set
 		// We need this to parse NAL type 1 (CCX_NAL_TYPE_CODED_SLICE_NON_IDR_PICTURE_1)
 		ctx->avc_ctx->num_nal_unit_type_7++;
-		seq_parameter_set_rbsp(ctx->avc_ctx, NAL_start+1, NAL_stop);
+		seq_parameter_set_rbsp(ctx->avc_ctx, rbsp, rbsp_stop);
 		ctx->avc_ctx->got_seq_para = 1;
 	}
-	else if ( ctx->avc_ctx->got_seq_para && (nal_unit_type == CCX_NAL_TYPE_CODED_SLICE_NON_IDR_PICTURE_1 ||
-				nal_unit_type == CCX_NAL_TYPE_CODED_SLICE_IDR_PICTURE)) // Only if nal_unit_type=1
+	else if ( ctx->avc_ctx->got_seq_para && is_slice ) // Only if nal_unit_type=1
 	{
 		// Found coded slice of a non-IDR picture
 		// We only need the slice header data, no need to implement
 		// slice_layer_without_partitioning_rbsp( );
-		slice_header(ctx, NAL_start+1, NAL_stop, nal_unit_type, sub);
+		slice_header(ctx, rbsp, rbsp_stop, nal_unit_type, sub);
 	}
 	else if ( ctx->avc_ctx->got_seq_para && nal_unit_type == CCX_NAL_TYPE_SEI )
 	{
 		// Found SEI (used for subtitles)
 		//set_fts(ctx->timing); // FIXME - check this!!!
-		sei_rbsp(ctx->avc_ctx, NAL_start+1, NAL_stop);
+		sei_rbsp(ctx->avc_ctx, rbsp, rbsp_stop);
 	}
 	else if ( ctx->avc_ctx->got_seq_para && nal_unit_type == CCX_NAL_TYPE_PICTURE_PARAMETER_SET )
 	{
@@ -136,16 +158,36 @@ void do_NAL (struct lib_cc_decode *ctx, unsigned char *NAL_start, LLONG NAL_leng
 	}
 	if (temp_debug)
 	{
-		int len = NAL_stop - (NAL_start + 1);
-		dbg_print(CCX_DMT_VIDES,"\n After decoding, the actual thing was (length =%d)\n", len);
-		dump(CCX_DMT_VIDES, NAL_start + 1, len > 160 ? 160 : len, 0, 0);
+		int len = rbsp_stop - rbsp;
+		dbg_print(CCX_DMT_VIDES,"\n After decoding, the actual thing was (length =%d)\n", rbsp_length);
+		dump(CCX_DMT_VIDES, rbsp, len > AVC_RBSP_HEAD_SIZE ? AVC_RBSP_HEAD_SIZE : len, 0, 0);
 	}
 
 	dvprint("END   NAL unit type: %d length %d ref_idc: %d - Buffered captions after: %d\n",
-			nal_unit_type,  NAL_stop-NAL_start-1, ctx->avc_ctx->nal_ref_idc, !ctx->avc_ctx->cc_buffer_saved);
+			nal_unit_type, rbsp_length, ctx->avc_ctx->nal_ref_idc, !ctx->avc_ctx->cc_buffer_saved);
 
 }
 
+size_t avc_nal_bytes_read(unsigned char nal_header, size_t nal_length)
+{
+	// The NAL header and the bytes that give AVC_RBSP_HEAD_SIZE once the
+	// emulation prevention bytes, at most one in three, are removed
+	size_t slice_head = 1 + AVC_RBSP_HEAD_SIZE + AVC_RBSP_HEAD_SIZE / 2;
+
+	switch (nal_header & 0x1F)
+	{
+		case CCX_NAL_TYPE_CODED_SLICE_NON_IDR_PICTURE_1:
+		case CCX_NAL_TYPE_CODED_SLICE_IDR_PICTURE:
+			return nal_length < slice_head ? nal_length : slice_head;
+		case CCX_NAL_TYPE_SEI:
+		case CCX_NAL_TYPE_SEQUENCE_PARAMETER_SET_7:
+		case CCX_NAL_TYPE_PICTURE_PARAMETER_SET:
+			return nal_length;
+		default:
+			return 0;
+	}
+}
+
 // Process inbuf bytes in buffer holding and AVC (H.264) video stream.
 // The number of processed bytes is returned.
 size_t process_avc ( struct lib_cc_decode *ctx, unsigned char *avcbuf, size_t avcbuflen ,struct cc_subtitle *sub)
@@ -167,76 +209,47 @@ size_t process_avc ( struct lib_cc_decode *ctx, unsigned char *avcbuf, size_t av
 		fatal(CCX_COMMON_EXIT_BUG_BUG,
 				"Broken AVC stream - Leading bytes are non-zero...");
 	}
-	buffer_position = buffer_position+2;
 
-	int firstloop=1; // Check for valid start code at buffer start
+	// The start codes are found a batch at a time
+	size_t offsets[AVC_START_CODE_BATCH];
+	size_t count = find_start_codes(avcbuf, avcbuflen, offsets, AVC_START_CODE_BATCH);
+	size_t next = 0;
+	unsigned char *start_code = count ? avcbuf + offsets[0] : NULL;
+	unsigned char *end = avcbuf + avcbuflen;
 
-	// Loop over NAL units
-	while(buffer_position < avcbuf + avcbuflen - 2) // buffer_position points to 0x01 plus at least two bytes
+	for (buffer_position = avcbuf + 2; buffer_position < (start_code ? start_code : end); buffer_position++)
 	{
-		int zeropad=0; // Count leading zeros
-
-		// Find next NAL_start
-		while (buffer_position < avcbuf + avcbuflen)
-		{
-			if(*buffer_position == 0x01)
-			{
-				// OK, found a start code
-				break;
-			}
-			else if(firstloop && *buffer_position != 0x00)
-			{
-				// Not 0x00 or 0x01
-				fatal(CCX_COMMON_EXIT_BUG_BUG,
-						"Broken AVC stream - Leading bytes are non-zero...");
-			}
-			buffer_position++;
-			zeropad++;
-		}
-		firstloop=0;
-		if (buffer_position >= avcbuf + avcbuflen)
+		if (*buffer_position != 0x00)
 		{
-			// No new start sequence
-			break;
+			// Not 0x00 before the first start code
+			fatal(CCX_COMMON_EXIT_BUG_BUG,
+					"Broken AVC stream - Leading bytes are non-zero...");
 		}
-		NAL_start = buffer_position+1;
-
-		// Find next start code or buffer end
-		LLONG restlen;
-		do
-		{
-			// Search for next 000000 or 000001
-			buffer_position++;
-			restlen = avcbuf - buffer_position + avcbuflen - 2; // leave room for two more bytes
+	}
 
-			// Find the next zero
-			if (restlen > 0)
-			{
-				buffer_position = (unsigned char *) memchr (buffer_position, 0x00, (size_t) restlen);
+	// Loop over NAL units, the 0x01 of the start code needs at least two bytes after it
+	while (start_code && start_code + 2 < end - 2)
+	{
+		NAL_start = start_code + 3;
 
-				if(!buffer_position)
-				{
-					// No 0x00 till the end of the buffer
-					NAL_stop = avcbuf + avcbuflen;
-					buffer_position = NAL_stop;
-					break;
-				}
+		// Next start code or buffer end, after the last one of a full
+		// batch the search goes on from it
+		if (++next == count)
+		{
+			size_t from = offsets[count - 1] + 3;
+			count = count < AVC_START_CODE_BATCH ? 0 :
+				find_start_codes(avcbuf + from, avcbuflen - from, offsets, AVC_START_CODE_BATCH);
+			for (size_t i = 0; i < count; i++)
+				offsets[i] += from;
+			next = 0;
+		}
+		start_code = next < count ? avcbuf + offsets[next] : NULL;
 
-				if(buffer_position[1]==0x00 && (buffer_position[2]|0x01)==0x01)
-				{
-					// Found new start code
-					NAL_stop = buffer_position;
-					buffer_position = buffer_position + 2; // Move after the two leading 0x00
-					break;
-				}
-			}
-			else
-			{
-				NAL_stop = avcbuf + avcbuflen;
-				buffer_position = NAL_stop;
-				break;
-			}
-		} while(restlen); // Should never be true - loop is exited via break
+		// The zeros before it, the first one of a four byte start code or
+		// trailing_zero_8bits, are not part of the NAL unit.
+		NAL_stop = start_code ? start_code : end;
+		while (NAL_stop > NAL_start + 1 && NAL_stop[-1] == 0x00)
+			NAL_stop--;
 
 		if(*NAL_start & 0x80)
 		{
@@ -246,7 +259,6 @@ size_t process_avc ( struct lib_cc_decode *ctx, unsigned char *avcbuf, size_t av
 		}
 
 		ctx->avc_ctx->nal_ref_idc = *NAL_start >> 5;
-                dvprint("process_avc: zeropad %d\n", zeropad);
 		do_NAL (ctx, NAL_start, NAL_stop-NAL_start, sub);
 	}
 
@@ -309,6 +321,39 @@ unsigned char *remove_03emu(unsigned char *from, unsigned char *to)
 	return from+newsize;
 }
 
+// Same as EBSPtoRBSP(), for the head of a NAL unit: the EBSP from..to is
+// copied to rbsp without its emulation prevention bytes, up to size bytes,
+// and not read any further. With rbsp NULL the bytes are only counted.
+// Returns the number of bytes, -1 if the part read is broken.
+static int ebsp_to_rbsp_head(unsigned char *rbsp, int size, const unsigned char *from, const unsigned char *to)
+{
+	const unsigned char *p;
+	int j = 0, count = 0;
+
+	for (p = from; p < to && j < size; p++)
+	{
+		if (count == ZEROBYTES_SHORTSTARTCODE && *p < 0x03)
+			return -1;
+		if (count == ZEROBYTES_SHORTSTARTCODE && *p == 0x03)
+		{
+			if (p < to - 1 && p[1] > 0x03)
+				return -1;
+			if (p == to - 1)
+				return j; // cabac_zero_word
+			p++;
+			count = 0;
+		}
+		if (rbsp)
+			rbsp[j] = *p;
+		if (*p == 0x00)
+			count++;
+		else
+			count = 0;
+		j++;
+	}
+	return j;
+}
+
 
 // Process SEI payload in AVC data. This function combines sei_rbsp()
 // and rbsp_trailing_bits().
@@ -330,7 +375,7 @@ void sei_rbsp (struct avc_ctx *ctx, unsigned char *seibuf, unsigned char *seiend
 	{
 		// TODO: This really really looks bad
 		mprint ("WARNING: Unexpected SEI unit length...trying to continue.");
-		temp_debug = 1;
+		set_temp_debug(1);
 		mprint ("\n Failed block (at sei_rbsp) was:\n");
 		dump (CCX_DMT_GENERIC_NOTICES,(unsigned char *) seibuf, seiend-seibuf,0,0);
 
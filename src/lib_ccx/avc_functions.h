@@ -48,8 +48,16 @@ struct avc_ctx
 	LLONG last_slice_pts;
 };
 
+// RBSP bytes of a slice that are unescaped: slice_header() reads at most 37,
+// the rest are for the dump with temp_debug
+#define AVC_RBSP_HEAD_SIZE 160
+
 struct avc_ctx *init_avc(void);
 void dinit_avc(struct avc_ctx **ctx);
 void do_NAL (struct lib_cc_decode *ctx, unsigned char *NAL_start, LLONG NAL_length, struct cc_subtitle *sub);
 size_t process_avc(struct lib_cc_decode *ctx, unsigned char *avcbuf, size_t avcbuflen, struct cc_subtitle *sub);
+/* Bytes of a NAL unit of nal_length bytes, starting with the nal_header byte,
+   that do_NAL() reads: all of a SEI or parameter set, the head of a slice,
+   none of the others. Readers of MP4 samples can leave out the rest. */
+size_t avc_nal_bytes_read(unsigned char nal_header, size_t nal_length);
 #endif
@@ -0,0 +1,215 @@
+#include "lib_ccx.h"
+#include "batch_jobs.h"
+
+int batch_job_fd = -1;
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+struct batch_job
+{
+	pid_t pid;
+	int fd; // Read end of the job's progress pipe, -1 if the slot is free
+	int file;
+	int percentage;
+};
+
+static int start_job(struct ccx_s_options *opt, struct batch_job *job, int file,
+		int (*run_job)(struct ccx_s_options *opt))
+{
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds))
+		return -1;
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		batch_job_fd = fds[1];
+		opt->inputfile[0] = opt->inputfile[file];
+		opt->num_input_files = 1;
+		opt->enc_cfg.first_input_file = opt->inputfile[0];
+		opt->jobs = 0;
+		opt->messages_target = 0; // Jobs would mix their messages up, errors still go to stderr
+		if (opt->metrics_file)
+		{
+			// Each job writes its own, with the number of its input file appended
+			char *name = malloc(strlen(opt->metrics_file) + 12);
+			if (name)
+			{
+				sprintf(name, "%s.%d", opt->metrics_file, file + 1);
+				opt->metrics_file = name;
+			}
+		}
+		exit(run_job(opt));
+	}
+	close(fds[1]);
+	job->pid = pid;
+	job->fd = fds[0];
+	job->file = file;
+	job->percentage = 0;
+	return 0;
+}
+
+/* Read the job's progress, return 1 once it is done */
+static int read_job_progress(struct batch_job *job)
+{
+	unsigned char buf[64];
+	ssize_t n = read(job->fd, buf, sizeof(buf));
+
+	if (n < 0)
+		return errno != EINTR && errno != EAGAIN;
+	if (n == 0)
+		return 1; // The job exited, closing its end of the pipe
+	job->percentage = buf[n - 1];
+	return 0;
+}
+
+static int finish_job(struct ccx_s_options *opt, struct batch_job *job)
+{
+	int status = 0;
+	int ret;
+
+	close(job->fd);
+	job->fd = -1;
+	while (waitpid(job->pid, &status, 0) < 0 && errno == EINTR)
+		;
+	if (WIFEXITED(status))
+		ret = WEXITSTATUS(status);
+	else
+		ret = EXIT_NOT_CLASSIFIED;
+
+	if (ret == EXIT_OK || ret == EXIT_NO_CAPTIONS)
+		mprint("\rDone: %s\n", opt->inputfile[job->file]);
+	else
+		mprint("\rFailed with exit code %d: %s\n", ret, opt->inputfile[job->file]);
+	return ret;
+}
+
+int run_batch_jobs(struct ccx_s_options *opt, int (*run_job)(struct ccx_s_options *opt))
+{
+	struct batch_job *jobs;
+	struct pollfd *pfd;
+	struct stat st;
+	LLONG *sizes;
+	LLONG total_size = 0, done_size = 0, progress_size;
+	time_t start = time(NULL), last_report = 0, now;
+	int nb_files = opt->num_input_files;
+	int next = 0, running = 0, done = 0, stopping = 0;
+	int ret = EXIT_OK, job_ret, caps = 0;
+	int i, n;
+
+	jobs = calloc(opt->jobs, sizeof(struct batch_job));
+	pfd = calloc(opt->jobs, sizeof(struct pollfd));
+	sizes = calloc(nb_files, sizeof(LLONG));
+	if (!jobs || !pfd || !sizes)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory to run the input files as jobs.\n");
+	for (i = 0; i < nb_files; i++)
+	{
+		if (!stat(opt->inputfile[i], &st))
+			sizes[i] = st.st_size;
+		total_size += sizes[i];
+	}
+	for (i = 0; i < opt->jobs; i++)
+		jobs[i].fd = -1;
+
+	mprint("Processing %d input files, %d at a time.\n", nb_files, opt->jobs);
+	while (running || (next < nb_files && !stopping))
+	{
+		for (i = 0; i < opt->jobs && next < nb_files && !stopping; i++)
+		{
+			if (jobs[i].fd != -1)
+				continue;
+			if (start_job(opt, &jobs[i], next, run_job))
+				fatal(EXIT_NOT_CLASSIFIED, "Unable to start a job for %s: %s\n", opt->inputfile[next], strerror(errno));
+			next++;
+			running++;
+		}
+
+		n = 0;
+		for (i = 0; i < opt->jobs; i++)
+		{
+			if (jobs[i].fd == -1)
+				continue;
+			pfd[n].fd = jobs[i].fd;
+			pfd[n].events = POLLIN;
+			pfd[n].revents = 0;
+			n++;
+		}
+		if (poll(pfd, n, 1000) > 0)
+		{
+			n = 0;
+			for (i = 0; i < opt->jobs; i++)
+			{
+				if (jobs[i].fd == -1)
+					continue;
+				if (pfd[n++].revents && read_job_progress(&jobs[i]))
+				{
+					job_ret = finish_job(opt, &jobs[i]);
+					if (job_ret == EXIT_OK)
+						caps = 1;
+					else if (ret == EXIT_OK && job_ret != EXIT_NO_CAPTIONS)
+						ret = job_ret;
+					done_size += sizes[jobs[i].file];
+					running--;
+					done++;
+				}
+			}
+		}
+
+		if (terminate_asap && !stopping)
+		{
+			mprint("\rStopping the running jobs.\n");
+			for (i = 0; i < opt->jobs; i++)
+			{
+				if (jobs[i].fd != -1)
+					kill(jobs[i].pid, SIGTERM);
+			}
+			stopping = 1;
+		}
+
+		now = time(NULL);
+		if (now != last_report)
+		{
+			progress_size = done_size;
+			for (i = 0; i < opt->jobs; i++)
+			{
+				if (jobs[i].fd != -1)
+					progress_size += sizes[jobs[i].file] * jobs[i].percentage / 100;
+			}
+			activity_progress(total_size ? (int) (progress_size * 100 / total_size) : done * 100 / nb_files,
+					(int) (now - start) / 60, (int) (now - start) % 60);
+			last_report = now;
+		}
+	}
+	mprint("\r%d of %d input files processed.\n", done, nb_files);
+	if (ret == EXIT_OK && done < nb_files)
+		ret = EXIT_NOT_CLASSIFIED;
+	else if (ret == EXIT_OK && !caps)
+		ret = EXIT_NO_CAPTIONS; // Like a single run that found nothing
+
+	free(jobs);
+	free(pfd);
+	free(sizes);
+	return ret;
+}
+
+#else // _WIN32
+
+int run_batch_jobs(struct ccx_s_options *opt, int (*run_job)(struct ccx_s_options *opt))
+{
+	return run_job(opt);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef BATCH_JOBS_H
+#define BATCH_JOBS_H
+
+#include "ccx_common_option.h"
+
+/**
+ * -jobs N: every input file is an independent job, run in a process of its
+ * own so that it gets its own copy of the options and of the decoders' global
+ * state. Up to N jobs run at the same time and whenever one is done, the next
+ * input file is handed to a new one.
+ */
+
+/* Set in a job, where activity_progress() reports to the batch through it */
+extern int batch_job_fd;
+
+/**
+ * Run every input file of opt as a job and show the overall progress.
+ *
+ * @param run_job called in the job's process, with opt changed to only have
+ *                the job's input file. Its return value is the job's exit code.
+ *
+ * @return the exit code of the first job that failed, or else EXIT_OK if any
+ *         job found captions and EXIT_NO_CAPTIONS if none did.
+ */
+int run_batch_jobs(struct ccx_s_options *opt, int (*run_job)(struct ccx_s_options *opt));
+
+#endif
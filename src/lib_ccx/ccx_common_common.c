@@ -89,6 +89,7 @@ int add_cc_sub_text(struct cc_subtitle *sub, char *str, LLONG start_time,
 	sub->nb_data = str? strlen(str): 0;
 	sub->start_time = start_time;
 	sub->end_time = end_time;
+	sub->flags = 0;
 	if(info)
 		strncpy(sub->info, info, 4);
 	if(mode)
@@ -43,10 +43,25 @@
 void fdprintf(int fd, const char *fmt, ...);
 void millis_to_time(LLONG milli, unsigned *hours, unsigned *minutes,unsigned *seconds, unsigned *ms);
 void freep(void *arg);
-void dbg_print(LLONG mask, const char *fmt, ...);
+void (dbg_print)(LLONG mask, const char *fmt, ...);
+void dbg_flush(void);
 unsigned char *debug_608_to_ASC(unsigned char *ccdata, int channel);
 int add_cc_sub_text(struct cc_subtitle *sub, char *str, LLONG start_time,
 		LLONG end_time, char *info, char *mode, enum ccx_encoding_type);
 
 extern int cc608_parity_table[256]; // From myth
+extern LLONG ccx_dbg_mask; // Categories printed right now, 0 when quiet
+
+#ifdef CCX_NO_VERBOSE_DEBUG
+#define CCX_DMT_COMPILED_OUT CCX_DMT_VERBOSE_CATEGORIES
+#else
+#define CCX_DMT_COMPILED_OUT 0
+#endif
+
+/* The mask is tested before the arguments are evaluated, so a message of a
+   category that is off costs a load and a test, and one of a category that is
+   compiled out costs nothing. */
+#define ccx_dbg_enabled(mask) (((mask) & ~(LLONG) CCX_DMT_COMPILED_OUT & ccx_dbg_mask) != 0)
+#define dbg_print(mask, ...) do { if (ccx_dbg_enabled(mask)) (dbg_print)((mask), __VA_ARGS__); } while (0)
+#define ccx_debug(mask, ...) do { if (ccx_dbg_enabled(mask)) ccx_common_logging.debug_ftn((mask), __VA_ARGS__); } while (0)
 #endif
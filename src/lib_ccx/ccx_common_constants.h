@@ -63,6 +63,9 @@ enum ccx_debug_message_types
 	CCX_DMT_DUMPDEF=0x4000,        // Dump defective TS packets
 };
 
+// Per packet categories, compiled out of builds made with CCX_NO_VERBOSE_DEBUG
+#define CCX_DMT_VERBOSE_CATEGORIES (CCX_DMT_PARSE | CCX_DMT_VIDES | CCX_DMT_VERBOSE | CCX_DMT_CBRAW | CCX_DMT_LEVENSHTEIN | CCX_DMT_DUMPDEF)
+
 // AVC NAL types
 enum ccx_avc_nal_types
 {
@@ -202,6 +205,7 @@ enum ccx_stream_mode_enum
 	CCX_SM_GXF = 11,
 	CCX_SM_MKV = 12,
 	CCX_SM_MXF = 13,
+	CCX_SM_FMP4 = 14,    // Fragmented MP4 read as a stream, see ccx_demuxer_fmp4.h
 
 	CCX_SM_AUTODETECT = 16
 };
@@ -12,6 +12,7 @@ void init_options (struct ccx_s_options *options)
 #else
 	options->buffer_input = 0; // In linux, not so much.
 #endif
+	options->mmap_input = 0;
 	options->nofontcolor=0; // 1 = don't put <font color> tags
 	options->notypesetting=0; // 1 = Don't put <i>, <u>, etc typesetting tags
 	options->no_rollup = 0;
@@ -68,7 +69,12 @@ void init_options (struct ccx_s_options *options)
 	options->ocrlang = NULL; // By default, autodetect .traineddata file
 	options->ocr_oem = 0; // By default, set Tesseract OEM mode OEM_TESSERACT_ONLY (0)
 	options->ocr_quantmode = 1; // CCExtractor's internal
+	options->ocr_cache_size = 1024;
+	options->ocr_cache_file = NULL; // By default, the OCR cache lasts for the run only
+	options->ocr_threads = 0;
+	options->ocr_max_latency = 0;
 	options->mkvlang = NULL; // By default, all the languages are extracted 
+	options->mkv_skip_clusters = 0;
 	options->ignore_pts_jumps = 1;
 	options->analyze_video_stream = 0;
 
@@ -93,6 +99,9 @@ void init_options (struct ccx_s_options *options)
 	options->udpsrc = NULL;
 	options->udpaddr = NULL;
 	options->udpport=0; // Non-zero => Listen for UDP packets on this port, no files.
+	options->udp_rcvbuf = 0;
+	options->udp_ring_size = 16;
+	options->metrics_interval = 10;
 	options->send_to_srv = 0;
 	options->tcpport = NULL;
 	options->tcp_password = NULL;
@@ -102,6 +111,8 @@ void init_options (struct ccx_s_options *options)
 	options->noautotimeref=0; // Do NOT set time automatically?
 	options->input_source=CCX_DS_FILE; // Files, stdin or network
 	options->multiprogram = 0;
+	options->program_threads = 0;
+	options->jobs = 0;
 	options->out_interval = -1;
 	options->segment_on_key_frames_only = 0;
 
@@ -133,6 +144,7 @@ void init_options (struct ccx_s_options *options)
 	options->enc_cfg.services_charsets = NULL;
 	options->enc_cfg.all_services_charset = NULL;
 	options->enc_cfg.with_semaphore = 0;
+	options->enc_cfg.output_buffer_size = 64 * 1024;
 
 	options->settings_dtvcc.enabled = 0;
 	options->settings_dtvcc.active_services_count = 0;
@@ -144,6 +156,8 @@ void init_options (struct ccx_s_options *options)
 #ifdef ENABLE_SHARING
 	options->sharing_enabled = 0;
 	options->sharing_url = NULL;
+	options->sharing_batch = 1;
+	options->sharing_wait = 1000;
 	options->translate_enabled = 0;
 	options->translate_key = NULL;
 	options->translate_langs = NULL;
@@ -37,6 +37,8 @@ struct encoder_cfg
 	int keep_output_closed;
 	int force_flush;                     // Force flush on content write
 	int append_mode;                     // Append mode for output files
+	size_t output_buffer_size;           // Bytes of output held back before writing, 0 = none
+	int flush_each_sub;                  // Write the output buffer out after every subtitle (live)
 	int ucla;                            // 1 if -UCLA used, 0 if not
 
 	enum ccx_encoding_type encoding;
@@ -89,6 +91,7 @@ struct ccx_s_options // Options from user parameters
 	int webvtt_create_css;
 	int cc_channel;                                            // Channel we want to dump in srt mode
 	int buffer_input;
+	int mmap_input;                                            // Memory map input files instead of read()ing them
 	int nofontcolor;
 	int nohtmlescape;
 	int notypesetting;
@@ -138,7 +141,12 @@ struct ccx_s_options // Options from user parameters
 	char *ocrlang;                    // The name of the .traineddata file to be loaded with tesseract
 	int ocr_oem;                      // The Tesseract OEM mode, could be 0 (default), 1 or 2
 	int ocr_quantmode;				  // How to quantize the bitmap before passing to to tesseract (0=no quantization at all, 1=CCExtractor's internal)
+	int ocr_cache_size;               // Max number of OCR results kept to reuse for identical bitmaps, 0 = no cache
+	char *ocr_cache_file;             // File the OCR cache is loaded from and saved to, NULL if none
+	int ocr_threads;                  // Threads doing the OCR, 0 = OCR on the decoding thread
+	int ocr_max_latency;              // ms after which a subtitle still being OCR'd is output without text, 0 = no limit
 	char *mkvlang;                    // The name of the language stream for MKV
+	int mkv_skip_clusters;            // If 1, skip the MKV clusters the Cues show have no subtitles
 	int analyze_video_stream;         // If 1, the video stream will be processed even if we're using a different one for subtitles.
 
 	/*HardsubX related stuff*/
@@ -163,6 +171,8 @@ struct ccx_s_options // Options from user parameters
 	char *udpsrc;
 	char *udpaddr;
 	unsigned udpport;                                   // Non-zero => Listen for UDP packets on this port, no files.
+	int udp_rcvbuf;                                     // Bytes of socket buffer asked to the kernel, 0 = system default
+	int udp_ring_size;                                  // MB of datagrams read ahead by a receive thread, 0 = no thread
 	char *tcpport;
 	char *tcp_password;
 	char *tcp_desc;
@@ -182,8 +192,13 @@ struct ccx_s_options // Options from user parameters
 	int pes_header_to_stdout;                           // If this is set to 1, the PES Header will be printed to console (debugging purposes)
 	int ignore_pts_jumps;                               // If 1, the program will ignore PTS jumps. Sometimes this parameter is required for DVB subs with > 30s pause time
 	int multiprogram;
+	int program_threads; // With multiprogram, decode each program in a thread of its own
+	int jobs; // Input files processed at the same time as independent jobs, 0 = one after another
 	int out_interval;
 	int segment_on_key_frames_only;
+	char *metrics_file;                                 // Where the pipeline metrics are written, NULL = only on SIGUSR2, to stderr
+	int metrics_interval;                               // Seconds between writes of metrics_file, 0 = only at the end
+	int metrics_format;                                 // CCX_METRICS_JSON or CCX_METRICS_PROMETHEUS
 #ifdef WITH_LIBCURL
 	char *curlposturl;
 #endif
@@ -193,6 +208,8 @@ struct ccx_s_options // Options from user parameters
 	//CC sharing
 	int sharing_enabled;
 	char *sharing_url;
+	int sharing_batch; // Messages per frame at most, 1 for a bare message per frame
+	int sharing_wait;  // ms subscribers are given to subscribe before the first message
 	//Translating
 	int translate_enabled;
 	char *translate_langs;
@@ -55,6 +55,14 @@
 
 	#include "disable_warnings.h"
 
+	// Decoding state that still lives in globals. Each -programthreads
+	// worker thread gets its own copy; there are no workers on Windows.
+	#ifdef _WIN32
+		#define CCX_THREAD_LOCAL
+	#else
+		#define CCX_THREAD_LOCAL __thread
+	#endif
+
 	#ifdef _MSC_VER
 		#include "stdintmsc.h"
 		// Don't bug me with strcpy() deprecation warnings
@@ -9,23 +9,23 @@
  */
 
 // Count 608 (per field) and 708 blocks since last set_fts() call
-int cb_field1, cb_field2, cb_708;
+CCX_THREAD_LOCAL int cb_field1, cb_field2, cb_708;
 
 int MPEG_CLOCK_FREQ = 90000; // This "constant" is part of the standard
 
 int max_dif = 5;
-unsigned pts_big_change;
+CCX_THREAD_LOCAL unsigned pts_big_change;
 
 // PTS timing related stuff
 
-double current_fps = (double) 30000.0 / 1001; /* 29.97 */ // TODO: Get from framerates_values[] instead
+CCX_THREAD_LOCAL double current_fps = (double) 30000.0 / 1001; /* 29.97 */ // TODO: Get from framerates_values[] instead
 
-int frames_since_ref_time = 0;
-unsigned total_frames_count;
+CCX_THREAD_LOCAL int frames_since_ref_time = 0;
+CCX_THREAD_LOCAL unsigned total_frames_count;
 
-struct gop_time_code gop_time, first_gop_time, printed_gop;
-LLONG fts_at_gop_start = 0;
-int gop_rollover = 0;
+CCX_THREAD_LOCAL struct gop_time_code gop_time, first_gop_time, printed_gop;
+CCX_THREAD_LOCAL LLONG fts_at_gop_start = 0;
+CCX_THREAD_LOCAL int gop_rollover = 0;
 
 struct ccx_common_timing_settings_t ccx_common_timing_settings;
 
@@ -180,10 +180,10 @@ int set_fts(struct ccx_common_timing_ctx *ctx)
 							-frames_since_ref_time+1)
 						*1000.0/current_fps);
 			}
-			ccx_common_logging.debug_ftn(CCX_DMT_TIME, "\nFirst sync time    PTS: %s %+lldms (time before this PTS)\n",
+			ccx_debug(CCX_DMT_TIME, "\nFirst sync time    PTS: %s %+lldms (time before this PTS)\n",
 					print_mstime_static(ctx->min_pts/(MPEG_CLOCK_FREQ/1000)),
 					ctx->fts_offset );
-			ccx_common_logging.debug_ftn(CCX_DMT_TIME, "Total_frames_count %u frames_since_ref_time %u\n",
+			ccx_debug(CCX_DMT_TIME, "Total_frames_count %u frames_since_ref_time %u\n",
 					total_frames_count, frames_since_ref_time);
 		}
 
@@ -210,7 +210,7 @@ int set_fts(struct ccx_common_timing_ctx *ctx)
 			// Set min_pts = sync_pts as this is used for fts_now
 			ctx->min_pts = ctx->sync_pts;
 
-			ccx_common_logging.debug_ftn(CCX_DMT_TIME, "\nNew min PTS time: %s %+lldms (time before this PTS)\n",
+			ccx_debug(CCX_DMT_TIME, "\nNew min PTS time: %s %+lldms (time before this PTS)\n",
 					print_mstime_static(ctx->min_pts/(MPEG_CLOCK_FREQ/1000)),
 					ctx->fts_offset );
 		}
@@ -274,7 +274,7 @@ LLONG get_fts(struct ccx_common_timing_ctx *ctx, int current_field)
 		default:
 			ccx_common_logging.fatal_ftn(CCX_COMMON_EXIT_BUG_BUG, "get_fts: unhandled branch");
 	}
-//	ccx_common_logging.debug_ftn(CCX_DMT_TIME, "[FTS] "
+//	ccx_debug(CCX_DMT_TIME, "[FTS] "
 //			"fts: %llu, fts_now: %llu, fts_global: %llu, current_field: %llu, cb_708: %llu\n",
 //								 fts, fts_now, fts_global, current_field, cb_708);
 	return fts;
@@ -312,7 +312,7 @@ size_t print_mstime_buff(LLONG mstime, char* fmt, char* buf){
    to the microsecond value in mstime. */
 char *print_mstime_static( LLONG mstime )
 {
-	static char buf[15]; // 14 should be long enough
+	static CCX_THREAD_LOCAL char buf[15]; // 14 should be long enough
 	print_mstime_buff(mstime, "%02u:%02u:%02u:%03u", buf);
 	return buf;
 }
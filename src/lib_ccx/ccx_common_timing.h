@@ -52,22 +52,22 @@ struct ccx_common_timing_ctx
 	LLONG sync_pts2fts_pts;
 };
 // Count 608 (per field) and 708 blocks since last set_fts() call
-extern int cb_field1, cb_field2, cb_708;
+extern CCX_THREAD_LOCAL int cb_field1, cb_field2, cb_708;
 
 extern int MPEG_CLOCK_FREQ; // This is part of the standard
 
 extern int max_dif;
-extern unsigned pts_big_change;
+extern CCX_THREAD_LOCAL unsigned pts_big_change;
 
 
 extern enum ccx_frame_type current_picture_coding_type;
-extern double current_fps;
-extern int frames_since_ref_time;
-extern unsigned total_frames_count;
+extern CCX_THREAD_LOCAL double current_fps;
+extern CCX_THREAD_LOCAL int frames_since_ref_time;
+extern CCX_THREAD_LOCAL unsigned total_frames_count;
 
-extern struct gop_time_code gop_time, first_gop_time, printed_gop;
-extern LLONG fts_at_gop_start;
-extern int gop_rollover;
+extern CCX_THREAD_LOCAL struct gop_time_code gop_time, first_gop_time, printed_gop;
+extern CCX_THREAD_LOCAL LLONG fts_at_gop_start;
+extern CCX_THREAD_LOCAL int gop_rollover;
 
 void ccx_common_timing_init(LLONG *file_position, int no_sync);
 
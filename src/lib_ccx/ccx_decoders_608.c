@@ -8,7 +8,7 @@
 
 static const int rowdata[] = {11,-1,1,2,3,4,12,13,14,15,5,6,7,8,9,10};
 // Relationship between the first PAC byte and the row number
-int in_xds_mode=0;
+CCX_THREAD_LOCAL int in_xds_mode=0;
 
 //unsigned char str[2048]; // Another generic general purpose buffer
 
@@ -245,18 +245,18 @@ void handle_text_attr(const unsigned char c1, const unsigned char c2, ccx_decode
 	context->channel = context->new_channel;
 	if (context->channel != context->my_channel)
 		return;
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\r608: text_attr: %02X %02X", c1, c2);
+	ccx_debug(CCX_DMT_DECODER_608, "\r608: text_attr: %02X %02X", c1, c2);
 	if ( ((c1!=0x11 && c1!=0x19) ||
 		(c2<0x20 || c2>0x2f)))
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rThis is not a text attribute!\n");
+		ccx_debug(CCX_DMT_DECODER_608, "\rThis is not a text attribute!\n");
 	}
 	else
 	{
 		int i = c2-0x20;
 		context->current_color = pac2_attribs[i][0];
 		context->font = pac2_attribs[i][1];
-		ccx_common_logging.debug_ftn(
+		ccx_debug(
 			CCX_DMT_DECODER_608,
 			"  --  Color: %s,  font: %s\n",
 			color_text[context->current_color][0],
@@ -511,7 +511,7 @@ int roll_up(ccx_decoder_608_context *context)
 		}
 	}
 
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rIn roll-up: %d lines used, first: %d, last: %d\n", rows_orig, firstrow, lastrow);
+	ccx_debug(CCX_DMT_DECODER_608, "\rIn roll-up: %d lines used, first: %d, last: %d\n", rows_orig, firstrow, lastrow);
 
 	if (lastrow==-1) // Empty screen, nothing to rollup
 		return 0;
@@ -649,8 +649,8 @@ void handle_command(unsigned char c1, const unsigned char c2, ccx_decoder_608_co
 	else if (command == COM_ROLLUP4 && context->settings->force_rollup == 3)
 		command=COM_ROLLUP3;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rCommand begin: %02X %02X (%s)\n", c1, c2, command_type[command]);
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rCurrent mode: %d  Position: %d,%d  VisBuf: %d\n", context->mode,
+	ccx_debug(CCX_DMT_DECODER_608, "\rCommand begin: %02X %02X (%s)\n", c1, c2, command_type[command]);
+	ccx_debug(CCX_DMT_DECODER_608, "\rCurrent mode: %d  Position: %d,%d  VisBuf: %d\n", context->mode,
 		context->cursor_row, context->cursor_column, context->visible_buffer);
 
 	switch (command)
@@ -814,12 +814,12 @@ void handle_command(unsigned char c1, const unsigned char c2, ccx_decoder_608_co
 			//ccx_common_logging.log_ftn ("to transcribe to a text file.\n");
 			break;
 		default:
-			ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rNot yet implemented.\n");
+			ccx_debug(CCX_DMT_DECODER_608, "\rNot yet implemented.\n");
 			break;
 	}
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rCurrent mode: %d  Position: %d,%d	VisBuf: %d\n", context->mode,
+	ccx_debug(CCX_DMT_DECODER_608, "\rCurrent mode: %d  Position: %d,%d	VisBuf: %d\n", context->mode,
 		context->cursor_row, context->cursor_column, context->visible_buffer);
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rCommand end: %02X %02X (%s)\n", c1, c2, command_type[command]);
+	ccx_debug(CCX_DMT_DECODER_608, "\rCommand end: %02X %02X (%s)\n", c1, c2, command_type[command]);
 
 }
 
@@ -839,7 +839,7 @@ void handle_double(const unsigned char c1, const unsigned char c2, ccx_decoder_6
 	if (c2>=0x30 && c2<=0x3f)
 	{
 		c=c2 + 0x50; // So if c>=0x80 && c<=0x8f, it comes from here
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rDouble: %02X %02X  -->  %c\n", c1, c2, c);
+		ccx_debug(CCX_DMT_DECODER_608, "\rDouble: %02X %02X  -->  %c\n", c1, c2, c);
 		write_char(c, context);
 	}
 }
@@ -851,7 +851,7 @@ unsigned char handle_extended(unsigned char hi, unsigned char lo, ccx_decoder_60
 	if (context->new_channel > 2)
 	{
 		context->new_channel -= 2;
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\nChannel correction, now %d\n", context->new_channel);
+		ccx_debug(CCX_DMT_DECODER_608, "\nChannel correction, now %d\n", context->new_channel);
 	}
 	context->channel = context->new_channel;
 	if (context->channel != context->my_channel)
@@ -860,7 +860,7 @@ unsigned char handle_extended(unsigned char hi, unsigned char lo, ccx_decoder_60
 	// For lo values between 0x20-0x3f
 	unsigned char c=0;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rExtended: %02X %02X\n", hi, lo);
+	ccx_debug(CCX_DMT_DECODER_608, "\rExtended: %02X %02X\n", hi, lo);
 	if (lo>=0x20 && lo<=0x3f && (hi==0x12 || hi==0x13))
 	{
 		switch (hi)
@@ -890,7 +890,7 @@ void handle_pac(unsigned char c1, unsigned char c2, ccx_decoder_608_context *con
 	if (context->new_channel > 2)
 	{
 		context->new_channel -= 2;
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\nChannel correction, now %d\n", context->new_channel);
+		ccx_debug(CCX_DMT_DECODER_608, "\nChannel correction, now %d\n", context->new_channel);
 	}
 	context->channel = context->new_channel;
 	if (context->channel != context->my_channel)
@@ -898,7 +898,7 @@ void handle_pac(unsigned char c1, unsigned char c2, ccx_decoder_608_context *con
 
 	int row=rowdata[((c1<<1)&14)|((c2>>5)&1)];
 
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rPAC: %02X %02X", c1, c2);
+	ccx_debug(CCX_DMT_DECODER_608, "\rPAC: %02X %02X", c1, c2);
 
 	if (c2>=0x40 && c2<=0x5f)
 	{
@@ -912,14 +912,14 @@ void handle_pac(unsigned char c1, unsigned char c2, ccx_decoder_608_context *con
 		}
 		else
 		{
-			ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\rThis is not a PAC!!!!!\n");
+			ccx_debug(CCX_DMT_DECODER_608, "\rThis is not a PAC!!!!!\n");
 			return;
 		}
 	}
 	context->current_color = pac2_attribs[c2][0];
 	context->font = pac2_attribs[c2][1];
 	int indent=pac2_attribs[c2][2];
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "  --  Position: %d:%d, color: %s,  font: %s\n", row,
+	ccx_debug(CCX_DMT_DECODER_608, "  --  Position: %d:%d, color: %s,  font: %s\n", row,
 		indent, color_text[context->current_color][0], font_text[context->font]);
 	if (context->settings->default_color == COL_USERDEFINED && (context->current_color == COL_WHITE || context->current_color == COL_TRANSPARENT))
 		context->current_color = COL_USERDEFINED;
@@ -959,7 +959,7 @@ void handle_single(const unsigned char c1, ccx_decoder_608_context *context)
 {
 	if (c1<0x20 || context->channel != context->my_channel)
 		return; // We don't allow special stuff here
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "%c", c1);
+	ccx_debug(CCX_DMT_DECODER_608, "%c", c1);
 
 	write_char (c1,context);
 }
@@ -990,7 +990,7 @@ int check_channel(unsigned char c1, ccx_decoder_608_context *context)
 		newchan=2;
 	if (newchan != context->channel)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\nChannel change, now %d\n", newchan);
+		ccx_debug(CCX_DMT_DECODER_608, "\nChannel change, now %d\n", newchan);
 		if (context->channel != 3) // Don't delete memories if returning from XDS.
 		{
 			// erase_both_memories (wb); // 47cfr15.119.pdf, page 859, part f
@@ -1117,7 +1117,8 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 			if (context == NULL || context->my_field == 2) // Originally: current_field from sequencing.c. Seems to be just to change channel, so context->my_field seems good.
 				ch+=2;
 
-			if(report)
+			// Only ever set, and shared by the programs' threads with -programthreads
+			if(report && !report->cc_channels[ch - 1])
 				report->cc_channels[ch - 1] = 1;
 		}
 
@@ -1130,7 +1131,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 				ts_start_of_xds = get_fts(dec_ctx->timing, dec_ctx->current_field);
 				in_xds_mode = 1;
 			}
-			if(report)
+			if(report && !report->xds)
 				report->xds = 1;
 		}
 		if (hi == 0x0F && in_xds_mode && (context == NULL || context->my_field == 2)) // End of XDS block
@@ -1154,7 +1155,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 			// diagnostic output from disCommand()
 			if (context->textprinted == 1 )
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\n");
+				ccx_debug(CCX_DMT_DECODER_608, "\n");
 				context->textprinted = 0;
 			}
 
@@ -1162,7 +1163,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 			{
 				// Duplicate dual code, discard. Correct to do it only in
 				// non-XDS, XDS codes shall not be repeated.
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "Skipping command %02X,%02X Duplicate\n", hi, lo);
+				ccx_debug(CCX_DMT_DECODER_608, "Skipping command %02X,%02X Duplicate\n", hi, lo);
 				// Ignore only the first repetition
 				context->last_c1=-1;
 				context->last_c2 = -1;
@@ -1198,7 +1199,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 
 				if( context->textprinted == 0 )
 				{
-					ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "\n");
+					ccx_debug(CCX_DMT_DECODER_608, "\n");
 					context->textprinted = 1;
 				}
 
@@ -1211,7 +1212,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
 
 			if (!context->textprinted && context->channel == context->my_channel)
 			{   // Current FTS information after the characters are shown
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "Current FTS: %s\n", print_mstime_static(get_fts(dec_ctx->timing, context->my_field)));
+				ccx_debug(CCX_DMT_DECODER_608, "Current FTS: %s\n", print_mstime_static(get_fts(dec_ctx->timing, context->my_field)));
 				//printf("  N:%u", unsigned(fts_now) );
 				//printf("  G:%u", unsigned(fts_global) );
 				//printf("  F:%d %d %d %d\n",
@@ -1240,7 +1241,7 @@ int process608(const unsigned char *data, int length, void *private_data, struct
  * of the caption data block. FOR DEBUG PURPOSES ONLY! */
 unsigned char *debug_608_to_ASC (unsigned char *cc_data, int channel)
 {
-	static unsigned char output[3];
+	static CCX_THREAD_LOCAL unsigned char output[3];
 
 	unsigned char cc_valid = (cc_data[0] & 4) >>2;
 	unsigned char cc_type = cc_data[0] & 3;
@@ -4,7 +4,7 @@
 #include "ccx_common_structs.h"
 #include "ccx_decoders_structs.h"
 
-extern LLONG ts_start_of_xds;
+extern CCX_THREAD_LOCAL LLONG ts_start_of_xds;
 
 /*
    This variable (ccx_decoder_608_report) holds data on the cc channels & xds packets that are encountered during file parse.
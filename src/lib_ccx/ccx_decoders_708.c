@@ -293,7 +293,7 @@ void _dtvcc_get_win_write_interval(ccx_dtvcc_window *window, int row_index, int
 
 void _dtvcc_window_dump(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_window *window)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "[CEA-708] Window %d dump:\n", window->number);
+	ccx_debug(CCX_DMT_GENERIC_NOTICES, "[CEA-708] Window %d dump:\n", window->number);
 
 	if (!window->is_defined)
 		return;
@@ -305,7 +305,7 @@ void _dtvcc_window_dump(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_window *wi
 	print_mstime_buff(window->time_ms_show, "%02u:%02u:%02u:%03u", tbuf1);
 	print_mstime_buff(window->time_ms_hide, "%02u:%02u:%02u:%03u", tbuf2);
 
-	ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "\r%s --> %s\n", tbuf1, tbuf2);
+	ccx_debug(CCX_DMT_GENERIC_NOTICES, "\r%s --> %s\n", tbuf1, tbuf2);
 	for (int i = 0; i < CCX_DTVCC_MAX_ROWS; i++)
 	{
 		if (!_dtvcc_is_win_row_empty(window, i))
@@ -318,13 +318,13 @@ void _dtvcc_window_dump(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_window *wi
 				sym = window->rows[i][j];
 				int len = utf16_to_utf8(sym.sym, sym_buf);
 				for (int index = 0; index < len; index++)
-					ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "%c", sym_buf[index]);
+					ccx_debug(CCX_DMT_GENERIC_NOTICES, "%c", sym_buf[index]);
 			}
-			ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "\n");
+			ccx_debug(CCX_DMT_GENERIC_NOTICES, "\n");
 		}
 	}
 
-	ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "[CEA-708] Dump done\n", window->number);
+	ccx_debug(CCX_DMT_GENERIC_NOTICES, "[CEA-708] Dump done\n", window->number);
 }
 
 #endif
@@ -344,7 +344,7 @@ void ccx_dtvcc_windows_reset(ccx_dtvcc_service_decoder *decoder)
 
 void _dtvcc_decoders_reset(ccx_dtvcc_ctx *dtvcc)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_decoders_reset: Resetting all decoders\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_decoders_reset: Resetting all decoders\n");
 
 	for (int i = 0; i < CCX_DTVCC_MAX_SERVICES; i++)
 	{
@@ -371,7 +371,7 @@ void _dtvcc_window_update_time_show(ccx_dtvcc_window *window, struct ccx_common_
 	char buf[128];
 	window->time_ms_show = get_visible_start(timing, 3);
 	print_mstime_buff(window->time_ms_show, "%02u:%02u:%02u:%03u", buf);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] "
+	ccx_debug(CCX_DMT_708, "[CEA-708] "
 			"[W-%d] show time updated to %s\n", window->number, buf);
 }
 
@@ -380,7 +380,7 @@ void _dtvcc_window_update_time_hide(ccx_dtvcc_window *window, struct ccx_common_
 	char buf[128];
 	window->time_ms_hide = get_visible_end(timing, 3);
 	print_mstime_buff(window->time_ms_hide, "%02u:%02u:%02u:%03u", buf);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] "
+	ccx_debug(CCX_DMT_708, "[CEA-708] "
 			"[W-%d] hide time updated to %s\n", window->number, buf);
 }
 
@@ -389,7 +389,7 @@ void _dtvcc_screen_update_time_show(dtvcc_tv_screen *tv, LLONG time)
 	char buf1[128], buf2[128];
 	print_mstime_buff(tv->time_ms_show, "%02u:%02u:%02u:%03u", buf1);
 	print_mstime_buff(time, "%02u:%02u:%02u:%03u", buf2);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] "
+	ccx_debug(CCX_DMT_708, "[CEA-708] "
 			"Screen show time: %s -> %s\n", buf1, buf2);
 
 	if (tv->time_ms_show == -1)
@@ -403,7 +403,7 @@ void _dtvcc_screen_update_time_hide(dtvcc_tv_screen *tv, LLONG time)
 	char buf1[128], buf2[128];
 	print_mstime_buff(tv->time_ms_hide, "%02u:%02u:%02u:%03u", buf1);
 	print_mstime_buff(time, "%02u:%02u:%02u:%03u", buf2);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] "
+	ccx_debug(CCX_DMT_708, "[CEA-708] "
 			"Screen hide time: %s -> %s\n", buf1, buf2);
 
 	if (tv->time_ms_hide == -1)
@@ -414,7 +414,7 @@ void _dtvcc_screen_update_time_hide(dtvcc_tv_screen *tv, LLONG time)
 
 void _dtvcc_window_copy_to_screen(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_window *window)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_window_copy_to_screen: W-%d\n", window->number);
+	ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_window_copy_to_screen: W-%d\n", window->number);
 	int top, left;
 	// For each window we calculate the top, left position depending on the
 	// anchor
@@ -460,12 +460,12 @@ void _dtvcc_window_copy_to_screen(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_
 			return;
 			break;
 	}
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] For window %d: Anchor point -> %d, size %d:%d, real position %d:%d\n",
+	ccx_debug(CCX_DMT_708, "[CEA-708] For window %d: Anchor point -> %d, size %d:%d, real position %d:%d\n",
 								 window->number, window->anchor_point, window->row_count, window->col_count,
 								 top, left
 	);
 
-	ccx_common_logging.debug_ftn(
+	ccx_debug(
 			CCX_DMT_708, "[CEA-708] we have top [%d] and left [%d]\n", top, left);
 
 	top = top < 0 ? 0 : top;
@@ -476,7 +476,7 @@ void _dtvcc_window_copy_to_screen(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_
 	int copycols = left + window->col_count >= CCX_DTVCC_SCREENGRID_COLUMNS ?
 				   CCX_DTVCC_SCREENGRID_COLUMNS - left : window->col_count;
 
-	ccx_common_logging.debug_ftn(
+	ccx_debug(
 			CCX_DMT_708, "[CEA-708] %d*%d will be copied to the TV.\n", copyrows, copycols);
 
 	for (int j = 0; j < copyrows; j++)
@@ -502,12 +502,12 @@ void _dtvcc_screen_print(ccx_dtvcc_ctx *dtvcc, ccx_dtvcc_service_decoder *decode
 	//TODO use priorities to solve windows overlap (with a video sample, please)
 	//qsort(wnd, visible, sizeof(ccx_dtvcc_window *), _dtvcc_compare_win_priorities);
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_screen_print\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_screen_print\n");
 
 	_dtvcc_screen_update_time_hide(decoder->tv, get_visible_end(dtvcc->timing, 3));
 
 #ifdef DTVCC_PRINT_DEBUG
-	//ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "[CEA-708] TV dump:\n");
+	//ccx_debug(CCX_DMT_GENERIC_NOTICES, "[CEA-708] TV dump:\n");
 	//ccx_dtvcc_write_debug(decoder->tv);
 #endif
 	decoder->cc_count++;
@@ -651,7 +651,7 @@ void _dtvcc_process_cr(ccx_dtvcc_ctx *dtvcc, ccx_dtvcc_service_decoder *decoder)
 
 	if (window->is_defined)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_process_cr: rolling up\n");
+		ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_process_cr: rolling up\n");
 
 		_dtvcc_window_update_time_hide(window, dtvcc->timing);
 		_dtvcc_window_copy_to_screen(decoder, window);
@@ -670,11 +670,11 @@ void _dtvcc_process_cr(ccx_dtvcc_ctx *dtvcc, ccx_dtvcc_service_decoder *decoder)
 
 void _dtvcc_process_character(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_symbol symbol)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] %d\n", decoder->current_window);
+	ccx_debug(CCX_DMT_708, "[CEA-708] %d\n", decoder->current_window);
 	int cw = decoder->current_window;
 	ccx_dtvcc_window *window = &decoder->windows[cw];
 
-	ccx_common_logging.debug_ftn(
+	ccx_debug(
 			CCX_DMT_708, "[CEA-708] _dtvcc_process_character: "
 					"%c [%02X]  - Window: %d %s, Pen: %d:%d\n",
 			CCX_DTVCC_SYM(symbol), CCX_DTVCC_SYM(symbol),
@@ -716,7 +716,7 @@ void _dtvcc_process_character(ccx_dtvcc_service_decoder *decoder, ccx_dtvcc_symb
 
 void ccx_dtvcc_decoder_flush(ccx_dtvcc_ctx *dtvcc, ccx_dtvcc_service_decoder *decoder)
 {
-	ccx_common_logging.debug_ftn(
+	ccx_debug(
 			CCX_DMT_708, "[CEA-708] _dtvcc_decoder_flush: Flushing decoder\n");
 	int screen_content_changed = 0;
 	for (int i = 0; i < CCX_DTVCC_MAX_WINDOWS; i++)
@@ -739,7 +739,7 @@ void ccx_dtvcc_decoder_flush(ccx_dtvcc_ctx *dtvcc, ccx_dtvcc_service_decoder *de
 
 void dtvcc_handle_CWx_SetCurrentWindow(ccx_dtvcc_service_decoder *decoder, int window_id)
 {
-	ccx_common_logging.debug_ftn(
+	ccx_debug(
 			CCX_DMT_708, "[CEA-708] dtvcc_handle_CWx_SetCurrentWindow: [%d]\n", window_id);
 	if (decoder->windows[window_id].is_defined)
 		decoder->current_window = window_id;
@@ -750,36 +750,36 @@ void dtvcc_handle_CWx_SetCurrentWindow(ccx_dtvcc_service_decoder *decoder, int w
 
 void dtvcc_handle_CLW_ClearWindows(ccx_dtvcc_service_decoder *decoder, int windows_bitmap)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_CLW_ClearWindows: windows: ");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_CLW_ClearWindows: windows: ");
 	if (windows_bitmap == 0)
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "none\n");
+		ccx_debug(CCX_DMT_708, "none\n");
 	else
 	{
 		for (int i = 0; i < CCX_DTVCC_MAX_WINDOWS; i++)
 		{
 			if (windows_bitmap & 1)
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[W%d] ", i);
+				ccx_debug(CCX_DMT_708, "[W%d] ", i);
 				_dtvcc_window_clear(decoder, i);
 			}
 			windows_bitmap >>= 1;
 		}
 	}
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "\n");
+	ccx_debug(CCX_DMT_708, "\n");
 }
 
 void dtvcc_handle_DSW_DisplayWindows(ccx_dtvcc_service_decoder *decoder, int windows_bitmap, struct ccx_common_timing_ctx *timing)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_DSW_DisplayWindows: windows: ");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_DSW_DisplayWindows: windows: ");
 	if (windows_bitmap == 0)
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "none\n");
+		ccx_debug(CCX_DMT_708, "none\n");
 	else
 	{
 		for (int i = 0; i < CCX_DTVCC_MAX_WINDOWS; i++)
 		{
 			if (windows_bitmap & 1)
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[Window %d] ", i);
+				ccx_debug(CCX_DMT_708, "[Window %d] ", i);
 				if (!decoder->windows[i].is_defined)
 				{
 					ccx_common_logging.log_ftn("[CEA-708] Error: window %d was not defined", i);
@@ -793,7 +793,7 @@ void dtvcc_handle_DSW_DisplayWindows(ccx_dtvcc_service_decoder *decoder, int win
 			}
 			windows_bitmap >>= 1;
 		}
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "\n");
+		ccx_debug(CCX_DMT_708, "\n");
 	}
 }
 
@@ -801,9 +801,9 @@ void dtvcc_handle_HDW_HideWindows(ccx_dtvcc_ctx *dtvcc,
 								  ccx_dtvcc_service_decoder *decoder,
 								  int windows_bitmap)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_HDW_HideWindows: windows: ");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_HDW_HideWindows: windows: ");
 	if (windows_bitmap == 0)
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "none\n");
+		ccx_debug(CCX_DMT_708, "none\n");
 	else
 	{
 		int screen_content_changed = 0;
@@ -811,7 +811,7 @@ void dtvcc_handle_HDW_HideWindows(ccx_dtvcc_ctx *dtvcc,
 		{
 			if (windows_bitmap & 1)
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[Window %d] ", i);
+				ccx_debug(CCX_DMT_708, "[Window %d] ", i);
 				if (decoder->windows[i].visible)
 				{
 					screen_content_changed = 1;
@@ -823,7 +823,7 @@ void dtvcc_handle_HDW_HideWindows(ccx_dtvcc_ctx *dtvcc,
 			}
 			windows_bitmap >>= 1;
 		}
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "\n");
+		ccx_debug(CCX_DMT_708, "\n");
 		if (screen_content_changed && !_dtvcc_decoder_has_visible_windows(decoder))
 			_dtvcc_screen_print(dtvcc, decoder);
 	}
@@ -833,9 +833,9 @@ void dtvcc_handle_TGW_ToggleWindows(ccx_dtvcc_ctx *dtvcc,
 									ccx_dtvcc_service_decoder *decoder,
 									int windows_bitmap)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_TGW_ToggleWindows: windows: ");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_TGW_ToggleWindows: windows: ");
 	if (windows_bitmap == 0)
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "none\n");
+		ccx_debug(CCX_DMT_708, "none\n");
 	else
 	{
 		int screen_content_changed = 0;
@@ -844,7 +844,7 @@ void dtvcc_handle_TGW_ToggleWindows(ccx_dtvcc_ctx *dtvcc,
 			ccx_dtvcc_window *window = &decoder->windows[i];
 			if ((windows_bitmap & 1) && window->is_defined)
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[W-%d: %d->%d]", i, window->visible, !window->visible);
+				ccx_debug(CCX_DMT_708, "[W-%d: %d->%d]", i, window->visible, !window->visible);
 				window->visible = !window->visible;
 				if (window->visible)
 					_dtvcc_window_update_time_show(window, dtvcc->timing);
@@ -861,7 +861,7 @@ void dtvcc_handle_TGW_ToggleWindows(ccx_dtvcc_ctx *dtvcc,
 			}
 			windows_bitmap >>= 1;
 		}
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "\n");
+		ccx_debug(CCX_DMT_708, "\n");
 		if (screen_content_changed && !_dtvcc_decoder_has_visible_windows(decoder))
 			_dtvcc_screen_print(dtvcc, decoder);
 	}
@@ -869,7 +869,7 @@ void dtvcc_handle_TGW_ToggleWindows(ccx_dtvcc_ctx *dtvcc,
 
 void dtvcc_handle_DFx_DefineWindow(ccx_dtvcc_service_decoder *decoder, int window_id, unsigned char *data, struct ccx_common_timing_ctx *timing)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_DFx_DefineWindow: "
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_DFx_DefineWindow: "
 			"W[%d], attributes: \n", window_id);
 
 	ccx_dtvcc_window *window = &decoder->windows[window_id];
@@ -879,7 +879,7 @@ void dtvcc_handle_DFx_DefineWindow(ccx_dtvcc_service_decoder *decoder, int windo
 		// When a decoder receives a DefineWindow command for an existing window, the
 		// command is to be ignored if the command parameters are unchanged from the
 		// previous window definition.
-		ccx_common_logging.debug_ftn(
+		ccx_debug(
 				CCX_DMT_708, "[CEA-708] dtvcc_handle_DFx_DefineWindow: Repeated window definition, ignored\n");
 		return;
 	}
@@ -901,18 +901,18 @@ void dtvcc_handle_DFx_DefineWindow(ccx_dtvcc_service_decoder *decoder, int windo
 
 	int do_clear_window = 0;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Visible: [%s]\n", visible ? "Yes" : "No");
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Priority: [%d]\n", priority);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Row count: [%d]\n", row_count);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Column count: [%d]\n", col_count);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Anchor point: [%d]\n", anchor_point);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Anchor vertical: [%d]\n", anchor_vertical);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Anchor horizontal: [%d]\n", anchor_horizontal);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Relative pos: [%s]\n", relative_pos ? "Yes" : "No");
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Row lock: [%s]\n", row_lock ? "Yes" : "No");
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Column lock: [%s]\n", col_lock ? "Yes" : "No");
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Pen style: [%d]\n", pen_style);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Win style: [%d]\n", win_style);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Visible: [%s]\n", visible ? "Yes" : "No");
+	ccx_debug(CCX_DMT_708, "[CEA-708] Priority: [%d]\n", priority);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Row count: [%d]\n", row_count);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Column count: [%d]\n", col_count);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Anchor point: [%d]\n", anchor_point);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Anchor vertical: [%d]\n", anchor_vertical);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Anchor horizontal: [%d]\n", anchor_horizontal);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Relative pos: [%s]\n", relative_pos ? "Yes" : "No");
+	ccx_debug(CCX_DMT_708, "[CEA-708] Row lock: [%s]\n", row_lock ? "Yes" : "No");
+	ccx_debug(CCX_DMT_708, "[CEA-708] Column lock: [%s]\n", col_lock ? "Yes" : "No");
+	ccx_debug(CCX_DMT_708, "[CEA-708] Pen style: [%d]\n", pen_style);
+	ccx_debug(CCX_DMT_708, "[CEA-708] Win style: [%d]\n", win_style);
 
 	/**
 	 * Korean samples have "anchor_vertical" and "anchor_horizontal" mixed up,
@@ -1027,7 +1027,7 @@ void dtvcc_handle_DFx_DefineWindow(ccx_dtvcc_service_decoder *decoder, int windo
 
 void dtvcc_handle_SWA_SetWindowAttributes(ccx_dtvcc_service_decoder *decoder, unsigned char *data)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_SWA_SetWindowAttributes: attributes: \n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_SWA_SetWindowAttributes: attributes: \n");
 
 	int fill_color    = (data[1]     ) & 0x3f;
 	int fill_opacity  = (data[1] >> 6) & 0x03;
@@ -1042,11 +1042,11 @@ void dtvcc_handle_SWA_SetWindowAttributes(ccx_dtvcc_service_decoder *decoder, un
 	int effect_dir    = (data[4] >> 2) & 0x03;
 	int effect_speed  = (data[4] >> 4) & 0x0f;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "       Fill color: [%d]     Fill opacity: [%d]    Border color: [%d]  Border type: [%d]\n",
+	ccx_debug(CCX_DMT_708, "       Fill color: [%d]     Fill opacity: [%d]    Border color: [%d]  Border type: [%d]\n",
 			fill_color, fill_opacity, border_color, border_type01);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "          Justify: [%d]       Scroll dir: [%d]       Print dir: [%d]    Word wrap: [%d]\n",
+	ccx_debug(CCX_DMT_708, "          Justify: [%d]       Scroll dir: [%d]       Print dir: [%d]    Word wrap: [%d]\n",
 			justify, scroll_dir, print_dir, word_wrap);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "      Border type: [%d]      Display eff: [%d]      Effect dir: [%d] Effect speed: [%d]\n",
+	ccx_debug(CCX_DMT_708, "      Border type: [%d]      Display eff: [%d]      Effect dir: [%d] Effect speed: [%d]\n",
 			border_type, display_eff, effect_dir, effect_speed);
 
 	if (decoder->current_window == -1)
@@ -1075,12 +1075,12 @@ void dtvcc_handle_DLW_DeleteWindows(ccx_dtvcc_ctx *dtvcc,
 									ccx_dtvcc_service_decoder *decoder,
 									int windows_bitmap)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLW_DeleteWindows: windows: ");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLW_DeleteWindows: windows: ");
 
 	int screen_content_changed = 0,
 		window_had_content;
 	if (windows_bitmap == 0)
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "none\n");
+		ccx_debug(CCX_DMT_708, "none\n");
 	else
 	{
 		for (int i = 0; i < CCX_DTVCC_MAX_WINDOWS; i++)
@@ -1088,7 +1088,7 @@ void dtvcc_handle_DLW_DeleteWindows(ccx_dtvcc_ctx *dtvcc,
 			if (windows_bitmap & 1)
 			{
 				ccx_dtvcc_window *window = &decoder->windows[i];
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Deleting [W-%d]\n", i);
+				ccx_debug(CCX_DMT_708, "[CEA-708] Deleting [W-%d]\n", i);
 				window_had_content = window->is_defined && window->visible && !window->is_empty;
 				if (window_had_content)
 				{
@@ -1111,14 +1111,14 @@ void dtvcc_handle_DLW_DeleteWindows(ccx_dtvcc_ctx *dtvcc,
 			windows_bitmap >>= 1;
 		}
 	}
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "\n");
+	ccx_debug(CCX_DMT_708, "\n");
 	if (screen_content_changed && !_dtvcc_decoder_has_visible_windows(decoder))
 		_dtvcc_screen_print(dtvcc, decoder);
 }
 
 void dtvcc_handle_SPA_SetPenAttributes(ccx_dtvcc_service_decoder *decoder, unsigned char *data)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPA_SetPenAttributes: attributes: \n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPA_SetPenAttributes: attributes: \n");
 
 	int pen_size  = (data[1]     ) & 0x3;
 	int offset    = (data[1] >> 2) & 0x3;
@@ -1128,9 +1128,9 @@ void dtvcc_handle_SPA_SetPenAttributes(ccx_dtvcc_service_decoder *decoder, unsig
 	int underline = (data[2] >> 6) & 0x1;
 	int italic    = (data[2] >> 7) & 0x1;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "       Pen size: [%d]     Offset: [%d]  Text tag: [%d]   Font tag: [%d]\n",
+	ccx_debug(CCX_DMT_708, "       Pen size: [%d]     Offset: [%d]  Text tag: [%d]   Font tag: [%d]\n",
 			pen_size, offset, text_tag, font_tag);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "      Edge type: [%d]  Underline: [%d]    Italic: [%d]\n",
+	ccx_debug(CCX_DMT_708, "      Edge type: [%d]  Underline: [%d]    Italic: [%d]\n",
 			edge_type, underline, italic);
 
 	if (decoder->current_window == -1)
@@ -1162,7 +1162,7 @@ void dtvcc_handle_SPA_SetPenAttributes(ccx_dtvcc_service_decoder *decoder, unsig
 
 void dtvcc_handle_SPC_SetPenColor(ccx_dtvcc_service_decoder *decoder, unsigned char *data)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPC_SetPenColor: attributes: \n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPC_SetPenColor: attributes: \n");
 
 	int fg_color   = (data[1]     ) & 0x3f;
 	int fg_opacity = (data[1] >> 6) & 0x03;
@@ -1170,11 +1170,11 @@ void dtvcc_handle_SPC_SetPenColor(ccx_dtvcc_service_decoder *decoder, unsigned c
 	int bg_opacity = (data[2] >> 6) & 0x03;
 	int edge_color = (data[3]     ) & 0x3f;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "      Foreground color: [%d]     Foreground opacity: [%d]\n",
+	ccx_debug(CCX_DMT_708, "      Foreground color: [%d]     Foreground opacity: [%d]\n",
 			fg_color, fg_opacity);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "      Background color: [%d]     Background opacity: [%d]\n",
+	ccx_debug(CCX_DMT_708, "      Background color: [%d]     Background opacity: [%d]\n",
 			bg_color, bg_opacity);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "            Edge color: [%d]\n",
+	ccx_debug(CCX_DMT_708, "            Edge color: [%d]\n",
 			edge_color);
 
 	if (decoder->current_window == -1)
@@ -1204,12 +1204,12 @@ void dtvcc_handle_SPC_SetPenColor(ccx_dtvcc_service_decoder *decoder, unsigned c
 
 void dtvcc_handle_SPL_SetPenLocation(ccx_dtvcc_service_decoder *decoder, unsigned char *data)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPL_SetPenLocation: attributes: \n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_SPL_SetPenLocation: attributes: \n");
 
 	int row = data[1] & 0x0f;
 	int col = data[2] & 0x3f;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "      row: [%d]     Column: [%d]\n", row, col);
+	ccx_debug(CCX_DMT_708, "      row: [%d]     Column: [%d]\n", row, col);
 
 	if (decoder->current_window == -1)
 	{
@@ -1232,7 +1232,7 @@ void dtvcc_handle_RST_Reset(ccx_dtvcc_service_decoder *decoder)
 
 void dtvcc_handle_DLY_Delay(ccx_dtvcc_service_decoder *decoder, int tenths_of_sec)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLY_Delay: "
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLY_Delay: "
 			"delay for [%d] tenths of second", tenths_of_sec);
 	// TODO: Probably ask for the current FTS and wait for this time before resuming - not sure it's worth it though
 	// TODO: No, seems to me that idea above will not work
@@ -1240,7 +1240,7 @@ void dtvcc_handle_DLY_Delay(ccx_dtvcc_service_decoder *decoder, int tenths_of_se
 
 void dtvcc_handle_DLC_DelayCancel(ccx_dtvcc_service_decoder *decoder)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLC_DelayCancel");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_handle_DLC_DelayCancel");
 	// TODO: See above
 }
 
@@ -1264,7 +1264,7 @@ int _dtvcc_handle_C0_P16(ccx_dtvcc_service_decoder *decoder, unsigned char *data
 		CCX_DTVCC_SYM_SET(sym, data[1]);
 	}
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0_P16: [%04X]\n", sym.sym);
+	ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0_P16: [%04X]\n", sym.sym);
 	_dtvcc_process_character(decoder, sym);
 
 	return 3;
@@ -1280,7 +1280,7 @@ int _dtvcc_handle_G0(ccx_dtvcc_service_decoder *decoder, unsigned char *data, in
 	}
 
 	unsigned char c = data[0];
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] G0: [%02X]  (%c)\n", c, c);
+	ccx_debug(CCX_DMT_708, "[CEA-708] G0: [%02X]  (%c)\n", c, c);
 	ccx_dtvcc_symbol sym;
 	if (c == 0x7F) {	// musical note replaces the Delete command code in ASCII
 		CCX_DTVCC_SYM_SET(sym, CCX_DTVCC_MUSICAL_NOTE_CHAR);
@@ -1295,7 +1295,7 @@ int _dtvcc_handle_G0(ccx_dtvcc_service_decoder *decoder, unsigned char *data, in
 // G1 Code Set - ISO 8859-1 LATIN-1 Character Set
 int _dtvcc_handle_G1(ccx_dtvcc_service_decoder *decoder, unsigned char *data, int data_length)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] G1: [%02X]  (%c)\n", data[0], data[0]);
+	ccx_debug(CCX_DMT_708, "[CEA-708] G1: [%02X]  (%c)\n", data[0], data[0]);
 	unsigned char c = dtvcc_get_internal_from_G1(data[0]);
 	ccx_dtvcc_symbol sym;
 	CCX_DTVCC_SYM_SET(sym, c);
@@ -1313,7 +1313,7 @@ int _dtvcc_handle_C0(ccx_dtvcc_ctx *dtvcc,
 	if (name == NULL)
 		name = "Reserved";
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] C0: [%02X]  (%d)   [%s]\n", c0, data_length, name);
+	ccx_debug(CCX_DMT_708, "[CEA-708] C0: [%02X]  (%d)   [%s]\n", c0, data_length, name);
 
 	int len = -1;
 	// These commands have a known length even if they are reserved.
@@ -1360,12 +1360,12 @@ int _dtvcc_handle_C0(ccx_dtvcc_ctx *dtvcc,
 	}
 	if (len == -1)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0: impossible len == -1");
+		ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0: impossible len == -1");
 		return -1;
 	}
 	if (len > data_length)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0: "
+		ccx_debug(CCX_DMT_708, "[CEA-708] _dtvcc_handle_C0: "
 				"command is %d bytes long but we only have %d\n", len, data_length);
 		return -1;
 	}
@@ -1379,13 +1379,13 @@ int _dtvcc_handle_C1(ccx_dtvcc_ctx *dtvcc,
 					 int data_length)
 {
 	struct CCX_DTVCC_S_COMMANDS_C1 com = DTVCC_COMMANDS_C1[data[0] - 0x80];
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] C1: %s | [%02X]  [%s] [%s] (%d)\n",
+	ccx_debug(CCX_DMT_708, "[CEA-708] C1: %s | [%02X]  [%s] [%s] (%d)\n",
 			print_mstime_static(get_fts(dtvcc->timing, 3)),
 			data[0], com.name, com.description, com.length);
 
 	if (com.length > data_length)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] C1: Warning: Not enough bytes for command.\n");
+		ccx_debug(CCX_DMT_708, "[CEA-708] C1: Warning: Not enough bytes for command.\n");
 		return -1;
 	}
 
@@ -1438,7 +1438,7 @@ int _dtvcc_handle_C1(ccx_dtvcc_ctx *dtvcc,
 		case CCX_DTVCC_C1_RSV94:
 		case CCX_DTVCC_C1_RSV95:
 		case CCX_DTVCC_C1_RSV96:
-			ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Warning, found Reserved codes, ignored.\n");
+			ccx_debug(CCX_DMT_708, "[CEA-708] Warning, found Reserved codes, ignored.\n");
 			break;
 		case CCX_DTVCC_C1_SWA:
 			dtvcc_handle_SWA_SetWindowAttributes(decoder, data);
@@ -1505,7 +1505,7 @@ int _dtvcc_handle_C3(ccx_dtvcc_service_decoder *decoder, unsigned char *data, in
 int _dtvcc_handle_extended_char(ccx_dtvcc_service_decoder *decoder, unsigned char *data, int data_length)
 {
 	int used;
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] In _dtvcc_handle_extended_char, "
+	ccx_debug(CCX_DMT_708, "[CEA-708] In _dtvcc_handle_extended_char, "
 			"first data code: [%c], length: [%u]\n", data[0], data_length);
 	unsigned char c = 0x20; // Default to space
 	unsigned char code = data[0];
@@ -1566,7 +1566,7 @@ void ccx_dtvcc_process_service_block(ccx_dtvcc_ctx *dtvcc,
 
 			if (used == -1)
 			{
-				ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_service_block: "
+				ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_service_block: "
 						"There was a problem handling the data. Reseting service decoder\n");
 				// TODO: Not sure if a local reset is going to be helpful here.
 				//ccx_dtvcc_windows_reset(decoder);
@@ -1609,7 +1609,7 @@ void ccx_dtvcc_process_current_packet(ccx_dtvcc_ctx *dtvcc)
 	if (dtvcc->last_sequence != CCX_DTVCC_NO_LAST_SEQUENCE &&
 			(dtvcc->last_sequence + 1) % 4 != seq)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
+		ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
 											 "Unexpected sequence number, it is [%d] but should be [%d]\n",
 				seq, (dtvcc->last_sequence + 1 ) % 4);
 		//WARN: if we reset decoders here, buffer will not be written
@@ -1626,7 +1626,7 @@ void ccx_dtvcc_process_current_packet(ccx_dtvcc_ctx *dtvcc)
 		int service_number = (pos[0] & 0xE0) >> 5; // 3 more significant bits
 		int block_length = (pos[0] & 0x1F); // 5 less significant bits
 
-		ccx_common_logging.debug_ftn(
+		ccx_debug(
 				CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: Standard header: "
 						"Service number: [%d] Block length: [%d]\n", service_number, block_length);
 
@@ -1637,7 +1637,7 @@ void ccx_dtvcc_process_current_packet(ccx_dtvcc_ctx *dtvcc)
 			// printf ("Extended header: Service number: [%d]\n",service_number);
 			if (service_number < 7)
 			{
-				ccx_common_logging.debug_ftn(
+				ccx_debug(
 						CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
 						"Illegal service number in extended header: [%d]\n", service_number);
 			}
@@ -1656,7 +1656,7 @@ void ccx_dtvcc_process_current_packet(ccx_dtvcc_ctx *dtvcc)
 		pos++; // Move to service data
 		if (service_number == 0 && block_length != 0) // Illegal, but specs say what to do...
 		{
-			ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
+			ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
 					"Data received for service 0, skipping rest of packet.");
 			pos = dtvcc->current_packet + len; // Move to end
 			break;
@@ -1677,14 +1677,14 @@ void ccx_dtvcc_process_current_packet(ccx_dtvcc_ctx *dtvcc)
 
 	if (pos != dtvcc->current_packet + len) // For some reason we didn't parse the whole packet
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet:"
+		ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet:"
 				" There was a problem with this packet, reseting\n");
 		_dtvcc_decoders_reset(dtvcc);
 	}
 
 	if (len < 128 && *pos) // Null header is mandatory if there is room
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
+		ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_process_current_packet: "
 				"Warning: Null header expected but not found.\n");
 	}
 }
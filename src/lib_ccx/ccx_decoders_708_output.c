@@ -43,7 +43,7 @@ void _dtvcc_color_to_hex(int color, unsigned *hR, unsigned *hG, unsigned *hB)
 	*hR = (unsigned) (color >> 4);
 	*hG = (unsigned) ((color >> 2) & 0x3);
 	*hB = (unsigned) (color & 0x3);
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] Color: %d [%06x] %u %u %u\n",
+	ccx_debug(CCX_DMT_708, "[CEA-708] Color: %d [%06x] %u %u %u\n",
 								 color, color, *hR, *hG, *hB);
 }
 
@@ -238,7 +238,7 @@ void ccx_dtvcc_write_debug(dtvcc_tv_screen *tv)
 	print_mstime_buff(tv->time_ms_show, "%02u:%02u:%02u:%03u", tbuf1);
 	print_mstime_buff(tv->time_ms_hide, "%02u:%02u:%02u:%03u", tbuf2);
 
-	ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "\r%s --> %s\n", tbuf1, tbuf2);
+	ccx_debug(CCX_DMT_GENERIC_NOTICES, "\r%s --> %s\n", tbuf1, tbuf2);
 	for (int i = 0; i < CCX_DTVCC_SCREENGRID_ROWS; i++)
 	{
 		if (!_dtvcc_is_row_empty(tv, i))
@@ -246,8 +246,8 @@ void ccx_dtvcc_write_debug(dtvcc_tv_screen *tv)
 			int first, last;
 			_dtvcc_get_write_interval(tv, i, &first, &last);
 			for (int j = first; j <= last; j++)
-				ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "%c", tv->chars[i][j]);
-			ccx_common_logging.debug_ftn(CCX_DMT_GENERIC_NOTICES, "\n");
+				ccx_debug(CCX_DMT_GENERIC_NOTICES, "%c", tv->chars[i][j]);
+			ccx_debug(CCX_DMT_GENERIC_NOTICES, "\n");
 		}
 	}
 }
@@ -394,7 +394,7 @@ void ccx_dtvcc_write_done(dtvcc_tv_screen *tv, struct encoder_ctx *encoder)
 			_dtvcc_write_sami_footer(tv, encoder);
 			break;
 		default:
-			ccx_common_logging.debug_ftn(
+			ccx_debug(
 					CCX_DMT_708, "[CEA-708] ccx_dtvcc_write_done: no handling required\n");
 			break;
 	}
@@ -407,7 +407,7 @@ void ccx_dtvcc_writer_init(ccx_dtvcc_writer_ctx *writer,
 						   enum ccx_output_format write_format,
 						   struct encoder_cfg *cfg)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init\n");
 	writer->fd = -1;
 	writer->cd = (iconv_t) -1;
 	if (write_format == CCX_OF_NULL)
@@ -416,7 +416,7 @@ void ccx_dtvcc_writer_init(ccx_dtvcc_writer_ctx *writer,
 		return;
 	}
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init: "
+	ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init: "
 			"[%s][%d][%d]\n", base_filename, program_number, service_number);
 
 	char *ext = get_file_extension(write_format);
@@ -428,7 +428,7 @@ void ccx_dtvcc_writer_init(ccx_dtvcc_writer_ctx *writer,
 		ccx_common_logging.fatal_ftn(
 				EXIT_NOT_ENOUGH_MEMORY, "[CEA-708] _dtvcc_decoder_init_write: not enough memory");
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init: inited [%s]\n", writer->filename);
+	ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_init: inited [%s]\n", writer->filename);
 
 	char *charset = cfg->all_services_charset ?
 					cfg->all_services_charset :
@@ -463,7 +463,7 @@ void ccx_dtvcc_writer_cleanup(ccx_dtvcc_writer_ctx *writer)
 
 void ccx_dtvcc_writer_output(ccx_dtvcc_writer_ctx *writer, ccx_dtvcc_service_decoder *decoder, struct encoder_ctx *encoder)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_output: "
+	ccx_debug(CCX_DMT_708, "[CEA-708] ccx_dtvcc_writer_output: "
 			"writing... [%s][%d]\n", writer->filename, writer->fd);
 
 	if (!writer->filename && writer->fd < 0)
@@ -471,7 +471,7 @@ void ccx_dtvcc_writer_output(ccx_dtvcc_writer_ctx *writer, ccx_dtvcc_service_dec
 
 	if (writer->filename && writer->fd < 0) //first request to write
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] "
+		ccx_debug(CCX_DMT_708, "[CEA-708] "
 				"ccx_dtvcc_writer_output: creating %s\n", writer->filename);
 		writer->fd = open(writer->filename, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, S_IREAD | S_IWRITE);
 		if (writer->fd == -1)
@@ -13,10 +13,12 @@ made to reuse, not duplicate, as many functions as possible */
 #include "ccx_decoders_xds.h"
 #include "ccx_decoders_vbi.h"
 #include "ccx_dtvcc.h"
+#include "ccx_metrics.h"
+#include "ocr_pool.h"
 
 
 uint64_t utc_refvalue = UINT64_MAX;  /* _UI64_MAX means don't use UNIX, 0 = use current system time as reference, +1 use a specific reference */
-extern int in_xds_mode;
+extern CCX_THREAD_LOCAL int in_xds_mode;
 
 
 /* This function returns a FTS that is guaranteed to be at least 1 ms later than the end of the previous screen. It shouldn't be needed
@@ -26,7 +28,7 @@ LLONG get_visible_start (struct ccx_common_timing_ctx *ctx, int current_field)
 	LLONG fts = get_fts(ctx, current_field);
 	if (fts <= ctx->minimum_fts)
 		fts = ctx->minimum_fts + 1;
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "Visible Start time=%s\n", print_mstime_static(fts));
+	ccx_debug(CCX_DMT_DECODER_608, "Visible Start time=%s\n", print_mstime_static(fts));
 	return fts;
 }
 
@@ -36,7 +38,7 @@ LLONG get_visible_end (struct ccx_common_timing_ctx *ctx, int current_field)
 	LLONG fts = get_fts(ctx, current_field);
 	if (fts > ctx->minimum_fts)
 		ctx->minimum_fts = fts;
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_608, "Visible End time=%s\n", print_mstime_static(fts));
+	ccx_debug(CCX_DMT_DECODER_608, "Visible End time=%s\n", print_mstime_static(fts));
 	return fts;
 }
 
@@ -136,7 +138,11 @@ int do_cb (struct lib_cc_decode *ctx, unsigned char *cc_block, struct cc_subtitl
 				if (timeok)
 				{
 					if(ctx->write_format!=CCX_OF_RCWT)
+					{
+						ccx_metrics_enter(CCX_STAGE_DECODE_608);
 						printdata (ctx, cc_block+1,2,0,0, sub);
+						ccx_metrics_leave(2);
+					}
 					else
 						writercwtdata(ctx, cc_block, sub);
 				}
@@ -160,7 +166,11 @@ int do_cb (struct lib_cc_decode *ctx, unsigned char *cc_block, struct cc_subtitl
 				if (timeok)
 				{
 					if(ctx->write_format!=CCX_OF_RCWT)
+					{
+						ccx_metrics_enter(CCX_STAGE_DECODE_608);
 						printdata (ctx, 0,0,cc_block+1,2, sub);
+						ccx_metrics_leave(2);
+					}
 					else
 						writercwtdata(ctx, cc_block, sub);
 				}
@@ -192,7 +202,11 @@ int do_cb (struct lib_cc_decode *ctx, unsigned char *cc_block, struct cc_subtitl
 				if (timeok)
 				{
 					if (ctx->write_format != CCX_OF_RCWT)
+					{
+						ccx_metrics_enter(CCX_STAGE_DECODE_708);
 						ccx_dtvcc_process_data(ctx, (const unsigned char *) temp, 4);
+						ccx_metrics_leave(2);
+					}
 					else
 						writercwtdata(ctx, cc_block, sub);
 				}
@@ -431,11 +445,8 @@ struct encoder_ctx* copy_encoder_context(struct encoder_ctx *ctx)
 		ctx_copy->first_input_file = malloc(strlen(ctx->first_input_file) * sizeof(char));
 		memcpy(ctx_copy->first_input_file, ctx->first_input_file, strlen(ctx->first_input_file) * sizeof(char));
 	}
-	if (ctx->out)
-	{
-		ctx_copy->out = malloc(sizeof(struct ccx_s_write));
-		memcpy(ctx_copy->out, ctx->out, sizeof(struct ccx_s_write));
-	}
+	// The copy writes to the same files, through the same output buffers
+	ctx_copy->out = ctx->out;
 	if (ctx->timing)
 	{
 		ctx_copy->timing = malloc(sizeof(struct ccx_common_timing_ctx));
@@ -528,7 +539,6 @@ void free_encoder_context(struct encoder_ctx *ctx)
 
 	freep(&ctx->first_input_file);
 	freep(&ctx->buffer);
-	freep(&ctx->out);
 	freep(&ctx->timing);
 	freep(&ctx->transcript_settings);
 	freep(&ctx->subline);
@@ -562,6 +572,9 @@ void free_subtitle(struct cc_subtitle* sub)
 		struct cc_bitmap *bitmap=(struct cc_bitmap *) sub->data;
 		if (bitmap)
 		{
+#ifdef ENABLE_OCR
+			ocr_pool_release(bitmap);
+#endif
 			freep(&bitmap->data0);
 			freep(&bitmap->data1);
 		}
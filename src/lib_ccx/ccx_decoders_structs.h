@@ -15,6 +15,8 @@
 
 /* flag raised when end of display marker arrives in Dvb Subtitle */
 #define SUB_EOD_MARKER (1 << 0 )
+/* teletext subtitle of a page written to a file of its own (-tpage p1,p2,...) */
+#define SUB_TLT_EXTRA_PAGE (1 << 1 )
 struct cc_bitmap
 {
 	int x;
@@ -28,6 +30,7 @@ struct cc_bitmap
 	int linesize1;
 #ifdef ENABLE_OCR
 	char *ocr_text;
+	struct ocr_job *ocr_job; // OCR still running with -ocrthreads, see ocr_pool.h
 #endif
 };
 
@@ -4,7 +4,7 @@
 #include "ccx_common_common.h"
 #include "utility.h" 
 
-LLONG ts_start_of_xds = -1; // Time at which we switched to XDS mode, =-1 hasn't happened yet
+CCX_THREAD_LOCAL LLONG ts_start_of_xds = -1; // Time at which we switched to XDS mode, =-1 hasn't happened yet
 
 static const char *XDSclasses[]=
 {
@@ -249,7 +249,7 @@ void process_xds_bytes (struct ccx_decoders_xds_context *ctx, const unsigned cha
 	{
 		int xds_class=(hi-1)/2; // Start codes 1 and 2 are "class type" 0, 3-4 are 2, and so on.
 		is_new=hi%2; // Start codes are even
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "XDS Start: %u.%u  Is new: %d  | Class: %d (%s), Used buffers: %d\n",
+		ccx_debug(CCX_DMT_DECODER_XDS, "XDS Start: %u.%u  Is new: %d  | Class: %d (%s), Used buffers: %d\n",
 			hi, lo, is_new, xds_class, XDSclasses[xds_class], how_many_used(ctx));
 		int first_free_buf=-1;
 		int matching_buf=-1;
@@ -297,7 +297,7 @@ void process_xds_bytes (struct ccx_decoders_xds_context *ctx, const unsigned cha
 	else
 	{
 		// Informational: 00, or 0x20-0x7F, so 01-0x1f forbidden
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "XDS: %02X.%02X (%c, %c)\n",hi,lo,hi,lo);
+		ccx_debug(CCX_DMT_DECODER_XDS, "XDS: %02X.%02X (%c, %c)\n",hi,lo,hi,lo);
 		if ((hi>0 && hi<=0x1f) || (lo>0 && lo<=0x1f))
 		{
 			ccx_common_logging.log_ftn ("\rNote: Illegal XDS data");
@@ -317,10 +317,10 @@ void process_xds_bytes (struct ccx_decoders_xds_context *ctx, const unsigned cha
  */
 void xds_do_copy_generation_management_system (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ctx, unsigned c1, unsigned c2)
 {
-	static unsigned last_c1=-1, last_c2=-1;
-	static char copy_permited[256];
-	static char aps[256];
-	static char rcd[256];
+	static CCX_THREAD_LOCAL unsigned last_c1=-1, last_c2=-1;
+	static CCX_THREAD_LOCAL char copy_permited[256];
+	static CCX_THREAD_LOCAL char aps[256];
+	static CCX_THREAD_LOCAL char rcd[256];
 	int changed=0;
 	unsigned c1_6=(c1&0x40)>>6;
 	/* unsigned unused1=(c1&0x20)>>5; */
@@ -368,17 +368,17 @@ void xds_do_copy_generation_management_system (struct cc_subtitle *sub, struct c
 		ccx_common_logging.log_ftn ("\rXDS: %s\n",aps);
 		ccx_common_logging.log_ftn ("\rXDS: %s\n",rcd);
 	}
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",copy_permited);
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",aps);
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",rcd);
+	ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",copy_permited);
+	ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",aps);
+	ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",rcd);
 }
 
 void xds_do_content_advisory (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ctx, unsigned c1, unsigned c2)
 {
-	static unsigned last_c1=-1, last_c2=-1;
-	static char age[256];
-	static char content[256];
-	static char rating[256];
+	static CCX_THREAD_LOCAL unsigned last_c1=-1, last_c2=-1;
+	static CCX_THREAD_LOCAL char age[256];
+	static CCX_THREAD_LOCAL char content[256];
+	static CCX_THREAD_LOCAL char rating[256];
 	int changed=0;
 	// Insane encoding
 	unsigned c1_6=(c1&0x40)>>6;
@@ -469,8 +469,8 @@ void xds_do_content_advisory (struct cc_subtitle *sub, struct ccx_decoders_xds_c
 			ccx_common_logging.log_ftn ("\rXDS: %s\n  ",age);
 			ccx_common_logging.log_ftn ("\rXDS: %s\n  ",content);
 		}
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",age);
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",content);
+		ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",age);
+		ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",content);
 	}
 	if (!a0 || // MPA
 			(a0 && a1 && !Da2 && !La3) ||  // Canadian English Language Rating
@@ -480,7 +480,7 @@ void xds_do_content_advisory (struct cc_subtitle *sub, struct ccx_decoders_xds_c
 		xdsprint(sub, ctx, rating);
 		if (changed)
 			ccx_common_logging.log_ftn ("\rXDS: %s\n  ",rating);
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",rating);
+		ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: %s\n",rating);
 	}
 
 	if (changed && !supported)
@@ -526,7 +526,7 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 				ctx->current_xds_month=month;
 			}
 
-			ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "PIN (Start Time): %s  %02d-%02d %02d:%02d\n",
+			ccx_debug(CCX_DMT_DECODER_XDS, "PIN (Start Time): %s  %02d-%02d %02d:%02d\n",
 					(ctx->cur_xds_packet_class==XDS_CLASS_CURRENT?"Current":"Future"),
 					date,month,hour,min);
 			xdsprint (sub, ctx, "PIN (Start Time): %s  %02d-%02d %02d:%02d\n",
@@ -552,7 +552,7 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 				if (!ctx->xds_program_length_shown)
 					ccx_common_logging.log_ftn ("\rXDS: Program length (HH:MM): %02d:%02d  ",hour,min);
 				else
-					ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS: Program length (HH:MM): %02d:%02d  ",hour,min);
+					ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS: Program length (HH:MM): %02d:%02d  ",hour,min);
 
 				xdsprint(sub, ctx, "Program length (HH:MM): %02d:%02d  ",hour,min);
 
@@ -563,7 +563,7 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 					if (!ctx->xds_program_length_shown)
 						ccx_common_logging.log_ftn ("Elapsed (HH:MM): %02d:%02d",el_hour,el_min);
 					else
-						ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "Elapsed (HH:MM): %02d:%02d",el_hour,el_min);
+						ccx_debug(CCX_DMT_DECODER_XDS, "Elapsed (HH:MM): %02d:%02d",el_hour,el_min);
 					xdsprint(sub, ctx, "Elapsed (HH:MM): %02d:%02d",el_hour,el_min);
 
 				}
@@ -571,13 +571,13 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 				{
 					int el_sec=ctx->cur_xds_payload[6] & 0x3f; // 6 bits
 					if (!ctx->xds_program_length_shown)
-						ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, ":%02d",el_sec);
+						ccx_debug(CCX_DMT_DECODER_XDS, ":%02d",el_sec);
 					xdsprint(sub, ctx, "Elapsed (SS) :%02d",el_sec);
 				}
 				if (!ctx->xds_program_length_shown)
 					ccx_common_logging.log_ftn("\n");
 				else
-					ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\n");
+					ccx_debug(CCX_DMT_DECODER_XDS, "\n");
 				ctx->xds_program_length_shown=1;
 			}
 			break;
@@ -589,7 +589,7 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 				for (i=2;i<ctx->cur_xds_payload_length-1;i++)
 					xds_program_name[i-2]=ctx->cur_xds_payload[i];
 				xds_program_name[i-2]=0;
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS Program name: %s\n",xds_program_name);
+				ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS Program name: %s\n",xds_program_name);
 				xdsprint(sub, ctx, "Program name: %s",xds_program_name);
 				if (ctx->cur_xds_packet_class==XDS_CLASS_CURRENT &&
 						strcmp (xds_program_name, ctx->current_xds_program_name)) // Change of program
@@ -691,8 +691,8 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 				}
 				else
 				{
-					ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS Notice: Aspect ratio info, start line=%u, end line=%u\n", ar_start, ar_end);
-					ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS Notice: Aspect ratio info, active picture height=%u, ratio=%f\n", active_picture_height, aspect_ratio);
+					ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS Notice: Aspect ratio info, start line=%u, end line=%u\n", ar_start, ar_end);
+					ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS Notice: Aspect ratio info, active picture height=%u, ratio=%f\n", active_picture_height, aspect_ratio);
 				}
 			}
 			break;
@@ -725,7 +725,7 @@ int xds_do_current_and_future (struct cc_subtitle *sub, struct ccx_decoders_xds_
 					}
 					else
 					{
-						ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "\rXDS description line %d: %s\n",line_num,xds_desc);
+						ccx_debug(CCX_DMT_DECODER_XDS, "\rXDS description line %d: %s\n",line_num,xds_desc);
 					}
 					xdsprint(sub, ctx, "XDS description line %d: %s",line_num,xds_desc);
 					ccx_common_logging.gui_ftn(CCX_COMMON_LOGGING_GUI_XDS_PROGRAM_DESCRIPTION, line_num, xds_desc);
@@ -753,7 +753,7 @@ int xds_do_channel (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ct
 			for (i=2;i<ctx->cur_xds_payload_length-1;i++)
 				xds_network_name[i-2]=ctx->cur_xds_payload[i];
 			xds_network_name[i-2]=0;
-			ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "XDS Network name: %s\n",xds_network_name);
+			ccx_debug(CCX_DMT_DECODER_XDS, "XDS Network name: %s\n",xds_network_name);
 			xdsprint (sub, ctx, "Network: %s",xds_network_name);
 			if (strcmp (xds_network_name, ctx->current_xds_network_name)) // Change of station
 			{
@@ -773,7 +773,7 @@ int xds_do_channel (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ct
 						xds_call_letters[i-2]=ctx->cur_xds_payload[i];
 				}
 				xds_call_letters[i-2]=0;
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "XDS Network call letters: %s\n",xds_call_letters);
+				ccx_debug(CCX_DMT_DECODER_XDS, "XDS Network call letters: %s\n",xds_call_letters);
 				xdsprint (sub, ctx, "Call Letters: %s",xds_call_letters);
 				if (strncmp (xds_call_letters, ctx->current_xds_call_letters, 7)) // Change of station
 				{
@@ -843,7 +843,7 @@ int xds_do_misc (struct ccx_decoders_xds_context *ctx)
 				int reset_seconds = (ctx->cur_xds_payload[5] & 0x20);
 				int day_of_week = ctx->cur_xds_payload[6] & 0x7;
 				int year = (ctx->cur_xds_payload[7] & 0x3f) + 1990;
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "Time of day: (YYYY/MM/DD) %04d/%02d/%02d (HH:SS) %02d:%02d DoW: %d  Reset seconds: %d\n",
+				ccx_debug(CCX_DMT_DECODER_XDS, "Time of day: (YYYY/MM/DD) %04d/%02d/%02d (HH:SS) %02d:%02d DoW: %d  Reset seconds: %d\n",
 						year,month,date,hour,min, day_of_week, reset_seconds);
 				break;
 			}
@@ -855,7 +855,7 @@ int xds_do_misc (struct ccx_decoders_xds_context *ctx)
 				// int b6 = (ctx->cur_xds_payload[2] & 0x40) >>6; // Bit 6 should always be 1
 				int dst = (ctx->cur_xds_payload[2] & 0x20) >>5; // Daylight Saving Time
 				int hour = ctx->cur_xds_payload[2] & 0x1f; // 5 bits
-				ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "Local Time Zone: %02d DST: %d\n",
+				ccx_debug(CCX_DMT_DECODER_XDS, "Local Time Zone: %02d DST: %d\n",
 						hour, dst);
 				break;
 			}
@@ -888,19 +888,19 @@ void do_end_of_xds (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ct
 		cs=cs+ctx->cur_xds_payload[i];
 		cs=cs & 0x7f; // Keep 7 bits only
 		int c=ctx->cur_xds_payload[i]&0x7F;
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "%02X - %c cs: %02X\n",
+		ccx_debug(CCX_DMT_DECODER_XDS, "%02X - %c cs: %02X\n",
 				c,(c>=0x20)?c:'?', cs);
 	}
 	cs=(128-cs) & 0x7F; // Convert to 2's complement & discard high-order bit
 
-	ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "End of XDS. Class=%d (%s), size=%d  Checksum OK: %d   Used buffers: %d\n",
+	ccx_debug(CCX_DMT_DECODER_XDS, "End of XDS. Class=%d (%s), size=%d  Checksum OK: %d   Used buffers: %d\n",
 			ctx->cur_xds_packet_class,XDSclasses[ctx->cur_xds_packet_class],
 			ctx->cur_xds_payload_length,
 			cs==expected_checksum, how_many_used(ctx));
 
 	if (cs!=expected_checksum || ctx->cur_xds_payload_length<3)
 	{
-		ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "Expected checksum: %02X  Calculated: %02X\n", expected_checksum, cs);
+		ccx_debug(CCX_DMT_DECODER_XDS, "Expected checksum: %02X  Calculated: %02X\n", expected_checksum, cs);
 		clear_xds_buffer (ctx, ctx->cur_xds_buffer_idx);
 		return; // Bad packets ignored as per specs
 	}
@@ -935,7 +935,7 @@ void do_end_of_xds (struct cc_subtitle *sub, struct ccx_decoders_xds_context *ct
 			was_proc = xds_do_private_data(sub, ctx);
 			break;
 		case XDS_CLASS_OUT_OF_BAND:
-			ccx_common_logging.debug_ftn(CCX_DMT_DECODER_XDS, "Out-of-band data, ignored.");
+			ccx_debug(CCX_DMT_DECODER_XDS, "Out-of-band data, ignored.");
 			was_proc = 1;
 			break;
 	}
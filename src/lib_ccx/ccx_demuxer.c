@@ -3,6 +3,8 @@
 #include "lib_ccx.h"
 #include "utility.h"
 #include "ffmpeg_intgr.h"
+#include "ccx_demuxer_fmp4.h"
+#include "ccx_demuxer_mxf.h"
 
 static void ccx_demuxer_reset(struct ccx_demuxer *ctx)
 {
@@ -17,11 +19,26 @@ static void ccx_demuxer_reset(struct ccx_demuxer *ctx)
 	}
 	memset(ctx->stream_id_of_each_pid, 0, (MAX_PSI_PID + 1) * sizeof(uint8_t));
 	memset (ctx->PIDs_programs, 0, 65536*sizeof (struct PMT_entry *));
+	// The sections of the former file were parsed with its programs
+	for (int i = 0; i < MAX_PSI_PID; i++)
+	{
+		if (ctx->PID_buffers[i])
+			psi_buffer_reset(ctx->PID_buffers[i]);
+	}
+	ctx->tsbatch.count = 0;
+	ctx->tsbatch.next = 0;
+	ctx->tsbatch.staged_pos = 0;
+	ctx->tsbatch.staged_len = 0;
+	ctx->tsbatch.eof = 0;
 }
 
 static void ccx_demuxer_close(struct ccx_demuxer *ctx)
 { 
 	ctx->past = 0;
+	if (ctx->stream_mode == CCX_SM_FMP4)
+		ccx_fmp4_delete(ctx);
+	if (ctx->stream_mode == CCX_SM_MXF)
+		ccx_mxf_delete(ctx);
 	if (ctx->infd!=-1 && ccx_options.input_source==CCX_DS_FILE)
 	{
 		close (ctx->infd);
@@ -55,6 +72,7 @@ static int ccx_demuxer_open(struct ccx_demuxer *ctx, const char *file)
 		mprint ("\rFailed to initialized ffmpeg falling back to legacy\n");
 	}
 #endif
+	close_file_mmap(ctx); // Previous file's window stays valid after close(), until here
 	init_file_buffer(ctx);
 	if (ccx_options.input_source==CCX_DS_STDIN)
 	{
@@ -84,6 +102,8 @@ static int ccx_demuxer_open(struct ccx_demuxer *ctx, const char *file)
 			print_error(ccx_options.gui_mode_reports,"socket() failed.");
 			return CCX_COMMON_EXIT_BUG_BUG;
 		}
+		udp_set_rcvbuf(ctx->infd, ccx_options.udp_rcvbuf);
+		ctx->udp_receiver = udp_receiver_start(ctx->infd);
 
 	}
 
@@ -108,6 +128,8 @@ static int ccx_demuxer_open(struct ccx_demuxer *ctx, const char *file)
 #endif
 		if (ctx->infd < 0)
 			return -1;
+		if (ccx_options.mmap_input)
+			init_file_mmap(ctx);
 	}
 
 	if (ctx->auto_stream == CCX_SM_AUTODETECT)
@@ -153,6 +175,9 @@ static int ccx_demuxer_open(struct ccx_demuxer *ctx, const char *file)
 			case CCX_SM_MXF:
 				mprint ("\rFile seems to be an MXF\n");
 				break;
+			case CCX_SM_FMP4:
+				mprint ("\rFile seems to be a MP4, read as a stream of fragments\n");
+				break;
 			case CCX_SM_MYTH:
 			case CCX_SM_AUTODETECT:
 				fatal(CCX_COMMON_EXIT_BUG_BUG, "In ccx_demuxer_open: Impossible value in stream_mode. Please file a bug report on GitHub.\n");
@@ -163,6 +188,11 @@ static int ccx_demuxer_open(struct ccx_demuxer *ctx, const char *file)
 	{
 		ctx->stream_mode = ctx->auto_stream;
 	}
+	if (ctx->stream_mode == CCX_SM_FMP4 && (ctx->private_data = ccx_fmp4_init(ctx)) == NULL)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ccx_demuxer_open: Out of memory for the fragmented MP4 demuxer.\n");
+	// Set by detect_stream_type() unless -in=mxf
+	if (ctx->stream_mode == CCX_SM_MXF && ctx->private_data == NULL && (ctx->private_data = ccx_mxf_init(ctx)) == NULL)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ccx_demuxer_open: Out of memory for the MXF demuxer.\n");
 
 	// The myth loop autodetect will only be used with ES or PS streams
 	switch (ccx_options.auto_myth)
@@ -254,6 +284,9 @@ static void ccx_demuxer_print_cfg(struct ccx_demuxer *ctx)
 		case CCX_SM_MXF:
 			mprint("MXF");
 			break;
+		case CCX_SM_FMP4:
+			mprint("Fragmented MP4");
+			break;
 #ifdef WTV_DEBUG
 		case CCX_SM_HEX_DUMP:
 			mprint ("Hex");
@@ -276,15 +309,13 @@ void ccx_demuxer_delete(struct ccx_demuxer **ctx)
 	struct ccx_demuxer *lctx = *ctx;
 	int i;
 	dinit_cap(lctx);
+	capbuf_arena_report(&lctx->capbuf_arena);
+	dinit_capbuf_arena(&lctx->capbuf_arena);
 	freep(&lctx->last_pat_payload);
 	for (i = 0; i < MAX_PSI_PID; i++)
 	{
-		if(lctx->PID_buffers[i]!=NULL && lctx->PID_buffers[i]->buffer!=NULL)
-		{
-			free(lctx->PID_buffers[i]->buffer);
-			lctx->PID_buffers[i]->buffer=NULL;
-			lctx->PID_buffers[i]->buffer_length=0;
-		}
+		if(lctx->PID_buffers[i]!=NULL)
+			psi_buffer_free(lctx->PID_buffers[i]);
 		freep(&lctx->PID_buffers[i]);
 	}
 	for (i = 0; i < MAX_PID; i++)
@@ -295,6 +326,8 @@ void ccx_demuxer_delete(struct ccx_demuxer **ctx)
 	if (lctx->fh_out_elementarystream != NULL)
 		fclose (lctx->fh_out_elementarystream);
 
+	udp_receiver_stop(&lctx->udp_receiver);
+	close_file_mmap(lctx);
 	freep(&lctx->filebuffer);
 	freep(ctx);
 }
@@ -308,6 +341,12 @@ struct ccx_demuxer *init_demuxer(void *parent, struct demuxer_cfg *cfg)
 
 	ctx->infd = -1;//Set to -1 to indicate no file is open.
 	ctx->m2ts = cfg->m2ts;
+	ctx->ts_packet_size = 188;
+	ctx->tsbatch.count = 0;
+	ctx->tsbatch.next = 0;
+	ctx->tsbatch.staged_pos = 0;
+	ctx->tsbatch.staged_len = 0;
+	ctx->tsbatch.eof = 0;
 	ctx->auto_stream = cfg->auto_stream;
 	ctx->stream_mode = CCX_SM_ELEMENTARY_OR_NOT_FOUND;
 
@@ -375,6 +414,7 @@ struct ccx_demuxer *init_demuxer(void *parent, struct demuxer_cfg *cfg)
 	ctx->warning_program_not_found_shown = CCX_FALSE;
 	ctx->strangeheader = 0;
 	memset(&ctx->freport, 0, sizeof(ctx->freport));
+	memset(&ctx->capbuf_arena, 0, sizeof(ctx->capbuf_arena));
 	if (cfg->out_elementarystream_filename != NULL)
 	{
 		if ((ctx->fh_out_elementarystream = fopen (cfg->out_elementarystream_filename,"wb"))==NULL)
@@ -389,6 +429,10 @@ struct ccx_demuxer *init_demuxer(void *parent, struct demuxer_cfg *cfg)
 
 	init_ts(ctx);
 	ctx->filebuffer = NULL;
+	ctx->filebuffer_mmapped = 0;
+	ctx->mmap_filesize = 0;
+	ctx->mmap_window_size = 0;
+	ctx->udp_receiver = NULL;
 
 	return ctx;
 }
@@ -413,19 +457,25 @@ struct demuxer_data* alloc_demuxer_data(void)
 		free(data);
 		return NULL;
 	}
+	reset_demuxer_data(data);
+	return data;
+	
+}
+
+/* Set all but the buffer back to the state of a freshly allocated node */
+void reset_demuxer_data(struct demuxer_data *data)
+{
 	data->len = 0;
 	data->bufferdatatype = CCX_PES;
 
 	data->program_number = -1;
 	data->stream_pid = -1;
 	data->codec = CCX_CODEC_NONE;
-	data->len = 0;
 	data->pts = CCX_NOPTS;
 	data->rollover_bits = 0;
 	data->tb.num = 1;
 	data->tb.den = 90000;
 	data->next_stream = 0;
 	data->next_program = 0;
-	return data;
-	
+	data->index = NULL;
 }
@@ -6,6 +6,7 @@
 #include "list.h"
 #include "activity.h"
 #include "utility.h"
+#include "udp_receiver.h"
 
 /* Report information */
 #define SUB_STREAMS_CNT 10
@@ -50,6 +51,35 @@ struct program_info
 	int has_all_min_pts;
 };
 
+/* Size classes of capture buffers, CAPBUF_MIN_SIZE doubled up to CAPBUF_CLASSES - 1 times */
+#define CAPBUF_MIN_SIZE 2048
+#define CAPBUF_CLASSES 16
+/* Buffers are carved out of one region of this size as long as it lasts */
+#define CAPBUF_REGION_SIZE (4 * 1024 * 1024)
+
+struct capbuf_block;
+
+/**
+ * Allocator for the cap_info PES reassembly buffers of one demuxer.
+ * Buffers grow geometrically and go back to a free list by size class
+ * when released, so PES units and PIDs reuse them instead of calling
+ * realloc() per TS packet.
+ */
+struct capbuf_arena
+{
+	unsigned char *region;
+	size_t region_used;
+	struct capbuf_block *free_list[CAPBUF_CLASSES];
+
+	/* Counters */
+	size_t bytes_allocated;      // Bytes in buffers currently held by a cap_info
+	size_t peak_bytes_allocated;
+	size_t bytes_reserved;       // Bytes taken from the system, region included
+	unsigned long requests;      // Buffers handed out
+	unsigned long reused;        // ...of which from a free list
+	unsigned long system_allocs; // malloc() calls
+};
+
 struct cap_info
 {
 	int pid;
@@ -82,6 +112,8 @@ struct cap_info
 struct ccx_demuxer
 {
 	int m2ts;
+	int ts_packet_size; // 188, or 204 with Reed-Solomon parity. M2TS adds its 4 byte header to this
+	struct ts_batch tsbatch;
 	enum ccx_stream_mode_enum stream_mode;
 	enum ccx_stream_mode_enum auto_stream;
 
@@ -132,6 +164,7 @@ struct ccx_demuxer
 
 	struct PMT_entry *PIDs_programs[MAX_PID];
 	struct ccx_demux_report freport;
+	struct capbuf_arena capbuf_arena;
 
 	/* Hauppauge support */
 	unsigned hauppauge_warning_shown; // Did we detect a possible Hauppauge capture and told the user already?
@@ -145,6 +178,13 @@ struct ccx_demuxer
 	LLONG filebuffer_start;      // Position of buffer start relative to file
 	unsigned int filebuffer_pos; // Position of pointer relative to buffer start
 	unsigned int bytesinbuffer;  // Number of bytes we actually have on buffer
+	/* Memory mapped input (-mmap): filebuffer is then a window of the file
+	   starting at filebuffer_start instead of a malloc'ed copy */
+	int filebuffer_mmapped;
+	LLONG mmap_filesize;
+	size_t mmap_window_size;
+	/* -udp datagrams read ahead by a thread, NULL reads the socket directly */
+	struct udp_receiver *udp_receiver;
 
 	int warning_program_not_found_shown;
 
@@ -182,12 +222,24 @@ struct demuxer_data
 	struct ccx_rational tb;
 	struct demuxer_data *next_stream;
 	struct demuxer_data *next_program;
+	struct demuxer_data_index *index; // Only set in the head of a list built by PID
+};
+
+/* Lookup table for a list of demuxer_data with one node per PID (transport
+   streams), so finding a stream doesn't walk the list for every PES */
+struct demuxer_data_index
+{
+	struct demuxer_data *by_pid[MAX_PSI_PID + 1];
+	struct demuxer_data *pool; // Deleted nodes kept with their buffer, by next_stream
+	struct demuxer_data *best; // get_best_data() result, while best_valid
+	int best_valid;
 };
 
 struct cap_info *get_sib_stream_by_type(struct cap_info* program, enum ccx_code_type type);
 struct ccx_demuxer *init_demuxer(void *parent, struct demuxer_cfg *cfg);
 void ccx_demuxer_delete(struct ccx_demuxer **ctx);
 struct demuxer_data* alloc_demuxer_data(void);
+void reset_demuxer_data(struct demuxer_data *data);
 void delete_demuxer_data(struct demuxer_data *data);
 int update_capinfo(struct ccx_demuxer *ctx, int pid, enum ccx_stream_type stream, enum ccx_code_type codec, int pn, void *private_data);
 struct cap_info * get_cinfo(struct ccx_demuxer *ctx, int pid);
@@ -195,9 +247,14 @@ int need_cap_info(struct ccx_demuxer *ctx, int program_number);
 int need_cap_info_for_pid(struct ccx_demuxer *ctx, int pid);
 struct demuxer_data *get_best_data(struct demuxer_data *data);
 struct demuxer_data *get_data_stream(struct demuxer_data *data, int pid);
+struct demuxer_data *get_data_node_by_pid(struct demuxer_data *data, int pid);
 int get_best_stream(struct ccx_demuxer *ctx);
 void ignore_other_stream(struct ccx_demuxer *ctx, int pid);
 void dinit_cap (struct ccx_demuxer *ctx);
+int capbuf_reserve(struct ccx_demuxer *ctx, struct cap_info *cinfo, long size);
+void capbuf_release(struct ccx_demuxer *ctx, struct cap_info *cinfo);
+void capbuf_arena_report(struct capbuf_arena *arena);
+void dinit_capbuf_arena(struct capbuf_arena *arena);
 int get_programme_number(struct ccx_demuxer *ctx, int pid);
 struct cap_info* get_best_sib_stream(struct cap_info* program);
 void ignore_other_sib_stream(struct cap_info* head, int pid);
@@ -0,0 +1,679 @@
+#include "lib_ccx.h"
+#include "ccx_common_option.h"
+#include "ccx_demuxer_fmp4.h"
+#include "ccx_mp4.h"
+#include "file_buffer.h"
+#include "utility.h"
+
+#define debug(fmt, ...) ccx_debug(CCX_DMT_PARSE, "fMP4:%s:%d: "fmt , __FUNCTION__ ,__LINE__ , ##__VA_ARGS__)
+
+#define BOX(a, b, c, d) (((uint32_t) (a) << 24) | ((b) << 16) | ((c) << 8) | (d))
+#define FMP4_MAX_TRACKS 32
+#define FMP4_MAX_TABLE_BOX (16 << 20)  // Larger moov or moof are skipped
+#define FMP4_MAX_CC_SAMPLE (64 << 10)  // Larger c608/c708 samples are skipped
+
+enum fmp4_track_type
+{
+	FMP4_OTHER,
+	FMP4_C608,
+	FMP4_C708,
+	FMP4_AVC,
+};
+
+struct fmp4_track
+{
+	uint32_t id;
+	uint32_t timescale;
+	enum fmp4_track_type type;
+	int nal_unit_size;           // AVC, from avcC
+	unsigned char *param_sets;   // AVC SPS and PPS from avcC, with start codes
+	size_t param_sets_len;
+	uint32_t default_duration;   // From trex
+	uint32_t default_size;
+	uint64_t next_dts;           // For a traf without tfdt
+};
+
+struct fmp4_sample
+{
+	uint64_t offset;             // Position in the input
+	uint32_t size;
+	int64_t pts;                 // In the timescale of the track
+};
+
+struct fmp4_ctx
+{
+	struct fmp4_track tracks[FMP4_MAX_TRACKS];
+	int nb_tracks;
+	struct fmp4_track *track;    // The one the captions are taken from, NULL before moov
+	int param_sets_pending;
+
+	struct fmp4_sample *samples; // Of track in the last moof
+	int nb_samples;
+	int samples_size;
+	int next_sample;
+	uint64_t mdat_end;           // End of the mdat being read, 0 outside of one
+
+	unsigned char *box;          // moov or moof being parsed
+	size_t box_size;
+	unsigned char *sample;       // c608 or c708 sample being parsed
+};
+
+static uint32_t rb32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t rb64(const unsigned char *p)
+{
+	return ((uint64_t) rb32(p) << 32) | rb32(p + 4);
+}
+
+static int read_input(struct ccx_demuxer *demux, unsigned char *buf, size_t n)
+{
+	size_t ret = buffered_read(demux, buf, n);
+	demux->past += ret;
+	return ret == n ? CCX_OK : CCX_EOF;
+}
+
+static int skip_input(struct ccx_demuxer *demux, uint64_t n)
+{
+	uint64_t ret = buffered_skip_long(demux, n);
+
+	demux->past += ret;
+	return ret == n ? CCX_OK : CCX_EOF;
+}
+
+/* Next box in p..end, in memory. Returns 0 at the end or on a broken box. */
+static int next_box(const unsigned char **p, const unsigned char *end, uint32_t *type,
+		const unsigned char **payload, uint64_t *size)
+{
+	uint64_t len;
+	int header = 8;
+
+	if (end - *p < 8)
+		return 0;
+	len = rb32(*p);
+	*type = rb32(*p + 4);
+	if (len == 1)
+	{
+		if (end - *p < 16)
+			return 0;
+		len = rb64(*p + 8);
+		header = 16;
+	}
+	else if (len == 0)
+		len = end - *p;
+	if (len < header || len > (uint64_t) (end - *p))
+		return 0;
+	*payload = *p + header;
+	*size = len - header;
+	*p += len;
+	return 1;
+}
+
+static const unsigned char *find_box(const unsigned char *p, const unsigned char *end, uint32_t want, uint64_t *size)
+{
+	const unsigned char *payload;
+	uint32_t type;
+
+	while (next_box(&p, end, &type, &payload, size))
+	{
+		if (type == want)
+			return payload;
+	}
+	return NULL;
+}
+
+static struct fmp4_track *get_track(struct fmp4_ctx *ctx, uint32_t id)
+{
+	for (int i = 0; i < ctx->nb_tracks; i++)
+	{
+		if (ctx->tracks[i].id == id)
+			return &ctx->tracks[i];
+	}
+	return NULL;
+}
+
+/* SPS and PPS of an avcC, with start codes as process_avc() wants them */
+static void parse_avcc(struct fmp4_track *track, const unsigned char *p, uint64_t size)
+{
+	const unsigned char *end = p + size;
+	unsigned char *out;
+
+	if (size < 7 || (p[4] & 3) == 2) // No 3 byte NAL unit lengths
+		return;
+	// 2 bytes of length become 4 of start code, for sets of at least 1 byte
+	if ((out = malloc(size * 2)) == NULL)
+		return;
+	track->nal_unit_size = (p[4] & 3) + 1;
+	track->param_sets = out;
+	track->param_sets_len = 0;
+
+	p += 5;
+	for (int list = 0; list < 2 && p < end; list++)
+	{
+		int count = list == 0 ? *p++ & 0x1f : *p++;
+		for (int i = 0; i < count && end - p >= 2; i++)
+		{
+			unsigned len = (p[0] << 8) | p[1];
+			if (len > (size_t) (end - p - 2))
+				break;
+			memcpy(out + track->param_sets_len, "\0\0\0\1", 4);
+			memcpy(out + track->param_sets_len + 4, p + 2, len);
+			track->param_sets_len += 4 + len;
+			p += 2 + len;
+		}
+	}
+}
+
+static void parse_trak(struct fmp4_ctx *ctx, const unsigned char *p, const unsigned char *end)
+{
+	struct fmp4_track *track;
+	const unsigned char *box, *mdia, *stbl, *entry;
+	uint64_t size, mdia_size, stbl_size;
+	uint32_t type;
+
+	if (ctx->nb_tracks == FMP4_MAX_TRACKS)
+		return;
+	track = &ctx->tracks[ctx->nb_tracks];
+	memset(track, 0, sizeof(struct fmp4_track));
+
+	if ((box = find_box(p, end, BOX('t','k','h','d'), &size)) == NULL || size < 24)
+		return;
+	track->id = rb32(box + (box[0] == 1 ? 20 : 12));
+	if ((mdia = find_box(p, end, BOX('m','d','i','a'), &mdia_size)) == NULL)
+		return;
+	if ((box = find_box(mdia, mdia + mdia_size, BOX('m','d','h','d'), &size)) == NULL || size < 24)
+		return;
+	track->timescale = rb32(box + (box[0] == 1 ? 20 : 12));
+	ctx->nb_tracks++;
+
+	if ((box = find_box(mdia, mdia + mdia_size, BOX('m','i','n','f'), &size)) == NULL ||
+			(stbl = find_box(box, box + size, BOX('s','t','b','l'), &stbl_size)) == NULL)
+		return;
+	if ((box = find_box(stbl, stbl + stbl_size, BOX('s','t','s','z'), &size)) != NULL && size >= 12 && rb32(box + 8) > 0)
+		mprint("\rWarning: MP4 track %u has samples outside of fragments, they are skipped. Use -in=mp4 for them.\n", track->id);
+
+	// First sample entry
+	if ((box = find_box(stbl, stbl + stbl_size, BOX('s','t','s','d'), &size)) == NULL || size < 8)
+		return;
+	p = box + 8;
+	if (!next_box(&p, box + size, &type, &entry, &size))
+		return;
+	switch (type)
+	{
+		case BOX('c','6','0','8'):
+			track->type = FMP4_C608;
+			break;
+		case BOX('c','7','0','8'):
+			track->type = FMP4_C708;
+			break;
+		case BOX('a','v','c','1'):
+		case BOX('a','v','c','3'):
+			// 78 bytes of visual sample entry before its boxes
+			if (size > 78 && (box = find_box(entry + 78, entry + size, BOX('a','v','c','C'), &size)) != NULL)
+			{
+				parse_avcc(track, box, size);
+				if (track->nal_unit_size)
+					track->type = FMP4_AVC;
+			}
+			break;
+	}
+}
+
+static void parse_moov(struct fmp4_ctx *ctx, const unsigned char *p, const unsigned char *end)
+{
+	const unsigned char *box, *payload;
+	uint64_t size;
+	uint32_t type;
+
+	for (int i = 0; i < ctx->nb_tracks; i++)
+		free(ctx->tracks[i].param_sets);
+	ctx->nb_tracks = 0;
+	ctx->track = NULL;
+	ctx->nb_samples = 0;
+
+	for (box = p; next_box(&box, end, &type, &payload, &size); )
+	{
+		if (type == BOX('t','r','a','k'))
+			parse_trak(ctx, payload, payload + size);
+	}
+	if ((payload = find_box(p, end, BOX('m','v','e','x'), &size)) != NULL)
+	{
+		const unsigned char *mvex_end = payload + size;
+		for (box = payload; next_box(&box, mvex_end, &type, &payload, &size); )
+		{
+			struct fmp4_track *track;
+			if (type != BOX('t','r','e','x') || size < 24 || (track = get_track(ctx, rb32(payload + 4))) == NULL)
+				continue;
+			track->default_duration = rb32(payload + 12);
+			track->default_size = rb32(payload + 16);
+		}
+	}
+
+	// Same choice as processmp4(): a caption track unless -mp4vidtrack
+	for (int i = 0; i < ctx->nb_tracks; i++)
+	{
+		struct fmp4_track *track = &ctx->tracks[i];
+		if (track->type == FMP4_OTHER)
+			continue;
+		if (ctx->track == NULL || (ctx->track->type == FMP4_AVC) != (ccx_options.mp4vidtrack != 0))
+			ctx->track = track;
+	}
+	if (ctx->track != NULL)
+	{
+		debug("Captions from track %u\n", ctx->track->id);
+		ctx->param_sets_pending = ctx->track->type == FMP4_AVC;
+	}
+	else
+		mprint("\rNo caption or AVC track in the MP4 movie header.\n");
+}
+
+static int add_sample(struct fmp4_ctx *ctx, uint64_t offset, uint32_t size, int64_t pts)
+{
+	if (ctx->nb_samples == ctx->samples_size)
+	{
+		int n = ctx->samples_size ? ctx->samples_size * 2 : 256;
+		struct fmp4_sample *samples = realloc(ctx->samples, n * sizeof(struct fmp4_sample));
+		if (samples == NULL)
+			return -1;
+		ctx->samples = samples;
+		ctx->samples_size = n;
+	}
+	ctx->samples[ctx->nb_samples].offset = offset;
+	ctx->samples[ctx->nb_samples].size = size;
+	ctx->samples[ctx->nb_samples].pts = pts;
+	ctx->nb_samples++;
+	return 0;
+}
+
+/* Samples of the caption track in a moof starting at moof_start, ISO/IEC
+ * 14496-12 8.8.7 to 8.8.8. The data of every track is followed through, for
+ * the implicit data offsets. */
+static void parse_moof(struct fmp4_ctx *ctx, uint64_t moof_start, const unsigned char *p, const unsigned char *end)
+{
+	const unsigned char *traf, *box, *payload;
+	uint64_t traf_size, size;
+	uint64_t data_end = moof_start;
+	uint32_t type;
+
+	ctx->nb_samples = 0;
+	ctx->next_sample = 0;
+	for (traf = p; next_box(&traf, end, &type, &p, &traf_size); )
+	{
+		const unsigned char *tfhd, *tfdt, *traf_end = p + traf_size;
+		struct fmp4_track *track;
+		uint32_t flags, duration, sample_size;
+		uint64_t dts, base, pos;
+
+		if (type != BOX('t','r','a','f'))
+			continue;
+		if ((tfhd = find_box(p, traf_end, BOX('t','f','h','d'), &size)) == NULL || size < 8 ||
+				(track = get_track(ctx, rb32(tfhd + 4))) == NULL)
+			continue;
+		flags = rb32(tfhd) & 0xffffff;
+		if (size < 8 + (flags & 0x01 ? 8 : 0) + (flags & 0x02 ? 4 : 0) + (flags & 0x08 ? 4 : 0) + (flags & 0x10 ? 4 : 0))
+			continue;
+		box = tfhd + 8;
+		if (flags & 0x01) // base_data_offset
+		{
+			base = rb64(box);
+			box += 8;
+		}
+		else if (flags & 0x20000) // default_base_is_moof
+			base = moof_start;
+		else
+			base = data_end;
+		pos = base;
+		if (flags & 0x02)
+			box += 4;
+		duration = track->default_duration;
+		if (flags & 0x08)
+		{
+			duration = rb32(box);
+			box += 4;
+		}
+		sample_size = track->default_size;
+		if (flags & 0x10)
+			sample_size = rb32(box);
+
+		dts = track->next_dts;
+		if ((tfdt = find_box(p, traf_end, BOX('t','f','d','t'), &size)) != NULL && size >= 8)
+			dts = tfdt[0] == 1 && size >= 12 ? rb64(tfdt + 4) : rb32(tfdt + 4);
+
+		for (box = p; next_box(&box, traf_end, &type, &payload, &size); )
+		{
+			uint32_t trun_flags, count, entry_size;
+			const unsigned char *q;
+
+			if (type != BOX('t','r','u','n') || size < 8)
+				continue;
+			trun_flags = rb32(payload) & 0xffffff;
+			count = rb32(payload + 4);
+			q = payload + 8;
+			if (trun_flags & 0x01) // data_offset, else right after the previous run
+			{
+				if (size < 12)
+					continue;
+				pos = base + (int32_t) rb32(q);
+				q += 4;
+			}
+			if (trun_flags & 0x04)
+				q += 4;
+			entry_size = 4 * (!!(trun_flags & 0x100) + !!(trun_flags & 0x200) + !!(trun_flags & 0x400) + !!(trun_flags & 0x800));
+			if ((uint64_t) (q - payload) + (uint64_t) count * entry_size > size)
+			{
+				debug("Broken trun of track %u\n", track->id);
+				continue;
+			}
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t d = duration, s = sample_size;
+				int64_t cts = 0;
+
+				if (trun_flags & 0x100)
+				{
+					d = rb32(q);
+					q += 4;
+				}
+				if (trun_flags & 0x200)
+				{
+					s = rb32(q);
+					q += 4;
+				}
+				if (trun_flags & 0x400)
+					q += 4;
+				if (trun_flags & 0x800)
+				{
+					cts = payload[0] == 1 ? (int64_t) (int32_t) rb32(q) : (int64_t) rb32(q);
+					q += 4;
+				}
+				if (track == ctx->track && add_sample(ctx, pos, s, dts + cts) != 0)
+					return;
+				pos += s;
+				dts += d;
+			}
+		}
+		data_end = pos;
+		track->next_dts = dts;
+	}
+}
+
+/* cc_data triplets of a c608 or c708 sample, as process_raw_with_field() wants them */
+static void read_cc_sample(struct fmp4_ctx *ctx, uint32_t size, struct demuxer_data *data)
+{
+	const unsigned char *p = ctx->sample, *payload;
+	uint64_t atom_size;
+	uint32_t type;
+
+	data->bufferdatatype = CCX_RAW_TYPE;
+	while (next_box(&p, ctx->sample + size, &type, &payload, &atom_size))
+	{
+		if (type == BOX('c','d','a','t') || type == BOX('c','d','t','2'))
+		{
+			// 608 byte pairs of field 1 or 2
+			for (uint64_t i = 0; i + 2 <= atom_size && data->len + 3 <= BUFSIZE; i += 2)
+			{
+				data->buffer[data->len++] = type == BOX('c','d','a','t') ? 0x04 : 0x05;
+				data->buffer[data->len++] = payload[i];
+				data->buffer[data->len++] = payload[i + 1];
+			}
+		}
+		else if (type == BOX('c','c','d','p') && ctx->track->type == FMP4_C708)
+		{
+			unsigned int cc_count;
+			unsigned char *cc_data = ccdp_find_data((unsigned char *) payload, atom_size, &cc_count);
+			if (cc_data != NULL && data->len + cc_count * 3 <= BUFSIZE)
+			{
+				memcpy(data->buffer + data->len, cc_data, cc_count * 3);
+				data->len += cc_count * 3;
+			}
+		}
+	}
+}
+
+/* The NAL units of an AVC sample do_NAL() uses, with start codes. Only the
+ * head of the slices is read, the rest of them and the other NAL units are
+ * skipped. */
+static int read_avc_sample(struct fmp4_ctx *ctx, struct ccx_demuxer *demux, uint32_t size, struct demuxer_data *data)
+{
+	struct fmp4_track *track = ctx->track;
+	unsigned char head[4];
+	int ret;
+
+	data->bufferdatatype = CCX_H264;
+	if (ctx->param_sets_pending && track->param_sets_len <= BUFSIZE)
+	{
+		memcpy(data->buffer, track->param_sets, track->param_sets_len);
+		data->len = track->param_sets_len;
+		ctx->param_sets_pending = 0;
+	}
+
+	while (size > (uint32_t) track->nal_unit_size)
+	{
+		uint32_t nal_length = 0, want;
+
+		if ((ret = read_input(demux, head, track->nal_unit_size)) != CCX_OK)
+			return ret;
+		for (int i = 0; i < track->nal_unit_size; i++)
+			nal_length = (nal_length << 8) | head[i];
+		size -= track->nal_unit_size;
+		if (nal_length == 0)
+			continue;
+		if (nal_length > size)
+			nal_length = size;
+		if ((ret = read_input(demux, head, 1)) != CCX_OK)
+			return ret;
+
+		want = avc_nal_bytes_read(head[0], nal_length);
+		if (want > 0 && data->len + 4 + want > BUFSIZE)
+		{
+			mprint("\rWarning: H.264 NAL unit of %u bytes in MP4 skipped, too large.\n", nal_length);
+			want = 0;
+		}
+		if (want > 0)
+		{
+			memcpy(data->buffer + data->len, "\0\0\0\1", 4);
+			data->buffer[data->len + 4] = head[0];
+			if ((ret = read_input(demux, data->buffer + data->len + 5, want - 1)) != CCX_OK)
+				return ret;
+			data->len += 4 + want;
+		}
+		else
+			want = 1;
+		if ((ret = skip_input(demux, nal_length - want)) != CCX_OK)
+			return ret;
+		size -= nal_length;
+	}
+	return skip_input(demux, size);
+}
+
+static int read_sample(struct fmp4_ctx *ctx, struct ccx_demuxer *demux, struct fmp4_sample *s, struct demuxer_data *data)
+{
+	int ret;
+
+	data->pts = s->pts;
+	data->tb.num = 1;
+	data->tb.den = ctx->track->timescale;
+	if (ctx->track->type == FMP4_AVC)
+	{
+		ret = read_avc_sample(ctx, demux, s->size, data);
+		// process_avc() needs more than a start code
+		if (data->len <= 5)
+			data->len = 0;
+		return ret;
+	}
+	if (s->size > FMP4_MAX_CC_SAMPLE)
+	{
+		debug("Sample of %u bytes skipped\n", s->size);
+		return skip_input(demux, s->size);
+	}
+	if ((ret = read_input(demux, ctx->sample, s->size)) != CCX_OK)
+		return ret;
+	read_cc_sample(ctx, s->size, data);
+	return CCX_OK;
+}
+
+/* Read boxes until a sample of the caption track gives some data */
+static int read_packet(struct ccx_demuxer *demux, struct demuxer_data *data)
+{
+	struct fmp4_ctx *ctx = demux->private_data;
+	unsigned char header[16];
+	int ret;
+
+	while (1)
+	{
+		uint64_t start = demux->past, size;
+		uint32_t type;
+		int header_size = 8;
+
+		if (ctx->mdat_end)
+		{
+			struct fmp4_sample *s = ctx->next_sample < ctx->nb_samples ? &ctx->samples[ctx->next_sample] : NULL;
+
+			if (s != NULL && s->offset < ctx->mdat_end)
+			{
+				ctx->next_sample++;
+				if (s->offset < (uint64_t) demux->past || s->offset + s->size > ctx->mdat_end)
+				{
+					debug("Sample at %"PRIu64" not in the mdat, skipped\n", s->offset);
+					continue;
+				}
+				if ((ret = skip_input(demux, s->offset - demux->past)) != CCX_OK ||
+						(ret = read_sample(ctx, demux, s, data)) != CCX_OK)
+					return ret;
+				if (data->len > 0)
+					return CCX_OK;
+				continue;
+			}
+			// Samples in a later mdat are kept for it
+			if ((ret = skip_input(demux, ctx->mdat_end - demux->past)) != CCX_OK)
+				return ret;
+			ctx->mdat_end = 0;
+			continue;
+		}
+
+		if (read_input(demux, header, 8) != CCX_OK)
+			return CCX_EOF;
+		size = rb32(header);
+		type = rb32(header + 4);
+		if (size == 1)
+		{
+			if (read_input(demux, header + 8, 8) != CCX_OK)
+				return CCX_EOF;
+			size = rb64(header + 8);
+			header_size = 16;
+		}
+		else if (size == 0) // Up to the end
+			size = UINT64_MAX - start;
+		if (size < header_size)
+		{
+			mprint("\rBroken MP4 box at %"PRIu64", stopping.\n", start);
+			return CCX_EOF;
+		}
+		size -= header_size;
+		debug("Box %c%c%c%c at %"PRIu64", %"PRIu64" bytes\n",
+				header[4], header[5], header[6], header[7], start, size);
+
+		switch (type)
+		{
+			case BOX('m','o','o','v'):
+			case BOX('m','o','o','f'):
+				if (size > FMP4_MAX_TABLE_BOX)
+				{
+					mprint("\rMP4 %c%c%c%c box of %"PRIu64" bytes skipped, too large.\n",
+							header[4], header[5], header[6], header[7], size);
+					if (type == BOX('m','o','o','f'))
+						ctx->nb_samples = 0;
+					if ((ret = skip_input(demux, size)) != CCX_OK)
+						return ret;
+					break;
+				}
+				if (size > ctx->box_size)
+				{
+					unsigned char *box = realloc(ctx->box, size);
+					if (box == NULL)
+						fatal(EXIT_NOT_ENOUGH_MEMORY, "In read_packet: Out of memory for a %"PRIu64" bytes MP4 box.", size);
+					ctx->box = box;
+					ctx->box_size = size;
+				}
+				if (read_input(demux, ctx->box, size) != CCX_OK)
+					return CCX_EOF;
+				if (type == BOX('m','o','o','v'))
+					parse_moov(ctx, ctx->box, ctx->box + size);
+				else if (ctx->track != NULL)
+					parse_moof(ctx, start, ctx->box, ctx->box + size);
+				break;
+			case BOX('m','d','a','t'):
+				ctx->mdat_end = size > UINT64_MAX - demux->past ? UINT64_MAX : demux->past + size;
+				break;
+			default:
+				if ((ret = skip_input(demux, size)) != CCX_OK)
+					return ret;
+				break;
+		}
+	}
+}
+
+int ccx_fmp4_getmoredata(struct lib_ccx_ctx *ctx, struct demuxer_data **ppdata)
+{
+	struct fmp4_ctx *fctx = ctx->demux_ctx->private_data;
+	struct demuxer_data *data;
+	int ret;
+
+	if (!*ppdata)
+	{
+		*ppdata = alloc_demuxer_data();
+		if (!*ppdata)
+			return -1;
+
+		data = *ppdata;
+		data->program_number = 1;
+		data->stream_pid = 1;
+		data->codec = CCX_CODEC_ATSC_CC;
+	}
+	else
+	{
+		data = *ppdata;
+	}
+
+	ret = read_packet(ctx->demux_ctx, data);
+	if (fctx->track != NULL && fctx->track->type == FMP4_C708)
+		ctx->dec_global_setting->settings_dtvcc->enabled = 1;
+
+	// Nothing left for the decoders, process_avc() refuses empty buffers
+	if (ret == CCX_EOF && data->len == 0)
+	{
+		delete_demuxer_data(data);
+		*ppdata = NULL;
+	}
+	return ret;
+}
+
+struct fmp4_ctx *ccx_fmp4_init(struct ccx_demuxer *demux)
+{
+	struct fmp4_ctx *ctx = calloc(1, sizeof(struct fmp4_ctx));
+
+	if (!ctx)
+		return NULL;
+	if ((ctx->sample = malloc(FMP4_MAX_CC_SAMPLE)) == NULL)
+	{
+		free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+void ccx_fmp4_delete(struct ccx_demuxer *demux)
+{
+	struct fmp4_ctx *ctx = demux->private_data;
+
+	if (!ctx)
+		return;
+	for (int i = 0; i < ctx->nb_tracks; i++)
+		free(ctx->tracks[i].param_sets);
+	free(ctx->samples);
+	free(ctx->box);
+	free(ctx->sample);
+	freep(&demux->private_data);
+}
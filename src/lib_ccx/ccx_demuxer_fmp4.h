@@ -0,0 +1,24 @@
+#ifndef CCX_DEMUXER_FMP4_H
+#define CCX_DEMUXER_FMP4_H
+
+#include "ccx_demuxer.h"
+
+/**
+ * Fragmented MP4 (fMP4, CMAF) read as a stream, box by box, for stdin and
+ * files still being written, which GPAC can't open: processmp4() needs the
+ * whole file before the first sample.
+ *
+ * The moov and each moof are read whole, they only hold tables. The mdat
+ * that follows a moof is read sample by sample from the caption track: a
+ * c608 or c708 track, or else the AVC track, of which only the SEI, the
+ * parameter sets and the head of each slice are read. Everything else is
+ * skipped as it comes, so memory stays bounded by the size of a moof.
+ *
+ * Used when an MP4 is detected on stdin, the network or with --stream, and
+ * with -in=fmp4.
+ */
+
+struct fmp4_ctx *ccx_fmp4_init(struct ccx_demuxer *demux);
+void ccx_fmp4_delete(struct ccx_demuxer *demux);
+
+#endif
@@ -10,10 +10,16 @@
 #include "utility.h"
 #include "lib_ccx.h"
 
-#define debug(fmt, ...) ccx_common_logging.debug_ftn(CCX_DMT_PARSE, "MXF:%s:%d: "fmt , __FUNCTION__ ,__LINE__ , ##__VA_ARGS__)
+#define debug(fmt, ...) ccx_debug(CCX_DMT_PARSE, "MXF:%s:%d: "fmt , __FUNCTION__ ,__LINE__ , ##__VA_ARGS__)
 #define log(fmt, ...) ccx_common_logging.log_ftn("MXF:%d: "fmt , __LINE__ , ##__VA_ARGS__)
 #define IS_KLV_KEY(x, y) (!memcmp(x, y, sizeof(y)))
 
+#define RB64(x) (((uint64_t) RB32(x) << 32) | RB32((x) + 4))
+
+#define MXF_MAX_INDEX_BYTES (64 << 20)  // Index tables of a partition, larger ones are not read
+#define MXF_MIN_EDIT_UNIT_BYTES 17      // Key and length of the caption element at least, bounds the index size
+#define MXF_MAX_ANC_BYTES (1 << 20)     // ANC elements hold a few packets of up to 255 bytes
+
 
 enum MXFCaptionType
 {
@@ -26,6 +32,7 @@ typedef struct KLVPacket
 {
 	UID key;
 	uint64_t length;
+	uint64_t offset; // Of the key in the input
 } KLVPacket;
 
 typedef struct MXFCodecUL
@@ -48,6 +55,26 @@ typedef struct MXFReadTableEntry
 	ReadFunc *read;
 } MXFReadTableEntry;
 
+enum MXFIndexState
+{
+	MXF_INDEX_UNTRIED, // Until the first caption element
+	MXF_INDEX_NONE,    // Read on KLV by KLV
+	MXF_INDEX_USED,    // Seek from one caption element to the next
+};
+
+typedef struct MXFPartition
+{
+	uint64_t offset;
+	uint64_t pack_end;
+	uint64_t previous;
+	uint64_t footer;
+	uint64_t header_bytes;
+	uint64_t index_bytes;
+	uint64_t body_offset;
+	uint32_t body_sid;
+	uint64_t essence_start; // After the header metadata and index tables
+} MXFPartition;
+
 typedef struct MXFContext
 {
 	enum MXFCaptionType type;
@@ -57,6 +84,18 @@ typedef struct MXFContext
 	int nb_tracks;
 	int cap_count;
 	struct ccx_rational edit_rate;
+	uint64_t footer_partition;
+
+	/* From the index table segments: where the content package of each
+	 * edit unit and the caption element in it are */
+	enum MXFIndexState index_state;
+	uint64_t *cp_offsets;
+	uint64_t *cap_offsets;
+	int64_t nb_edit_units;
+	int64_t next_edit_unit;
+
+	uint8_t *anc_buf;
+	size_t anc_buf_size;
 } MXFContext;
 
 typedef struct MXFLocalTAGS
@@ -70,6 +109,10 @@ typedef struct MXFLocalTAGS
 static const uint8_t mxf_header_partition_pack_key[] = { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x02 };
 static const uint8_t mxf_essence_element_key[]       = { 0x06,0x0e,0x2b,0x34,0x01,0x02,0x01,0x01,0x0d,0x01,0x03,0x01 };
 static const uint8_t mxf_klv_key[]                   = { 0x06,0x0e,0x2b,0x34 };
+static const uint8_t mxf_random_index_pack_key[]     = { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x11,0x01,0x00 };
+static const uint8_t mxf_index_table_segment_key[]   = { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x10,0x01,0x00 };
+// KLV fill item, after 06 0e 2b 34 01 01 01 and a version byte
+static const uint8_t mxf_fill_key_tail[]             = { 0x03,0x01,0x02,0x10,0x01,0x00,0x00,0x00 };
 
 static const MXFCodecUL mxf_caption_essence_container[] = {
 { {0x6,0xE,0x2B,0x34,0x04,0x01,0x01,0x09,0xD,0x1,0x3,0x1,0x2,0xD,0x0,0x0}, MXF_CT_VBI },
@@ -83,6 +126,14 @@ enum MXFLocalTag
 	MXF_TAG_TRACK_ID     = 0x4801,
 	MXF_TAG_TRACK_NUMBER = 0x4804,
 	MXF_TAG_EDIT_RATE    = 0x4b01,
+	/* Index table segment */
+	MXF_TAG_EDIT_UNIT_BYTE_COUNT  = 0x3f05,
+	MXF_TAG_BODY_SID              = 0x3f07,
+	MXF_TAG_SLICE_COUNT           = 0x3f08,
+	MXF_TAG_DELTA_ENTRY_ARRAY     = 0x3f09,
+	MXF_TAG_INDEX_ENTRY_ARRAY     = 0x3f0a,
+	MXF_TAG_INDEX_START_POSITION  = 0x3f0c,
+	MXF_TAG_INDEX_DURATION        = 0x3f0d,
 };
 
 void update_tid_lut(struct MXFContext *ctx, uint32_t track_id, uint8_t *track_number, struct ccx_rational edit_rate)
@@ -139,6 +190,7 @@ static int mxf_read_header_partition_pack(struct ccx_demuxer *demux, uint64_t si
 	int j = 0;
 
 	uint8_t essence_ul[16];
+	uint8_t pack[78];
 	uint8_t nb_essence_container;
 	struct MXFContext *ctx = demux->private_data;
 
@@ -161,11 +213,12 @@ static int mxf_read_header_partition_pack(struct ccx_demuxer *demux, uint64_t si
 	}
 	len += 2;
 
-	ret = buffered_skip(demux, 78);
+	ret = buffered_read(demux, pack, 78);
 	if (ret != 78)
 		return CCX_EOF;
 	demux->past += ret;
 	len += ret;
+	ctx->footer_partition = RB64(pack + 22);
 
 	nb_essence_container = buffered_get_be32(demux);
 	len += 4;
@@ -274,52 +327,33 @@ static int mxf_read_vanc_vbi_desc(struct ccx_demuxer *demux, uint64_t size)
 	return len;
 }
 
-static int mxf_read_cdp_data(struct ccx_demuxer *demux, int size, struct demuxer_data *data)
+static void mxf_read_cdp_data(const uint8_t *cdp, int size, struct demuxer_data *data)
 {
-	int len = 0;
-	int ret, cc_count;
+	int cc_count;
 
-	ret = buffered_get_be16(demux);
-	len += 2;
-	if(ret != 0x9669)
+	if (size < 9 || RB16(cdp) != 0x9669)
 	{
 		log("Invalid CDP Identifier\n");
-		goto error;
+		return;
 	}
-
-	ret = buffered_get_byte(demux);
-	len++;
-	if(ret != size)
+	if (cdp[2] != size)
 	{
 		log("Incomplete CDP packet\n");
-		goto error;
+		return;
 	}
 	//skip framerate, flag and hdr_seq_cntr
-	buffered_skip(demux, 4);
-	demux->past += 4;
-	len += 4;
-
-	ret = buffered_get_byte(demux);
-	len ++;
-	if(ret != 0x72) // Skip if its not cdata identitfier
-		goto error;
+	if (cdp[7] != 0x72) // Skip if its not cdata identitfier
+		return;
 
-	cc_count = buffered_get_byte(demux) & 0x1F;
-	len++;
+	cc_count = cdp[8] & 0x1F;
 	// -4 for cdp footer length
-	if ( (cc_count * 3) != (size - len - 4))
+	if ((cc_count * 3) != (size - 9 - 4))
 		log("Incomplete CDP packet\n");
+	if (cc_count * 3 > size - 9)
+		cc_count = (size - 9) / 3;
 
-	ret = buffered_read(demux, data->buffer+data->len, cc_count*3);
-	data->len += cc_count*3;
-	demux->past += cc_count*3;
-	len += ret;
-
-error:
-	ret = buffered_skip(demux, size - len);
-	demux->past += ret;
-	len += ret;
-	return len;
+	memcpy(data->buffer + data->len, cdp + 9, cc_count * 3);
+	data->len += cc_count * 3;
 }
 
 /**
@@ -357,163 +391,624 @@ error:
  * DID 0x61 (did could be 0x80 as well)
  * SDID 0x01 for CEA-708 0x02 for EIA-608 )
  */
-static int mxf_read_vanc_data(struct ccx_demuxer *demux, uint64_t size, struct demuxer_data *data)
+static void mxf_read_vanc_data(const uint8_t *vanc, uint64_t size, struct demuxer_data *data)
 {
-	int len = 0;
-	int ret;
+	const uint8_t *p = vanc + 16;
+	const uint8_t *end = vanc + size;
 	int cdp_size;
-	char vanc_header[16];
 	uint8_t DID;
 	uint8_t SDID;
-	uint8_t count;
 
 	if (size < 19)
-		goto error;
-
-	ret = buffered_read(demux, vanc_header, 16);
+		return;
 
-	demux->past += ret;
-	if (ret < 16)
-		return CCX_EOF;
-	len += ret;
+	for (int i = 0; i < vanc[1] && end - p >= 3; i++)
+	{
+		DID = p[0];
+		if (!(DID == 0x61 || DID == 0x80))
+			return;
 
-	for (int i = 0; i < vanc_header[1]; i++) {
-		DID = buffered_get_byte(demux);
-        len++;
-        if (!(DID == 0x61 || DID == 0x80))
-        {
-            goto error;
-        }
+		SDID = p[1];
+		if (SDID == 0x01)
+			debug("Caption Type 708\n");
+		else if (SDID == 0x02)
+			debug("Caption Type 608\n");
 
-		SDID = buffered_get_byte(demux);
-        len++;
-        if (SDID == 0x01)
-            debug("Caption Type 708\n");
-        else if (SDID == 0x02)
-            debug("Caption Type 608\n");
+		cdp_size = p[2];
+		p += 3;
+		if (cdp_size + 19 > size || cdp_size > end - p)
+		{
+			debug("Incomplete cdp(%d) in anc data(%d)\n", cdp_size, size);
+			return;
+		}
 
-		cdp_size = buffered_get_byte(demux);
-        if (cdp_size + 19 > size)
-        {
-            debug("Incomplete cdp(%d) in anc data(%d)\n", cdp_size, size);
-            goto error;
-        }
-        len++;
+		mxf_read_cdp_data(p, cdp_size, data);
+		p += cdp_size;
+	}
+}
 
-        ret = mxf_read_cdp_data(demux, cdp_size, data);
-        len += ret;
-        //len += (3 + count + 4);
+/* Buffer for the ANC elements that aren't in the file buffer */
+static uint8_t *mxf_anc_buffer(struct MXFContext *ctx, size_t size)
+{
+	if (size > ctx->anc_buf_size)
+	{
+		uint8_t *buf = realloc(ctx->anc_buf, size);
+		if (!buf)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "In mxf_anc_buffer: Not enough memory for ANC data.\n");
+		ctx->anc_buf = buf;
+		ctx->anc_buf_size = size;
 	}
+	return ctx->anc_buf;
+}
 
+static int mxf_skip(struct ccx_demuxer *demux, uint64_t size)
+{
+	uint64_t ret = buffered_skip_long(demux, size);
 
-error:
-	ret = buffered_skip(demux, size - len);
 	demux->past += ret;
-	len += ret;
-	return len;
-
+	return ret == size ? 0 : CCX_EOF;
 }
 
+/* The whole element is read at once, the packets in it are small */
 static int mxf_read_essence_element(struct ccx_demuxer *demux, uint64_t size, struct demuxer_data *data)
 {
 	int ret;
 	struct MXFContext *ctx = demux->private_data;
+	uint8_t *vanc;
 
-	if (ctx->type == MXF_CT_ANC)
+	if (ctx->type == MXF_CT_ANC && size <= MXF_MAX_ANC_BYTES)
 	{
+		vanc = buffered_read_ptr(demux, size);
+		if (!vanc)
+		{
+			vanc = mxf_anc_buffer(ctx, size);
+			ret = buffered_read(demux, vanc, size);
+			demux->past += ret;
+			if (ret < size)
+				return CCX_EOF;
+		}
+		else
+			demux->past += size;
+
 		data->bufferdatatype = CCX_RAW_TYPE;
-		ret = mxf_read_vanc_data(demux, size, data);
+		mxf_read_vanc_data(vanc, size, data);
 		data->pts = ctx->cap_count;
 		ctx->cap_count++;
+		ret = size;
 	}
 	else
 	{
-		ret = buffered_skip(demux, size);
-		demux->past += ret;
+		// An ANC element too large to be real is skipped, but still counted
+		if (ctx->type == MXF_CT_ANC)
+			ctx->cap_count++;
+		if (mxf_skip(demux, size) != 0)
+			return CCX_EOF;
+		ret = size;
 	}
 
 	return ret;
 }
 
+/* Sorted by key for getMXFReader() */
 static const MXFReadTableEntry mxf_read_table[] = {
 /* According to section 7.1 of S377 partition key byte 14 and 15 have variable values */
 { { 0x06,0x0e,0x2b,0x34,0x02,0x05,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x02,0x04,0x00 }, mxf_read_header_partition_pack},
 /* Structural Metadata Sets */
 { { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x01,0x01,0x01,0x01,0x3B,0x00 }, mxf_read_timeline_track_metadata },
 { { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x01,0x01,0x01,0x01,0x5c,0x00 }, mxf_read_vanc_vbi_desc},
-/* Generic Track */
-{ { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, NULL},
 };
 
-static int mxf_read_sync(struct ccx_demuxer *ctx, const uint8_t *key, size_t size)
+/* Length of a KLV, from p in the input or from buf if not NULL. Returns
+ * the number of bytes it took, -1 if it's invalid or not all there. */
+static int klv_decode_ber_length(struct ccx_demuxer *ctx, const uint8_t *buf, int avail, uint64_t *length)
 {
-	size_t i;
-	unsigned char b;
-	int ret;
-	for (i = 0; i < size ; i++)
+	uint8_t bytes[9];
+	int bytes_num;
+
+	if (!buf)
+	{
+		if (buffered_read(ctx, bytes, 1) != 1)
+			return -1;
+		ctx->past++;
+		buf = bytes;
+		avail = 1;
+	}
+	if (avail < 1)
+		return -1;
+	*length = buf[0];
+	if (!(buf[0] & 0x80))
+		return 1;
+	/* long form, SMPTE 379M 5.3.4 guarantee that bytes_num must not exceed 8 bytes */
+	bytes_num = buf[0] & 0x7f;
+	if (bytes_num > 8)
+		return -1;
+	if (buf == bytes)
 	{
-		ret = buffered_read_byte(ctx, &b);
-		if (ret != 1)
+		if (buffered_read(ctx, bytes + 1, bytes_num) != bytes_num)
+			return -1;
+		ctx->past += bytes_num;
+	}
+	else if (avail < 1 + bytes_num)
+		return -1;
+	*length = 0;
+	for (int i = 1; i <= bytes_num; i++)
+		*length = *length << 8 | buf[i];
+	return 1 + bytes_num;
+}
+
+/*
+ * The next KLV usually starts right where the previous one ends, so its key
+ * is read at once. Only if it doesn't, and resync is set, we look for the
+ * next one.
+ */
+static int klv_read_packet(KLVPacket *klv, struct ccx_demuxer *ctx, int resync)
+{
+	size_t result;
+
+	result = buffered_read(ctx, klv->key, 16);
+	ctx->past += result;
+	if (result != 16)
+		return CCX_EOF;
+
+	while (!IS_KLV_KEY(klv->key, mxf_klv_key))
+	{
+		int i;
+
+		if (!resync)
+			return CCX_EINVAL;
+		// A key starting in what we read, or cut at its end
+		for (i = 1; i < 16; i++)
 		{
+			if (!memcmp(klv->key + i, mxf_klv_key, 16 - i < 4 ? 16 - i : 4))
+				break;
+		}
+		memmove(klv->key, klv->key + i, 16 - i);
+		result = buffered_read(ctx, klv->key + 16 - i, i);
+		ctx->past += result;
+		if (result != i)
 			return CCX_EOF;
+	}
+	klv->offset = ctx->past - 16;
+
+	return klv_decode_ber_length(ctx, NULL, 0, &klv->length) < 0 ? -1 : 0;
+}
+
+static int compare_read_table_key(const void *key, const void *entry)
+{
+	return memcmp(key, ((const MXFReadTableEntry *) entry)->key, sizeof(UID));
+}
+
+/* mxf_read_table is sorted by key */
+static const MXFReadTableEntry *getMXFReader(UID key)
+{
+	return bsearch(key, mxf_read_table, sizeof(mxf_read_table) / sizeof(*mxf_read_table),
+			sizeof(*mxf_read_table), compare_read_table_key);
+}
+
+/*
+ * Read the input file at offset, for the index, without moving where the
+ * demuxer reads. Returns the number of bytes read, -1 on error.
+ */
+static int mxf_read_at(struct ccx_demuxer *demux, uint64_t offset, uint8_t *buf, int len)
+{
+	LLONG current = LSEEK(demux->infd, 0, SEEK_CUR);
+	int total = 0, ret = 0;
+
+	if (current < 0 || LSEEK(demux->infd, offset, SEEK_SET) != (LLONG) offset)
+		return -1;
+	while (total < len && (ret = read(demux->infd, buf + total, len - total)) > 0)
+		total += ret;
+	if (LSEEK(demux->infd, current, SEEK_SET) != current)
+		fatal(EXIT_READ_ERROR, "Error seeking in MXF input file!\n");
+	return ret < 0 ? -1 : total;
+}
+
+/* Key and length of the KLV at offset. Returns the offset of its value, 0 on error. */
+static uint64_t mxf_klv_at(struct ccx_demuxer *demux, uint64_t offset, KLVPacket *klv)
+{
+	uint8_t buf[16 + 9];
+	int len = mxf_read_at(demux, offset, buf, sizeof(buf));
+	int ber;
+
+	if (len < 17 || !IS_KLV_KEY(buf, mxf_klv_key))
+		return 0;
+	ber = klv_decode_ber_length(demux, buf + 16, len - 16, &klv->length);
+	if (ber < 0)
+		return 0;
+	memcpy(klv->key, buf, 16);
+	klv->offset = offset;
+	return offset + 16 + ber;
+}
+
+static int mxf_read_partition(struct ccx_demuxer *demux, uint64_t offset, MXFPartition *p)
+{
+	uint8_t buf[16 + 9 + 64];
+	int len = mxf_read_at(demux, offset, buf, sizeof(buf));
+	const uint8_t *v;
+	uint64_t size;
+	int ber;
+
+	if (len < 17 || memcmp(buf, mxf_header_partition_pack_key, 13))
+		return -1;
+	ber = klv_decode_ber_length(demux, buf + 16, len - 16, &size);
+	if (ber < 0 || size < 88 || len < 16 + ber + 64)
+		return -1;
+	v = buf + 16 + ber;
+	p->offset = offset;
+	p->pack_end = offset + 16 + ber + size;
+	p->previous = RB64(v + 16);
+	p->footer = RB64(v + 24);
+	p->header_bytes = RB64(v + 32);
+	p->index_bytes = RB64(v + 40);
+	p->body_offset = RB64(v + 52);
+	p->body_sid = RB32(v + 60);
+	p->essence_start = 0;
+	return 0;
+}
+
+/*
+ * The partitions, from the random index pack at the end of the file or else
+ * going back from the footer partition.
+ */
+static MXFPartition *mxf_read_partitions(struct ccx_demuxer *demux, LLONG file_size, int *nb)
+{
+	struct MXFContext *ctx = demux->private_data;
+	MXFPartition *partitions = NULL;
+	uint8_t *rip = NULL;
+	uint8_t buf[4];
+	uint32_t rip_size = 0;
+	uint64_t length;
+	int ber;
+
+	*nb = 0;
+	if (file_size > 4 && mxf_read_at(demux, file_size - 4, buf, 4) == 4)
+		rip_size = RB32(buf);
+	if (rip_size >= 16 + 1 + 4 && rip_size <= file_size && rip_size <= MXF_MAX_INDEX_BYTES &&
+			(rip = malloc(rip_size)) != NULL &&
+			mxf_read_at(demux, file_size - rip_size, rip, rip_size) == (int) rip_size &&
+			IS_KLV_KEY(rip, mxf_random_index_pack_key) &&
+			(ber = klv_decode_ber_length(demux, rip + 16, rip_size - 16, &length)) > 0 &&
+			length == rip_size - 16 - ber && length >= 4)
+	{
+		int count = (length - 4) / 12;
+		partitions = malloc(count * sizeof(*partitions));
+		for (int i = 0; partitions && i < count; i++)
+		{
+			if (mxf_read_partition(demux, RB64(rip + 16 + ber + i * 12 + 4), &partitions[*nb]) == 0)
+				(*nb)++;
 		}
-		ctx->past++;
+	}
+	else if (ctx->footer_partition)
+	{
+		MXFPartition p;
+		uint64_t offset = ctx->footer_partition;
+		int size = 0;
 
-		if (b == key[0])
-			i = 0;
-		else if (b != key[i])
-			i = -1;
+		while (mxf_read_partition(demux, offset, &p) == 0)
+		{
+			if (*nb == size)
+			{
+				MXFPartition *tmp = realloc(partitions, (size = size ? size * 2 : 16) * sizeof(*partitions));
+				if (!tmp)
+					break;
+				partitions = tmp;
+			}
+			partitions[(*nb)++] = p;
+			if (offset == 0 || p.previous >= offset)
+				break;
+			offset = p.previous;
+		}
+		for (int i = 0; i < *nb / 2; i++)
+		{
+			p = partitions[i];
+			partitions[i] = partitions[*nb - 1 - i];
+			partitions[*nb - 1 - i] = p;
+		}
 	}
+	free(rip);
+	return partitions;
+}
+
+static int mxf_is_fill_key(const uint8_t *key)
+{
+	return !memcmp(key, mxf_klv_key, 4) && key[4] == 0x01 && key[5] == 0x01 && key[6] == 0x01 &&
+		!memcmp(key + 8, mxf_fill_key_tail, sizeof(mxf_fill_key_tail));
+}
+
+/* The essence starts after the header metadata, the index tables and any fill */
+static void mxf_find_essence(struct ccx_demuxer *demux, MXFPartition *p)
+{
+	uint64_t offset = p->pack_end + p->header_bytes + p->index_bytes, value;
+	KLVPacket klv;
 
-	return !(i == size);
+	while ((value = mxf_klv_at(demux, offset, &klv)) != 0 && mxf_is_fill_key(klv.key))
+		offset = value + klv.length;
+	p->essence_start = offset;
 }
 
-static int64_t klv_decode_ber_length(struct ccx_demuxer *ctx)
+/* File offset of a byte of the essence stream, 0 if it isn't in a partition */
+static uint64_t mxf_stream_to_file(const MXFPartition *partitions, int nb, uint32_t body_sid, uint64_t stream_offset)
 {
-	uint64_t size = buffered_get_byte(ctx);
-	if (size & 0x80)
-	{ /* long form */
-		int bytes_num = size & 0x7f;
-		/* SMPTE 379M 5.3.4 guarantee that bytes_num must not exceed 8 bytes */
-		if (bytes_num > 8)
+	uint64_t offset = 0;
+
+	for (int i = 0; i < nb; i++)
+	{
+		if (partitions[i].body_sid == body_sid && partitions[i].essence_start &&
+				partitions[i].body_offset <= stream_offset)
+			offset = partitions[i].essence_start + stream_offset - partitions[i].body_offset;
+	}
+	return offset;
+}
+
+typedef struct MXFIndexSegment
+{
+	uint64_t start;
+	uint64_t duration;
+	uint32_t edit_unit_bytes;
+	uint32_t body_sid;
+	int slice_count;
+	const uint8_t *deltas;
+	uint32_t nb_deltas;
+	uint32_t delta_size;
+	const uint8_t *entries;
+	uint32_t nb_entries;
+	uint32_t entry_size;
+} MXFIndexSegment;
+
+static int mxf_parse_index_segment(const uint8_t *p, uint64_t size, MXFIndexSegment *seg)
+{
+	const uint8_t *end = p + size;
+
+	memset(seg, 0, sizeof(*seg));
+	while (end - p >= 4)
+	{
+		uint16_t tag = (p[0] << 8) | p[1];
+		uint16_t len = (p[2] << 8) | p[3];
+		const uint8_t *v = p + 4;
+
+		if (end - v < len)
 			return -1;
-		size = 0;
-		while (bytes_num--)
-			size = size << 8 | buffered_get_byte(ctx);
+		if (tag == MXF_TAG_INDEX_START_POSITION && len == 8)
+			seg->start = RB64(v);
+		else if (tag == MXF_TAG_INDEX_DURATION && len == 8)
+			seg->duration = RB64(v);
+		else if (tag == MXF_TAG_EDIT_UNIT_BYTE_COUNT && len == 4)
+			seg->edit_unit_bytes = RB32(v);
+		else if (tag == MXF_TAG_BODY_SID && len == 4)
+			seg->body_sid = RB32(v);
+		else if (tag == MXF_TAG_SLICE_COUNT && len == 1)
+			seg->slice_count = v[0];
+		else if ((tag == MXF_TAG_DELTA_ENTRY_ARRAY || tag == MXF_TAG_INDEX_ENTRY_ARRAY) && len >= 8)
+		{
+			uint32_t count = RB32(v), item = RB32(v + 4);
+			if (item == 0 || count > (uint32_t) (len - 8) / item)
+				return -1;
+			if (tag == MXF_TAG_DELTA_ENTRY_ARRAY)
+			{
+				seg->deltas = v + 8;
+				seg->nb_deltas = count;
+				seg->delta_size = item;
+			}
+			else
+			{
+				seg->entries = v + 8;
+				seg->nb_entries = count;
+				seg->entry_size = item;
+			}
+		}
+		p = v + len;
 	}
-	return size;
+	if (seg->entries && seg->entry_size < 11 + 4 * seg->slice_count)
+		return -1;
+	if (seg->deltas && seg->delta_size < 6)
+		return -1;
+	if (!seg->edit_unit_bytes)
+		seg->duration = seg->nb_entries;
+	return 0;
 }
 
-static int klv_read_packet(KLVPacket *klv, struct ccx_demuxer *ctx)
+/* Offset in the essence stream of the content package of an edit unit of
+ * seg, and of its element described by delta entry k (all of it if k < 0) */
+static uint64_t mxf_segment_offset(const MXFIndexSegment *seg, uint64_t edit_unit, int k, uint64_t *element)
 {
-	long long result;
-	int ret;
+	uint64_t offset;
+	int slice = 0;
+	uint32_t delta = 0;
 
-	ret = mxf_read_sync(ctx, mxf_klv_key, 4);
-	if ( ret !=  0)
-		return ret;
+	if (k >= 0)
+	{
+		slice = seg->deltas[k * seg->delta_size + 1];
+		delta = RB32(seg->deltas + k * seg->delta_size + 2);
+	}
+	if (seg->edit_unit_bytes)
+	{
+		offset = edit_unit * seg->edit_unit_bytes;
+		*element = offset + delta;
+	}
+	else
+	{
+		const uint8_t *entry = seg->entries + (edit_unit - seg->start) * seg->entry_size;
+		offset = RB64(entry + 3);
+		*element = offset + delta;
+		if (slice > 0 && slice <= seg->slice_count)
+			*element += RB32(entry + 11 + (slice - 1) * 4);
+	}
+	return offset;
+}
 
-	memcpy(klv->key, mxf_klv_key, 4);
-	result = buffered_read(ctx, klv->key + 4, 12);
-	ctx->past += result;
-	if (result != 12)
-		return CCX_EOF;
+/*
+ * Fill the offsets of the edit units of one index table segment. The
+ * caption element is the one of the delta entries whose offset in the first
+ * edit unit holds the caption essence key. An index without delta entries
+ * describes content packages of one element.
+ */
+static int mxf_add_index_segment(struct ccx_demuxer *demux, const MXFPartition *partitions, int nb_partitions,
+		uint32_t body_sid, uint64_t max_edit_units, const MXFIndexSegment *seg)
+{
+	struct MXFContext *ctx = demux->private_data;
+	uint64_t end, cp, element;
+	int k, nb_candidates = seg->nb_deltas ? seg->nb_deltas : 1;
+	KLVPacket klv;
 
-	klv->length = klv_decode_ber_length(ctx);
+	if (seg->body_sid != body_sid || seg->duration == 0)
+		return 0;
+	// More edit units than the file can hold: a broken index
+	if (seg->start >= max_edit_units || seg->duration > max_edit_units - seg->start)
+		return -1;
+	end = seg->start + seg->duration;
+
+	for (k = 0; k < nb_candidates; k++)
+	{
+		mxf_segment_offset(seg, seg->start, seg->nb_deltas ? k : -1, &element);
+		element = mxf_stream_to_file(partitions, nb_partitions, body_sid, element);
+		if (element && mxf_klv_at(demux, element, &klv) && IS_KLV_KEY(klv.key, ctx->cap_essence_key))
+			break;
+	}
+	if (k == nb_candidates)
+		return -1;
 
-	return klv->length == -1 ? -1 : 0;
+	if ((int64_t) end > ctx->nb_edit_units)
+	{
+		uint64_t *cp_offsets = realloc(ctx->cp_offsets, end * sizeof(uint64_t));
+		uint64_t *cap_offsets = cp_offsets ? realloc(ctx->cap_offsets, end * sizeof(uint64_t)) : NULL;
+		if (cp_offsets)
+			ctx->cp_offsets = cp_offsets;
+		if (!cap_offsets)
+			return -1;
+		ctx->cap_offsets = cap_offsets;
+		memset(ctx->cp_offsets + ctx->nb_edit_units, 0, (end - ctx->nb_edit_units) * sizeof(uint64_t));
+		memset(ctx->cap_offsets + ctx->nb_edit_units, 0, (end - ctx->nb_edit_units) * sizeof(uint64_t));
+		ctx->nb_edit_units = end;
+	}
+	for (uint64_t i = seg->start; i < end; i++)
+	{
+		cp = mxf_segment_offset(seg, i, seg->nb_deltas ? k : -1, &element);
+		ctx->cp_offsets[i] = mxf_stream_to_file(partitions, nb_partitions, body_sid, cp);
+		ctx->cap_offsets[i] = mxf_stream_to_file(partitions, nb_partitions, body_sid, element);
+	}
+	return 0;
 }
 
-static const MXFReadTableEntry *getMXFReader(UID key)
+static int mxf_read_index_tables(struct ccx_demuxer *demux, const MXFPartition *partitions, int nb_partitions,
+		uint32_t body_sid, LLONG file_size)
 {
-	const MXFReadTableEntry *entry;
+	for (int i = 0; i < nb_partitions; i++)
+	{
+		const MXFPartition *p = &partitions[i];
+		uint8_t *buf, *pos, *end;
+		int ret = 0;
+
+		if (p->index_bytes == 0)
+			continue;
+		if (p->index_bytes > MXF_MAX_INDEX_BYTES || (buf = malloc(p->index_bytes)) == NULL)
+			return -1;
+		if (mxf_read_at(demux, p->pack_end + p->header_bytes, buf, p->index_bytes) != (int) p->index_bytes)
+			ret = -1;
+		for (pos = buf, end = buf + p->index_bytes; ret == 0 && end - pos > 17; )
+		{
+			uint64_t length;
+			int ber = klv_decode_ber_length(demux, pos + 16, end - pos - 16, &length);
+			MXFIndexSegment seg;
+
+			if (!IS_KLV_KEY(pos, mxf_klv_key) || ber < 0 || length > (uint64_t) (end - pos - 16 - ber))
+				break;
+			pos += 16 + ber;
+			if (IS_KLV_KEY(pos - 16 - ber, mxf_index_table_segment_key))
+			{
+				if (mxf_parse_index_segment(pos, length, &seg) < 0 ||
+						mxf_add_index_segment(demux, partitions, nb_partitions, body_sid,
+							file_size / MXF_MIN_EDIT_UNIT_BYTES, &seg) < 0)
+					ret = -1;
+			}
+			pos += length;
+		}
+		free(buf);
+		if (ret < 0)
+			return -1;
+	}
+	return 0;
+}
 
-	for (entry = mxf_read_table; entry->read; entry++)
+/*
+ * Called on the first caption element, klv. If the input is a file whose
+ * index tables locate the caption element of every edit unit, the rest of
+ * the file is read by seeking from one to the next.
+ */
+static void mxf_read_index(struct ccx_demuxer *demux, const KLVPacket *klv)
+{
+	struct MXFContext *ctx = demux->private_data;
+	MXFPartition *partitions = NULL;
+	int nb_partitions = 0;
+	uint32_t body_sid = 0;
+	int64_t lo, hi;
+	LLONG file_size;
+
+	ctx->index_state = MXF_INDEX_NONE;
+	// With several files joined, the demuxer positions are not offsets in this one
+	if (ctx->type != MXF_CT_ANC || ccx_options.input_source != CCX_DS_FILE || ccx_options.live_stream ||
+			(ccx_options.binary_concat && ((struct lib_ccx_ctx *) demux->parent)->num_input_files > 1) ||
+			(file_size = get_file_size(demux->infd)) <= 0)
+		return;
+
+	partitions = mxf_read_partitions(demux, file_size, &nb_partitions);
+	for (int i = 0; i < nb_partitions; i++)
+	{
+		if (partitions[i].offset <= klv->offset)
+			body_sid = partitions[i].body_sid;
+	}
+	for (int i = 0; i < nb_partitions; i++)
 	{
-		if (IS_KLV_KEY(key, entry->key))
-			return entry;
+		if (partitions[i].body_sid == body_sid)
+			mxf_find_essence(demux, &partitions[i]);
 	}
-	return NULL;
+	if (body_sid == 0 || mxf_read_index_tables(demux, partitions, nb_partitions, body_sid, file_size) < 0)
+		goto end;
+
+	// Every edit unit has to be there, and the element we're at in it
+	for (lo = 0; lo < ctx->nb_edit_units; lo++)
+	{
+		if (!ctx->cap_offsets[lo] || (lo > 0 && ctx->cap_offsets[lo] <= ctx->cap_offsets[lo - 1]))
+			goto end;
+	}
+	for (lo = 0, hi = ctx->nb_edit_units; lo < hi; )
+	{
+		int64_t mid = lo + (hi - lo) / 2;
+		if (ctx->cap_offsets[mid] < klv->offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == ctx->nb_edit_units || ctx->cap_offsets[lo] != klv->offset)
+		goto end;
+
+	debug("Index of %"PRId64" edit units in %d partitions, seeking to the captions\n", ctx->nb_edit_units, nb_partitions);
+	ctx->index_state = MXF_INDEX_USED;
+	ctx->next_edit_unit = lo + 1;
+end:
+	if (ctx->index_state != MXF_INDEX_USED)
+	{
+		freep(&ctx->cp_offsets);
+		freep(&ctx->cap_offsets);
+		ctx->nb_edit_units = 0;
+	}
+	free(partitions);
+}
+
+/* Seek to the caption element of the next edit unit */
+static int mxf_next_indexed(struct ccx_demuxer *demux)
+{
+	struct MXFContext *ctx = demux->private_data;
+
+	while (ctx->next_edit_unit < ctx->nb_edit_units)
+	{
+		uint64_t offset = ctx->cap_offsets[ctx->next_edit_unit];
+		if (offset >= (uint64_t) demux->past)
+			return mxf_skip(demux, offset - demux->past);
+		ctx->next_edit_unit++;
+	}
+	// Past the last one, whatever follows is read as it comes
+	ctx->index_state = MXF_INDEX_NONE;
+	return 0;
 }
 
 static int read_packet(struct ccx_demuxer *demux, struct demuxer_data *data)
@@ -522,8 +1017,29 @@ static int read_packet(struct ccx_demuxer *demux, struct demuxer_data *data)
 	KLVPacket klv;
 	const MXFReadTableEntry *reader;
 	struct MXFContext *ctx = demux->private_data;
-	while( (ret = klv_read_packet(&klv, demux) ) == 0)
+	while (1)
 	{
+		int indexed = ctx->index_state == MXF_INDEX_USED;
+
+		if (indexed && (ret = mxf_next_indexed(demux)) != 0)
+			break;
+		indexed = ctx->index_state == MXF_INDEX_USED;
+		ret = klv_read_packet(&klv, demux, !indexed);
+		if (ret != 0 && indexed && ret != CCX_EOF)
+		{
+			// Not at a KLV, go on from the next content package. Its caption
+			// element is lost but still counted, for the times of the next ones.
+			log("MXF index doesn't match the file at %"PRIu64", reading on without it\n", demux->past - 16);
+			ctx->index_state = MXF_INDEX_NONE;
+			ctx->cap_count++;
+			if (ctx->next_edit_unit + 1 < ctx->nb_edit_units &&
+					ctx->cp_offsets[ctx->next_edit_unit + 1] > (uint64_t) demux->past &&
+					mxf_skip(demux, ctx->cp_offsets[ctx->next_edit_unit + 1] - demux->past) != 0)
+				return CCX_EOF;
+			continue;
+		}
+		if (ret != 0)
+			break;
 		debug("Key %02X%02X%02X%02X%02X%02X%02X%02X.%02X%02X%02X%02X%02X%02X%02X%02X size %"PRIu64"\n",
             klv.key[ 0], klv.key[ 1], klv.key[ 2], klv.key[ 3],
             klv.key[ 4], klv.key[ 5], klv.key[ 5], klv.key[ 7],
@@ -533,18 +1049,34 @@ static int read_packet(struct ccx_demuxer *demux, struct demuxer_data *data)
 
 		if (IS_KLV_KEY(klv.key, ctx->cap_essence_key))
 		{
+			if (ctx->index_state == MXF_INDEX_UNTRIED)
+				mxf_read_index(demux, &klv);
+			else if (indexed)
+				ctx->next_edit_unit++;
 			mxf_read_essence_element(demux, klv.length, data);
 			if (data->len > 0)
 				break;
 			continue;
 		}
+		if (indexed)
+		{
+			// Another element where the index has the caption one, read on from
+			// it. If it is in a later content package, a caption element was
+			// passed and is counted.
+			log("MXF index doesn't match the file at %"PRIu64", reading on without it\n", klv.offset);
+			ctx->index_state = MXF_INDEX_NONE;
+			if (ctx->next_edit_unit + 1 < ctx->nb_edit_units &&
+					klv.offset >= ctx->cp_offsets[ctx->next_edit_unit + 1])
+				ctx->cap_count++;
+		}
 
 		reader = getMXFReader(klv.key);
 		if (reader == NULL)
 		{
-			ret = buffered_skip(demux, klv.length);
-			demux->past += ret;
+			ret = mxf_skip(demux, klv.length);
 			debug("Unknown or Dark key\n");
+			if (ret != 0)
+				break;
 			continue;
 		}
 
@@ -611,3 +1143,15 @@ struct MXFContext *ccx_mxf_init(struct ccx_demuxer *demux)
 	memset(ctx, 0, sizeof(struct MXFContext));
 	return ctx;
 }
+
+void ccx_mxf_delete(struct ccx_demuxer *demux)
+{
+	struct MXFContext *ctx = demux->private_data;
+
+	if (!ctx)
+		return;
+	free(ctx->cp_offsets);
+	free(ctx->cap_offsets);
+	free(ctx->anc_buf);
+	freep(&demux->private_data);
+}
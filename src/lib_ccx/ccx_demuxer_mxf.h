@@ -5,4 +5,5 @@
 
 int ccx_probe_mxf(struct ccx_demuxer *ctx);
 struct MXFContext *ccx_mxf_init(struct ccx_demuxer *demux);
+void ccx_mxf_delete(struct ccx_demuxer *demux);
 #endif
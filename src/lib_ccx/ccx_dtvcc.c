@@ -27,14 +27,14 @@ void ccx_dtvcc_process_data(struct lib_cc_decode *ctx,
 		switch (cc_type)
 		{
 			case 2:
-				ccx_common_logging.debug_ftn (CCX_DMT_708, "[CEA-708] dtvcc_process_data: DTVCC Channel Packet Data\n");
+				ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_process_data: DTVCC Channel Packet Data\n");
 				if (cc_valid == 0) // This ends the previous packet
 					ccx_dtvcc_process_current_packet(dtvcc);
 				else
 				{
 					if (dtvcc->current_packet_length > 253)
 					{
-						ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_process_data: "
+						ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_process_data: "
 								"Warning: Legal packet size exceeded (1), data not added.\n");
 					}
 					else
@@ -45,13 +45,13 @@ void ccx_dtvcc_process_data(struct lib_cc_decode *ctx,
 				}
 				break;
 			case 3:
-				ccx_common_logging.debug_ftn (CCX_DMT_708, "[CEA-708] dtvcc_process_data: DTVCC Channel Packet Start\n");
+				ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_process_data: DTVCC Channel Packet Start\n");
 				ccx_dtvcc_process_current_packet(dtvcc);
 				if (cc_valid)
 				{
 					if (dtvcc->current_packet_length > CCX_DTVCC_MAX_PACKET_LENGTH - 1)
 					{
-						ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_process_data: "
+						ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_process_data: "
 								"Warning: Legal packet size exceeded (2), data not added.\n");
 					}
 					else
@@ -72,7 +72,7 @@ void ccx_dtvcc_process_data(struct lib_cc_decode *ctx,
 
 ccx_dtvcc_ctx *ccx_dtvcc_init(struct ccx_decoder_dtvcc_settings *opts)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] initializing dtvcc decoder\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] initializing dtvcc decoder\n");
 	ccx_dtvcc_ctx *ctx = (ccx_dtvcc_ctx *) malloc(sizeof(ccx_dtvcc_ctx));
 	if (!ctx)
 	{
@@ -96,7 +96,7 @@ ccx_dtvcc_ctx *ccx_dtvcc_init(struct ccx_decoder_dtvcc_settings *opts)
 	ctx->report_enabled = opts->print_file_reports;
 	ctx->timing = opts->timing;
 
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] initializing services\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] initializing services\n");
 
 	for (int i = 0; i < CCX_DTVCC_MAX_SERVICES; i++)
 	{
@@ -122,7 +122,7 @@ ccx_dtvcc_ctx *ccx_dtvcc_init(struct ccx_decoder_dtvcc_settings *opts)
 
 void ccx_dtvcc_free(ccx_dtvcc_ctx **ctx_ptr)
 {
-	ccx_common_logging.debug_ftn(CCX_DMT_708, "[CEA-708] dtvcc_free: cleaning up\n");
+	ccx_debug(CCX_DMT_708, "[CEA-708] dtvcc_free: cleaning up\n");
 
 	ccx_dtvcc_ctx *ctx = *ctx_ptr;
 
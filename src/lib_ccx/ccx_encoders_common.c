@@ -2,12 +2,14 @@
 #include "ccx_encoders_common.h"
 #include "utility.h"
 #include "ocr.h"
+#include "ocr_pool.h"
 #include "ccx_decoders_608.h"
 #include "ccx_decoders_708.h"
 #include "ccx_decoders_708_output.h"
 #include "ccx_encoders_xds.h"
 #include "ccx_encoders_helpers.h"
 #include "../ccextractor.h"
+#include "ccx_metrics.h"
 #ifdef ENABLE_SHARING
 #include "ccx_share.h"
 #endif //ENABLE_SHARING
@@ -351,7 +353,7 @@ int write_subtitle_file_footer(struct encoder_ctx *ctx,struct ccx_s_write *out)
 				dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 			}
 			used = encode_line (ctx, ctx->buffer,(unsigned char *) str);
-			ret = write(out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if (ret != used)
 			{
 				mprint("WARNING: loss of data\n");
@@ -364,7 +366,7 @@ int write_subtitle_file_footer(struct encoder_ctx *ctx,struct ccx_s_write *out)
 				dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 			}
 			used = encode_line (ctx, ctx->buffer,(unsigned char *) str);
-			ret = write (out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if (ret != used)
 			{
 				mprint("WARNING: loss of data\n");
@@ -380,7 +382,7 @@ int write_subtitle_file_footer(struct encoder_ctx *ctx,struct ccx_s_write *out)
 				dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 			}
 			used = encode_line (ctx, ctx->buffer,(unsigned char *) str);
-			ret = write (out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if (ret != used)
 			{
 				mprint("WARNING: loss of data\n");
@@ -399,7 +401,7 @@ static int write_bom(struct encoder_ctx *ctx, struct ccx_s_write *out)
 	int ret = 0;
 	if (!ctx->no_bom){
 		if (ctx->encoding == CCX_ENC_UTF_8){ // Write BOM
-			ret = write(out->fh, UTF8_BOM, sizeof(UTF8_BOM));
+			ret = write_buffered(out, UTF8_BOM, sizeof(UTF8_BOM));
 			if ( ret < sizeof(UTF8_BOM)) {
 				mprint("WARNING: Unable tp write UTF BOM\n");
 				return -1;
@@ -407,7 +409,7 @@ static int write_bom(struct encoder_ctx *ctx, struct ccx_s_write *out)
 
 		}
 		if (ctx->encoding == CCX_ENC_UNICODE){ // Write BOM
-			ret = write(out->fh, LITTLE_ENDIAN_BOM, sizeof(LITTLE_ENDIAN_BOM));
+			ret = write_buffered(out, LITTLE_ENDIAN_BOM, sizeof(LITTLE_ENDIAN_BOM));
 			if ( ret < sizeof(LITTLE_ENDIAN_BOM)) {
 				mprint("WARNING: Unable to write LITTLE_ENDIAN_BOM \n");
 				return -1;
@@ -435,7 +437,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				return -1;
 			REQUEST_BUFFER_CAPACITY(ctx,strlen (ssa_header)*3);
 			used = encode_line (ctx, ctx->buffer,(unsigned char *) ssa_header);
-			ret = write (out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if(ret < used)
 			{
 				mprint("WARNING: Unable to write complete Buffer \n");
@@ -461,7 +463,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				{
 					used = encode_line (ctx, ctx->buffer,(unsigned char *) webvtt_header[i]);
 				}
-				ret = write (out->fh, ctx->buffer,used);
+				ret = write_buffered(out, ctx->buffer,used);
 				if(ret < used)
 				{
 					mprint("WARNING: Unable to write complete Buffer \n");
@@ -476,7 +478,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				return -1;
 			REQUEST_BUFFER_CAPACITY(ctx,strlen (sami_header)*3);
 			used = encode_line (ctx, ctx->buffer,(unsigned char *) sami_header);
-			ret = write (out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if(ret < used)
 			{
 				mprint("WARNING: Unable to write complete Buffer \n");
@@ -490,7 +492,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				return -1;
 			REQUEST_BUFFER_CAPACITY(ctx,strlen (smptett_header)*3);
 			used=encode_line (ctx, ctx->buffer,(unsigned char *) smptett_header);
-			ret = write(out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if(ret < used)
 			{
 				mprint("WARNING: Unable to write complete Buffer \n");
@@ -504,7 +506,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				net_send_header(rcwt_header, sizeof(rcwt_header));
 			else
 			{
-				ret = write(out->fh, rcwt_header, sizeof(rcwt_header));
+				ret = write_buffered(out, rcwt_header, sizeof(rcwt_header));
 				if(ret < 0)
 				{
 					mprint("Unable to write rcwt header\n");
@@ -514,7 +516,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 
 			break;
 		case CCX_OF_RAW:
-			ret = write(out->fh,BROADCAST_HEADER, sizeof(BROADCAST_HEADER));
+			ret = write_buffered(out, BROADCAST_HEADER, sizeof(BROADCAST_HEADER));
 			if(ret < sizeof(BROADCAST_HEADER))
 			{
 				mprint("Unable to write Raw header\n");
@@ -538,7 +540,7 @@ static int write_subtitle_file_header(struct encoder_ctx *ctx, struct ccx_s_writ
 				return -1;
 			REQUEST_BUFFER_CAPACITY(ctx,strlen (simple_xml_header)*3);
 			used=encode_line (ctx, ctx->buffer,(unsigned char *) simple_xml_header);
-			ret = write(out->fh, ctx->buffer, used);
+			ret = write_buffered(out, ctx->buffer, used);
 			if(ret < used)
 			{
 				mprint("WARNING: Unable to write complete Buffer \n");
@@ -573,7 +575,7 @@ int write_cc_subtitle_as_simplexml(struct cc_subtitle *sub, struct encoder_ctx *
 			{
 				continue;
 			}
-			ret = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			ret = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 			if(ret <  context->encoded_crlf_length)
 			{
 				mprint("Warning:Loss of data\n");
@@ -609,14 +611,14 @@ void write_cc_line_as_simplexml(struct eia608_screen *data, struct encoder_ctx *
 	length = get_str_basic (context->subline, data->characters[line_number],
 			context->trim_subs, CCX_ENC_ASCII, context->encoding, CCX_DECODER_608_SCREEN_WIDTH);
 
-	ret = write(context->out->fh, cap, strlen(cap));
-	ret = write(context->out->fh, context->subline, length);
+	ret = write_buffered(context->out, cap, strlen(cap));
+	ret = write_buffered(context->out, context->subline, length);
 	if(ret < length)
 	{
 		mprint("Warning:Loss of data\n");
 	}
-	ret = write(context->out->fh, cap1, strlen(cap1));
-	ret = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+	ret = write_buffered(context->out, cap1, strlen(cap1));
+	ret = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 
 }
 
@@ -791,12 +793,15 @@ static int init_output_ctx(struct encoder_ctx *ctx, struct encoder_cfg *cfg)
 	else
 		nb_lang = 1;
 
-	ctx->out = malloc(sizeof(struct ccx_s_write) * nb_lang);
+	ctx->out = calloc(nb_lang, sizeof(struct ccx_s_write));
 	if(!ctx->out)
 		return -1;
+	for (int i = 0; i < nb_lang; i++)
+		ctx->out[i].fh = -1;
 	ctx->nb_out = nb_lang;
 	ctx->keep_output_closed = cfg->keep_output_closed;
 	ctx->force_flush = cfg->force_flush;
+	ctx->flush_each_sub = cfg->flush_each_sub;
 	ctx->ucla = cfg->ucla;
 
 	if(ctx->generates_file && cfg->cc_to_stdout == CCX_FALSE && cfg->send_to_srv == CCX_FALSE)
@@ -852,6 +857,7 @@ static int init_output_ctx(struct encoder_ctx *ctx, struct encoder_cfg *cfg)
 	if (cfg->cc_to_stdout == CCX_TRUE)
 	{
 		ctx->out[0].fh = STDOUT_FILENO;
+		ctx->out[0].buffer_size = cfg->output_buffer_size;
 		ctx->out[0].filename = NULL;
 		ctx->out[0].with_semaphore = 0;
 		ctx->out[0].semaphore_filename = NULL;
@@ -917,6 +923,11 @@ void dinit_encoder(struct encoder_ctx **arg, LLONG current_fts)
 	int i;
 	if(!ctx)
 		return;
+	// For DVB the copy in prev is the context that encoded last
+	encode_ocr_pending(ctx->prev ? ctx->prev : ctx, 1);
+#ifdef ENABLE_OCR
+	ocr_reorder_free(&ctx->ocr_pending);
+#endif
 	for (i = 0; i < ctx->nb_out; i++)
 	{
 		if (ctx->end_credits_text!=NULL)
@@ -924,6 +935,10 @@ void dinit_encoder(struct encoder_ctx **arg, LLONG current_fts)
 		write_subtitle_file_footer(ctx, ctx->out + i);
 	}
 
+	for (i = 0; i < ctx->nb_tlt_page_enc; i++)
+		dinit_encoder(&ctx->tlt_page_enc[i], current_fts);
+	freep(&ctx->tlt_page_enc);
+
 	free_encoder_context(ctx->prev);
 	dinit_output_ctx(ctx);
 	freep(&ctx->subline);
@@ -934,8 +949,12 @@ void dinit_encoder(struct encoder_ctx **arg, LLONG current_fts)
 
 int reset_output_ctx(struct encoder_ctx *ctx, struct encoder_cfg *cfg)
 {
+	int ret;
 	dinit_output_ctx(ctx);
-	return init_output_ctx(ctx, cfg);
+	ret = init_output_ctx(ctx, cfg);
+	if (ctx->prev)
+		ctx->prev->out = ctx->out; // See copy_encoder_context()
+	return ret;
 }
 
 struct encoder_ctx *init_encoder(struct encoder_cfg *opt)
@@ -999,6 +1018,7 @@ struct encoder_ctx *init_encoder(struct encoder_cfg *opt)
 	ctx->extract = opt->extract;
 	ctx->keep_output_closed = opt->keep_output_closed;
 	ctx->force_flush = opt->force_flush;
+	ctx->flush_each_sub = opt->flush_each_sub;
 	ctx->ucla = opt->ucla;
 
 	ctx->sbs_enabled = opt->splitbysentence;
@@ -1038,6 +1058,16 @@ struct encoder_ctx *init_encoder(struct encoder_cfg *opt)
 	ctx->segment_last_key_frame = 0;
 	ctx->nospupngocr = opt->nospupngocr;
 
+	ctx->tlt_page_enc = NULL;
+	ctx->nb_tlt_page_enc = 0;
+	ctx->tlt_page[0] = 0;
+
+#ifdef ENABLE_OCR
+	ctx->ocr_pending = ocr_reorder_init();
+#else
+	ctx->ocr_pending = NULL;
+#endif
+
 	ctx->prev = NULL;
 	return ctx;
 }
@@ -1052,7 +1082,7 @@ void set_encoder_rcwt_fileformat(struct encoder_ctx *ctx, short int format)
 
 static int write_newline(struct encoder_ctx *ctx, int lang)
 {
-	return write(ctx->out[lang].fh, ctx->encoded_crlf, ctx->encoded_crlf_length);
+	return write_buffered(&ctx->out[lang], ctx->encoded_crlf, ctx->encoded_crlf_length);
 }
 
 struct ccx_s_write *get_output_ctx(struct encoder_ctx *ctx, int lan)
@@ -1067,19 +1097,131 @@ struct ccx_s_write *get_output_ctx(struct encoder_ctx *ctx, int lan)
 	}
 }
 
-int encode_sub(struct encoder_ctx *context, struct cc_subtitle *sub)
+/* Teletext pages after the first one go to a file of their own, named after
+ * the main output with _p<page> added before the extension */
+static struct encoder_ctx *get_tlt_page_encoder(struct encoder_ctx *ctx, const char *page)
+{
+	struct encoder_cfg cfg;
+	struct encoder_ctx *page_ctx;
+	struct encoder_ctx **tmp;
+	const char *filename, *ext;
+	int i;
+
+	for (i = 0; i < ctx->nb_tlt_page_enc; i++)
+	{
+		if (!strcmp(ctx->tlt_page_enc[i]->tlt_page, page))
+			return ctx->tlt_page_enc[i];
+	}
+	if (!ctx->out || !ctx->out->filename)
+		return NULL;
+
+	filename = ctx->out->filename;
+	ext = strrchr(filename, '.');
+	if (!ext || strpbrk(ext, "/\\"))
+		ext = filename + strlen(filename);
+
+	cfg = ccx_options.enc_cfg;
+	cfg.output_filename = malloc(strlen(filename) + 6);
+	if (!cfg.output_filename)
+		return NULL;
+	sprintf(cfg.output_filename, "%.*s_p%s%s", (int) (ext - filename), filename, page, ext);
+	cfg.program_number = ctx->program_number;
+	cfg.in_format = 2;
+
+	page_ctx = init_encoder(&cfg);
+	free(cfg.output_filename);
+	if (!page_ctx)
+		return NULL;
+	tmp = realloc(ctx->tlt_page_enc, (ctx->nb_tlt_page_enc + 1) * sizeof(struct encoder_ctx *));
+	if (!tmp)
+	{
+		dinit_encoder(&page_ctx, 0);
+		return NULL;
+	}
+	ctx->tlt_page_enc = tmp;
+	ctx->tlt_page_enc[ctx->nb_tlt_page_enc++] = page_ctx;
+
+	// The copy of the settings goes away, the ones of the main output don't
+	page_ctx->transcript_settings = ctx->transcript_settings;
+	strcpy(page_ctx->tlt_page, page);
+	mprint("Teletext page %s is written to %s\n", page, page_ctx->out->filename);
+	return page_ctx;
+}
+
+static void encode_tlt_page_sub(struct encoder_ctx *ctx, struct cc_subtitle *sub)
+{
+	struct encoder_ctx *page_ctx = get_tlt_page_encoder(ctx, sub->info);
+
+	sub->flags &= ~SUB_TLT_EXTRA_PAGE;
+	if (!page_ctx)
+	{
+		freep(&sub->data);
+		return;
+	}
+	page_ctx->timing = ctx->timing;
+	encode_sub(page_ctx, sub);
+}
+
+/* Encodes the subtitles of the teletext pages written to a file of their own
+ * and takes them out of the list. Returns what is left, NULL if nothing. */
+static struct cc_subtitle *encode_tlt_extra_pages(struct encoder_ctx *ctx, struct cc_subtitle *sub)
+{
+	struct cc_subtitle *node, *next;
+
+	// The first one belongs to the decoder, so the next one is moved into it
+	while (sub->flags & SUB_TLT_EXTRA_PAGE)
+	{
+		struct cc_subtitle one = *sub;
+		struct cc_subtitle *prev = sub->prev;
+
+		one.next = NULL;
+		one.prev = NULL;
+		encode_tlt_page_sub(ctx, &one);
+		node = sub->next;
+		if (!node)
+		{
+			sub->data = NULL;
+			sub->nb_data = 0;
+			sub->flags = 0;
+			return NULL;
+		}
+		*sub = *node;
+		sub->prev = prev;
+		if (sub->next)
+			sub->next->prev = sub;
+		free(node);
+	}
+	for (node = sub->next; node; node = next)
+	{
+		next = node->next;
+		if (!(node->flags & SUB_TLT_EXTRA_PAGE))
+			continue;
+		node->prev->next = next;
+		if (next)
+			next->prev = node->prev;
+		node->next = NULL;
+		node->prev = NULL;
+		encode_tlt_page_sub(ctx, node);
+		free(node);
+	}
+	return sub;
+}
+
+static int encode_sub_now(struct encoder_ctx *context, struct cc_subtitle *sub)
 {
 	int wrote_something = 0;
 	int ret = 0;
 
-	if(!context)
-		return CCX_OK;
-
-	context = change_filename(context);
+	if (sub->type == CC_TEXT)
+	{
+		sub = encode_tlt_extra_pages(context, sub);
+		if (!sub)
+			return wrote_something;
+	}
 
 #ifdef ENABLE_SHARING
 	if (ccx_options.sharing_enabled)
-		ccx_share_send(sub);
+		ccx_share_send(sub, context->program_number);
 #endif //ENABLE_SHARING
 
 	if (context->sbs_enabled)
@@ -1109,7 +1251,7 @@ int encode_sub(struct encoder_ctx *context, struct cc_subtitle *sub)
 					xds_write_transcript_line_prefix(context, out, data->start_time, data->end_time, data->cur_xds_packet_class);
 					if (data->xds_len > 0)
 					{
-						ret = write(out->fh, data->xds_str, data->xds_len);
+						ret = write_buffered(out, data->xds_str, data->xds_len);
 						if (ret < data->xds_len)
 						{
 							mprint("WARNING:Loss of data\n");
@@ -1247,7 +1389,7 @@ int encode_sub(struct encoder_ctx *context, struct cc_subtitle *sub)
 				net_send_header(sub->data, sub->nb_data);
 			else
 			{
-				ret = write(context->out->fh, sub->data, sub->nb_data);
+				ret = write_buffered(context->out, sub->data, sub->nb_data);
 				if (ret < sub->nb_data) {
 					mprint("WARNING: Loss of data\n");
 				}
@@ -1300,11 +1442,62 @@ int encode_sub(struct encoder_ctx *context, struct cc_subtitle *sub)
 
 	if (!sub->nb_data)
 		freep(&sub->data);
+	if (wrote_something && context->flush_each_sub)
+		flush_buffered(context->out);
 	if (wrote_something && context->force_flush)
 		fsync(context->out->fh); // Don't buffer
 	return wrote_something;
 }
 
+int encode_ocr_pending(struct encoder_ctx *context, int flush)
+{
+	int wrote_something = 0;
+#ifdef ENABLE_OCR
+	struct cc_subtitle *sub;
+
+	while ((sub = ocr_reorder_next(context->ocr_pending, flush)))
+	{
+		wrote_something |= encode_sub_now(context, sub);
+		free(sub);
+	}
+#endif
+	return wrote_something;
+}
+
+static int encode_sub_as_format(struct encoder_ctx *context, struct cc_subtitle *sub)
+{
+	int wrote_something = 0;
+
+	if(!context)
+		return CCX_OK;
+
+	// Subtitles held back for OCR belong to the current file
+	if (change_filename_requested)
+		encode_ocr_pending(context, 1);
+	context = change_filename(context);
+
+#ifdef ENABLE_OCR
+	// With -ocrthreads a subtitle waits for its text in the reorder buffer,
+	// and anything else for the subtitles before it
+	if (ocr_reorder_add(context->ocr_pending, sub))
+		return encode_ocr_pending(context, 0);
+	wrote_something = encode_ocr_pending(context, 1);
+#endif
+	return wrote_something | encode_sub_now(context, sub);
+}
+
+int encode_sub(struct encoder_ctx *context, struct cc_subtitle *sub)
+{
+	int ret;
+
+	if (!context || (unsigned) context->write_format > CCX_OF_SSA)
+		return encode_sub_as_format(context, sub);
+	ccx_metrics_enter(CCX_STAGE_ENCODE + context->write_format);
+	ret = encode_sub_as_format(context, sub);
+	ccx_metrics_leave(0);
+	return ret;
+}
+
 void write_cc_buffer_to_gui(struct eia608_screen *data, struct encoder_ctx *context)
 {
 	unsigned h1, m1, s1, ms1;
@@ -1417,6 +1610,7 @@ unsigned int get_font_encoded(struct encoder_ctx *ctx, unsigned char *buffer, in
 void switch_output_file(struct lib_ccx_ctx *ctx, struct encoder_ctx *enc_ctx, int track_id) {
 	if (enc_ctx->out->filename != NULL) { // Close and release the previous handle
 		free(enc_ctx->out->filename);
+		flush_buffered(enc_ctx->out);
 		close(enc_ctx->out->fh);
 	}
 	char *ext = get_file_extension(ctx->write_format);
@@ -71,6 +71,8 @@ struct encoder_ctx
 	unsigned int keep_output_closed;
 	/* Force a flush on the file buffer whenever content is written */
 	int force_flush;
+	/* Write the output buffer out after every subtitle */
+	int flush_each_sub;
 	/* Keep track of whether -UCLA used */
 	int ucla;
 
@@ -135,6 +137,14 @@ struct encoder_ctx
 
 	// OCR in SPUPNG
 	int nospupngocr;
+
+	// Outputs of the teletext pages after the first one (-tpage p1,p2,...)
+	struct encoder_ctx **tlt_page_enc;
+	int nb_tlt_page_enc;
+	char tlt_page[4]; // Teletext page written by this output if it's one of them, "" otherwise
+
+	// Subtitles waiting for -ocrthreads, shared with the copies of this context, see ocr_pool.h
+	struct ocr_reorder *ocr_pending;
 };
 
 #define INITIAL_ENC_BUFFER_CAPACITY	2048
@@ -169,6 +179,13 @@ void dinit_encoder(struct encoder_ctx **arg, LLONG current_fts);
  */
 int encode_sub(struct encoder_ctx *ctx,struct cc_subtitle *sub);
 
+/**
+ * Encode the subtitles of ctx->ocr_pending whose OCR is done
+ *
+ * @param flush wait for the OCR of all of them
+ */
+int encode_ocr_pending(struct encoder_ctx *ctx, int flush);
+
 int write_cc_buffer_as_srt            (struct eia608_screen *data, struct encoder_ctx *context);
 int write_cc_buffer_as_ssa            (struct eia608_screen *data, struct encoder_ctx *context);
 int write_cc_buffer_as_webvtt         (struct eia608_screen *data, struct encoder_ctx *context);
@@ -210,6 +227,13 @@ int write_cc_bitmap_as_libcurl         (struct cc_subtitle *sub, struct encoder_
 void write_spumux_header(struct encoder_ctx *ctx, struct ccx_s_write *out);
 void write_spumux_footer(struct ccx_s_write *out);
 
+/* Output buffering for ccx_s_write, in output.c. Anything written to fh
+   directly must be preceded by flush_buffered() */
+int write_buffered(struct ccx_s_write *wb, const void *data, size_t len);
+void printf_buffered(struct ccx_s_write *wb, const char *fmt, ...);
+int flush_buffered(struct ccx_s_write *wb);
+void free_buffered(struct ccx_s_write *wb);
+
 struct cc_subtitle * reformat_cc_bitmap_through_sentence_buffer (struct cc_subtitle *sub, struct encoder_ctx *context);
 
 void set_encoder_last_displayed_subs_ms(struct encoder_ctx *ctx, LLONG last_displayed_subs_ms);
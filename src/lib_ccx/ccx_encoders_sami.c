@@ -22,7 +22,7 @@ int write_stringz_as_sami(char *string, struct encoder_ctx *context, LLONG ms_st
 	}
 
 	used = encode_line(context, context->buffer, (unsigned char *) str);
-	ret = write (context->out->fh, context->buffer, used);
+	ret = write_buffered(context->out, context->buffer, used);
 	if(ret != used)
 	{
 		return ret;
@@ -73,15 +73,15 @@ int write_stringz_as_sami(char *string, struct encoder_ctx *context, LLONG ms_st
 			dbg_print(CCX_DMT_DECODER_608, "\r");
 			dbg_print(CCX_DMT_DECODER_608, "%s\n",context->subline);
 		}
-		ret = write(context->out->fh, el, u);
+		ret = write_buffered(context->out, el, u);
 		if(ret != u)
 			goto end;
 
-		ret = write(context->out->fh, context->encoded_br, context->encoded_br_length);
+		ret = write_buffered(context->out, context->encoded_br, context->encoded_br_length);
 		if(ret != context->encoded_br_length)
 			goto end;
 
-		ret = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+		ret = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		if(ret != context->encoded_crlf_length)
 			goto end;
 
@@ -94,7 +94,7 @@ int write_stringz_as_sami(char *string, struct encoder_ctx *context, LLONG ms_st
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line (context, context->buffer,(unsigned char *) str);
-	ret = write(context->out->fh, context->buffer, used);
+	ret = write_buffered(context->out, context->buffer, used);
 	if(ret != used)
 		goto end;
 	sprintf ((char *) str,
@@ -104,7 +104,7 @@ int write_stringz_as_sami(char *string, struct encoder_ctx *context, LLONG ms_st
 	{
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
-	ret = write(context->out->fh, context->buffer, used);
+	ret = write_buffered(context->out, context->buffer, used);
 	if(ret != used)
 		goto end;
 
@@ -138,7 +138,7 @@ int write_cc_bitmap_as_sami(struct cc_subtitle *sub, struct encoder_ctx *context
 		sprintf(buf,
 			"<SYNC start=%llu><P class=\"UNKNOWNCC\">\r\n"
 			, (unsigned long long)ms_start);
-		write(context->out->fh, buf, strlen(buf));
+		write_buffered(context->out, buf, strlen(buf));
 		for (int i = sub->nb_data - 1; i >= 0; i--)
 		{
 			if (rect[i].ocr_text && *(rect[i].ocr_text))
@@ -148,22 +148,22 @@ int write_cc_bitmap_as_sami(struct cc_subtitle *sub, struct encoder_ctx *context
 					token = strtok(rect[i].ocr_text, "\r\n");
 					sprintf(buf, "%s", token);
 					token = strtok(NULL, "\r\n");
-					write(context->out->fh, buf, strlen(buf));
+					write_buffered(context->out, buf, strlen(buf));
 					if (i != 0)
-						write(context->out->fh, context->encoded_br, context->encoded_br_length);
-					write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+						write_buffered(context->out, context->encoded_br, context->encoded_br_length);
+					write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 				}
 			}
 		}
 		sprintf(buf, "</P></SYNC>\r\n");
-		write(context->out->fh, buf, strlen(buf));
+		write_buffered(context->out, buf, strlen(buf));
 	}
 	else //we write an empty subtitle to clear the old one
 	{
 		sprintf(buf,
 			"<SYNC start=%llu><P class=\"UNKNOWNCC\">&nbsp;</P></SYNC>\r\n\r\n"
 			, (unsigned long long)ms_start);
-		write(context->out->fh, buf, strlen(buf));
+		write_buffered(context->out, buf, strlen(buf));
 	}
 #endif
 
@@ -220,7 +220,7 @@ int write_cc_buffer_as_sami(struct eia608_screen *data, struct encoder_ctx *cont
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer,(unsigned char *) str);
-	write (context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	for (int i=0;i<15;i++)
 	{
 		if (data->row_used[i])
@@ -231,11 +231,11 @@ int write_cc_buffer_as_sami(struct eia608_screen *data, struct encoder_ctx *cont
 				dbg_print(CCX_DMT_DECODER_608, "\r");
 				dbg_print(CCX_DMT_DECODER_608, "%s\n",context->subline);
 			}
-			write (context->out->fh, context->subline, length);
+			write_buffered(context->out, context->subline, length);
 			wrote_something = 1;
 			if (i!=14)
-				write (context->out->fh, context->encoded_br, context->encoded_br_length);
-			write (context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+				write_buffered(context->out, context->encoded_br, context->encoded_br_length);
+			write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		}
 	}
 	sprintf ((char *) str,"</P></SYNC>\r\n");
@@ -244,7 +244,7 @@ int write_cc_buffer_as_sami(struct eia608_screen *data, struct encoder_ctx *cont
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer,(unsigned char *) str);
-	write (context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	sprintf ((char *) str,
 			"<SYNC start=%llu><P class=\"UNKNOWNCC\">&nbsp;</P></SYNC>\r\n\r\n",
 			(unsigned long long)endms);
@@ -253,6 +253,6 @@ int write_cc_buffer_as_sami(struct eia608_screen *data, struct encoder_ctx *cont
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer,(unsigned char *) str);
-	write (context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	return wrote_something;
 }
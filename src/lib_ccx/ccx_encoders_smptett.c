@@ -53,7 +53,7 @@ void write_stringz_as_smptett(char *string, struct encoder_ctx *context, LLONG m
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer, (unsigned char *) str);
-	write (context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	// Scan for \n in the string and replace it with a 0
 	while (pos_r < len)
 	{
@@ -80,10 +80,10 @@ void write_stringz_as_smptett(char *string, struct encoder_ctx *context, LLONG m
 			dbg_print(CCX_DMT_DECODER_608, "\r");
 			dbg_print(CCX_DMT_DECODER_608, "%s\n", context->subline);
 		}
-		write(context->out->fh, el, u);
+		write_buffered(context->out, el, u);
 		//write (wb->fh, encoded_br, encoded_br_length);
 
-		write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+		write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		begin += strlen ((const char *) begin)+1;
 	}
 
@@ -93,14 +93,14 @@ void write_stringz_as_smptett(char *string, struct encoder_ctx *context, LLONG m
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer, (unsigned char *) str);
-	write(context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	sprintf ((char *) str, "<p begin=\"%02u:%02u:%02u.%03u\">\n\n", h2, m2, s2, ms2);
 	if (context->encoding != CCX_ENC_UNICODE)
 	{
 		dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 	}
 	used = encode_line(context, context->buffer, (unsigned char *) str);
-	write (context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	sprintf ((char *) str, "</p>\n");
 	free(el);
 	free(unescaped);
@@ -139,12 +139,12 @@ int write_cc_bitmap_as_smptett(struct cc_subtitle *sub, struct encoder_ctx *cont
 				millis_to_time(ms_start, &h1, &m1, &s1, &ms1);
 				millis_to_time(ms_end - 1, &h2, &m2, &s2, &ms2); // -1 To prevent overlapping with next line.
 				sprintf((char *)context->buffer, "<p begin=\"%02u:%02u:%02u.%03u\" end=\"%02u:%02u:%02u.%03u\">\n", h1, m1, s1, ms1, h2, m2, s2, ms2);
-                write(context->out->fh, buf, strlen(buf));
+                write_buffered(context->out, buf, strlen(buf));
 				len = strlen(rect[i].ocr_text);
-                write(context->out->fh, rect[i].ocr_text, len);
-				write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+                write_buffered(context->out, rect[i].ocr_text, len);
+				write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 				sprintf(buf, "</p>\n");
-				write(context->out->fh, buf, strlen(buf));
+				write_buffered(context->out, buf, strlen(buf));
 
 			}
 		}
@@ -254,7 +254,7 @@ int write_cc_buffer_as_smptett(struct eia608_screen *data, struct encoder_ctx *c
 					dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 				}
 				used = encode_line(context, context->buffer,(unsigned char *) str);
-				write (context->out->fh, context->buffer, used);
+				write_buffered(context->out, context->buffer, used);
 				// Trimming subs because the position is defined by "tts:origin"
 				int old_trim_subs = context->trim_subs;
 				context->trim_subs=1;
@@ -423,10 +423,10 @@ int write_cc_buffer_as_smptett(struct eia608_screen *data, struct encoder_ctx *c
 				}
 
 
-				write(context->out->fh, final, strlen(final));
+				write_buffered(context->out, final, strlen(final));
 
 
-				write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+				write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 				context->trim_subs=old_trim_subs;
 				
 				sprintf ((char *) str,"        <style tts:backgroundColor=\"#000000FF\" tts:fontSize=\"18px\"/></span>\n      </p>\n");
@@ -435,7 +435,7 @@ int write_cc_buffer_as_smptett(struct eia608_screen *data, struct encoder_ctx *c
 					dbg_print(CCX_DMT_DECODER_608, "\r%s\n", str);
 				}
 				used = encode_line(context, context->buffer,(unsigned char *) str);
-				write (context->out->fh, context->buffer, used);
+				write_buffered(context->out, context->buffer, used);
 
 				if (context->encoding!=CCX_ENC_UNICODE)
 				{
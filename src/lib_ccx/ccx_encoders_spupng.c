@@ -149,6 +149,7 @@ void spupng_write_footer(struct spupng_t *sp)
 
 void write_spumux_header(struct encoder_ctx *ctx, struct ccx_s_write *out)
 {
+	flush_buffered(out); // The XML is written through stdio from here on
 	if (0 == out->spupng_data)
 		out->spupng_data = spunpg_init(out);
 
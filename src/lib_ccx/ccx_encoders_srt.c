@@ -26,14 +26,14 @@ int write_stringz_as_srt(char *string, struct encoder_ctx *context, LLONG ms_sta
 	context->srt_counter++;
 	sprintf(timeline, "%u%s", context->srt_counter, context->encoded_crlf);
 	used = encode_line(context, context->buffer,(unsigned char *) timeline);
-	write(context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	sprintf (timeline, "%02u:%02u:%02u,%03u --> %02u:%02u:%02u,%03u%s",
 		h1, m1, s1, ms1, h2, m2, s2, ms2, context->encoded_crlf);
 	used = encode_line(context, context->buffer,(unsigned char *) timeline);
 	dbg_print(CCX_DMT_DECODER_608, "\n- - - SRT caption - - -\n");
 	dbg_print(CCX_DMT_DECODER_608, "%s",timeline);
 
-	write(context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	int len=strlen (string);
 	unsigned char *unescaped= (unsigned char *) malloc (len+1);
 	unsigned char *el = (unsigned char *) malloc (len*3+1); // Be generous
@@ -67,14 +67,14 @@ int write_stringz_as_srt(char *string, struct encoder_ctx *context, LLONG ms_sta
 			dbg_print(CCX_DMT_DECODER_608, "\r");
 			dbg_print(CCX_DMT_DECODER_608, "%s\n",context->subline);
 		}
-		write(context->out->fh, el, u);
-		write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+		write_buffered(context->out, el, u);
+		write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		begin+= strlen ((const char *) begin)+1;
 	}
 
 	dbg_print(CCX_DMT_DECODER_608, "- - - - - - - - - - - -\r\n");
 
-	write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+	write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 	free(el);
 	free(unescaped);
 
@@ -117,14 +117,14 @@ int write_cc_bitmap_as_srt(struct cc_subtitle *sub, struct encoder_ctx *context)
 			context->srt_counter++;
 			sprintf(timeline, "%u%s", context->srt_counter, context->encoded_crlf);
 			used = encode_line(context, context->buffer,(unsigned char *) timeline);
-			write(context->out->fh, context->buffer, used);
+			write_buffered(context->out, context->buffer, used);
 			sprintf (timeline, "%02u:%02u:%02u,%03u --> %02u:%02u:%02u,%03u%s",
 				h1, m1, s1, ms1, h2, m2, s2, ms2, context->encoded_crlf);
 			used = encode_line(context, context->buffer,(unsigned char *) timeline);
-            write (context->out->fh, context->buffer, used);
+            write_buffered(context->out, context->buffer, used);
 			len = strlen(str);
-            write (context->out->fh, str, len);
-			write (context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+            write_buffered(context->out, str, len);
+			write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		}
 		freep(&str);
 	}
@@ -205,7 +205,7 @@ int write_cc_buffer_as_srt(struct eia608_screen *data, struct encoder_ctx *conte
 	context->srt_counter++;
 	sprintf(timeline, "%u%s", context->srt_counter, context->encoded_crlf);
 	used = encode_line(context, context->buffer,(unsigned char *) timeline);
-	write(context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 
 	sprintf (timeline, "%02u:%02u:%02u,%03u --> %02u:%02u:%02u,%03u%s",
 		h1, m1, s1, ms1, h2, m2, s2, ms2, context->encoded_crlf);
@@ -214,7 +214,7 @@ int write_cc_buffer_as_srt(struct eia608_screen *data, struct encoder_ctx *conte
 	dbg_print(CCX_DMT_DECODER_608, "\n- - - SRT caption ( %d) - - -\n", context->srt_counter);
 	dbg_print(CCX_DMT_DECODER_608, "%s",timeline);
 
-	write(context->out->fh, context->buffer, used);
+	write_buffered(context->out, context->buffer, used);
 	for (int i=0;i<15;i++)
 	{
 		if (data->row_used[i])
@@ -274,7 +274,7 @@ int write_cc_buffer_as_srt(struct eia608_screen *data, struct encoder_ctx *conte
 					do_dash=0;
 
 				if (do_dash)
-					write(context->out->fh, "- ", 2);
+					write_buffered(context->out, "- ", 2);
 				prev_line_start=first;
 				prev_line_end=last;
 				prev_line_center1=center1;
@@ -287,8 +287,8 @@ int write_cc_buffer_as_srt(struct eia608_screen *data, struct encoder_ctx *conte
 				dbg_print(CCX_DMT_DECODER_608, "\r");
 				dbg_print(CCX_DMT_DECODER_608, "%s\n",context->subline);
 			}
-			write(context->out->fh, context->subline, length);
-			write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			write_buffered(context->out, context->subline, length);
+			write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 			wrote_something=1;
 			// fprintf (wb->fh,context->encoded_crlf);
 		}
@@ -296,7 +296,7 @@ int write_cc_buffer_as_srt(struct eia608_screen *data, struct encoder_ctx *conte
 	dbg_print(CCX_DMT_DECODER_608, "- - - - - - - - - - - -\r\n");
 
 	// fprintf (wb->fh, context->encoded_crlf);
-    write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+    write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
     //printf("$ = %s\n",context->encoded_crlf);
 	return wrote_something;
 }
@@ -1,6 +1,8 @@
 #ifndef CCX_ENCODERS_STRUCTS_H
 #define CCX_ENCODERS_STRUCTS_H
 
+#include "list.h"
+
 typedef struct ccx_encoders_transcript_format {
 	// TODO: add more options, and (perhaps) reduce other ccextractor options?
 	int showStartTime, showEndTime; // Show start and/or end time.
@@ -25,6 +27,10 @@ struct ccx_s_write
 	char *playlist_filename; 
 	int renaming_extension; //Used for file rotations
 	int append_mode;        /* Append the file. Prevent overwriting of files */
+	unsigned char *buffer;  // Output not written to fh yet, see write_buffered()
+	size_t buffer_used;
+	size_t buffer_size;     // 0 means every write goes straight to fh
+	struct list_head buffered; // In the list flushed at exit while buffer is allocated
 
 };
 
@@ -44,7 +44,7 @@ int write_cc_bitmap_as_transcript(struct cc_subtitle *sub, struct encoder_ctx *c
 				if (context->transcript_settings->relativeTimestamp)
 				{
 					millis_to_date(start_time + context->subs_delay, buf1, context->date_format, context->millis_separator);
-					fdprintf(context->out->fh, "%s|", buf1);
+					printf_buffered(context->out, "%s|", buf1);
 				}
 				else
 				{
@@ -52,7 +52,7 @@ int write_cc_bitmap_as_transcript(struct cc_subtitle *sub, struct encoder_ctx *c
 					int start_time_dec = (start_time + context->subs_delay) % 1000;
 					struct tm *start_time_struct = gmtime(&start_time_int);
 					strftime(buf1, sizeof(buf1), "%Y%m%d%H%M%S", start_time_struct);
-					fdprintf(context->out->fh, "%s%c%03d|", buf1, context->millis_separator, start_time_dec);
+					printf_buffered(context->out, "%s%c%03d|", buf1, context->millis_separator, start_time_dec);
 				}
 			}
 
@@ -62,7 +62,7 @@ int write_cc_bitmap_as_transcript(struct cc_subtitle *sub, struct encoder_ctx *c
 				if (context->transcript_settings->relativeTimestamp)
 				{
 					millis_to_date(end_time + context->subs_delay, buf2, context->date_format, context->millis_separator);
-					fdprintf(context->out->fh, "%s|", buf2);
+					printf_buffered(context->out, "%s|", buf2);
 				}
 				else
 				{
@@ -70,16 +70,16 @@ int write_cc_bitmap_as_transcript(struct cc_subtitle *sub, struct encoder_ctx *c
 					int end_time_dec = (end_time + context->subs_delay) % 1000;
 					struct tm *end_time_struct = gmtime(&end_time_int);
 					strftime(buf2, sizeof(buf2), "%Y%m%d%H%M%S", end_time_struct);
-					fdprintf(context->out->fh, "%s%c%03d|", buf2, context->millis_separator, end_time_dec);
+					printf_buffered(context->out, "%s%c%03d|", buf2, context->millis_separator, end_time_dec);
 				}
 			}
 			if (context->transcript_settings->showCC)
 			{
-				fdprintf(context->out->fh, "%s|", language[sub->lang_index]);
+				printf_buffered(context->out, "%s|", language[sub->lang_index]);
 			}
 			if (context->transcript_settings->showMode)
 			{
-				fdprintf(context->out->fh, "DVB|");
+				printf_buffered(context->out, "DVB|");
 			}
 
 			while (token)
@@ -87,22 +87,22 @@ int write_cc_bitmap_as_transcript(struct cc_subtitle *sub, struct encoder_ctx *c
 				char *newline_pos = strstr(token, context->encoded_crlf);
 				if (!newline_pos)
 				{
-					fdprintf(context->out->fh, "%s", token);
+					printf_buffered(context->out, "%s", token);
 					break;
 				}
 				else
 				{
 					while (token != newline_pos)
 					{
-						fdprintf(context->out->fh, "%c", *token);
+						printf_buffered(context->out, "%c", *token);
 						token++;
 					}
 					token += context->encoded_crlf_length;
-					fdprintf(context->out->fh, "%c", ' ');
+					printf_buffered(context->out, "%c", ' ');
 				}
 			}
 
-			write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 
 		}
 	}
@@ -165,7 +165,7 @@ int write_cc_subtitle_as_transcript(struct cc_subtitle *sub, struct encoder_ctx
 				if (context->transcript_settings->relativeTimestamp)
 				{
 					millis_to_date(start_time + context->subs_delay, buf, context->date_format, context->millis_separator);
-					fdprintf(context->out->fh, "%s|", buf);
+					printf_buffered(context->out, "%s|", buf);
 				}
 				else
 				{
@@ -173,7 +173,7 @@ int write_cc_subtitle_as_transcript(struct cc_subtitle *sub, struct encoder_ctx
 					int start_time_dec = (start_time + context->subs_delay) % 1000;
 					struct tm *start_time_struct = gmtime(&start_time_int);
 					strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", start_time_struct);
-					fdprintf(context->out->fh, "%s%c%03d|", buf, context->millis_separator, start_time_dec);
+					printf_buffered(context->out, "%s%c%03d|", buf, context->millis_separator, start_time_dec);
 				}
 			}
 
@@ -183,7 +183,7 @@ int write_cc_subtitle_as_transcript(struct cc_subtitle *sub, struct encoder_ctx
 				if (context->transcript_settings->relativeTimestamp)
 				{
 					millis_to_date(end_time + context->subs_delay, buf, context->date_format, context->millis_separator);
-					fdprintf(context->out->fh, "%s|", buf);
+					printf_buffered(context->out, "%s|", buf);
 				}
 				else
 				{
@@ -191,32 +191,32 @@ int write_cc_subtitle_as_transcript(struct cc_subtitle *sub, struct encoder_ctx
 					int end_time_dec = (end_time + context->subs_delay) % 1000;
 					struct tm *end_time_struct = gmtime(&end_time_int);
 					strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", end_time_struct);
-					fdprintf(context->out->fh, "%s%c%03d|", buf, context->millis_separator, end_time_dec);
+					printf_buffered(context->out, "%s%c%03d|", buf, context->millis_separator, end_time_dec);
 				}
 			}
 
 			if (context->transcript_settings->showCC)
 			{
 				if (!context->ucla || !strcmp(sub->mode, "TLT"))
-					fdprintf(context->out->fh, sub->info);				
+					printf_buffered(context->out, sub->info);				
 				else if (context->in_fileformat == 1)
 					//TODO, data->my_field == 1 ? data->channel : data->channel + 2); // Data from field 2 is CC3 or 4
-					fdprintf(context->out->fh, "CC?|");
+					printf_buffered(context->out, "CC?|");
 			}
 			if (context->transcript_settings->showMode)
 			{
 				if (context->ucla && strcmp(sub->mode, "TLT") == 0)
-					fdprintf(context->out->fh, "|");
+					printf_buffered(context->out, "|");
 				else
-					fdprintf(context->out->fh, "%s|", sub->mode);
+					printf_buffered(context->out, "%s|", sub->mode);
 			}
-			ret = write(context->out->fh, context->subline, length);
+			ret = write_buffered(context->out, context->subline, length);
 			if (ret < length)
 			{
 				mprint("Warning:Loss of data\n");
 			}
 
-			ret = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			ret = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 			if (ret <  context->encoded_crlf_length)
 			{
 				mprint("Warning:Loss of data\n");
@@ -274,14 +274,14 @@ void write_cc_line_as_transcript2(struct eia608_screen *data, struct encoder_ctx
 			char buf1[80];
 			if (context->transcript_settings->relativeTimestamp){
 				millis_to_date(start_time + context->subs_delay, buf1, context->date_format, context->millis_separator);
-				fdprintf(context->out->fh, "%s|", buf1);
+				printf_buffered(context->out, "%s|", buf1);
 			}
 			else {
 				time_t start_time_int = (start_time + context->subs_delay) / 1000;
 				int start_time_dec = (start_time + context->subs_delay) % 1000;
 				struct tm *start_time_struct = gmtime(&start_time_int);
 				strftime(buf1, sizeof(buf1), "%Y%m%d%H%M%S", start_time_struct);
-				fdprintf(context->out->fh, "%s%c%03d|", buf1, context->millis_separator, start_time_dec);
+				printf_buffered(context->out, "%s%c%03d|", buf1, context->millis_separator, start_time_dec);
 			}
 		}
 
@@ -289,19 +289,19 @@ void write_cc_line_as_transcript2(struct eia608_screen *data, struct encoder_ctx
 			char buf2[80];
 			if (context->transcript_settings->relativeTimestamp){
 				millis_to_date(end_time, buf2, context->date_format, context->millis_separator);
-				fdprintf(context->out->fh, "%s|", buf2);
+				printf_buffered(context->out, "%s|", buf2);
 			}
 			else {
 				time_t end_time_int = end_time / 1000;
 				int end_time_dec = end_time % 1000;
 				struct tm *end_time_struct = gmtime(&end_time_int);
 				strftime(buf2, sizeof(buf2), "%Y%m%d%H%M%S", end_time_struct);
-				fdprintf(context->out->fh, "%s%c%03d|", buf2, context->millis_separator, end_time_dec);
+				printf_buffered(context->out, "%s%c%03d|", buf2, context->millis_separator, end_time_dec);
 			}
 		}
 
 		if (context->transcript_settings->showCC){
-			fdprintf(context->out->fh, "CC%d|", data->my_field == 1 ? data->channel : data->channel + 2); // Data from field 2 is CC3 or 4
+			printf_buffered(context->out, "CC%d|", data->my_field == 1 ? data->channel : data->channel + 2); // Data from field 2 is CC3 or 4
 		}
 		if (context->transcript_settings->showMode){
 			const char *mode = "???";
@@ -329,16 +329,16 @@ void write_cc_line_as_transcript2(struct eia608_screen *data, struct encoder_ctx
 					mode = "PAI";
 					break;
 			}
-			fdprintf(context->out->fh, "%s|", mode);
+			printf_buffered(context->out, "%s|", mode);
 		}
 
-		ret = write(context->out->fh, context->subline, length);
+		ret = write_buffered(context->out, context->subline, length);
 		if (ret < length)
 		{
 			mprint("Warning:Loss of data\n");
 		}
 
-		ret = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+		ret = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		if (ret < context->encoded_crlf_length)
 		{
 			mprint("Warning:Loss of data\n");
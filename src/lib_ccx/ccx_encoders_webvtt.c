@@ -137,7 +137,7 @@ int write_stringz_as_webvtt(char *string, struct encoder_ctx *context, LLONG ms_
 	dbg_print(CCX_DMT_DECODER_608, "\n- - - WEBVTT caption - - -\n");
 	dbg_print(CCX_DMT_DECODER_608, "%s", timeline);
 
-	written = write(context->out->fh, context->buffer, used);
+	written = write_buffered(context->out, context->buffer, used);
 	if (written != used)
 		return -1;
 	int len = strlen(string);
@@ -173,14 +173,14 @@ int write_stringz_as_webvtt(char *string, struct encoder_ctx *context, LLONG ms_
 			dbg_print(CCX_DMT_DECODER_608, "\r");
 			dbg_print(CCX_DMT_DECODER_608, "%s\n", context->subline);
 		}
-		written = write(context->out->fh, el, u);
+		written = write_buffered(context->out, el, u);
 		if (written != u)
 		{
 			free(el);
 			free(unescaped);
 			return -1;
 		}
-		written = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+		written = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		if (written != context->encoded_crlf_length)
 		{   
             		free(el);
@@ -191,7 +191,7 @@ int write_stringz_as_webvtt(char *string, struct encoder_ctx *context, LLONG ms_
 
 	dbg_print(CCX_DMT_DECODER_608, "- - - - - - - - - - - -\r\n");
 
-	written = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+	written = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 	free(el);
 	free(unescaped);
 	if (written != context->encoded_crlf_length)
@@ -224,21 +224,21 @@ int write_webvtt_header(struct encoder_ctx *context)
 
 		char* outline_css_file = (char*)malloc((strlen(css_file_name) + strlen(webvtt_outline_css)) * sizeof(char));
 		sprintf(outline_css_file, webvtt_outline_css, css_file_name);
-		write (context->out->fh, outline_css_file, strlen(outline_css_file));
+		write_buffered(context->out, outline_css_file, strlen(outline_css_file));
 	} else {
-		write(context->out->fh, webvtt_inline_css, strlen(webvtt_inline_css));
+		write_buffered(context->out, webvtt_inline_css, strlen(webvtt_inline_css));
 		if(ccx_options.enc_cfg.line_terminator_lf == 1) // If -lf parameter is set.
 		{
-			write(context->out->fh, "\n", 1);
+			write_buffered(context->out, "\n", 1);
 		}
 		else
 		{
-			write(context->out->fh,"\r\n",2);
+			write_buffered(context->out, "\r\n",2);
 		}
 	}
 
-	write(context->out->fh, "##\n", 3);
-	write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+	write_buffered(context->out, "##\n", 3);
+	write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 
 	if (context->timing->sync_pts2fts_set)
 	{
@@ -250,7 +250,7 @@ int write_webvtt_header(struct encoder_ctx *context)
 			context->timing->sync_pts2fts_pts,
 			h1, m1, s1, ms1);
 		used = encode_line(context, context->buffer, (unsigned char *)header_string);
-		write(context->out->fh, context->buffer, used);
+		write_buffered(context->out, context->buffer, used);
 
 	}
 
@@ -294,10 +294,10 @@ int write_cc_bitmap_as_webvtt(struct cc_subtitle *sub, struct encoder_ctx *conte
 			sprintf(timeline, "%02u:%02u:%02u.%03u --> %02u:%02u:%02u.%03u%s",
 				h1, m1, s1, ms1, h2, m2, s2, ms2, context->encoded_crlf);
 			used = encode_line(context, context->buffer, (unsigned char *)timeline);
-            write(context->out->fh, context->buffer, used);
+            write_buffered(context->out, context->buffer, used);
 			len = strlen(str);
-			write(context->out->fh, str, len);
-			write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			write_buffered(context->out, str, len);
+			write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 		}
 		freep(&str);
 	}
@@ -441,7 +441,7 @@ int write_cc_buffer_as_webvtt(struct eia608_screen *data, struct encoder_ctx *co
 
 			dbg_print(CCX_DMT_DECODER_608, "\n- - - WEBVTT caption - - -\n");
 			dbg_print(CCX_DMT_DECODER_608, "%s", timeline);
-			written = write(context->out->fh, context->buffer, used);
+			written = write_buffered(context->out, context->buffer, used);
 			if (written != used)
 				return -1;
 
@@ -476,23 +476,23 @@ int write_cc_buffer_as_webvtt(struct eia608_screen *data, struct encoder_ctx *co
 					if (open_font != FONT_REGULAR)
 					{
 						if (open_font & FONT_ITALICS)
-							write(context->out->fh, strdup("<i>"), 3);
+							write_buffered(context->out, strdup("<i>"), 3);
 						if (open_font & FONT_UNDERLINED)
-							write(context->out->fh, strdup("<u>"), 3);
+							write_buffered(context->out, strdup("<u>"), 3);
 					}
 
 					// opening events for colors
 					int open_color = color_events[j] & 0xFF;	// Last 16 bytes
 					if (open_color != COL_WHITE)
 					{
-						write(context->out->fh, strdup("<c."), 3);
-						write(context->out->fh, color_text[open_color][0], strlen(color_text[open_color][0]));
-						write(context->out->fh, ">", 1);
+						write_buffered(context->out, strdup("<c."), 3);
+						write_buffered(context->out, color_text[open_color][0], strlen(color_text[open_color][0]));
+						write_buffered(context->out, ">", 1);
 					}
 				}
 
 				// write current text symbol
-				write(context->out->fh, &(context->subline[j]), 1);
+				write_buffered(context->out, &(context->subline[j]), 1);
 
 				if (ccx_options.use_webvtt_styling)
 				{
@@ -500,7 +500,7 @@ int write_cc_buffer_as_webvtt(struct eia608_screen *data, struct encoder_ctx *co
 					int close_color = color_events[j] >> 16;	// First 16 bytes
 					if (close_color != COL_WHITE)
 					{
-						write(context->out->fh, strdup("</c>"), 4);
+						write_buffered(context->out, strdup("</c>"), 4);
 					}
 
 					// closing events for fonts
@@ -508,9 +508,9 @@ int write_cc_buffer_as_webvtt(struct eia608_screen *data, struct encoder_ctx *co
 					if (close_font != FONT_REGULAR)
 					{
 						if (close_font & FONT_ITALICS)
-							write(context->out->fh, strdup("</i>"), 4);
+							write_buffered(context->out, strdup("</i>"), 4);
 						if (close_font & FONT_UNDERLINED)
-							write(context->out->fh, strdup("</u>"), 4);
+							write_buffered(context->out, strdup("</u>"), 4);
 					}
 				}
 			}
@@ -521,12 +521,11 @@ int write_cc_buffer_as_webvtt(struct eia608_screen *data, struct encoder_ctx *co
 				free(font_events);
 			}
 
-			written = write(context->out->fh,
-				context->encoded_crlf, context->encoded_crlf_length);
+			written = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 			if (written != context->encoded_crlf_length)
 				return -1;
 
-			written = write(context->out->fh, context->encoded_crlf, context->encoded_crlf_length);
+			written = write_buffered(context->out, context->encoded_crlf, context->encoded_crlf_length);
 			if (written != context->encoded_crlf_length)
 				return -1;
 
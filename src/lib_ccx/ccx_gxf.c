@@ -26,7 +26,7 @@
 #define CLOSED_C708_SDID 0x01
 #define CLOSED_C608_SDID 0x02
 
-#define debug(fmt, ...) ccx_common_logging.debug_ftn(CCX_DMT_PARSE, "GXF:%s:%d: "fmt , __FUNCTION__ ,__LINE__ , ##__VA_ARGS__)
+#define debug(fmt, ...) ccx_debug(CCX_DMT_PARSE, "GXF:%s:%d: "fmt , __FUNCTION__ ,__LINE__ , ##__VA_ARGS__)
 #define log(fmt, ...) ccx_common_logging.log_ftn("GXF:%d: "fmt , __LINE__ , ##__VA_ARGS__)
 
 #undef CCX_GXF_ENABLE_AD_VBI
@@ -0,0 +1,359 @@
+#include "lib_ccx.h"
+#include "ccx_common_option.h"
+#include "ccx_metrics.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#endif
+
+/* Stages entered inside one another at most, deeper ones aren't timed */
+#define METRICS_MAX_NESTING 8
+
+#ifdef _WIN32
+#define METRICS_ADD(var, v) ((var) += (v))
+#else
+#define METRICS_ADD(var, v) __atomic_fetch_add(&(var), (v), __ATOMIC_RELAXED)
+#endif
+
+struct ccx_metrics_pid ccx_metrics_pids[8192];
+
+static struct
+{
+	unsigned long long calls;
+	unsigned long long ns;
+	unsigned long long bytes;
+} stages[CCX_STAGE_COUNT];
+
+static struct
+{
+	long depth;
+	long peak;
+} queues[CCX_QUEUE_COUNT];
+
+/* The stages this thread is in, the last one is being timed */
+static CCX_THREAD_LOCAL struct
+{
+	int depth;
+	int stage[METRICS_MAX_NESTING];
+	unsigned long long start[METRICS_MAX_NESTING];
+} in_stage;
+
+static unsigned long long start_ns;
+
+static const char *stage_names[CCX_STAGE_ENCODE] = {
+	"read", "ts", "pes", "video", "decode_608", "decode_708",
+	"decode_teletext", "decode_dvb", "decode_isdb", "decode_dvd"
+};
+
+// Indexed by enum ccx_output_format
+static const char *format_names[CCX_STAGE_COUNT - CCX_STAGE_ENCODE] = {
+	"raw", "srt", "sami", "transcript", "rcwt", "null", "smptett", "spupng",
+	"dvdraw", "webvtt", "simplexml", "g608", "curl", "ssa"
+};
+
+static const char *queue_names[CCX_QUEUE_COUNT] = { "program", "ocr", "udp", "ocr_reorder" };
+
+static unsigned long long now_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (unsigned long long) ((double) count.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void ccx_metrics_enter(enum ccx_metrics_stage stage)
+{
+	int depth = in_stage.depth++;
+	unsigned long long t;
+
+	if (depth >= METRICS_MAX_NESTING)
+		return;
+	t = now_ns();
+	if (depth > 0)
+	{
+		int parent = in_stage.stage[depth - 1];
+		METRICS_ADD(stages[parent].ns, t - in_stage.start[depth - 1]);
+	}
+	in_stage.stage[depth] = stage;
+	in_stage.start[depth] = t;
+}
+
+void ccx_metrics_leave(size_t bytes)
+{
+	int depth = --in_stage.depth;
+	int stage;
+	unsigned long long t;
+
+	if (depth >= METRICS_MAX_NESTING)
+		return;
+	t = now_ns();
+	stage = in_stage.stage[depth];
+	METRICS_ADD(stages[stage].ns, t - in_stage.start[depth]);
+	METRICS_ADD(stages[stage].calls, 1);
+	METRICS_ADD(stages[stage].bytes, bytes);
+	if (depth > 0)
+		in_stage.start[depth - 1] = t; // The enclosing stage goes on
+}
+
+void ccx_metrics_queue_depth(enum ccx_metrics_queue queue, long depth)
+{
+	queues[queue].depth = depth;
+	if (depth > queues[queue].peak)
+		queues[queue].peak = depth;
+}
+
+static const char *stage_name(int stage, char *buf)
+{
+	if (stage < CCX_STAGE_ENCODE)
+		return stage_names[stage];
+	sprintf(buf, "encode_%s", format_names[stage - CCX_STAGE_ENCODE]);
+	return buf;
+}
+
+static void write_json(FILE *f)
+{
+	char name[32];
+	const char *sep = "";
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"uptime_seconds\": %.3f,\n", (now_ns() - start_ns) / 1e9);
+	fprintf(f, "  \"stages\": {");
+	for (int i = 0; i < CCX_STAGE_COUNT; i++)
+	{
+		if (!stages[i].calls)
+			continue;
+		fprintf(f, "%s\n    \"%s\": { \"calls\": %llu, \"seconds\": %.6f, \"bytes\": %llu }",
+				sep, stage_name(i, name), stages[i].calls, stages[i].ns / 1e9, stages[i].bytes);
+		sep = ",";
+	}
+	fprintf(f, "\n  },\n");
+	fprintf(f, "  \"pids\": {");
+	sep = "";
+	for (int pid = 0; pid < 8192; pid++)
+	{
+		struct ccx_metrics_pid *p = &ccx_metrics_pids[pid];
+		if (!p->packets)
+			continue;
+		fprintf(f, "%s\n    \"%d\": { \"packets\": %llu, \"bytes\": %llu, \"cc_errors\": %llu }",
+				sep, pid, p->packets, p->bytes, p->cc_errors);
+		sep = ",";
+	}
+	fprintf(f, "\n  },\n");
+	fprintf(f, "  \"queues\": {");
+	for (int i = 0; i < CCX_QUEUE_COUNT; i++)
+		fprintf(f, "%s\n    \"%s\": { \"depth\": %ld, \"peak\": %ld }",
+				i ? "," : "", queue_names[i], queues[i].depth, queues[i].peak);
+	fprintf(f, "\n  }\n");
+	fprintf(f, "}\n");
+}
+
+static void write_prometheus_stages(FILE *f, const char *metric, const char *help, int field)
+{
+	char name[32];
+
+	fprintf(f, "# HELP ccextractor_%s %s\n", metric, help);
+	fprintf(f, "# TYPE ccextractor_%s counter\n", metric);
+	for (int i = 0; i < CCX_STAGE_COUNT; i++)
+	{
+		if (!stages[i].calls)
+			continue;
+		fprintf(f, "ccextractor_%s{stage=\"%s\"} ", metric, stage_name(i, name));
+		if (field == 0)
+			fprintf(f, "%llu\n", stages[i].calls);
+		else if (field == 1)
+			fprintf(f, "%.6f\n", stages[i].ns / 1e9);
+		else
+			fprintf(f, "%llu\n", stages[i].bytes);
+	}
+}
+
+static void write_prometheus_pids(FILE *f, const char *metric, const char *help, int field)
+{
+	fprintf(f, "# HELP ccextractor_%s %s\n", metric, help);
+	fprintf(f, "# TYPE ccextractor_%s counter\n", metric);
+	for (int pid = 0; pid < 8192; pid++)
+	{
+		struct ccx_metrics_pid *p = &ccx_metrics_pids[pid];
+		if (!p->packets)
+			continue;
+		fprintf(f, "ccextractor_%s{pid=\"%d\"} %llu\n", metric, pid,
+				field == 0 ? p->packets : field == 1 ? p->bytes : p->cc_errors);
+	}
+}
+
+static void write_prometheus(FILE *f)
+{
+	fprintf(f, "# HELP ccextractor_uptime_seconds Time since the processing started.\n");
+	fprintf(f, "# TYPE ccextractor_uptime_seconds gauge\n");
+	fprintf(f, "ccextractor_uptime_seconds %.3f\n", (now_ns() - start_ns) / 1e9);
+	write_prometheus_stages(f, "stage_calls_total", "Times each processing stage ran.", 0);
+	write_prometheus_stages(f, "stage_seconds_total", "Time spent in each processing stage, stages it called excluded.", 1);
+	write_prometheus_stages(f, "stage_bytes_total", "Bytes each processing stage got to work on.", 2);
+	write_prometheus_pids(f, "pid_packets_total", "TS packets of each PID.", 0);
+	write_prometheus_pids(f, "pid_bytes_total", "TS payload bytes of each PID.", 1);
+	write_prometheus_pids(f, "pid_cc_errors_total", "TS continuity counter errors of each PID.", 2);
+	fprintf(f, "# HELP ccextractor_queue_depth Items waiting in each queue between threads.\n");
+	fprintf(f, "# TYPE ccextractor_queue_depth gauge\n");
+	for (int i = 0; i < CCX_QUEUE_COUNT; i++)
+		fprintf(f, "ccextractor_queue_depth{queue=\"%s\"} %ld\n", queue_names[i], queues[i].depth);
+	fprintf(f, "# HELP ccextractor_queue_depth_peak Most items that waited in each queue.\n");
+	fprintf(f, "# TYPE ccextractor_queue_depth_peak gauge\n");
+	for (int i = 0; i < CCX_QUEUE_COUNT; i++)
+		fprintf(f, "ccextractor_queue_depth_peak{queue=\"%s\"} %ld\n", queue_names[i], queues[i].peak);
+}
+
+static void write_metrics(FILE *f)
+{
+	if (ccx_options.metrics_format == CCX_METRICS_PROMETHEUS)
+		write_prometheus(f);
+	else
+		write_json(f);
+	fflush(f);
+}
+
+/* Written to a temporary file renamed over the previous one, so a reader
+   never sees half of it */
+static void write_metrics_file(const char *filename)
+{
+	char *tmp = malloc(strlen(filename) + 5);
+	FILE *f;
+
+	if (!tmp)
+		return;
+	sprintf(tmp, "%s.tmp", filename);
+	f = fopen(tmp, "w");
+	if (!f)
+	{
+		mprint("Unable to write the metrics to %s: %s\n", tmp, strerror(errno));
+		free(tmp);
+		return;
+	}
+	write_metrics(f);
+	fclose(f);
+#ifdef _WIN32
+	remove(filename);
+#endif
+	if (rename(tmp, filename))
+		mprint("Unable to rename %s to %s: %s\n", tmp, filename, strerror(errno));
+	free(tmp);
+}
+
+#ifndef _WIN32
+
+static pthread_t writer;
+static int wake_pipe[2] = { -1, -1 };
+
+/* Writes the file every metrics_interval seconds, and when woken up through
+   wake_pipe: 'd' to write the metrics now, 'q' to stop */
+static void *writer_main(void *arg)
+{
+	struct pollfd pfd;
+	int interval_ms = ccx_options.metrics_file ? ccx_options.metrics_interval * 1000 : 0;
+	unsigned long long due = now_ns() + interval_ms * 1000000ULL;
+
+	pfd.fd = wake_pipe[0];
+	pfd.events = POLLIN;
+	for (;;)
+	{
+		int timeout = -1;
+		int dump = 0;
+		char cmd[16];
+
+		if (interval_ms)
+		{
+			unsigned long long t = now_ns();
+			timeout = due > t ? (int) ((due - t) / 1000000) : 0;
+		}
+		pfd.revents = 0;
+		int n = poll(&pfd, 1, timeout);
+		if (n < 0)
+			continue; // EINTR
+		if (n > 0)
+		{
+			ssize_t len = read(wake_pipe[0], cmd, sizeof(cmd));
+			if (len <= 0)
+				continue;
+			if (memchr(cmd, 'q', len))
+				break;
+			dump = 1;
+		}
+		if (n == 0 || dump)
+		{
+			if (ccx_options.metrics_file)
+				write_metrics_file(ccx_options.metrics_file);
+			else
+				write_metrics(stderr);
+		}
+		if (n == 0)
+			due += interval_ms * 1000000ULL;
+	}
+	return NULL;
+}
+
+void ccx_metrics_start(void)
+{
+	start_ns = now_ns();
+	if (wake_pipe[0] >= 0)
+		return;
+	if (pipe(wake_pipe))
+	{
+		wake_pipe[0] = wake_pipe[1] = -1;
+		return;
+	}
+	// A signal handler must never block on it
+	fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+	if (pthread_create(&writer, NULL, writer_main, NULL))
+	{
+		close(wake_pipe[0]);
+		close(wake_pipe[1]);
+		wake_pipe[0] = wake_pipe[1] = -1;
+	}
+}
+
+void ccx_metrics_request_dump(void)
+{
+	if (wake_pipe[1] >= 0 && write(wake_pipe[1], "d", 1) < 0)
+		return; // Already plenty of requests waiting
+}
+
+void ccx_metrics_stop(void)
+{
+	if (wake_pipe[0] >= 0)
+	{
+		while (write(wake_pipe[1], "q", 1) < 0 && errno == EAGAIN)
+			poll(NULL, 0, 10);
+		pthread_join(writer, NULL);
+		close(wake_pipe[0]);
+		close(wake_pipe[1]);
+		wake_pipe[0] = wake_pipe[1] = -1;
+	}
+	if (ccx_options.metrics_file)
+		write_metrics_file(ccx_options.metrics_file);
+}
+
+#else // _WIN32
+
+void ccx_metrics_start(void)
+{
+	start_ns = now_ns();
+}
+
+void ccx_metrics_request_dump(void)
+{
+}
+
+void ccx_metrics_stop(void)
+{
+	if (ccx_options.metrics_file)
+		write_metrics_file(ccx_options.metrics_file);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CCX_METRICS_H
+#define CCX_METRICS_H
+
+#include "ccx_common_platform.h"
+#include "ccx_common_constants.h"
+
+/**
+ * Counters and timers of each stage of the processing, always collected:
+ * calls, time spent and bytes in for the input read, the TS demuxer, the
+ * PES packets handed to the decoders, each decoder and the encoder of each
+ * output format; packets, bytes and continuity errors of each TS PID; and
+ * the depth of the queues between threads.
+ *
+ * Time is taken with a monotonic clock when a stage is entered and left, a
+ * few times per PES packet and subtitle, never per TS packet. The time of a
+ * stage doesn't include the time of the stages it calls (a 608 decoder
+ * called from the video parser), so the stages add up to the time spent.
+ * Stages running on several threads (-programthreads, -ocrthreads) add up
+ * the time of all of them.
+ *
+ * -metrics writes them to a file, as JSON or in the Prometheus text format,
+ * every -metricsinterval seconds and at the end. SIGUSR2 writes them at once,
+ * to stderr without -metrics.
+ */
+
+// ccx_options.metrics_format
+#define CCX_METRICS_JSON       0
+#define CCX_METRICS_PROMETHEUS 1
+
+enum ccx_metrics_stage
+{
+	CCX_STAGE_READ,             // Input read, including the wait for network data
+	CCX_STAGE_TS,               // TS packets, PSI tables included
+	CCX_STAGE_PES,              // PES packets completed and handed to the decoders
+	CCX_STAGE_VIDEO,            // MPEG-2 and H.264 video searched for caption data
+	CCX_STAGE_DECODE_608,
+	CCX_STAGE_DECODE_708,
+	CCX_STAGE_DECODE_TELETEXT,
+	CCX_STAGE_DECODE_DVB,
+	CCX_STAGE_DECODE_ISDB,
+	CCX_STAGE_DECODE_DVD,
+	CCX_STAGE_ENCODE,           // CCX_STAGE_ENCODE + write_format
+	CCX_STAGE_COUNT = CCX_STAGE_ENCODE + CCX_OF_SSA + 1
+};
+
+enum ccx_metrics_queue
+{
+	CCX_QUEUE_PROGRAM,          // Work queued for a -programthreads worker
+	CCX_QUEUE_OCR,              // Bitmaps waiting for a -ocrthreads thread
+	CCX_QUEUE_UDP,              // Bytes waiting in the -udpring ring
+	CCX_QUEUE_OCR_REORDER,      // Subtitles waiting in an OCR reorder buffer
+	CCX_QUEUE_COUNT
+};
+
+struct ccx_metrics_pid
+{
+	unsigned long long packets;
+	unsigned long long bytes;      // Payload bytes
+	unsigned long long cc_errors;  // Continuity counter not incremented
+	unsigned char counter_seen;    // Last continuity counter + 1, 0 before the first packet with payload
+};
+
+extern struct ccx_metrics_pid ccx_metrics_pids[8192];
+
+/**
+ * Count a TS packet of pid. Called for every packet, so kept inline.
+ */
+static inline void ccx_metrics_ts_packet(unsigned pid, unsigned counter, unsigned payload_length,
+		int has_payload, int discontinuity)
+{
+	struct ccx_metrics_pid *p = &ccx_metrics_pids[pid];
+
+	p->packets++;
+	p->bytes += payload_length;
+	if (!has_payload)
+		return;
+	// A packet may be sent twice in a row, with the same counter
+	if (p->counter_seen && !discontinuity && pid != 0x1fff &&
+			counter != (p->counter_seen & 0xf) && counter != p->counter_seen - 1u)
+		p->cc_errors++;
+	p->counter_seen = counter + 1;
+}
+
+/**
+ * Time what this thread does until ccx_metrics_leave() as stage. Stages
+ * nest, the time of the enclosing one stops while this one runs.
+ */
+void ccx_metrics_enter(enum ccx_metrics_stage stage);
+
+/**
+ * Leave the stage last entered.
+ *
+ * @param bytes the size of what the stage got to work on
+ */
+void ccx_metrics_leave(size_t bytes);
+
+void ccx_metrics_queue_depth(enum ccx_metrics_queue queue, long depth);
+
+/**
+ * Start the thread writing ccx_options.metrics_file, if any, and answering
+ * SIGUSR2. Not available on Windows, where the file is only written by
+ * ccx_metrics_stop().
+ */
+void ccx_metrics_start(void);
+
+/**
+ * Stop the thread and write the file one last time.
+ */
+void ccx_metrics_stop(void);
+
+/**
+ * Have the metrics written as soon as possible. Safe in a signal handler.
+ */
+void ccx_metrics_request_dump(void);
+
+#endif
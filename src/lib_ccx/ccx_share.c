@@ -13,16 +13,43 @@
 
 #include <nanomsg/nn.h>
 #include <nanomsg/pubsub.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef _WIN32
+static pthread_mutex_t publishers_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK(m) pthread_mutex_lock(m)
+#define UNLOCK(m) pthread_mutex_unlock(m)
+#else
+#define LOCK(m)
+#define UNLOCK(m)
+#endif
 
-ccx_share_service_ctx ccx_share_ctx;
+static ccx_share_service_ctx *publishers;
+static char *share_stream_name;
 
-void ccx_sub_entry_msg_cleanup(CcxSubEntryMessage *msg)
+static LLONG share_clock_ms()
 {
-	for (int i = 0; i < msg->n_lines; i++) {
-		free(msg->lines[i]);
-	}
-	free(msg->lines);
-	free(msg->stream_name);
+#ifdef _WIN32
+	return GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (LLONG)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+static void share_sleep_ms(LLONG ms)
+{
+#ifdef _WIN32
+	Sleep((DWORD)ms);
+#else
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+	nanosleep(&ts, NULL);
+#endif
 }
 
 void ccx_sub_entry_msg_print(CcxSubEntryMessage *msg)
@@ -55,19 +82,39 @@ void ccx_sub_entry_msg_print(CcxSubEntryMessage *msg)
 void ccx_sub_entries_init(ccx_sub_entries *entries)
 {
 	entries->count = 0;
+	entries->capacity = 0;
 	entries->messages = NULL;
+	entries->lines = NULL;
+	entries->text = NULL;
 }
 
+// The messages point into entries, which are kept for the next subtitle
 void ccx_sub_entries_cleanup(ccx_sub_entries *entries)
 {
-	for (int i = 0; i < entries->count; i++) {
-		ccx_sub_entry_msg_cleanup(entries->messages + i);
-	}
-	free(entries->messages);
-	entries->messages = NULL;
 	entries->count = 0;
 }
 
+void ccx_sub_entries_free(ccx_sub_entries *entries)
+{
+	free(entries->messages);
+	free(entries->lines);
+	free(entries->text);
+	ccx_sub_entries_init(entries);
+}
+
+static void ccx_sub_entries_reserve(ccx_sub_entries *entries, unsigned int count)
+{
+	if (count <= entries->capacity)
+		return;
+	entries->messages = realloc(entries->messages, count * sizeof(CcxSubEntryMessage));
+	entries->lines = realloc(entries->lines, count * CCX_SHARE_MAX_LINES * sizeof(char *));
+	entries->text = realloc(entries->text, count * CCX_SHARE_MAX_LINES * CCX_SHARE_LINE_SIZE);
+	if (!entries->messages || !entries->lines || !entries->text) {
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ccx_sub_entries_reserve: Not enough memory to store sub-entry-messages\n");
+	}
+	entries->capacity = count;
+}
+
 void ccx_sub_entries_print(ccx_sub_entries *entries)
 {
 	dbg_print(CCX_DMT_SHARE, "[share] ccx_sub_entries_print (%u entries)\n", entries->count);
@@ -76,122 +123,271 @@ void ccx_sub_entries_print(ccx_sub_entries *entries)
 	}
 }
 
+// A sharing url with a single %d, replaced by the program number, gives a socket per program
+static int share_url_per_program(const char *url)
+{
+	const char *p = strchr(url, '%');
+	return p && p[1] == 'd' && !strchr(p + 1, '%');
+}
 
-ccx_share_status ccx_share_start(const char *stream_name) //TODO add stream
+static ccx_share_service_ctx *share_open(int program_number)
 {
-	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_start: starting service\n");
-	//TODO for multiple files we have to move creation to ccx_share_init
-	ccx_share_ctx.nn_sock = nn_socket(AF_SP, NN_PUB);
-	if (ccx_share_ctx.nn_sock < 0) {
-		perror("[share] ccx_share_start: can't nn_socket()\n");
-		fatal(EXIT_NOT_CLASSIFIED, "In ccx_share_start: can't nn_socket().");
+	ccx_share_service_ctx *ctx;
+	char *url = ccx_options.sharing_url;
+	char url_buf[1024];
+
+	ctx = malloc(sizeof(ccx_share_service_ctx));
+	if (!ctx) {
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ccx_share_start: Out of memory\n");
+	}
+	if (program_number >= 0) {
+		snprintf(url_buf, sizeof(url_buf), ccx_options.sharing_url, program_number);
+		url = url_buf;
 	}
 
-	if (!ccx_options.sharing_url) {
-		ccx_options.sharing_url = strdup("tcp://*:3269");
+	ctx->nn_sock = nn_socket(AF_SP, NN_PUB);
+	if (ctx->nn_sock < 0) {
+		perror("[share] ccx_share_start: can't nn_socket()\n");
+		fatal(EXIT_NOT_CLASSIFIED, "In ccx_share_start: can't nn_socket().");
 	}
 
-	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_start: url=%s\n", ccx_options.sharing_url);
+	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_start: url=%s\n", url);
 
-	ccx_share_ctx.nn_binder = nn_bind(ccx_share_ctx.nn_sock, ccx_options.sharing_url);
-	if (ccx_share_ctx.nn_binder < 0) {
+	ctx->nn_binder = nn_bind(ctx->nn_sock, url);
+	if (ctx->nn_binder < 0) {
 		perror("[share] ccx_share_start: can't nn_bind()\n");
 		fatal(EXIT_NOT_CLASSIFIED, "In ccx_share_start: can't nn_bind()");
 	}
 
 	int linger = -1;
-	int rc = nn_setsockopt(ccx_share_ctx.nn_sock, NN_SOL_SOCKET, NN_LINGER, &linger, sizeof(int));
+	int rc = nn_setsockopt(ctx->nn_sock, NN_SOL_SOCKET, NN_LINGER, &linger, sizeof(int));
 	if (rc < 0) {
 		perror("[share] ccx_share_start: can't nn_setsockopt()\n");
 		fatal(EXIT_NOT_CLASSIFIED, "In ccx_share_start: can't nn_setsockopt()");
 	}
 
+	ctx->counter = 0;
+	ctx->stream_name = strdup(share_stream_name ? share_stream_name : "unknown");
+	ctx->program_number = program_number;
+	// It takes some time for subscribers to subscribe, messages sent before are lost
+	ctx->subscribe_until = share_clock_ms() + ccx_options.sharing_wait;
+	ccx_sub_entries_init(&ctx->entries);
+	ctx->frame = NULL;
+	ctx->frame_size = 0;
+	ctx->frame_len = 0;
+	ctx->frame_messages = 0;
+	ctx->frame_since = 0;
+	ctx->sent_frames = 0;
+	ctx->sent_messages = 0;
+#ifndef _WIN32
+	pthread_mutex_init(&ctx->lock, NULL);
+#endif
+	ctx->next = publishers;
+	publishers = ctx;
+	return ctx;
+}
+
+static ccx_share_service_ctx *share_get(int program_number)
+{
+	ccx_share_service_ctx *ctx;
+
+	if (!share_url_per_program(ccx_options.sharing_url) || program_number < 0)
+		program_number = -1;
+
+	LOCK(&publishers_lock);
+	for (ctx = publishers; ctx; ctx = ctx->next) {
+		if (ctx->program_number == program_number)
+			break;
+	}
+	if (!ctx)
+		ctx = share_open(program_number);
+	UNLOCK(&publishers_lock);
+	return ctx;
+}
+
+ccx_share_status ccx_share_start(const char *stream_name) //TODO add stream
+{
+	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_start: starting service\n");
+
+	if (!ccx_options.sharing_url) {
+		ccx_options.sharing_url = strdup("tcp://*:3269");
+	}
+
 	//TODO remove path from stream name to minimize traffic (/?)
-	ccx_share_ctx.stream_name = strdup(stream_name ? stream_name : "unknown");
+	LOCK(&publishers_lock);
+	free(share_stream_name);
+	share_stream_name = strdup(stream_name ? stream_name : "unknown");
+	// The sockets stay open from a file to the next, subscribers don't have to wait again
+	for (ccx_share_service_ctx *ctx = publishers; ctx; ctx = ctx->next) {
+		free(ctx->stream_name);
+		ctx->stream_name = strdup(share_stream_name);
+	}
+	UNLOCK(&publishers_lock);
 
-	sleep(1); //We have to sleep a while, because it takes some time for subscribers to subscribe
+	// Bound now, so that subscribers connect while the input is opened
+	if (!share_url_per_program(ccx_options.sharing_url))
+		share_get(-1);
 	return CCX_SHARE_OK;
 }
 
 ccx_share_status ccx_share_stop()
 {
+	ccx_share_service_ctx *ctx, *next;
+
 	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_stop: stopping service\n");
-	nn_shutdown(ccx_share_ctx.nn_sock, ccx_share_ctx.nn_binder);
-	free(ccx_share_ctx.stream_name);
+	LOCK(&publishers_lock);
+	for (ctx = publishers; ctx; ctx = next) {
+		next = ctx->next;
+		_ccx_share_flush(ctx);
+		dbg_print(CCX_DMT_SHARE, "[share] program %d: %lu messages in %lu frames\n",
+				ctx->program_number, ctx->sent_messages, ctx->sent_frames);
+		nn_shutdown(ctx->nn_sock, ctx->nn_binder);
+		nn_close(ctx->nn_sock);
+		ccx_sub_entries_free(&ctx->entries);
+		free(ctx->frame);
+		free(ctx->stream_name);
+#ifndef _WIN32
+		pthread_mutex_destroy(&ctx->lock);
+#endif
+		free(ctx);
+	}
+	publishers = NULL;
+	freep(&share_stream_name);
+	UNLOCK(&publishers_lock);
 	return CCX_SHARE_OK;
 }
 
-ccx_share_status ccx_share_send(struct cc_subtitle *sub)
+ccx_share_status ccx_share_send(struct cc_subtitle *sub, int program_number)
 {
+	ccx_share_service_ctx *ctx = share_get(program_number);
+	ccx_share_status ret = CCX_SHARE_OK;
+
 	dbg_print(CCX_DMT_SHARE, "[share] ccx_share_send: sending\n");
-	ccx_sub_entries entries;
-	ccx_sub_entries_init(&entries);
-	_ccx_share_sub_to_entries(sub, &entries);
-	ccx_sub_entries_print(&entries);
+	LOCK(&ctx->lock);
+	_ccx_share_sub_to_entries(ctx, sub);
+	ccx_sub_entries_print(&ctx->entries);
 	dbg_print(CCX_DMT_SHARE, "[share] entry obtained:\n");
 
-	for (unsigned int i = 0; i < entries.count; i++) {
+	for (unsigned int i = 0; i < ctx->entries.count && ret == CCX_SHARE_OK; i++) {
 		dbg_print(CCX_DMT_SHARE, "[share] ccx_share_send: _sending %u\n", i);
-		//TODO prevent sending empty messages
-		if (_ccx_share_send(entries.messages + i) != CCX_SHARE_OK) {
-			dbg_print(CCX_DMT_SHARE, "[share] can't send message\n");
-			return CCX_SHARE_FAIL;
-		}
+		ret = _ccx_share_queue(ctx, ctx->entries.messages + i);
 	}
+	// A frame that isn't full waits -sharing-wait ms at most for the next subtitles
+	if (ret == CCX_SHARE_OK && ctx->frame_messages &&
+			share_clock_ms() - ctx->frame_since >= ccx_options.sharing_wait)
+		ret = _ccx_share_flush(ctx);
+	if (ret != CCX_SHARE_OK)
+		dbg_print(CCX_DMT_SHARE, "[share] can't send message\n");
 
-	ccx_sub_entries_cleanup(&entries);
+	ccx_sub_entries_cleanup(&ctx->entries);
+	UNLOCK(&ctx->lock);
 
-	return CCX_SHARE_OK;
+	return ret;
 }
 
-ccx_share_status _ccx_share_send(CcxSubEntryMessage *msg)
+ccx_share_status _ccx_share_flush(ccx_share_service_ctx *ctx)
 {
-	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_send\n");
-	size_t len = ccx_sub_entry_message__get_packed_size(msg);
-	void *buf = malloc(len);
-	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_send: packing\n");
-	ccx_sub_entry_message__pack(msg, buf);
+	if (!ctx->frame_messages)
+		return CCX_SHARE_OK;
+
+	if (ctx->subscribe_until) {
+		LLONG wait = ctx->subscribe_until - share_clock_ms();
+		if (wait > 0)
+			share_sleep_ms(wait);
+		ctx->subscribe_until = 0;
+	}
 
-	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_send: sending\n");
-	int sent = nn_send(ccx_share_ctx.nn_sock, buf, len, 0);
+	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_flush: sending %u messages\n", ctx->frame_messages);
+	int sent = nn_send(ctx->nn_sock, ctx->frame, ctx->frame_len, 0);
+	size_t len = ctx->frame_len;
+	ctx->frame_len = 0;
+	ctx->frame_messages = 0;
 	if (sent != len) {
-		free(buf);
-		dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_send: len=%zd sent=%d\n", len, sent);
+		dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_flush: len=%zd sent=%d\n", len, sent);
 		return CCX_SHARE_FAIL;
 	}
-	free(buf);
-	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_send: sent\n");
+	ctx->sent_frames++;
+	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_flush: sent\n");
 	return CCX_SHARE_OK;
 }
 
-ccx_share_status ccx_share_stream_done(char *stream_name)
+/* Pack msg into the frame of ctx, sending the frame when it is full. With
+ * -sharing-batch n above 1 a frame holds up to n messages, each after its
+ * length as a varint, as protobuf's writeDelimitedTo() does, and may collect
+ * them from several subtitles. Otherwise a frame is a single message, as
+ * subscribers have always had them. */
+ccx_share_status _ccx_share_queue(ccx_share_service_ctx *ctx, CcxSubEntryMessage *msg)
 {
-	CcxSubEntryMessage msg = CCX_SUB_ENTRY_MESSAGE__INIT;
-	msg.eos = 1;
-	msg.stream_name = strdup(stream_name);
-	msg.counter = 0;
-	msg.start_time = 0;
-	msg.end_time = 0;
-	msg.n_lines = 0;
-	msg.lines = NULL;
-
-	if (_ccx_share_send(&msg) != CCX_SHARE_OK) {
-		ccx_sub_entry_msg_cleanup(&msg);
-		dbg_print(CCX_DMT_SHARE, "[share] can't send message\n");
-		return CCX_SHARE_FAIL;
+	int batch = ccx_options.sharing_batch > 1;
+	size_t len = ccx_sub_entry_message__get_packed_size(msg);
+	size_t need = ctx->frame_len + len + (batch ? 5 : 0);
+
+	if (need > ctx->frame_size) {
+		uint8_t *frame = realloc(ctx->frame, need * 2);
+		if (!frame) {
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "In _ccx_share_queue: Out of memory\n");
+		}
+		ctx->frame = frame;
+		ctx->frame_size = need * 2;
 	}
-	ccx_sub_entry_msg_cleanup(&msg);
 
+	if (batch) {
+		uint32_t v = len;
+		while (v >= 0x80) {
+			ctx->frame[ctx->frame_len++] = v | 0x80;
+			v >>= 7;
+		}
+		ctx->frame[ctx->frame_len++] = v;
+	}
+	dbg_print(CCX_DMT_SHARE, "[share] _ccx_share_queue: packing\n");
+	if (!ctx->frame_messages)
+		ctx->frame_since = share_clock_ms();
+	ctx->frame_len += ccx_sub_entry_message__pack(msg, ctx->frame + ctx->frame_len);
+	ctx->frame_messages++;
+	ctx->sent_messages++;
+
+	if (!batch || ctx->frame_messages >= ccx_options.sharing_batch)
+		return _ccx_share_flush(ctx);
 	return CCX_SHARE_OK;
 }
 
-ccx_share_status _ccx_share_sub_to_entries(struct cc_subtitle *sub, ccx_sub_entries *entries)
+ccx_share_status ccx_share_stream_done(char *stream_name)
+{
+	ccx_share_status ret = CCX_SHARE_OK;
+
+	LOCK(&publishers_lock);
+	for (ccx_share_service_ctx *ctx = publishers; ctx; ctx = ctx->next) {
+		CcxSubEntryMessage msg = CCX_SUB_ENTRY_MESSAGE__INIT;
+		msg.eos = 1;
+		msg.stream_name = stream_name;
+		msg.counter = 0;
+		msg.start_time = 0;
+		msg.end_time = 0;
+		msg.n_lines = 0;
+		msg.lines = NULL;
+
+		LOCK(&ctx->lock);
+		if (_ccx_share_queue(ctx, &msg) != CCX_SHARE_OK || _ccx_share_flush(ctx) != CCX_SHARE_OK) {
+			dbg_print(CCX_DMT_SHARE, "[share] can't send message\n");
+			ret = CCX_SHARE_FAIL;
+		}
+		UNLOCK(&ctx->lock);
+	}
+	UNLOCK(&publishers_lock);
+
+	return ret;
+}
+
+ccx_share_status _ccx_share_sub_to_entries(ccx_share_service_ctx *ctx, struct cc_subtitle *sub)
 {
+	ccx_sub_entries *entries = &ctx->entries;
+
 	dbg_print(CCX_DMT_SHARE, "\n[share] _ccx_share_sub_to_entry\n");
 	if (sub->type == CC_608) {
 		dbg_print(CCX_DMT_SHARE, "[share] CC_608\n");
 		struct eia608_screen *data;
 		unsigned int nb_data = sub->nb_data;
+		ccx_sub_entries_reserve(entries, nb_data);
 		for (data = sub->data; nb_data; nb_data--, data++) {
 			dbg_print(CCX_DMT_SHARE, "[share] data item\n");
 			if (data->format == SFORMAT_XDS) {
@@ -203,54 +399,42 @@ ccx_share_status _ccx_share_sub_to_entries(struct cc_subtitle *sub, ccx_sub_entr
 				break;
 			}
 
-			entries->messages = realloc(entries->messages, ++entries->count * sizeof(CcxSubEntryMessage));
-			if (!entries->messages) {
-				fatal(EXIT_NOT_ENOUGH_MEMORY, "In _ccx_share_sub_to_entry: Not enough memory to store sub-entry-messages\n");
-			}
-
-			unsigned int entry_index = entries->count - 1;
+			unsigned int entry_index = entries->count;
 			CcxSubEntryMessage msg = CCX_SUB_ENTRY_MESSAGE__INIT;
-			entries->messages[entry_index] = msg;
+			CcxSubEntryMessage *entry = entries->messages + entry_index;
+			*entry = msg;
 
-			entries->messages[entry_index].n_lines = 0;
+			entry->n_lines = 0;
 			for (int i = 0; i < 15; i++) {
 				if (data->row_used[i]) {
-					entries->messages[entry_index].n_lines++;
+					entry->n_lines++;
 				}
 			}
-			if (!entries->messages[entry_index].n_lines) {// Prevent writing empty screens. Not needed in .srt
+			if (!entry->n_lines) {// Prevent writing empty screens. Not needed in .srt
 				dbg_print(CCX_DMT_SHARE, "[share] buffer is empty\n");
-				dbg_print(CCX_DMT_SHARE, "[share] done\n");
-				return CCX_SHARE_OK;
-			}
-			entries->messages[entry_index].lines = (char **)malloc(entries->messages[entry_index].n_lines * sizeof(char *));
-			if (!entries->messages[entry_index].lines) {
-				fatal(EXIT_NOT_ENOUGH_MEMORY, "In _ccx_share_sub_to_entry: Out of memory for entries->messages[entry_index].lines\n");
+				continue;
 			}
+			entry->lines = entries->lines + entry_index * CCX_SHARE_MAX_LINES;
 
-			dbg_print(CCX_DMT_SHARE, "[share] Copying %u lines\n", entries->messages[entry_index].n_lines);
+			dbg_print(CCX_DMT_SHARE, "[share] Copying %u lines\n", entry->n_lines);
 			int i = 0, j = 0;
 			while (i < 15) {
 				if (data->row_used[i]) {
-					entries->messages[entry_index].lines[j] =
-						(char *)malloc((strnlen((char *)data->characters[i], 32) + 1) * sizeof(char));
-					if (!entries->messages[entry_index].lines[j]) {
-						fatal(EXIT_NOT_ENOUGH_MEMORY,
-                                "In _ccx_share_sub_to_entry: Out of memory for entries->messages[entry_index].lines[j]\n");
-					}
-					strncpy(entries->messages[entry_index].lines[j], (char *)data->characters[i], 32);
-					entries->messages[entry_index].lines[j][strnlen((char *)data->characters[i], 32)] = '\0';
-					dbg_print(CCX_DMT_SHARE, "[share] line (len=%zd): %s\n",
-						strlen(entries->messages[entry_index].lines[j]),
-						entries->messages[entry_index].lines[j]);
+					size_t len = strnlen((char *)data->characters[i], 32);
+					entry->lines[j] = entries->text + (entry_index * CCX_SHARE_MAX_LINES + j) * CCX_SHARE_LINE_SIZE;
+					memcpy(entry->lines[j], data->characters[i], len);
+					entry->lines[j][len] = '\0';
+					dbg_print(CCX_DMT_SHARE, "[share] line (len=%zd): %s\n", len, entry->lines[j]);
 					j++;
 				}
 				i++;
 			}
-			entries->messages[entry_index].eos = 0;
-			entries->messages[entry_index].start_time = data->start_time;
-			entries->messages[entry_index].end_time = data->end_time;
-			entries->messages[entry_index].counter = ++ccx_share_ctx.counter;
+			entry->eos = 0;
+			entry->stream_name = ctx->stream_name;
+			entry->start_time = data->start_time;
+			entry->end_time = data->end_time;
+			entry->counter = ++ctx->counter;
+			entries->count++;
 			dbg_print(CCX_DMT_SHARE, "[share] item done\n");
 		}
 	}
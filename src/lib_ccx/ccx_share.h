@@ -12,39 +12,64 @@
 
 #ifdef ENABLE_SHARING
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 typedef struct _ccx_sub_entries {
 	CcxSubEntryMessage *messages;
 	unsigned int count;
+	unsigned int capacity; // Messages allocated, kept from a subtitle to the next
+	char **lines;          // CCX_SHARE_MAX_LINES per message
+	char *text;            // CCX_SHARE_MAX_LINES lines of CCX_SHARE_LINE_SIZE per message
 } ccx_sub_entries;
 
+#define CCX_SHARE_MAX_LINES 15
+#define CCX_SHARE_LINE_SIZE 33
+
+/* A publishing socket. There is one for all the programs, or one per program
+ * when the sharing url has a %d for the program number. */
 typedef struct _ccx_share_service_ctx {
 	LLONG counter;
 	char *stream_name;
 	int nn_sock;
 	int nn_binder;
+	int program_number;      // -1 for the socket of all the programs
+	LLONG subscribe_until;   // The first message waits until then for subscribers, in ms
+	ccx_sub_entries entries; // Reused from a subtitle to the next
+	uint8_t *frame;          // Messages packed for the next nn_send(), reused
+	size_t frame_size;
+	size_t frame_len;
+	unsigned int frame_messages;
+	LLONG frame_since;       // When the first message of the frame was packed, in ms
+	unsigned long sent_frames;
+	unsigned long sent_messages;
+#ifndef _WIN32
+	pthread_mutex_t lock;    // Programs decoded by threads of their own can share it
+#endif
+	struct _ccx_share_service_ctx *next;
 } ccx_share_service_ctx;
 
-extern ccx_share_service_ctx ccx_share_ctx;
-
 typedef enum _ccx_share_status {
 	CCX_SHARE_OK = 0,
 	CCX_SHARE_FAIL
 } ccx_share_status;
 
-void ccx_sub_entry_message_cleanup(CcxSubEntryMessage *);
-void ccx_sub_entry_message_print(CcxSubEntryMessage *);
+void ccx_sub_entry_msg_print(CcxSubEntryMessage *);
 
 void ccx_sub_entries_init(ccx_sub_entries *);
 void ccx_sub_entries_cleanup(ccx_sub_entries *);
+void ccx_sub_entries_free(ccx_sub_entries *);
 void ccx_sub_entries_print(ccx_sub_entries *);
 
 ccx_share_status ccx_share_launch_translator(char *langs, char *google_api_key);
 ccx_share_status ccx_share_start(const char *);
 ccx_share_status ccx_share_stop();
-ccx_share_status ccx_share_send(struct cc_subtitle *);
+ccx_share_status ccx_share_send(struct cc_subtitle *, int program_number);
 ccx_share_status ccx_share_stream_done(char *);
-ccx_share_status _ccx_share_sub_to_entries(struct cc_subtitle *, ccx_sub_entries *);
-ccx_share_status _ccx_share_send(CcxSubEntryMessage *);
+ccx_share_status _ccx_share_sub_to_entries(ccx_share_service_ctx *, struct cc_subtitle *);
+ccx_share_status _ccx_share_queue(ccx_share_service_ctx *, CcxSubEntryMessage *);
+ccx_share_status _ccx_share_flush(ccx_share_service_ctx *);
 
 #endif //ENABLE_SHARING
 
@@ -0,0 +1,12 @@
+/*
+ * the configured options and settings for CCExtractor
+ */
+
+#ifndef CCX_CCEXTRACTOR_COMPILE_REAL_H
+#define CCX_CCEXTRACTOR_COMPILE_REAL_H
+#define GIT_COMMIT "8fde306cd4aef037e3e60d36c110faf902de1038"
+#define COMPILE_DATE "2026-10-17"
+#endif
+
+#define CCExtractor_VERSION_MAJOR "0"
+#define CCExtractor_VERSION_MINOR "85b"
@@ -45,6 +45,7 @@ static int set_int(void *var, char*val)
 struct conf_map configuration_map[] = {
 	{"INPUT_SOURCE",offsetof(struct ccx_s_options,input_source),set_int},
 	{"BUFFER_INPUT",offsetof(struct ccx_s_options,buffer_input),set_int},
+	{"MMAP_INPUT",offsetof(struct ccx_s_options,mmap_input),set_int},
 	{"NOFONT_COLOR",offsetof(struct ccx_s_options,nofontcolor),set_int},
 	{"NOTYPE_SETTING",offsetof(struct ccx_s_options,notypesetting),set_int},
 	{"OUTPUT_FORMAT",offsetof(struct ccx_s_options,write_format),set_int},
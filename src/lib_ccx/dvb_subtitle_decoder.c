@@ -1537,6 +1537,10 @@ static int write_dvb_sub(struct lib_cc_decode *dec_ctx, struct cc_subtitle *sub)
 		return -1;
 	rect->data0=NULL;
 	rect->data1=NULL;
+#ifdef ENABLE_OCR
+	rect->ocr_text = NULL;
+	rect->ocr_job = NULL;
+#endif
 
 	sub->flags |= SUB_EOD_MARKER;
 	sub->got_output = 1;
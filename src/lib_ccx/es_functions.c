@@ -1,6 +1,7 @@
 #include "lib_ccx.h"
 #include "ccx_common_option.h"
 #include "activity.h"
+#include "start_code.h"
 
 // Functions to parse a mpeg-2 data stream, see ISO/IEC 13818-2 6.2
 static uint8_t search_start_code(struct bitstream *esstream);
@@ -18,7 +19,7 @@ static int read_eau_info(struct lib_cc_decode* ctx, struct bitstream *esstream,
 static int extension_and_user_data(struct lib_cc_decode *ctx, struct bitstream *esstream, int udtype, struct cc_subtitle *sub);
 static int read_pic_data(struct bitstream *esstream);
 
-#define debug( ... ) ccx_common_logging.debug_ftn( CCX_DMT_VERBOSE, __VA_ARGS__)
+#define debug( ... ) ccx_debug( CCX_DMT_VERBOSE, __VA_ARGS__)
 /* Process a mpeg-2 data stream with "lenght" bytes in buffer "data".
  * The number of processed bytes is returned.
  * Defined in ISO/IEC 13818-2 6.2 */
@@ -61,36 +62,29 @@ static uint8_t search_start_code(struct bitstream *esstream)
 		return 0xB4;
 	}
 
-	unsigned char *tstr = esstream->pos;
-
-	// Scan for 0x000001xx in header
-	while(1)
+	// Scan for 0x000001xx in header, the start code value byte included
+	unsigned char *tstr = (unsigned char *) find_start_code(esstream->pos, esstream->end - 1);
+	if (tstr)
 	{
-		// The loop is exited by break only, and if tstr+3 is less than
-		// esstream->end we found the start code prefix
-		tstr = (unsigned char *) memchr(tstr, 0x00,
-				esstream->end - tstr);
-		if (tstr==NULL)
-		{
-			// We don't even have the starting 0x00
-			tstr = esstream->end;
-			esstream->bitsleft = -8*4;
-			break;
-		}
-		else if (tstr+3 >= esstream->end)
+		// Found 0x000001??
+		esstream->bitsleft = 8*(esstream->end-(tstr+4));
+	}
+	else
+	{
+		// Not enough bytes left to check for 0x000001??, continue from
+		// the first 0x00 of the last three bytes
+		tstr = esstream->end - 3 > esstream->pos ? esstream->end - 3 : esstream->pos;
+		tstr = (unsigned char *) memchr(tstr, 0x00, esstream->end - tstr);
+		if (tstr)
 		{
-			// Not enough bytes left to check for 0x000001??
 			esstream->bitsleft = 8*(esstream->end-(tstr+4));
-			break;
 		}
-		else if (tstr[1]==0x00 && tstr[2]==0x01)
+		else
 		{
-			// Found 0x000001??
-			esstream->bitsleft = 8*(esstream->end-(tstr+4));
-			break;
+			// We don't even have the starting 0x00
+			tstr = esstream->end;
+			esstream->bitsleft = -8*4;
 		}
-		// Keep searching
-		tstr++;
 	}
 	esstream->pos = tstr;
 	if (esstream->bitsleft < 0)
@@ -174,7 +168,7 @@ static int es_video_sequence(struct lib_cc_decode *ctx, struct bitstream *esstre
 {
 	// Avoid "Skip forward" message on first call and later only
 	// once per search.
-	static int noskipmessage = 1;
+	static CCX_THREAD_LOCAL int noskipmessage = 1;
 	uint8_t startcode;
 
 	debug("es_video_sequence()\n");
@@ -283,7 +283,7 @@ int user_data(struct lib_cc_decode *ctx, struct bitstream *ustream, int udtype,
 		// To process this with the HDTV framework we create a "HDTV" caption
 		// format compatible array. Two times 3 bytes plus one for the 0xFF
 		// marker at the end. Pre-init to field 1 and set the 0xFF marker.
-		static unsigned char dishdata[7] = {0x04, 0, 0, 0x04, 0, 0, 0xFF};
+		static CCX_THREAD_LOCAL unsigned char dishdata[7] = {0x04, 0, 0, 0x04, 0, 0, 0xFF};
 		int cc_count;
 
 		dbg_print(CCX_DMT_VERBOSE, "Reading Dish Network user data\n");
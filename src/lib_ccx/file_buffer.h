@@ -17,6 +17,13 @@
  */
 size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t bytes);
 
+/**
+ * Slide the memory mapped window so that bytes starting at the current
+ * position are contiguous, and return a pointer to them. Only for use by
+ * buffered_peek().
+ */
+unsigned char *buffered_peek_mmap(struct ccx_demuxer *ctx, size_t bytes, size_t *avail);
+
 
 /**
  * Skip bytes from file buffer and if needed also seek file for number of bytes.
@@ -37,6 +44,15 @@ static size_t inline  buffered_skip(struct ccx_demuxer *ctx, unsigned int bytes)
 	return result;
 }
 
+/**
+ * Skip bytes, also more than buffered_skip() takes. Anything but a file is
+ * read and dropped: a pipe can't be seeked once the bytes read for the
+ * stream detection are used up.
+ *
+ * @return the number of bytes skipped, less than bytes at end of input.
+ */
+uint64_t buffered_skip_long(struct ccx_demuxer *ctx, uint64_t bytes);
+
 /**
  * Read bytes from file buffer and if needed also read file for number of bytes.
  *
@@ -64,6 +80,43 @@ static size_t inline buffered_read(struct ccx_demuxer *ctx, unsigned char *buffe
 	return result;
 }
 
+/**
+ * Zero copy peek: return a pointer to the next bytes of input in the file buffer
+ * without consuming them. The pointer is only valid until the next read from ctx.
+ *
+ * @param avail set to the number of bytes available contiguously at the pointer,
+ *              at most bytes. With memory mapped input that is only less than
+ *              bytes near end of file, otherwise it depends on what is buffered
+ *              and can be 0.
+ */
+static inline unsigned char *buffered_peek(struct ccx_demuxer *ctx, size_t bytes, size_t *avail)
+{
+	if (ctx->filebuffer_mmapped)
+		return buffered_peek_mmap(ctx, bytes, avail);
+	*avail = ctx->bytesinbuffer - ctx->filebuffer_pos;
+	if (*avail > bytes)
+		*avail = bytes;
+	return ctx->filebuffer + ctx->filebuffer_pos;
+}
+
+/**
+ * Zero copy read: return a pointer to the next bytes of input in the file buffer
+ * and skip past them. The pointer is only valid until the next read from ctx.
+ *
+ * @return NULL if the bytes are not available contiguously in the buffer (always
+ *         possible with memory mapped input, except at end of file). Nothing is
+ *         consumed in that case and the caller should fall back to buffered_read().
+ */
+static inline unsigned char *buffered_read_ptr(struct ccx_demuxer *ctx, size_t bytes)
+{
+	size_t avail;
+	unsigned char *ptr = buffered_peek(ctx, bytes, &avail);
+	if (avail < bytes)
+		return NULL;
+	ctx->filebuffer_pos += bytes;
+	return ptr;
+}
+
 /**
  * Read single byte from file buffer and if needed also read file for number of bytes.
  *
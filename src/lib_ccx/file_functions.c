@@ -2,6 +2,11 @@
 #include "ccx_common_option.h"
 #include "activity.h"
 #include "file_buffer.h"
+#include "ccx_metrics.h"
+#include "program_pipeline.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 long FILEBUFFERSIZE = 1024*1024*16; // 16 Mbytes no less. Minimize number of real read calls()
 
 #ifdef _WIN32
@@ -61,8 +66,22 @@ LLONG get_total_file_size (struct lib_ccx_ctx *ctx) // -1 if one or more files f
 	return ts;
 }
 
+/* Per file timing, in the thread the decoder runs in, see program_pipeline_call() */
+static void reset_file_timing(struct lib_cc_decode *dec_ctx, void *arg)
+{
+	total_frames_count          = 0;
+	frames_since_ref_time       = 0;
+	gop_time.inited             = 0;
+	first_gop_time.inited       = 0;
+	gop_rollover                = 0;
+	printed_gop.inited          = 0;
+	pts_big_change              = 0;
+}
+
 void prepare_for_new_file (struct lib_ccx_ctx *ctx)
 {
+	struct lib_cc_decode *dec_ctx;
+
 	// Init per file variables
 	ctx->last_reported_progress =-1;
 	ctx->stat_numuserheaders    = 0;
@@ -73,30 +92,29 @@ void prepare_for_new_file (struct lib_ccx_ctx *ctx)
 	ctx->stat_dishheaders       = 0;
 	ctx->stat_hdtv              = 0;
 	ctx->stat_divicom           = 0;
-	total_frames_count          = 0;
 	ctx->false_pict_header      = 0;
-	frames_since_ref_time       = 0;
-	gop_time.inited             = 0;
-	first_gop_time.inited       = 0;
-	gop_rollover                = 0;
-	printed_gop.inited          = 0;
-	pts_big_change              = 0;
 	firstcall                   = 1;
+	reset_file_timing(NULL, NULL);
+	if (ctx->pipeline)
+	{
+		list_for_each_entry(dec_ctx, &ctx->dec_ctx_head, list, struct lib_cc_decode)
+			program_pipeline_call(ctx->pipeline, dec_ctx, reset_file_timing, NULL);
+	}
 
 	if(ctx->epg_inited)
 	{
-		for(int x = 0; x < 0xfff; x++)
-		{
-			ctx->epg_buffers[x].buffer   = NULL;
-			ctx->epg_buffers[x].ccounter = 0;
-		}
+		EPG_compact_output(ctx);
+		for(int x = 0; x <= 0xfff; x++)
+			psi_buffer_reset(&ctx->epg_buffers[x]);
 		for (int i = 0; i < TS_PMT_MAP_SIZE; i++)
 		{
 			ctx->eit_programs[i].array_len = 0;
+			memset(ctx->eit_programs[i].id_hash, 0, sizeof(ctx->eit_programs[i].id_hash));
 			ctx->eit_current_events[i] = -1;
 		}
 		ctx->epg_last_output      = -1;
 		ctx->epg_last_live_output = -1;
+		ctx->epg_written          = 0;
 	}
 }
 
@@ -186,7 +204,7 @@ int switch_to_next_file (struct lib_ccx_ctx *ctx, LLONG bytesinbuffer)
 void position_sanity_check(struct ccx_demuxer *ctx)
 {
 #ifdef SANITY_CHECK
-	if (ctx->infd!=-1)
+	if (ctx->infd!=-1 && !ctx->filebuffer_mmapped) // The file offset doesn't move when mapped
 	{
 		LLONG realpos = LSEEK (ctx->infd,0,SEEK_CUR);
 		if (realpos == -1) // Happens for example when infd==stdin.
@@ -216,10 +234,226 @@ int init_file_buffer(struct ccx_demuxer *ctx)
 	return 0;
 }
 
+#ifndef _WIN32
+/* Map the window of the input file that contains file position pos. A few
+   bytes before pos are kept in the window so we have a guaranteed working
+   seek (-8), same as the read() based buffer - needed by mythtv. */
+static int mmap_window_at(struct ccx_demuxer *ctx, LLONG pos)
+{
+	LLONG page = sysconf(_SC_PAGESIZE);
+	LLONG keep = pos > 8 ? 8 : pos;
+	LLONG start = (pos - keep) & ~(page - 1);
+	size_t len;
+	void *window;
+
+	if (pos < 0 || pos > ctx->mmap_filesize)
+		return -1;
+
+	len = ctx->mmap_window_size;
+	if (ctx->mmap_filesize - start < (LLONG) len)
+		len = (size_t) (ctx->mmap_filesize - start);
+
+	if (ctx->filebuffer != NULL)
+		munmap(ctx->filebuffer, ctx->bytesinbuffer);
+	ctx->filebuffer = NULL;
+
+	// Private and writable so return_to_buffer() and anyone else patching
+	// the data in place get copy-on-write pages instead of a SIGSEGV.
+	window = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, ctx->infd, start);
+	if (window == MAP_FAILED)
+	{
+		ctx->bytesinbuffer = 0;
+		ctx->filebuffer_pos = 0;
+		return -1;
+	}
+	madvise(window, len, MADV_SEQUENTIAL);
+
+	ctx->filebuffer       = (unsigned char *) window;
+	ctx->filebuffer_start = start;
+	ctx->filebuffer_pos   = (unsigned int) (pos - start);
+	ctx->bytesinbuffer    = (unsigned int) len;
+	return 0;
+}
+#endif
+
+/* Switch the file buffer to a memory mapping of the (already open) input
+   file. Returns 0 on success, or -1 if the input can't be mapped, in which
+   case the normal read() based buffer is left in place. */
+int init_file_mmap(struct ccx_demuxer *ctx)
+{
+#ifdef _WIN32
+	return -1;
+#else
+	LLONG page = sysconf(_SC_PAGESIZE);
+	LLONG size;
+	LLONG window;
+
+	// Growing files and pipes can't be mapped in advance
+	if (ccx_options.input_source != CCX_DS_FILE || ccx_options.live_stream)
+		return -1;
+
+	size = get_file_size(ctx->infd);
+	if (size <= 0)
+		return -1;
+
+	// The window must be able to hold the whole start buffer so that
+	// return_to_buffer() after stream detection is just a pointer move.
+	window = FILEBUFFERSIZE > STARTBYTESLENGTH ? FILEBUFFERSIZE : STARTBYTESLENGTH;
+	window = (window + 2 * page - 1) & ~(page - 1);
+
+	if (!ctx->filebuffer_mmapped)
+		freep(&ctx->filebuffer);
+	ctx->filebuffer_mmapped = 1;
+	ctx->mmap_filesize = size;
+	ctx->mmap_window_size = (size_t) window;
+	if (mmap_window_at(ctx, 0) < 0)
+	{
+		mprint("\rUnable to memory map input file (%s), reading it instead.\n", strerror(errno));
+		ctx->filebuffer_mmapped = 0;
+		ctx->filebuffer = NULL;
+		init_file_buffer(ctx);
+		return -1;
+	}
+	return 0;
+#endif
+}
+
+void close_file_mmap(struct ccx_demuxer *ctx)
+{
+#ifndef _WIN32
+	if (!ctx->filebuffer_mmapped)
+		return;
+	if (ctx->filebuffer != NULL)
+		munmap(ctx->filebuffer, ctx->bytesinbuffer);
+	ctx->filebuffer         = NULL;
+	ctx->filebuffer_start   = 0;
+	ctx->filebuffer_pos     = 0;
+	ctx->bytesinbuffer      = 0;
+	ctx->filebuffer_mmapped = 0;
+#endif
+}
+
+/* Memory mapped version of buffered_read_opt(). Reads are a single memcpy
+   from the mapping and skips only move the window. */
+static size_t buffered_read_mmap(struct ccx_demuxer *ctx, unsigned char *buffer, size_t bytes)
+{
+	size_t origin_buffer_size = bytes;
+	size_t copied = 0;
+#ifndef _WIN32
+	while (bytes)
+	{
+		size_t ready = ctx->bytesinbuffer - ctx->filebuffer_pos;
+		LLONG pos = ctx->filebuffer_start + ctx->filebuffer_pos;
+
+		if (terminate_asap)
+			break;
+		if (buffer == NULL && bytes > ready)
+		{
+			// Skipping: no need to map anything in between
+			LLONG target = pos + bytes;
+			if (target > ctx->mmap_filesize)
+				target = ctx->mmap_filesize;
+			if (mmap_window_at(ctx, target) < 0)
+				fatal (EXIT_READ_ERROR, "Error mapping input file!\n");
+			copied += (size_t) (target - pos);
+			bytes  -= (size_t) (target - pos);
+			if (!bytes)
+				break;
+		}
+		else if (ready)
+		{
+			size_t copy = ready >= bytes ? bytes : ready;
+			if (buffer != NULL)
+			{
+				memcpy (buffer, ctx->filebuffer + ctx->filebuffer_pos, copy);
+				buffer += copy;
+			}
+			ctx->filebuffer_pos += copy;
+			bytes  -= copy;
+			copied += copy;
+			continue;
+		}
+
+		pos = ctx->filebuffer_start + ctx->filebuffer_pos;
+		if (pos < ctx->mmap_filesize)
+		{
+			if (mmap_window_at(ctx, pos) < 0)
+				fatal (EXIT_READ_ERROR, "Error mapping input file!\n");
+			continue;
+		}
+		// End of file. Same as the buffered read, a request bigger than the
+		// whole file (stream detection) doesn't switch to the next one.
+		if (((struct lib_ccx_ctx *)ctx->parent)->inputsize <= origin_buffer_size ||
+				!(ccx_options.binary_concat && switch_to_next_file(ctx->parent, copied)))
+			break;
+		if (!ctx->filebuffer_mmapped) // Next file couldn't be mapped
+			return copied + buffered_read_opt (ctx, buffer, bytes);
+	}
+#endif
+	return copied;
+}
+
+unsigned char *buffered_peek_mmap(struct ccx_demuxer *ctx, size_t bytes, size_t *avail)
+{
+#ifndef _WIN32
+	LLONG pos = ctx->filebuffer_start + ctx->filebuffer_pos;
+	LLONG window_end = ctx->filebuffer_start + ctx->bytesinbuffer;
+
+	if (bytes > ctx->mmap_window_size / 2)
+		bytes = ctx->mmap_window_size / 2;
+	if (pos + (LLONG) bytes > window_end && window_end < ctx->mmap_filesize)
+	{
+		if (mmap_window_at(ctx, pos) < 0)
+			fatal (EXIT_READ_ERROR, "Error mapping input file!\n");
+	}
+	*avail = ctx->bytesinbuffer - ctx->filebuffer_pos;
+	if (*avail > bytes)
+		*avail = bytes;
+	return ctx->filebuffer + ctx->filebuffer_pos;
+#else
+	*avail = 0;
+	return NULL;
+#endif
+}
+
+uint64_t buffered_skip_long(struct ccx_demuxer *ctx, uint64_t bytes)
+{
+	unsigned char drop[16384];
+	int seekable = ccx_options.input_source == CCX_DS_FILE;
+	uint64_t skipped = 0;
+
+	while (skipped < bytes)
+	{
+		unsigned int max = seekable ? (1u << 30) : sizeof(drop);
+		unsigned int step = bytes - skipped > max ? max : (unsigned int) (bytes - skipped);
+		size_t ret = seekable ? buffered_skip(ctx, step) : buffered_read(ctx, drop, step);
+		skipped += ret;
+		if (ret < step)
+			break;
+	}
+	return skipped;
+}
+
 void buffered_seek (struct ccx_demuxer *ctx, int offset)
 {
 	position_sanity_check(ctx);
-	if (offset < 0)
+	if (offset < 0 && ctx->filebuffer_mmapped)
+	{
+		// Whole file is available, just move back in it
+		LLONG pos = ctx->filebuffer_start + ctx->filebuffer_pos + offset;
+		if (pos < 0)
+			fatal (CCX_COMMON_EXIT_BUG_BUG, "PANIC: Attempt to seek before file start, this is a bug!");
+#ifndef _WIN32
+		if (pos < ctx->filebuffer_start)
+		{
+			if (mmap_window_at(ctx, pos) < 0)
+				fatal (EXIT_READ_ERROR, "Error mapping input file!\n");
+		}
+		else
+#endif
+			ctx->filebuffer_pos += offset;
+	}
+	else if (offset < 0)
 	{
 		ctx->filebuffer_pos += offset;
 		if (ctx->filebuffer_pos < 0)
@@ -264,6 +498,26 @@ void sleepandchecktimeout (time_t start)
 
 void return_to_buffer (struct ccx_demuxer *ctx, unsigned char *buffer, unsigned int bytes)
 {
+	if (ctx->filebuffer_mmapped)
+	{
+		// The bytes came from the mapping, so going back is just moving the
+		// position. We only copy if the caller changed them.
+		LLONG pos = ctx->filebuffer_start + ctx->filebuffer_pos - bytes;
+		if (pos < 0)
+			fatal (CCX_COMMON_EXIT_BUG_BUG, "Invalid return_to_buffer() - please submit a bug report.");
+#ifndef _WIN32
+		if (pos < ctx->filebuffer_start)
+		{
+			if (mmap_window_at(ctx, pos) < 0)
+				fatal (EXIT_READ_ERROR, "Error mapping input file!\n");
+		}
+		else
+#endif
+			ctx->filebuffer_pos -= bytes;
+		if (memcmp (ctx->filebuffer + ctx->filebuffer_pos, buffer, bytes))
+			memcpy (ctx->filebuffer + ctx->filebuffer_pos, buffer, bytes);
+		return;
+	}
 	if (bytes == ctx->filebuffer_pos)
 	{
 		// Usually we're just going back in the buffer and memcpy would be
@@ -301,7 +555,7 @@ void return_to_buffer (struct ccx_demuxer *ctx, unsigned char *buffer, unsigned
  *
  * TODO instead of using global ccx_options move them to ccx_demuxer
  */
-size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t bytes)
+static size_t buffered_read_input (struct ccx_demuxer *ctx, unsigned char *buffer, size_t bytes)
 {
 	size_t origin_buffer_size = bytes;
 	size_t copied   = 0;
@@ -309,6 +563,9 @@ size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t
 
 	position_sanity_check(ctx);
 
+	if (ctx->filebuffer_mmapped)
+		return buffered_read_mmap(ctx, buffer, bytes);
+
 	if (ccx_options.live_stream > 0)
 		time (&seconds);
 
@@ -390,6 +647,8 @@ size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t
 					i = read (ctx->infd, ctx->filebuffer + keep, FILEBUFFERSIZE-keep);
 				else if (ccx_options.input_source == CCX_DS_TCP)
 					i = net_tcp_read(ctx->infd, (char *) ctx->filebuffer + keep, FILEBUFFERSIZE - keep);
+				else if (ctx->udp_receiver)
+					i = udp_receiver_read(ctx->udp_receiver, ctx->filebuffer + keep, FILEBUFFERSIZE - keep);
 				else
 					i = recvfrom(ctx->infd,(char *) ctx->filebuffer + keep, FILEBUFFERSIZE - keep, 0, NULL, NULL);
 				if (terminate_asap) /* Looks like receiving a signal here will trigger a -1, so check that first */
@@ -482,6 +741,16 @@ size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t
 	return copied;
 }
 
+size_t buffered_read_opt (struct ccx_demuxer *ctx, unsigned char *buffer, size_t bytes)
+{
+	size_t copied;
+
+	ccx_metrics_enter(CCX_STAGE_READ);
+	copied = buffered_read_input(ctx, buffer, bytes);
+	ccx_metrics_leave(copied);
+	return copied;
+}
+
 uint16_t buffered_get_be16(struct ccx_demuxer *ctx)
 {
 	unsigned char a,b;
@@ -8,6 +8,7 @@
 
 #include "dvb_subtitle_decoder.h"
 #include "ccx_encoders_common.h"
+#include "program_pipeline.h"
 #include "activity.h"
 #include "utility.h"
 #include "ccx_demuxer.h"
@@ -17,6 +18,7 @@
 #include "ccx_gxf.h"
 #include "dvd_subtitle_decoder.h"
 #include "ccx_demuxer_mxf.h"
+#include "ccx_metrics.h"
 
 
 int end_of_file=0; // End of file?
@@ -624,6 +626,7 @@ size_t process_raw(struct lib_cc_decode *ctx, struct cc_subtitle *sub, unsigned
 void delete_datalist(struct demuxer_data *list)
 {
 	struct demuxer_data *slist = list;
+	struct demuxer_data_index *index = list ? list->index : NULL;
 
 	while(list)
 	{
@@ -632,12 +635,17 @@ void delete_datalist(struct demuxer_data *list)
 		delete_demuxer_data(slist);
 
 	}
+	if (index)
+	{
+		delete_datalist(index->pool);
+		free(index);
+	}
 }
 int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, struct demuxer_data *data_node)
 {
 	size_t got; // Means 'consumed' from buffer actually
 	int ret = 0;
-	static LLONG last_pts = 0x01FFFFFFFFLL;
+	static CCX_THREAD_LOCAL LLONG last_pts = 0x01FFFFFFFFLL;
 	struct cc_subtitle *dec_sub = &dec_ctx->dec_sub;
 
 	if (dec_ctx->hauppauge_mode)
@@ -648,7 +656,9 @@ int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, str
 	}
 	else if(data_node->bufferdatatype == CCX_DVB_SUBTITLE)
 	{
+		ccx_metrics_enter(CCX_STAGE_DECODE_DVB);
 		ret=dvbsub_decode(enc_ctx, dec_ctx, data_node->buffer + 2, data_node->len - 2, dec_sub);
+		ccx_metrics_leave(data_node->len);
 		if (ret<0)
 			mprint ("Return from dvbsub_decode: %d\n", ret);
 		set_fts(dec_ctx->timing);
@@ -657,7 +667,9 @@ int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, str
 	else if (data_node->bufferdatatype == CCX_PES)
 	{
 		dec_ctx->in_bufferdatatype = CCX_PES;
+		ccx_metrics_enter(CCX_STAGE_VIDEO);
 		got = process_m2v (dec_ctx, data_node->buffer, data_node->len, dec_sub);
+		ccx_metrics_leave(data_node->len);
 	}
 	else if (data_node->bufferdatatype == CCX_DVD_SUBTITLE)
 	{
@@ -666,14 +678,18 @@ int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, str
 			dec_ctx->private_data = init_dvdsub_decode();
 			dec_ctx->is_alloc = 1;
 		}
+		ccx_metrics_enter(CCX_STAGE_DECODE_DVD);
 		process_spu (dec_ctx, data_node->buffer, data_node->len, dec_sub);
+		ccx_metrics_leave(data_node->len);
 		got = data_node->len;
 	}
 	else if (data_node->bufferdatatype == CCX_TELETEXT)
 	{
 		//telxcc_update_gt(dec_ctx->private_data, ctx->demux_ctx->global_timestamp);
 		if (enc_ctx) {
+			ccx_metrics_enter(CCX_STAGE_DECODE_TELETEXT);
 			ret = tlt_process_pes_packet(dec_ctx, data_node->buffer, data_node->len, dec_sub, enc_ctx->sentence_cap);
+			ccx_metrics_leave(data_node->len);
 			if (ret == CCX_EINVAL)
 				return ret;
 		}
@@ -724,7 +740,9 @@ int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, str
 	else if (data_node->bufferdatatype == CCX_H264) // H.264 data from TS file
 	{
 		dec_ctx->in_bufferdatatype = CCX_H264;
+		ccx_metrics_enter(CCX_STAGE_VIDEO);
 		got = process_avc(dec_ctx, data_node->buffer, data_node->len, dec_sub);
+		ccx_metrics_leave(data_node->len);
 	}
 	else if (data_node->bufferdatatype == CCX_RAW_TYPE)
 	{
@@ -732,7 +750,9 @@ int process_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, str
 	}
 	else if (data_node->bufferdatatype == CCX_ISDB_SUBTITLE)
 	{
+		ccx_metrics_enter(CCX_STAGE_DECODE_ISDB);
 		isdbsub_decode(dec_ctx, data_node->buffer, data_node->len, dec_sub);
+		ccx_metrics_leave(data_node->len);
 		got = data_node->len;
 	}
 	else
@@ -839,6 +859,107 @@ void segment_output_file(struct lib_ccx_ctx *ctx, struct lib_cc_decode *dec_ctx)
 	}
 }
 
+/* Min PTS of the streams a program's subtitles are synced with, UINT64_MAX until known */
+static void get_program_min_pts(struct ccx_demuxer *demux_ctx, int program_number,
+		uint64_t *private1_min_pts, uint64_t *audio_min_pts)
+{
+	int p_index = 0; //program index
+	for (int i = 0; i < demux_ctx->nb_program; i++)
+	{
+		if (program_number == demux_ctx->pinfo[i].program_number)
+		{
+			p_index = i;
+			break;
+		}
+	}
+	*private1_min_pts = demux_ctx->pinfo[p_index].got_important_streams_min_pts[PRIVATE_STREAM_1];
+	*audio_min_pts = demux_ctx->pinfo[p_index].got_important_streams_min_pts[AUDIO];
+}
+
+/**
+ * Decode data_node (can be NULL) for one program of a -multiprogram run,
+ * from general_loop() or the program's worker thread with -programthreads.
+ * Return 1 if captions were found.
+ */
+int process_program_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, struct demuxer_data *data_node,
+		uint64_t private1_min_pts, uint64_t audio_min_pts, int last)
+{
+	uint64_t min_pts;
+	int caps = 0;
+	int ret;
+
+	dec_ctx->dtvcc->encoder = (void *)enc_ctx; //WARN: otherwise cea-708 will not work
+	
+	if (dec_ctx->timing->min_pts == 0x01FFFFFFFFLL) //if we didn't set the min_pts of the program
+	{
+		if (dec_ctx->codec == CCX_CODEC_TELETEXT) //even if there's no sub data, we still need to set the min_pts
+		{
+			if (private1_min_pts != UINT64_MAX) //Teletext is synced with subtitle packet PTS
+			{
+				min_pts = private1_min_pts; //it means we got the first pts for private stream 1
+				set_current_pts(dec_ctx->timing, min_pts);
+				set_fts(dec_ctx->timing);
+			}
+		}
+		if (dec_ctx->codec == CCX_CODEC_DVB) //DVB will always have to be in sync with audio (no matter the min_pts of the other streams)
+		{
+			if (audio_min_pts != UINT64_MAX) //it means we got the first pts for audio
+			{
+				min_pts = audio_min_pts;
+				set_current_pts(dec_ctx->timing, min_pts);
+				set_fts(dec_ctx->timing);
+			}
+		}
+	}
+
+	if (enc_ctx)
+		enc_ctx->timing = dec_ctx->timing;
+
+	if (!data_node)
+		return 0;
+	
+	if(data_node->pts != CCX_NOPTS)
+		set_current_pts(dec_ctx->timing, data_node->pts);
+
+	ret = process_data(enc_ctx, dec_ctx, data_node);
+	if (
+		(enc_ctx && (enc_ctx->srt_counter || enc_ctx->cea_708_counter) ||
+			dec_ctx->saw_caption_block || ret == 1)
+		)
+		caps = 1;
+	// Process the last subtitle for DVB
+	if (last) {
+		if (data_node->bufferdatatype == CCX_DVB_SUBTITLE && dec_ctx && dec_ctx->dec_sub.prev && dec_ctx->dec_sub.prev->end_time == 0) {
+			dec_ctx->dec_sub.prev->end_time = (dec_ctx->timing->current_pts - dec_ctx->timing->min_pts) / (MPEG_CLOCK_FREQ / 1000);
+			encode_sub(enc_ctx->prev, dec_ctx->dec_sub.prev);
+			dec_ctx->dec_sub.prev->got_output = 0;
+		}
+	}
+	return caps;
+}
+
+/* Output whatever the decoder still holds at the end of the input */
+void flush_decoder(struct lib_cc_decode *dec_ctx)
+{
+	if (dec_ctx->codec == CCX_CODEC_TELETEXT)
+		telxcc_close(&dec_ctx->private_data, &dec_ctx->dec_sub);
+	// Flush remaining HD captions
+	if (dec_ctx->has_ccdata_buffered)
+				process_hdcc(dec_ctx, &dec_ctx->dec_sub);
+
+	mprint ("\nNumber of NAL_type_7: %ld\n",dec_ctx->avc_ctx->num_nal_unit_type_7);
+	mprint ("Number of VCL_HRD: %ld\n",dec_ctx->avc_ctx->num_vcl_hrd);
+	mprint ("Number of NAL HRD: %ld\n",dec_ctx->avc_ctx->num_nal_hrd);
+	mprint ("Number of jump-in-frames: %ld\n",dec_ctx->avc_ctx->num_jump_in_frames);
+	mprint ("Number of num_unexpected_sei_length: %ld", dec_ctx->avc_ctx->num_unexpected_sei_length);
+	free(dec_ctx->xds_ctx);
+}
+
+static void flush_decoder_call(struct lib_cc_decode *dec_ctx, void *arg)
+{
+	flush_decoder(dec_ctx);
+}
+
 int general_loop(struct lib_ccx_ctx *ctx)
 {
 	struct lib_cc_decode *dec_ctx = NULL;
@@ -848,6 +969,7 @@ int general_loop(struct lib_ccx_ctx *ctx)
 	int (*get_more_data)(struct lib_ccx_ctx *c, struct demuxer_data **d);
 	int ret;
 	int caps = 0;
+	struct program_pipeline *pipeline = NULL;
 
 	uint64_t min_pts = UINT64_MAX;
 
@@ -856,6 +978,10 @@ int general_loop(struct lib_ccx_ctx *ctx)
 	if(stream_mode == CCX_SM_TRANSPORT && ctx->write_format == CCX_OF_NULL)
 		ctx->multiprogram = 1;
 
+	if (ctx->multiprogram && ccx_options.program_threads && ctx->out_interval < 1 && !ctx->pipeline)
+		ctx->pipeline = init_program_pipeline(ctx);
+	pipeline = ctx->pipeline;
+
 	switch (stream_mode)
 	{
 		case CCX_SM_ELEMENTARY_OR_NOT_FOUND:
@@ -884,6 +1010,9 @@ int general_loop(struct lib_ccx_ctx *ctx)
 		case CCX_SM_MXF:
 			get_more_data = ccx_mxf_getmoredata;
 			break;
+		case CCX_SM_FMP4:
+			get_more_data = ccx_fmp4_getmoredata;
+			break;
 		default:
 			fatal(CCX_COMMON_EXIT_BUG_BUG, "In general_loop: Impossible value for stream_mode");
 	}
@@ -1047,6 +1176,9 @@ int general_loop(struct lib_ccx_ctx *ctx)
 			struct encoder_ctx *enc_ctx = NULL;
 			list_for_each_entry(program_iter, &ptr->pg_stream, pg_stream, struct cap_info)
 			{
+				uint64_t private1_min_pts, audio_min_pts;
+				int last;
+
 				cinfo = get_best_sib_stream(program_iter);
 				if(!cinfo)
 				{
@@ -1060,70 +1192,27 @@ int general_loop(struct lib_ccx_ctx *ctx)
 
 				enc_ctx = update_encoder_list_cinfo(ctx, cinfo);
 				dec_ctx = update_decoder_list_cinfo(ctx, cinfo);
-				dec_ctx->dtvcc->encoder = (void *)enc_ctx; //WARN: otherwise cea-708 will not work
-				
-				if (dec_ctx->timing->min_pts == 0x01FFFFFFFFLL) //if we didn't set the min_pts of the program
-				{
-					int p_index = 0; //program index
-					for (int i = 0; i < ctx->demux_ctx->nb_program; i++)
-					{
-						if (dec_ctx->program_number == ctx->demux_ctx->pinfo[i].program_number)
-						{
-							p_index = i;
-							break;
-						}
-					}
-
-					if (dec_ctx->codec == CCX_CODEC_TELETEXT) //even if there's no sub data, we still need to set the min_pts
-					{
-						if (ctx->demux_ctx->pinfo[p_index].got_important_streams_min_pts[PRIVATE_STREAM_1] != UINT64_MAX) //Teletext is synced with subtitle packet PTS
-						{
-							min_pts = ctx->demux_ctx->pinfo[p_index].got_important_streams_min_pts[PRIVATE_STREAM_1]; //it means we got the first pts for private stream 1
-							set_current_pts(dec_ctx->timing, min_pts);
-							set_fts(dec_ctx->timing);
-						}
-					}
-					if (dec_ctx->codec == CCX_CODEC_DVB) //DVB will always have to be in sync with audio (no matter the min_pts of the other streams)
-					{
-						if (ctx->demux_ctx->pinfo[p_index].got_important_streams_min_pts[AUDIO] != UINT64_MAX) //it means we got the first pts for audio
-						{
-							min_pts = ctx->demux_ctx->pinfo[p_index].got_important_streams_min_pts[AUDIO];
-							set_current_pts(dec_ctx->timing, min_pts);
-							set_fts(dec_ctx->timing);
-						}
-					}
-				}
+				get_program_min_pts(ctx->demux_ctx, dec_ctx->program_number, &private1_min_pts, &audio_min_pts);
+				last = terminate_asap || end_of_file || is_decoder_processed_enough(ctx) == CCX_TRUE;
 
-				if (enc_ctx)
-					enc_ctx->timing = dec_ctx->timing;
-
-				if (!data_node)
+				if (pipeline)
+				{
+					// The worker needs the node even when empty, it may hold data left over
+					program_pipeline_submit(pipeline, dec_ctx, enc_ctx,
+							cinfo ? get_data_node_by_pid(datalist, cinfo->pid) : data_node, !cinfo,
+							private1_min_pts, audio_min_pts, last);
 					continue;
-				
-				if(data_node->pts != CCX_NOPTS)
-					set_current_pts(dec_ctx->timing, data_node->pts);
-
-				ret = process_data(enc_ctx, dec_ctx, data_node);
-				if (
-					(enc_ctx && (enc_ctx->srt_counter || enc_ctx->cea_708_counter) ||
-						dec_ctx->saw_caption_block || ret == 1)
-					)
-					caps = 1;
-				// Process the last subtitle for DVB
-				if (!(!terminate_asap && !end_of_file && is_decoder_processed_enough(ctx) == CCX_FALSE)) {
-					if (data_node->bufferdatatype == CCX_DVB_SUBTITLE && dec_ctx && dec_ctx->dec_sub.prev && dec_ctx->dec_sub.prev->end_time == 0) {
-						dec_ctx->dec_sub.prev->end_time = (dec_ctx->timing->current_pts - dec_ctx->timing->min_pts) / (MPEG_CLOCK_FREQ / 1000);
-						encode_sub(enc_ctx->prev, dec_ctx->dec_sub.prev);
-						dec_ctx->dec_sub.prev->got_output = 0;
-					}
 				}
+				if (process_program_data(enc_ctx, dec_ctx, data_node, private1_min_pts, audio_min_pts, last))
+					caps = 1;
 			}
 			if (!data_node)
 				continue;
 		}
 		if (ctx->live_stream)
 		{
-			int cur_sec = (int) (get_fts(dec_ctx->timing, dec_ctx->current_field) / 1000);
+			// With a pipeline the timing belongs to the workers
+			int cur_sec = pipeline ? 0 : (int) (get_fts(dec_ctx->timing, dec_ctx->current_field) / 1000);
 			int th=cur_sec/10;
 			if (ctx->last_reported_progress!=th)
 			{
@@ -1138,7 +1227,7 @@ int general_loop(struct lib_ccx_ctx *ctx)
 				int progress = (int) ((((ctx->total_past+ctx->demux_ctx->past)>>8)*100)/(ctx->total_inputsize>>8));
 				if (ctx->last_reported_progress != progress)
 				{
-					LLONG t=get_fts(dec_ctx->timing, dec_ctx->current_field);
+					LLONG t = pipeline ? 0 : get_fts(dec_ctx->timing, dec_ctx->current_field);
 					if (!t && ctx->demux_ctx->global_timestamp_inited)
 						t=ctx->demux_ctx->global_timestamp - ctx->demux_ctx->min_global_timestamp;
 					int cur_sec = (int) (t / 1000);
@@ -1149,28 +1238,18 @@ int general_loop(struct lib_ccx_ctx *ctx)
 		}
 		
 		//void segment_output_file(struct lib_ccx_ctx *ctx, struct lib_cc_decode *dec_ctx);
-		segment_output_file(ctx, dec_ctx);
+		if (!pipeline)
+			segment_output_file(ctx, dec_ctx);
 
 		if (ccx_options.send_to_srv)
 			net_check_conn();
 	}
 
+	// A worker's decoder state is in its thread, so it has to flush it
 	list_for_each_entry(dec_ctx, &ctx->dec_ctx_head, list, struct lib_cc_decode)
-	{
-
-		if (dec_ctx->codec == CCX_CODEC_TELETEXT)
-			telxcc_close(&dec_ctx->private_data, &dec_ctx->dec_sub);
-		// Flush remaining HD captions
-		if (dec_ctx->has_ccdata_buffered)
-					process_hdcc(dec_ctx, &dec_ctx->dec_sub);
-
-		mprint ("\nNumber of NAL_type_7: %ld\n",dec_ctx->avc_ctx->num_nal_unit_type_7);
-		mprint ("Number of VCL_HRD: %ld\n",dec_ctx->avc_ctx->num_vcl_hrd);
-		mprint ("Number of NAL HRD: %ld\n",dec_ctx->avc_ctx->num_nal_hrd);
-		mprint ("Number of jump-in-frames: %ld\n",dec_ctx->avc_ctx->num_jump_in_frames);
-		mprint ("Number of num_unexpected_sei_length: %ld", dec_ctx->avc_ctx->num_unexpected_sei_length);
-		free(dec_ctx->xds_ctx);
-	}
+		program_pipeline_call(pipeline, dec_ctx, flush_decoder_call, NULL);
+	if (pipeline && program_pipeline_end_file(pipeline))
+		caps = 1;
 
 	delete_datalist(datalist);
 	if (ctx->total_past!=ctx->total_inputsize && ctx->binary_concat && is_decoder_processed_enough(ctx))
@@ -0,0 +1,255 @@
+/*!
+(c) 2011-2013 Forers, s. r. o.: telxcc
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAMMING_SSE2
+#endif
+#include "hamming.h"
+
+const uint8_t PARITY_8[256] = {
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x01, 0x00
+};
+
+const uint8_t REVERSE_8[256] = {
+	0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0, 0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+	0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8, 0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+	0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4, 0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+	0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec, 0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+	0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2, 0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+	0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea, 0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+	0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6, 0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+	0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee, 0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+	0x01, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1, 0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
+	0x09, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9, 0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
+	0x05, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5, 0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
+	0x0d, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed, 0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
+	0x03, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3, 0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
+	0x0b, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb, 0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
+	0x07, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7, 0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
+	0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef, 0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
+};
+
+const uint8_t UNHAM_8_4[256] = {
+	0x01, 0xff, 0x01, 0x01, 0xff, 0x00, 0x01, 0xff, 0xff, 0x02, 0x01, 0xff, 0x0a, 0xff, 0xff, 0x07,
+	0xff, 0x00, 0x01, 0xff, 0x00, 0x00, 0xff, 0x00, 0x06, 0xff, 0xff, 0x0b, 0xff, 0x00, 0x03, 0xff,
+	0xff, 0x0c, 0x01, 0xff, 0x04, 0xff, 0xff, 0x07, 0x06, 0xff, 0xff, 0x07, 0xff, 0x07, 0x07, 0x07,
+	0x06, 0xff, 0xff, 0x05, 0xff, 0x00, 0x0d, 0xff, 0x06, 0x06, 0x06, 0xff, 0x06, 0xff, 0xff, 0x07,
+	0xff, 0x02, 0x01, 0xff, 0x04, 0xff, 0xff, 0x09, 0x02, 0x02, 0xff, 0x02, 0xff, 0x02, 0x03, 0xff,
+	0x08, 0xff, 0xff, 0x05, 0xff, 0x00, 0x03, 0xff, 0xff, 0x02, 0x03, 0xff, 0x03, 0xff, 0x03, 0x03,
+	0x04, 0xff, 0xff, 0x05, 0x04, 0x04, 0x04, 0xff, 0xff, 0x02, 0x0f, 0xff, 0x04, 0xff, 0xff, 0x07,
+	0xff, 0x05, 0x05, 0x05, 0x04, 0xff, 0xff, 0x05, 0x06, 0xff, 0xff, 0x05, 0xff, 0x0e, 0x03, 0xff,
+	0xff, 0x0c, 0x01, 0xff, 0x0a, 0xff, 0xff, 0x09, 0x0a, 0xff, 0xff, 0x0b, 0x0a, 0x0a, 0x0a, 0xff,
+	0x08, 0xff, 0xff, 0x0b, 0xff, 0x00, 0x0d, 0xff, 0xff, 0x0b, 0x0b, 0x0b, 0x0a, 0xff, 0xff, 0x0b,
+	0x0c, 0x0c, 0xff, 0x0c, 0xff, 0x0c, 0x0d, 0xff, 0xff, 0x0c, 0x0f, 0xff, 0x0a, 0xff, 0xff, 0x07,
+	0xff, 0x0c, 0x0d, 0xff, 0x0d, 0xff, 0x0d, 0x0d, 0x06, 0xff, 0xff, 0x0b, 0xff, 0x0e, 0x0d, 0xff,
+	0x08, 0xff, 0xff, 0x09, 0xff, 0x09, 0x09, 0x09, 0xff, 0x02, 0x0f, 0xff, 0x0a, 0xff, 0xff, 0x09,
+	0x08, 0x08, 0x08, 0xff, 0x08, 0xff, 0xff, 0x09, 0x08, 0xff, 0xff, 0x0b, 0xff, 0x0e, 0x03, 0xff,
+	0xff, 0x0c, 0x0f, 0xff, 0x04, 0xff, 0xff, 0x09, 0x0f, 0xff, 0x0f, 0x0f, 0xff, 0x0e, 0x0f, 0xff,
+	0x08, 0xff, 0xff, 0x05, 0xff, 0x0e, 0x0d, 0xff, 0xff, 0x0e, 0x0f, 0xff, 0x0e, 0x0e, 0xff, 0x0e
+};
+
+// ETS 300 706, chapter 8.3: tests A-F of each byte of a 24/18 triplet, LSB first.
+// Bits 0-5 of the XOR of the three values are the tests A-F, see unham_24_18().
+static const uint8_t UNHAM_24_18_PAR[3][256] = {
+	{
+		0x00, 0x21, 0x22, 0x03, 0x23, 0x02, 0x01, 0x20, 0x24, 0x05, 0x06, 0x27, 0x07, 0x26, 0x25, 0x04,
+		0x25, 0x04, 0x07, 0x26, 0x06, 0x27, 0x24, 0x05, 0x01, 0x20, 0x23, 0x02, 0x22, 0x03, 0x00, 0x21,
+		0x26, 0x07, 0x04, 0x25, 0x05, 0x24, 0x27, 0x06, 0x02, 0x23, 0x20, 0x01, 0x21, 0x00, 0x03, 0x22,
+		0x03, 0x22, 0x21, 0x00, 0x20, 0x01, 0x02, 0x23, 0x27, 0x06, 0x05, 0x24, 0x04, 0x25, 0x26, 0x07,
+		0x27, 0x06, 0x05, 0x24, 0x04, 0x25, 0x26, 0x07, 0x03, 0x22, 0x21, 0x00, 0x20, 0x01, 0x02, 0x23,
+		0x02, 0x23, 0x20, 0x01, 0x21, 0x00, 0x03, 0x22, 0x26, 0x07, 0x04, 0x25, 0x05, 0x24, 0x27, 0x06,
+		0x01, 0x20, 0x23, 0x02, 0x22, 0x03, 0x00, 0x21, 0x25, 0x04, 0x07, 0x26, 0x06, 0x27, 0x24, 0x05,
+		0x24, 0x05, 0x06, 0x27, 0x07, 0x26, 0x25, 0x04, 0x00, 0x21, 0x22, 0x03, 0x23, 0x02, 0x01, 0x20,
+		0x28, 0x09, 0x0a, 0x2b, 0x0b, 0x2a, 0x29, 0x08, 0x0c, 0x2d, 0x2e, 0x0f, 0x2f, 0x0e, 0x0d, 0x2c,
+		0x0d, 0x2c, 0x2f, 0x0e, 0x2e, 0x0f, 0x0c, 0x2d, 0x29, 0x08, 0x0b, 0x2a, 0x0a, 0x2b, 0x28, 0x09,
+		0x0e, 0x2f, 0x2c, 0x0d, 0x2d, 0x0c, 0x0f, 0x2e, 0x2a, 0x0b, 0x08, 0x29, 0x09, 0x28, 0x2b, 0x0a,
+		0x2b, 0x0a, 0x09, 0x28, 0x08, 0x29, 0x2a, 0x0b, 0x0f, 0x2e, 0x2d, 0x0c, 0x2c, 0x0d, 0x0e, 0x2f,
+		0x0f, 0x2e, 0x2d, 0x0c, 0x2c, 0x0d, 0x0e, 0x2f, 0x2b, 0x0a, 0x09, 0x28, 0x08, 0x29, 0x2a, 0x0b,
+		0x2a, 0x0b, 0x08, 0x29, 0x09, 0x28, 0x2b, 0x0a, 0x0e, 0x2f, 0x2c, 0x0d, 0x2d, 0x0c, 0x0f, 0x2e,
+		0x29, 0x08, 0x0b, 0x2a, 0x0a, 0x2b, 0x28, 0x09, 0x0d, 0x2c, 0x2f, 0x0e, 0x2e, 0x0f, 0x0c, 0x2d,
+		0x0c, 0x2d, 0x2e, 0x0f, 0x2f, 0x0e, 0x0d, 0x2c, 0x28, 0x09, 0x0a, 0x2b, 0x0b, 0x2a, 0x29, 0x08
+	},
+	{
+		0x00, 0x29, 0x2a, 0x03, 0x2b, 0x02, 0x01, 0x28, 0x2c, 0x05, 0x06, 0x2f, 0x07, 0x2e, 0x2d, 0x04,
+		0x2d, 0x04, 0x07, 0x2e, 0x06, 0x2f, 0x2c, 0x05, 0x01, 0x28, 0x2b, 0x02, 0x2a, 0x03, 0x00, 0x29,
+		0x2e, 0x07, 0x04, 0x2d, 0x05, 0x2c, 0x2f, 0x06, 0x02, 0x2b, 0x28, 0x01, 0x29, 0x00, 0x03, 0x2a,
+		0x03, 0x2a, 0x29, 0x00, 0x28, 0x01, 0x02, 0x2b, 0x2f, 0x06, 0x05, 0x2c, 0x04, 0x2d, 0x2e, 0x07,
+		0x2f, 0x06, 0x05, 0x2c, 0x04, 0x2d, 0x2e, 0x07, 0x03, 0x2a, 0x29, 0x00, 0x28, 0x01, 0x02, 0x2b,
+		0x02, 0x2b, 0x28, 0x01, 0x29, 0x00, 0x03, 0x2a, 0x2e, 0x07, 0x04, 0x2d, 0x05, 0x2c, 0x2f, 0x06,
+		0x01, 0x28, 0x2b, 0x02, 0x2a, 0x03, 0x00, 0x29, 0x2d, 0x04, 0x07, 0x2e, 0x06, 0x2f, 0x2c, 0x05,
+		0x2c, 0x05, 0x06, 0x2f, 0x07, 0x2e, 0x2d, 0x04, 0x00, 0x29, 0x2a, 0x03, 0x2b, 0x02, 0x01, 0x28,
+		0x30, 0x19, 0x1a, 0x33, 0x1b, 0x32, 0x31, 0x18, 0x1c, 0x35, 0x36, 0x1f, 0x37, 0x1e, 0x1d, 0x34,
+		0x1d, 0x34, 0x37, 0x1e, 0x36, 0x1f, 0x1c, 0x35, 0x31, 0x18, 0x1b, 0x32, 0x1a, 0x33, 0x30, 0x19,
+		0x1e, 0x37, 0x34, 0x1d, 0x35, 0x1c, 0x1f, 0x36, 0x32, 0x1b, 0x18, 0x31, 0x19, 0x30, 0x33, 0x1a,
+		0x33, 0x1a, 0x19, 0x30, 0x18, 0x31, 0x32, 0x1b, 0x1f, 0x36, 0x35, 0x1c, 0x34, 0x1d, 0x1e, 0x37,
+		0x1f, 0x36, 0x35, 0x1c, 0x34, 0x1d, 0x1e, 0x37, 0x33, 0x1a, 0x19, 0x30, 0x18, 0x31, 0x32, 0x1b,
+		0x32, 0x1b, 0x18, 0x31, 0x19, 0x30, 0x33, 0x1a, 0x1e, 0x37, 0x34, 0x1d, 0x35, 0x1c, 0x1f, 0x36,
+		0x31, 0x18, 0x1b, 0x32, 0x1a, 0x33, 0x30, 0x19, 0x1d, 0x34, 0x37, 0x1e, 0x36, 0x1f, 0x1c, 0x35,
+		0x1c, 0x35, 0x36, 0x1f, 0x37, 0x1e, 0x1d, 0x34, 0x30, 0x19, 0x1a, 0x33, 0x1b, 0x32, 0x31, 0x18
+	},
+	{
+		0x00, 0x31, 0x32, 0x03, 0x33, 0x02, 0x01, 0x30, 0x34, 0x05, 0x06, 0x37, 0x07, 0x36, 0x35, 0x04,
+		0x35, 0x04, 0x07, 0x36, 0x06, 0x37, 0x34, 0x05, 0x01, 0x30, 0x33, 0x02, 0x32, 0x03, 0x00, 0x31,
+		0x36, 0x07, 0x04, 0x35, 0x05, 0x34, 0x37, 0x06, 0x02, 0x33, 0x30, 0x01, 0x31, 0x00, 0x03, 0x32,
+		0x03, 0x32, 0x31, 0x00, 0x30, 0x01, 0x02, 0x33, 0x37, 0x06, 0x05, 0x34, 0x04, 0x35, 0x36, 0x07,
+		0x37, 0x06, 0x05, 0x34, 0x04, 0x35, 0x36, 0x07, 0x03, 0x32, 0x31, 0x00, 0x30, 0x01, 0x02, 0x33,
+		0x02, 0x33, 0x30, 0x01, 0x31, 0x00, 0x03, 0x32, 0x36, 0x07, 0x04, 0x35, 0x05, 0x34, 0x37, 0x06,
+		0x01, 0x30, 0x33, 0x02, 0x32, 0x03, 0x00, 0x31, 0x35, 0x04, 0x07, 0x36, 0x06, 0x37, 0x34, 0x05,
+		0x34, 0x05, 0x06, 0x37, 0x07, 0x36, 0x35, 0x04, 0x00, 0x31, 0x32, 0x03, 0x33, 0x02, 0x01, 0x30,
+		0x20, 0x11, 0x12, 0x23, 0x13, 0x22, 0x21, 0x10, 0x14, 0x25, 0x26, 0x17, 0x27, 0x16, 0x15, 0x24,
+		0x15, 0x24, 0x27, 0x16, 0x26, 0x17, 0x14, 0x25, 0x21, 0x10, 0x13, 0x22, 0x12, 0x23, 0x20, 0x11,
+		0x16, 0x27, 0x24, 0x15, 0x25, 0x14, 0x17, 0x26, 0x22, 0x13, 0x10, 0x21, 0x11, 0x20, 0x23, 0x12,
+		0x23, 0x12, 0x11, 0x20, 0x10, 0x21, 0x22, 0x13, 0x17, 0x26, 0x25, 0x14, 0x24, 0x15, 0x16, 0x27,
+		0x17, 0x26, 0x25, 0x14, 0x24, 0x15, 0x16, 0x27, 0x23, 0x12, 0x11, 0x20, 0x10, 0x21, 0x22, 0x13,
+		0x22, 0x13, 0x10, 0x21, 0x11, 0x20, 0x23, 0x12, 0x16, 0x27, 0x24, 0x15, 0x25, 0x14, 0x17, 0x26,
+		0x21, 0x10, 0x13, 0x22, 0x12, 0x23, 0x20, 0x11, 0x15, 0x24, 0x27, 0x16, 0x26, 0x17, 0x14, 0x25,
+		0x14, 0x25, 0x26, 0x17, 0x27, 0x16, 0x15, 0x24, 0x20, 0x11, 0x12, 0x23, 0x13, 0x22, 0x21, 0x10
+	}
+};
+
+// Bit to flip for each result of the tests, 0xffffffff for a double error
+static const uint32_t UNHAM_24_18_ERR[64] = {
+	0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000, 0x00800000,
+	0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000, 0x00008000,
+	0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100, 0x00000080,
+	0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001, 0x00000000,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x00000000
+};
+
+// ETS 300 706, chapter 8.2
+uint8_t unham_8_4(uint8_t a)
+{
+	return UNHAM_8_4[a] & 0x0f;
+}
+
+// ETS 300 706, chapter 8.3
+uint32_t unham_24_18(uint32_t a)
+{
+	uint8_t test = UNHAM_24_18_PAR[0][a & 0xff] ^ UNHAM_24_18_PAR[1][(a >> 8) & 0xff] ^ UNHAM_24_18_PAR[2][(a >> 16) & 0xff];
+	uint32_t err = UNHAM_24_18_ERR[test];
+
+	if (err == 0xffffffff)
+		return err; // Double error
+	a ^= err;
+
+	return (a & 0x000004) >> 2 | (a & 0x000070) >> 3 | (a & 0x007f00) >> 4 | (a & 0x7f0000) >> 5;
+}
+
+int unham_8_4_block(const uint8_t *in, uint8_t *out, size_t n)
+{
+	int errors = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint8_t r = UNHAM_8_4[in[i]];
+		errors += (r == 0xff);
+		out[i] = r & 0x0f;
+	}
+	return errors;
+}
+
+int unham_24_18_block(const uint8_t *in, uint32_t *out, size_t n)
+{
+	int errors = 0;
+	for (size_t i = 0; i < n; i++, in += 3)
+	{
+		out[i] = unham_24_18((in[2] << 16) | (in[1] << 8) | in[0]);
+		errors += (out[i] == 0xffffffff);
+	}
+	return errors;
+}
+
+static int odd_parity_block_scalar(const uint8_t *in, uint8_t *out, size_t n)
+{
+	int errors = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (PARITY_8[in[i]])
+			out[i] = in[i] & 0x7f;
+		else
+		{
+			out[i] = PARITY_ERROR;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+#ifdef HAMMING_SSE2
+// 16 bytes at a time: the bits of each byte are folded with shifts, masking
+// what comes in from the next byte, until bit 0 is the parity of the byte.
+static int odd_parity_block_sse2(const uint8_t *in, uint8_t *out, size_t n)
+{
+	const __m128i m0f = _mm_set1_epi8(0x0f), m3f = _mm_set1_epi8(0x3f), m7f = _mm_set1_epi8(0x7f);
+	const __m128i one = _mm_set1_epi8(1), ones = _mm_set1_epi8((char) 0xff);
+	int errors = 0;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+		__m128i x = _mm_xor_si128(v, _mm_and_si128(_mm_srli_epi16(v, 4), m0f));
+		x = _mm_xor_si128(x, _mm_and_si128(_mm_srli_epi16(x, 2), m3f));
+		x = _mm_xor_si128(x, _mm_and_si128(_mm_srli_epi16(x, 1), m7f));
+		__m128i ok = _mm_cmpeq_epi8(_mm_and_si128(x, one), one);
+		__m128i r = _mm_or_si128(_mm_and_si128(ok, _mm_and_si128(v, m7f)), _mm_andnot_si128(ok, ones));
+		_mm_storeu_si128((__m128i *) (out + i), r);
+		for (unsigned bad = ~_mm_movemask_epi8(ok) & 0xffff; bad; bad &= bad - 1)
+			errors++;
+	}
+	return errors + odd_parity_block_scalar(in + i, out + i, n - i);
+}
+#endif
+
+int odd_parity_block(const uint8_t *in, uint8_t *out, size_t n)
+{
+#ifdef HAMMING_SSE2
+	return odd_parity_block_sse2(in, out, n);
+#else
+	return odd_parity_block_scalar(in, out, n);
+#endif
+}
+
+int telx_decode_packet(const uint8_t address[2], const uint8_t data[40], struct telx_decoded_packet *p)
+{
+	uint8_t a[2];
+
+	p->errors = unham_8_4_block(address, a, 2);
+	p->magazine = a[0] & 0x7;
+	if (p->magazine == 0)
+		p->magazine = 8;
+	p->row = ((a[1] << 4) | a[0]) >> 3;
+	p->designation = 0;
+
+	if (p->row == 0)
+		p->errors += unham_8_4_block(data, p->header, 8);
+	else if (p->row > 25)
+	{
+		p->errors += unham_8_4_block(data, &p->designation, 1);
+		// X/27/0-3 are page links in Hamming 8/4, X/27/4-7 are triplets
+		if (p->row == 26 || p->row == 28 || p->row == 29 || (p->row == 27 && p->designation >= 4))
+			p->errors += unham_24_18_block(data + 1, p->triplets, 13);
+	}
+	return p->errors;
+}
@@ -1,10 +1,13 @@
 #include "lib_ccx.h"
+#include "program_pipeline.h"
 #include "ccx_common_option.h"
 #include "activity.h"
 #include "utility.h"
 #include "dvb_subtitle_decoder.h"
 #include "ccx_decoders_708.h"
 #include "ccx_decoders_isdb.h"
+#include "ocr_cache.h"
+#include "ocr_pool.h"
 
 struct ccx_common_logging_t ccx_common_logging;
 static struct ccx_decoders_common_settings_t *init_decoder_setting(
@@ -140,6 +143,7 @@ struct lib_ccx_ctx* init_libraries(struct ccx_s_options *opt)
 	// Set logging functions for libraries
 	ccx_common_logging.debug_ftn = &dbg_print;
 	ccx_common_logging.debug_mask = opt->debug_mask;
+	dbg_update_mask();
 	ccx_common_logging.fatal_ftn = &fatal;
 	ccx_common_logging.log_ftn = &mprint;
 	ccx_common_logging.gui_ftn = &activity_library_process;
@@ -192,6 +196,7 @@ struct lib_ccx_ctx* init_libraries(struct ccx_s_options *opt)
 	ctx->segment_on_key_frames_only = opt->segment_on_key_frames_only;
 	ctx->segment_counter = 0;
 	ctx->system_start_time = -1;
+	ctx->pipeline = NULL;
 
 end:
 	if (ret != EXIT_OK)
@@ -202,41 +207,53 @@ end:
 	return ctx;
 }
 
+/* Called in the thread the decoder runs in, see program_pipeline_call() */
+static void dinit_decoder(struct lib_cc_decode *dec_ctx, void *arg)
+{
+	struct lib_ccx_ctx *lctx = arg;
+	struct encoder_ctx *enc_ctx;
+	LLONG cfts;
+
+	if (dec_ctx->codec == CCX_CODEC_DVB)
+		dvbsub_close_decoder(&dec_ctx->private_data);
+	//Test memory for teletext
+	else if (dec_ctx->codec == CCX_CODEC_TELETEXT)
+		telxcc_close(&dec_ctx->private_data, &dec_ctx->dec_sub);
+	else if (dec_ctx->codec == CCX_CODEC_ISDB_CC)
+		delete_isdb_decoder(&dec_ctx->private_data);
+
+	flush_cc_decode(dec_ctx, &dec_ctx->dec_sub);
+	cfts = get_fts(dec_ctx->timing, dec_ctx->current_field);
+	enc_ctx = get_encoder_by_pn(lctx, dec_ctx->program_number);
+	if (enc_ctx && dec_ctx->dec_sub.got_output == CCX_TRUE)
+	{
+		encode_sub(enc_ctx, &dec_ctx->dec_sub);
+		dec_ctx->dec_sub.got_output = CCX_FALSE;
+	}
+	list_del(&dec_ctx->list);
+	dinit_cc_decode(&dec_ctx);
+	if (enc_ctx)
+	{
+		list_del(&enc_ctx->list);
+		dinit_encoder(&enc_ctx, cfts);
+	}
+}
+
 void dinit_libraries( struct lib_ccx_ctx **ctx)
 {
 	struct lib_ccx_ctx *lctx = *ctx;
-	struct encoder_ctx *enc_ctx;
 	struct lib_cc_decode *dec_ctx;
 	struct lib_cc_decode *dec_ctx1;
 	int i;
 	list_for_each_entry_safe(dec_ctx, dec_ctx1, &lctx->dec_ctx_head, list, struct lib_cc_decode)
-	{
-		LLONG cfts;
-		if (dec_ctx->codec == CCX_CODEC_DVB)
-			dvbsub_close_decoder(&dec_ctx->private_data);
-		//Test memory for teletext
-		else if (dec_ctx->codec == CCX_CODEC_TELETEXT)
-			telxcc_close(&dec_ctx->private_data, &dec_ctx->dec_sub);
-		else if (dec_ctx->codec == CCX_CODEC_ISDB_CC)
-			delete_isdb_decoder(&dec_ctx->private_data);
-
-		flush_cc_decode(dec_ctx, &dec_ctx->dec_sub);
-		cfts = get_fts(dec_ctx->timing, dec_ctx->current_field);
-		enc_ctx = get_encoder_by_pn(lctx, dec_ctx->program_number);
-		if (enc_ctx && dec_ctx->dec_sub.got_output == CCX_TRUE)
-		{
-			encode_sub(enc_ctx, &dec_ctx->dec_sub);
-			dec_ctx->dec_sub.got_output = CCX_FALSE;
-		}
-		list_del(&dec_ctx->list);
-		dinit_cc_decode(&dec_ctx);
-		if (enc_ctx)
-		{
-			list_del(&enc_ctx->list);
-			dinit_encoder(&enc_ctx, cfts);
-		}
-	}
-
+		program_pipeline_call(lctx->pipeline, dec_ctx, dinit_decoder, lctx);
+	if (lctx->pipeline)
+		dinit_program_pipeline(&lctx->pipeline);
+
+#ifdef ENABLE_OCR
+	ocr_pool_close();
+#endif
+	ocr_cache_close();
 	// free EPG memory
 	EPG_free(lctx);
 	freep(&lctx->freport.data_from_608);
@@ -257,7 +274,7 @@ int is_decoder_processed_enough(struct lib_ccx_ctx *ctx)
 	struct lib_cc_decode *dec_ctx;
 	list_for_each_entry(dec_ctx, &ctx->dec_ctx_head, list, struct lib_cc_decode)
 	{
-		if (dec_ctx->processed_enough == CCX_TRUE && ctx->multiprogram == CCX_FALSE)
+		if (ctx->multiprogram == CCX_FALSE && dec_ctx->processed_enough == CCX_TRUE)
 			return CCX_TRUE;
 	}
 
@@ -43,6 +43,8 @@ struct file_report
 };
 
 // Stuff for telxcc.c
+#define CCX_TLT_MAX_EXTRA_PAGES 16
+
 struct ccx_s_teletext_config
 {
 	uint8_t verbose : 1;                                       // should telxcc be verbose?
@@ -54,6 +56,9 @@ struct ccx_s_teletext_config
 	// uint8_t se_mode : 1;                                    // search engine compatible mode => Uses CCExtractor's write_format
 	// uint64_t utc_refvalue;                                  // UTC referential value => Moved to ccx_decoders_common, so can be used for other decoders (608/xds) too
 	uint16_t user_page;                                        // Page selected by user, which MIGHT be different to 'page' depending on autodetection stuff
+	uint16_t extra_pages[CCX_TLT_MAX_EXTRA_PAGES];             // Pages after the first one in -tpage p1,p2,..., each written to a file of its own
+	int num_extra_pages;
+	int all_pages;                                             // -tpage all: extract every page flagged as subtitles
 	int dolevdist;											   // 0=Don't attempt to correct errors
 	int levdistmincnt, levdistmaxpct;                          // Means 2 fails or less is "the same", 10% or less is also "the same"
 	struct ccx_boundary_time extraction_start, extraction_end; // Segment we actually process
@@ -124,11 +129,17 @@ struct lib_ccx_ctx
 
 	int epg_inited;
 	struct PSI_buffer *epg_buffers;
+	uint32_t epg_programs;           // Programs the sections in epg_buffers were decoded with, see EPG_parse_table()
 	struct EIT_program *eit_programs;
 	int32_t *eit_current_events;
 	int16_t *ATSC_source_pg_map;
 	int epg_last_output;
 	int epg_last_live_output;
+	int epg_written;                 // _epg.xml was written in full and changes can be appended to it
+	int epg_appended;                // Changes were appended to _epg.xml since it was last written in full
+	int epg_written_events;          // Events in _epg.xml, including old copies of updated ones
+	int epg_stale_events;            // Old copies of updated events in _epg.xml
+	uint32_t epg_channels_hash;      // Of the channels in _epg.xml, it is written in full when they change
 	struct file_report freport;
 
 	unsigned int hauppauge_mode;         // If 1, use PID=1003, process specially and so on
@@ -146,6 +157,8 @@ struct lib_ccx_ctx
 	int segment_on_key_frames_only;
 	int segment_counter;
 	LLONG system_start_time;
+
+	struct program_pipeline *pipeline; // -programthreads workers, kept for the whole run
 };
 
 
@@ -164,17 +177,23 @@ int stringztoms (const char *s, struct ccx_boundary_time *bt);
 // general_loop.c
 void position_sanity_check(struct ccx_demuxer *ctx);
 int init_file_buffer(struct ccx_demuxer *ctx);
+int init_file_mmap(struct ccx_demuxer *ctx);
+void close_file_mmap(struct ccx_demuxer *ctx);
 int ps_get_more_data(struct lib_ccx_ctx *ctx, struct demuxer_data **ppdata);
 int general_get_more_data(struct lib_ccx_ctx *ctx, struct demuxer_data **data);
 int raw_loop (struct lib_ccx_ctx *ctx);
 size_t process_raw(struct lib_cc_decode *ctx, struct cc_subtitle *sub, unsigned char *buffer, size_t len);
 int general_loop(struct lib_ccx_ctx *ctx);
+int process_program_data(struct encoder_ctx *enc_ctx, struct lib_cc_decode *dec_ctx, struct demuxer_data *data_node,
+		uint64_t private1_min_pts, uint64_t audio_min_pts, int last);
+void flush_decoder(struct lib_cc_decode *dec_ctx);
 void process_hex(struct lib_ccx_ctx *ctx, char *filename);
 int rcwt_loop(struct lib_ccx_ctx *ctx);
 
 extern int end_of_file;
 
 int ccx_mxf_getmoredata(struct lib_ccx_ctx *ctx, struct demuxer_data **ppdata);
+int ccx_fmp4_getmoredata(struct lib_ccx_ctx *ctx, struct demuxer_data **ppdata);
 
 // asf_functions.c
 int asf_get_more_data(struct lib_ccx_ctx *ctx, struct demuxer_data **ppdata);
@@ -232,9 +251,15 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data);
 int ts_get_more_data(struct lib_ccx_ctx *ctx, struct demuxer_data **data);
 int write_section(struct ccx_demuxer *ctx, struct ts_payload *payload, unsigned char*buf, int size,  struct program_info *pinfo);
 void ts_buffer_psi_packet(struct ccx_demuxer *ctx);
+int psi_buffer_add(struct PSI_buffer *psi, unsigned char *payload_start, unsigned payload_length,
+		unsigned payload_start_indicator, unsigned ccounter);
+int psi_section_unchanged(struct PSI_buffer *psi, unsigned char *section, unsigned len);
+void psi_buffer_reset(struct PSI_buffer *psi);
+void psi_buffer_free(struct PSI_buffer *psi);
 int parse_PMT (struct ccx_demuxer *ctx, unsigned char *buf, int len,  struct program_info *pinfo);
 int parse_PAT (struct ccx_demuxer *ctx);
 void parse_EPG_packet (struct lib_ccx_ctx *ctx);
+void EPG_compact_output(struct lib_ccx_ctx *ctx);
 void EPG_free(struct lib_ccx_ctx *ctx);
 char* EPG_DVB_decode_string(uint8_t *in, size_t size);
 void parse_SDT(struct ccx_demuxer *ctx);
@@ -287,7 +312,7 @@ extern int firstcall;
 
 // From ts_functions
 //extern struct ts_payload payload;
-extern unsigned char tspacket[188];
+extern unsigned char *tspacket;
 extern unsigned char *last_pat_payload;
 extern unsigned last_pat_length;
 extern volatile int terminate_asap;
@@ -2,38 +2,175 @@
 #include "utility.h"
 #include "matroska.h"
 #include "ccx_encoders_helpers.h"
+#include "ccx_encoders_common.h"
 #include <limits.h>
 
-void skip_bytes(FILE* file, ULLONG n) {
-    FSEEK(file, n, SEEK_CUR);
+void init_matroska_reader(struct matroska_reader* file, FILE* stream) {
+    memset(file, 0, sizeof(struct matroska_reader));
+    file->stream = stream;
+    if (stream == NULL)
+        return;
+    // The window is all the buffering needed
+    setvbuf(stream, NULL, _IONBF, 0);
+    FSEEK(stream, 0, SEEK_END);
+    file->file_size = (ULLONG) FTELL(stream);
+    FSEEK(stream, 0, SEEK_SET);
+    file->buffer_size = MATROSKA_READ_WINDOW;
+    file->buffer = malloc(file->buffer_size);
+    if (file->buffer == NULL)
+        fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for the Matroska read window.\n");
 }
 
-void set_bytes(FILE* file, ULLONG n) {
-    FSEEK(file, n, SEEK_SET);
+void free_matroska_reader(struct matroska_reader* file) {
+    if (file->stream != NULL)
+        fclose(file->stream);
+    free(file->buffer);
+    memset(file, 0, sizeof(struct matroska_reader));
 }
 
-ULLONG get_current_byte(FILE* file) {
-    return (ULLONG) FTELL(file);
+// Make at least n bytes from the current position available in the window,
+// growing it if needed. Return how many there are, fewer if the file ends first.
+static size_t mkv_fill(struct matroska_reader* file, size_t n) {
+    size_t avail = file->buffer_len - file->buffer_pos;
+    if (avail >= n || file->stream == NULL)
+        return avail;
+
+    if (n > file->buffer_size) {
+        UBYTE* buffer = realloc(file->buffer, n);
+        if (buffer == NULL)
+            fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for a Matroska block of " LLU " bytes.\n", (ULLONG) n);
+        file->buffer = buffer;
+        file->buffer_size = n;
+    }
+    memmove(file->buffer, file->buffer + file->buffer_pos, avail);
+    file->buffer_start += file->buffer_pos;
+    file->buffer_pos = 0;
+    file->buffer_len = avail;
+    // Right after a seek, read only what is needed for now. Seeks come when
+    // skipping elements, likely followed by another one.
+    size_t want = file->buffer_size;
+    if (file->seeked)
+        want = MIN(n > MATROSKA_SEEK_READ ? n : MATROSKA_SEEK_READ, file->buffer_size);
+    file->seeked = 0;
+    while (file->buffer_len < n) {
+        size_t got = fread(file->buffer + file->buffer_len, 1, want - file->buffer_len, file->stream);
+        if (got == 0)
+            break;
+        file->buffer_len += got;
+    }
+    return file->buffer_len;
+}
+
+// Bytes left in the file from the current position
+static ULLONG mkv_remaining(struct matroska_reader* file) {
+    ULLONG pos = get_current_byte(file);
+    return pos < file->file_size ? file->file_size - pos : 0;
+}
+
+// Copy up to n bytes to dest, return how many there were
+static ULLONG mkv_read_into(struct matroska_reader* file, UBYTE* dest, ULLONG n) {
+    ULLONG done = 0;
+    while (done < n) {
+        size_t avail = file->buffer_len - file->buffer_pos;
+        if (avail == 0 && (avail = mkv_fill(file, 1)) == 0)
+            break;
+        if (avail > n - done)
+            avail = (size_t) (n - done);
+        memcpy(dest + done, file->buffer + file->buffer_pos, avail);
+        file->buffer_pos += avail;
+        done += avail;
+    }
+    return done;
+}
+
+void skip_bytes(struct matroska_reader* file, ULLONG n) {
+    set_bytes(file, get_current_byte(file) + n);
 }
 
-UBYTE* read_byte_block(FILE* file, ULLONG n) {
+void set_bytes(struct matroska_reader* file, ULLONG n) {
+    if (n >= file->buffer_start && n <= file->buffer_start + file->buffer_len) {
+        file->buffer_pos = (size_t) (n - file->buffer_start);
+    } else {
+        if (file->stream != NULL)
+            FSEEK(file->stream, n, SEEK_SET);
+        file->buffer_start = n;
+        file->buffer_pos = 0;
+        file->buffer_len = 0;
+        file->seeked = 1;
+    }
+    file->eof = 0;
+}
+
+ULLONG get_current_byte(struct matroska_reader* file) {
+    return file->buffer_start + file->buffer_pos;
+}
+
+UBYTE* read_byte_block(struct matroska_reader* file, ULLONG n) {
+    n = MIN(n, mkv_remaining(file));
     UBYTE* buffer = malloc((size_t)(sizeof(UBYTE) * n));
-    fread(buffer, 1, (size_t)n, file);
+    mkv_read_into(file, buffer, n);
     return buffer;
 }
 
-char* read_bytes_signed(FILE* file, ULLONG n) {
+char* read_bytes_signed(struct matroska_reader* file, ULLONG n) {
+    n = MIN(n, mkv_remaining(file));
     char* buffer = malloc((size_t)(sizeof(UBYTE) * (n + 1)));
-    fread(buffer, 1, (size_t)n, file);
+    n = mkv_read_into(file, (UBYTE*) buffer, n);
     buffer[n] = 0;
     return buffer;
 }
 
-UBYTE mkv_read_byte(FILE* file) {
-    return (UBYTE)fgetc(file);
+void* mkv_store_alloc(struct matroska_ctx* mkv_ctx, size_t n) {
+    struct matroska_store_chunk* chunk = mkv_ctx->store;
+    n = (n + 7) & ~(size_t) 7;
+    if (chunk == NULL || chunk->size - chunk->used < n) {
+        size_t size = n > MATROSKA_STORE_CHUNK_SIZE / 4 ? n : MATROSKA_STORE_CHUNK_SIZE;
+        struct matroska_store_chunk* new_chunk = malloc(sizeof(struct matroska_store_chunk) + size);
+        if (new_chunk == NULL)
+            fatal(EXIT_NOT_ENOUGH_MEMORY, "In mkv_store_alloc: Out of memory.");
+        new_chunk->size = size;
+        new_chunk->used = 0;
+        // A big block gets a chunk of its own, behind the one still being filled
+        if (chunk != NULL && size != MATROSKA_STORE_CHUNK_SIZE) {
+            new_chunk->next = chunk->next;
+            chunk->next = new_chunk;
+        } else {
+            new_chunk->next = chunk;
+            mkv_ctx->store = new_chunk;
+        }
+        chunk = new_chunk;
+    }
+    void* p = chunk->data + chunk->used;
+    chunk->used += n;
+    return p;
+}
+
+char* mkv_store_bytes_signed(struct matroska_ctx* mkv_ctx, ULLONG n) {
+    struct matroska_reader* file = &mkv_ctx->file;
+    n = MIN(n, mkv_remaining(file));
+    char* buffer = mkv_store_alloc(mkv_ctx, (size_t) n + 1);
+    n = mkv_read_into(file, (UBYTE*) buffer, n);
+    buffer[n] = 0;
+    return buffer;
 }
 
-ULLONG read_vint_length(FILE* file) {
+UBYTE* view_byte_block(struct matroska_reader* file, ULLONG n) {
+    if (n > mkv_remaining(file) || mkv_fill(file, (size_t) n) < n)
+        return NULL;
+    UBYTE* view = file->buffer + file->buffer_pos;
+    file->buffer_pos += (size_t) n;
+    return view;
+}
+
+UBYTE mkv_read_byte(struct matroska_reader* file) {
+    if (file->buffer_pos == file->buffer_len && mkv_fill(file, 1) == 0) {
+        file->eof = 1;
+        return 0xFF; // What fgetc() returning EOF used to give
+    }
+    return file->buffer[file->buffer_pos++];
+}
+
+ULLONG read_vint_length(struct matroska_reader* file) {
     UBYTE ch = mkv_read_byte(file);
     int cnt = 0;
     for (int i = 7; i >= 0; i--) {
@@ -51,40 +188,42 @@ ULLONG read_vint_length(FILE* file) {
     return ret;
 }
 
-UBYTE* read_vint_block(FILE* file) {
+UBYTE* read_vint_block(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
     return read_byte_block(file, len);
 }
 
-char* read_vint_block_signed(FILE* file) {
+char* read_vint_block_signed(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
     return read_bytes_signed(file, len);
 }
 
-ULLONG read_vint_block_int(FILE* file) {
+ULLONG read_vint_block_int(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
-    UBYTE* s = read_byte_block(file, len);
+    UBYTE* s = len <= sizeof(ULLONG) ? view_byte_block(file, len) : NULL;
 
     ULLONG res = 0;
+    if (s == NULL) {
+        skip_bytes(file, len);
+        return res;
+    }
     for (int i = 0; i < len; i++) {
         res <<= 8;
         res += s[i];
     }
-
-    free(s);
     return res;
 }
 
-char* read_vint_block_string(FILE* file) {
+char* read_vint_block_string(struct matroska_reader* file) {
     return read_vint_block_signed(file);
 }
 
-void read_vint_block_skip(FILE* file) {
+void read_vint_block_skip(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
     skip_bytes(file, len);
 }
 
-void parse_ebml(FILE* file) {
+void parse_ebml(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
@@ -139,7 +278,7 @@ void parse_ebml(FILE* file) {
     }
 }
 
-void parse_segment_info(FILE* file) {
+void parse_segment_info(struct matroska_reader* file) {
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
@@ -227,6 +366,17 @@ char* generate_timestamp_ass_ssa(ULLONG milliseconds) {
     return buf;
 }
 
+// Report the progress when it changed, not for every block
+void matroska_progress(struct matroska_ctx* mkv_ctx) {
+    int percentage = (int) (get_current_byte(&mkv_ctx->file) * 100 / mkv_ctx->ctx->inputsize);
+    if (percentage == mkv_ctx->reported_percentage && mkv_ctx->current_second == mkv_ctx->reported_second)
+        return;
+    mkv_ctx->reported_percentage = percentage;
+    mkv_ctx->reported_second = mkv_ctx->current_second;
+    activity_progress(percentage, (int) (mkv_ctx->current_second / 60),
+                      (int) (mkv_ctx->current_second % 60));
+}
+
 int find_sub_track_index(struct matroska_ctx* mkv_ctx, ULLONG track_number) {
     for (int i = mkv_ctx->sub_tracks_count-1; i >=0 ; i--)
         if (mkv_ctx->sub_tracks[i]->track_number == track_number)
@@ -235,7 +385,7 @@ int find_sub_track_index(struct matroska_ctx* mkv_ctx, ULLONG track_number) {
 }
 
 struct matroska_sub_sentence* parse_segment_cluster_block_group_block(struct matroska_ctx* mkv_ctx, ULLONG cluster_timecode) {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
     ULLONG track_number = read_vint_length(file);     // track number is length, not int
@@ -253,33 +403,30 @@ struct matroska_sub_sentence* parse_segment_cluster_block_group_block(struct mat
     mkv_read_byte(file);    // skip one byte
 
     ULLONG size = pos + len - get_current_byte(file);
-    char* message = read_bytes_signed(file, size);
+    char* message = mkv_store_bytes_signed(mkv_ctx, size);
 
-    struct matroska_sub_sentence* sentence = malloc(sizeof(struct matroska_sub_sentence));
+    struct matroska_sub_sentence* sentence = mkv_store_alloc(mkv_ctx, sizeof(struct matroska_sub_sentence));
     sentence->text = message;
     sentence->text_size = size;
     sentence->time_start = timecode + cluster_timecode;
 	sentence->blockaddition = NULL;
 
     struct matroska_sub_track* track = mkv_ctx->sub_tracks[sub_track_index];
-    if (track->sentence_count==0){
-      track->sentences = malloc(sizeof(struct matroska_sub_sentence*));
+    if (track->sentence_count == track->sentences_size) {
+      track->sentences_size = track->sentences_size ? track->sentences_size * 2 : 16;
+      track->sentences = realloc(track->sentences, track->sentences_size * sizeof(struct matroska_sub_sentence*));
     }
-    else
-      track->sentences = realloc(track->sentences,(track->sentence_count+1)*sizeof(struct matroska_sub_sentence*));
     track->sentences[track->sentence_count] = sentence;
     track->sentence_count++;
 
     mkv_ctx->current_second = max(mkv_ctx->current_second, sentence->time_start / 1000);
-    activity_progress((int) (get_current_byte(file) * 100 / mkv_ctx->ctx->inputsize),
-                      (int) (mkv_ctx->current_second / 60),
-                      (int) (mkv_ctx->current_second % 60));
+    matroska_progress(mkv_ctx);
 
     return sentence;
 }
 
 struct matroska_sub_sentence* parse_segment_cluster_block_group_block_additions(struct matroska_ctx* mkv_ctx, ULLONG cluster_timecode) {
-	FILE* file = mkv_ctx->file;
+	struct matroska_reader* file = &mkv_ctx->file;
 	ULLONG len = read_vint_length(file);
 	ULLONG pos = get_current_byte(file);
 
@@ -295,10 +442,11 @@ struct matroska_sub_sentence* parse_segment_cluster_block_group_block_additions(
 		mkv_read_byte(file);
 
 	ULLONG size = pos + len - get_current_byte(file);
-	char* message = read_bytes_signed(file, size);
+	char* message = mkv_store_bytes_signed(mkv_ctx, size);
 
 	// parses message into block addition
-	struct block_addition *newBA = calloc(1, sizeof(struct block_addition)); 
+	struct block_addition *newBA = mkv_store_alloc(mkv_ctx, sizeof(struct block_addition));
+	memset(newBA, 0, sizeof(struct block_addition));
 	char* current = message;
 	int lastIndex = 0;
 	int item = 0;
@@ -337,13 +485,12 @@ struct matroska_sub_sentence* parse_segment_cluster_block_group_block_additions(
 }
 
 void parse_segment_cluster_block_group(struct matroska_ctx* mkv_ctx, ULLONG cluster_timecode) {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
     ULLONG block_duration = ULONG_MAX;
     struct matroska_sub_sentence* new_sentence;
-    struct matroska_sub_sentence** sentence_list = NULL;
     int sentence_count = 0;
 
     int code = 0, code_len = 0;
@@ -358,8 +505,12 @@ void parse_segment_cluster_block_group(struct matroska_ctx* mkv_ctx, ULLONG clus
             case MATROSKA_SEGMENT_CLUSTER_BLOCK_GROUP_BLOCK:
                 new_sentence = parse_segment_cluster_block_group_block(mkv_ctx, cluster_timecode);
                 if (new_sentence != NULL) {
-                    sentence_list = realloc(sentence_list, sizeof(struct matroska_sub_track*) * (sentence_count + 1));
-                    sentence_list[sentence_count] = new_sentence;
+                    if (sentence_count == mkv_ctx->group_sentences_size) {
+                        mkv_ctx->group_sentences_size = mkv_ctx->group_sentences_size ? mkv_ctx->group_sentences_size * 2 : 4;
+                        mkv_ctx->group_sentences = realloc(mkv_ctx->group_sentences,
+                                sizeof(struct matroska_sub_sentence*) * mkv_ctx->group_sentences_size);
+                    }
+                    mkv_ctx->group_sentences[sentence_count] = new_sentence;
                     sentence_count++;
                 }
                 MATROSKA_SWITCH_BREAK(code, code_len);
@@ -410,6 +561,7 @@ void parse_segment_cluster_block_group(struct matroska_ctx* mkv_ctx, ULLONG clus
         }
     }
 
+    struct matroska_sub_sentence** sentence_list = mkv_ctx->group_sentences;
     for (int i = 0; i < sentence_count; i++)
     {
         // When BlockDuration is not written, the value is assumed to be the difference
@@ -448,12 +600,10 @@ void parse_segment_cluster_block_group(struct matroska_ctx* mkv_ctx, ULLONG clus
             }
         }
     }
-
-    free(sentence_list);
 }
 
 void parse_segment_cluster(struct matroska_ctx* mkv_ctx) {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
@@ -510,9 +660,7 @@ void parse_segment_cluster(struct matroska_ctx* mkv_ctx) {
 
     // We already update activity progress in subtitle block, but we also need to show percents
     // in samples without captions
-    activity_progress((int) (get_current_byte(file) * 100 / mkv_ctx->ctx->inputsize),
-                      (int) (mkv_ctx->current_second / 60),
-                      (int) (mkv_ctx->current_second % 60));
+    matroska_progress(mkv_ctx);
 }
 
 char* get_track_entry_type_description(enum matroska_track_entry_type type) {
@@ -544,7 +692,7 @@ enum matroska_track_subtitle_codec_id get_track_subtitle_codec_id(char* codec_id
 }
 
 void parse_segment_track_entry(struct matroska_ctx* mkv_ctx) {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     mprint("\nTrack entry:\n");
 
     ULLONG len = read_vint_length(file);
@@ -712,6 +860,8 @@ void parse_segment_track_entry(struct matroska_ctx* mkv_ctx) {
         sub_track->lang_index = 0;
         sub_track->codec_id = codec_id;
         sub_track->sentence_count = 0;
+        sub_track->sentences_size = 0;
+        sub_track->sentences = NULL;
 		for (int i = 0; i < mkv_ctx->sub_tracks_count; i++)
 			if (strcmp((const char *)mkv_ctx->sub_tracks[i]->lang, (const char *)lang) == 0)
 				sub_track->lang_index++;
@@ -725,7 +875,7 @@ void parse_segment_track_entry(struct matroska_ctx* mkv_ctx) {
 
 void parse_segment_tracks(struct matroska_ctx* mkv_ctx)
 {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
@@ -762,13 +912,301 @@ void parse_segment_tracks(struct matroska_ctx* mkv_ctx)
     }
 }
 
+void parse_segment_seek_head_seek(struct matroska_ctx* mkv_ctx)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+    ULLONG len = read_vint_length(file);
+    ULLONG pos = get_current_byte(file);
+
+    ULLONG seek_id = 0, seek_position = 0;
+
+    int code = 0, code_len = 0;
+    while (pos + len > get_current_byte(file)) {
+        code <<= 8;
+        code += mkv_read_byte(file);
+        code_len++;
+
+        switch (code) {
+            /* Seek ids */
+            case MATROSKA_SEGMENT_SEEK_ID:
+                seek_id = read_vint_block_int(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_SEEK_POSITION:
+                seek_position = read_vint_block_int(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+
+                /* Misc ids */
+            case MATROSKA_VOID:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_CRC32:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            default:
+                if (code_len == MATROSKA_MAX_ID_LENGTH) {
+                    mprint(MATROSKA_ERROR "Unknown element 0x%x at position " LLD ", skipping seek block\n", code,
+                           get_current_byte(file) - MATROSKA_MAX_ID_LENGTH);
+                    set_bytes(file, pos + len);
+                    return;
+                }
+                break;
+        }
+    }
+
+    if (seek_id == MATROSKA_SEGMENT_CUES)
+        mkv_ctx->cues_position = seek_position;
+}
+
+void parse_segment_seek_head(struct matroska_ctx* mkv_ctx)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+    ULLONG len = read_vint_length(file);
+    ULLONG pos = get_current_byte(file);
+
+    int code = 0, code_len = 0;
+    while (pos + len > get_current_byte(file)) {
+        code <<= 8;
+        code += mkv_read_byte(file);
+        code_len++;
+
+        switch (code) {
+            /* Seek head ids */
+            case MATROSKA_SEGMENT_SEEK:
+                parse_segment_seek_head_seek(mkv_ctx);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+
+                /* Misc ids */
+            case MATROSKA_VOID:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_CRC32:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            default:
+                if (code_len == MATROSKA_MAX_ID_LENGTH) {
+                    mprint(MATROSKA_ERROR "Unknown element 0x%x at position " LLD ", skipping seek head block\n", code,
+                           get_current_byte(file) - MATROSKA_MAX_ID_LENGTH);
+                    set_bytes(file, pos + len);
+                    return;
+                }
+                break;
+        }
+    }
+}
+
+void parse_segment_cue_track_positions(struct matroska_ctx* mkv_ctx, int* sub_track_cued)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+    ULLONG len = read_vint_length(file);
+    ULLONG pos = get_current_byte(file);
+
+    ULLONG track_number = 0, cluster_position = 0;
+    int has_cluster_position = 0;
+
+    int code = 0, code_len = 0;
+    while (pos + len > get_current_byte(file)) {
+        code <<= 8;
+        code += mkv_read_byte(file);
+        code_len++;
+
+        switch (code) {
+            /* Cue track positions ids */
+            case MATROSKA_SEGMENT_CUE_TRACK:
+                track_number = read_vint_block_int(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_CLUSTER_POSITION:
+                cluster_position = read_vint_block_int(file);
+                has_cluster_position = 1;
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_RELATIVE_POSITION:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_DURATION:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_BLOCK_NUMBER:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_CODEC_STATE:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_REFERENCE:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+
+                /* Misc ids */
+            case MATROSKA_VOID:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_CRC32:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            default:
+                if (code_len == MATROSKA_MAX_ID_LENGTH) {
+                    mprint(MATROSKA_ERROR "Unknown element 0x%x at position " LLD ", skipping cue track positions block\n", code,
+                           get_current_byte(file) - MATROSKA_MAX_ID_LENGTH);
+                    set_bytes(file, pos + len);
+                    return;
+                }
+                break;
+        }
+    }
+
+    int sub_track_index = find_sub_track_index(mkv_ctx, track_number);
+    if (sub_track_index == -1 || !has_cluster_position)
+        return;
+    sub_track_cued[sub_track_index] = 1;
+    if (mkv_ctx->sub_clusters_count == mkv_ctx->sub_clusters_size) {
+        mkv_ctx->sub_clusters_size = mkv_ctx->sub_clusters_size ? mkv_ctx->sub_clusters_size * 2 : 64;
+        mkv_ctx->sub_clusters = realloc(mkv_ctx->sub_clusters, sizeof(ULLONG) * mkv_ctx->sub_clusters_size);
+    }
+    mkv_ctx->sub_clusters[mkv_ctx->sub_clusters_count] = cluster_position;
+    mkv_ctx->sub_clusters_count++;
+}
+
+void parse_segment_cue_point(struct matroska_ctx* mkv_ctx, int* sub_track_cued)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+    ULLONG len = read_vint_length(file);
+    ULLONG pos = get_current_byte(file);
+
+    int code = 0, code_len = 0;
+    while (pos + len > get_current_byte(file)) {
+        code <<= 8;
+        code += mkv_read_byte(file);
+        code_len++;
+
+        switch (code) {
+            /* Cue point ids */
+            case MATROSKA_SEGMENT_CUE_TIME:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_SEGMENT_CUE_TRACK_POSITIONS:
+                parse_segment_cue_track_positions(mkv_ctx, sub_track_cued);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+
+                /* Misc ids */
+            case MATROSKA_VOID:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_CRC32:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            default:
+                if (code_len == MATROSKA_MAX_ID_LENGTH) {
+                    mprint(MATROSKA_ERROR "Unknown element 0x%x at position " LLD ", skipping cue point block\n", code,
+                           get_current_byte(file) - MATROSKA_MAX_ID_LENGTH);
+                    set_bytes(file, pos + len);
+                    return;
+                }
+                break;
+        }
+    }
+}
+
+static int cmp_cluster_position(const void* a, const void* b)
+{
+    ULLONG pa = *(const ULLONG*) a, pb = *(const ULLONG*) b;
+    return pa < pb ? -1 : pa > pb;
+}
+
+void parse_segment_cues(struct matroska_ctx* mkv_ctx)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+    ULLONG len = read_vint_length(file);
+    ULLONG pos = get_current_byte(file);
+
+    // Which subtitle tracks have cue points. The clusters are only skipped if
+    // every subtitle track has some, -mkvskipclusters takes it that they are
+    // all cued.
+    int* sub_track_cued = calloc(mkv_ctx->sub_tracks_count + 1, sizeof(int));
+    int incomplete = 0;
+
+    int code = 0, code_len = 0;
+    while (pos + len > get_current_byte(file)) {
+        code <<= 8;
+        code += mkv_read_byte(file);
+        code_len++;
+
+        switch (code) {
+            /* Cues ids */
+            case MATROSKA_SEGMENT_CUE_POINT:
+                parse_segment_cue_point(mkv_ctx, sub_track_cued);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+
+                /* Misc ids */
+            case MATROSKA_VOID:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            case MATROSKA_CRC32:
+                read_vint_block_skip(file);
+                MATROSKA_SWITCH_BREAK(code, code_len);
+            default:
+                if (code_len == MATROSKA_MAX_ID_LENGTH) {
+                    mprint(MATROSKA_ERROR "Unknown element 0x%x at position " LLD ", skipping cues block\n", code,
+                           get_current_byte(file) - MATROSKA_MAX_ID_LENGTH);
+                    set_bytes(file, pos + len);
+                    incomplete = 1;
+                }
+                break;
+        }
+    }
+
+    mkv_ctx->cues_state = MATROSKA_CUES_SUBTITLES;
+    if (mkv_ctx->sub_tracks_count == 0 || incomplete)
+        mkv_ctx->cues_state = MATROSKA_CUES_NOT_USED;
+    for (int i = 0; i < mkv_ctx->sub_tracks_count; i++)
+        if (!sub_track_cued[i])
+            mkv_ctx->cues_state = MATROSKA_CUES_NOT_USED;
+    free(sub_track_cued);
+
+    if (mkv_ctx->cues_state == MATROSKA_CUES_SUBTITLES) {
+        qsort(mkv_ctx->sub_clusters, mkv_ctx->sub_clusters_count, sizeof(ULLONG), cmp_cluster_position);
+        mprint(MATROSKA_INFO "Using the cues to skip clusters without subtitles\n");
+    }
+}
+
+// Whether the Cues show that the cluster whose ID starts at position has no
+// subtitle block. Cues that come after the clusters are found through the
+// SeekHead and read when the first cluster is reached. Only with
+// -mkvskipclusters, as Matroska doesn't require subtitle blocks to be cued.
+int matroska_skip_cluster(struct matroska_ctx* mkv_ctx, ULLONG position)
+{
+    struct matroska_reader* file = &mkv_ctx->file;
+
+    if (!ccx_options.mkv_skip_clusters)
+        return 0;
+    if (mkv_ctx->cues_state == MATROSKA_CUES_UNKNOWN) {
+        mkv_ctx->cues_state = MATROSKA_CUES_NOT_USED;
+        if (mkv_ctx->cues_position != 0) {
+            ULLONG current = get_current_byte(file);
+            int code = 0;
+            set_bytes(file, mkv_ctx->segment_start + mkv_ctx->cues_position);
+            for (int i = 0; i < MATROSKA_MAX_ID_LENGTH; i++) {
+                code <<= 8;
+                code += mkv_read_byte(file);
+            }
+            if (code == MATROSKA_SEGMENT_CUES)
+                parse_segment_cues(mkv_ctx);
+            set_bytes(file, current);
+        }
+    }
+    if (mkv_ctx->cues_state != MATROSKA_CUES_SUBTITLES)
+        return 0;
+
+    position -= mkv_ctx->segment_start;
+    return bsearch(&position, mkv_ctx->sub_clusters, mkv_ctx->sub_clusters_count, sizeof(ULLONG),
+                   cmp_cluster_position) == NULL;
+}
+
 void parse_segment(struct matroska_ctx* mkv_ctx)
 {
-    FILE* file = mkv_ctx->file;
+    struct matroska_reader* file = &mkv_ctx->file;
     ULLONG len = read_vint_length(file);
     ULLONG pos = get_current_byte(file);
 
     int code = 0, code_len = 0;
+    mkv_ctx->segment_start = pos;
     while (pos + len > get_current_byte(file)) {
         code <<= 8;
         code += mkv_read_byte(file);
@@ -776,20 +1214,25 @@ void parse_segment(struct matroska_ctx* mkv_ctx)
         switch (code) {
             /* Segment ids */
             case MATROSKA_SEGMENT_SEEK_HEAD:
-                read_vint_block_skip(file);
+                parse_segment_seek_head(mkv_ctx);
                 MATROSKA_SWITCH_BREAK(code, code_len);
             case MATROSKA_SEGMENT_INFO:
                 parse_segment_info(file);
                 MATROSKA_SWITCH_BREAK(code, code_len);
             case MATROSKA_SEGMENT_CLUSTER:
-                //read_vint_block_skip(file);
-                parse_segment_cluster(mkv_ctx);
+                if (matroska_skip_cluster(mkv_ctx, get_current_byte(file) - MATROSKA_MAX_ID_LENGTH))
+                    read_vint_block_skip(file);
+                else
+                    parse_segment_cluster(mkv_ctx);
                 MATROSKA_SWITCH_BREAK(code, code_len);
             case MATROSKA_SEGMENT_TRACKS:
                 parse_segment_tracks(mkv_ctx);
                 MATROSKA_SWITCH_BREAK(code, code_len);
             case MATROSKA_SEGMENT_CUES:
-                read_vint_block_skip(file);
+                if (mkv_ctx->cues_state == MATROSKA_CUES_UNKNOWN && ccx_options.mkv_skip_clusters)
+                    parse_segment_cues(mkv_ctx);
+                else
+                    read_vint_block_skip(file);
                 MATROSKA_SWITCH_BREAK(code, code_len);
             case MATROSKA_SEGMENT_ATTACHMENTS:
                 read_vint_block_skip(file);
@@ -861,8 +1304,14 @@ void save_sub_track(struct matroska_ctx* mkv_ctx, struct matroska_sub_track* tra
 #endif
     free(filename);
 
+    // Sentences are written a few bytes at a time, buffer them
+    struct ccx_s_write out;
+    memset(&out, 0, sizeof(out));
+    out.fh = desc;
+    out.buffer_size = ccx_options.enc_cfg.output_buffer_size;
+
     if (track->header != NULL)
-        write(desc, track->header, strlen(track->header));
+        write_buffered(&out, track->header, strlen(track->header));
 
     for (int i = 0; i < track->sentence_count; i++)
     {
@@ -871,26 +1320,26 @@ void save_sub_track(struct matroska_ctx* mkv_ctx, struct matroska_sub_track* tra
 
         if(track->codec_id == MATROSKA_TRACK_SUBTITLE_CODEC_ID_WEBVTT)
 		{
-			write(desc, "\n\n", 2);
+			write_buffered(&out, "\n\n", 2);
 
 			struct block_addition* blockaddition = sentence->blockaddition;
 
 			// writing comment
 			if (blockaddition!=NULL) {
 				if (blockaddition->comment != NULL) {
-					write(desc, sentence->blockaddition->comment, sentence->blockaddition->comment_size);
-					write(desc, "\n", 1);
+					write_buffered(&out, sentence->blockaddition->comment, sentence->blockaddition->comment_size);
+					write_buffered(&out, "\n", 1);
 				}
 			}
 
 			// writing cue identifier
 			if (blockaddition != NULL) {
 				if (blockaddition->cue_identifier != NULL) {
-					write(desc, blockaddition->cue_identifier, blockaddition->cue_identifier_size);
-					write(desc, "\n", 1);
+					write_buffered(&out, blockaddition->cue_identifier, blockaddition->cue_identifier_size);
+					write_buffered(&out, "\n", 1);
 				}
 				else if (blockaddition->comment != NULL) {
-					write(desc, "\n", 1);
+					write_buffered(&out, "\n", 1);
 				}
 			}
 
@@ -903,23 +1352,23 @@ void save_sub_track(struct matroska_ctx* mkv_ctx, struct matroska_sub_track* tra
 			char *timestamp_end = malloc(sizeof(char) * 80);
 			timestamp_to_vtttime(time_end, timestamp_end);
 
-			write(desc, timestamp_start, strlen(timestamp_start));
-			write(desc, " --> ", 5);
-			write(desc, timestamp_end, strlen(timestamp_start));
+			write_buffered(&out, timestamp_start, strlen(timestamp_start));
+			write_buffered(&out, " --> ", 5);
+			write_buffered(&out, timestamp_end, strlen(timestamp_start));
 
 			// writing cue settings list
 			if (blockaddition != NULL) {
 				if (blockaddition->cue_settings_list != NULL) {
-					write(desc, " ", 1);
-					write(desc, blockaddition->cue_settings_list, blockaddition->cue_settings_list_size);
+					write_buffered(&out, " ", 1);
+					write_buffered(&out, blockaddition->cue_settings_list, blockaddition->cue_settings_list_size);
 				}
 			}
-			write(desc, "\n", 1);
+			write_buffered(&out, "\n", 1);
 
 			int size = 0;
 			while (*(sentence->text + size) == '\n' || *(sentence->text + size) == '\r')
 				size++;
-			write(desc, sentence->text + size, sentence->text_size - size);
+			write_buffered(&out, sentence->text + size, sentence->text_size - size);
 
 			free(timestamp_start);
 			free(timestamp_end);
@@ -936,17 +1385,17 @@ void save_sub_track(struct matroska_ctx* mkv_ctx, struct matroska_sub_track* tra
             char *timestamp_end = malloc(sizeof(char) * 80);
             timestamp_to_srttime(time_end, timestamp_end);
 
-            write(desc, number, strlen(number));
-            write(desc, "\n", 1);
-            write(desc, timestamp_start, strlen(timestamp_start));
-            write(desc, " --> ", 5);
-            write(desc, timestamp_end, strlen(timestamp_start));
-            write(desc, "\n", 1);
+            write_buffered(&out, number, strlen(number));
+            write_buffered(&out, "\n", 1);
+            write_buffered(&out, timestamp_start, strlen(timestamp_start));
+            write_buffered(&out, " --> ", 5);
+            write_buffered(&out, timestamp_end, strlen(timestamp_start));
+            write_buffered(&out, "\n", 1);
             int size=0;
             while (*(sentence->text+size)=='\n' || *(sentence->text+size)=='\r' )
               size++;
-            write(desc, sentence->text+size, sentence->text_size-size);
-            write(desc, "\n\n", 2);
+            write_buffered(&out, sentence->text+size, sentence->text_size-size);
+            write_buffered(&out, "\n\n", 2);
 
             free(timestamp_start);
             free(timestamp_end);
@@ -959,21 +1408,26 @@ void save_sub_track(struct matroska_ctx* mkv_ctx, struct matroska_sub_track* tra
                 time_end = MIN(time_end, track->sentences[i + 1]->time_start - 1);
             char *timestamp_end = generate_timestamp_ass_ssa(time_end);
 
-            write(desc, "Dialogue: Marked=0,", strlen("Dialogue: Marked=0,"));
-            write(desc, timestamp_start, strlen(timestamp_start));
-            write(desc, ",", 1);
-            write(desc, timestamp_end, strlen(timestamp_start));
-            write(desc, ",", 1);
-            char* text = ass_ssa_sentence_erase_read_order(sentence->text);
+            write_buffered(&out, "Dialogue: Marked=0,", strlen("Dialogue: Marked=0,"));
+            write_buffered(&out, timestamp_start, strlen(timestamp_start));
+            write_buffered(&out, ",", 1);
+            write_buffered(&out, timestamp_end, strlen(timestamp_start));
+            write_buffered(&out, ",", 1);
+            char* erased = ass_ssa_sentence_erase_read_order(sentence->text);
+            char* text = erased;
             while((text[0]=='\\') &&  (text[1]=='n' || text[1]=='N'))
               text+=2;
-            write(desc, text, strlen(text));
-            write(desc, "\n", 1);
+            write_buffered(&out, text, strlen(text));
+            write_buffered(&out, "\n", 1);
+            free(erased);
 
             free(timestamp_start);
             free(timestamp_end);
         }
     }
+
+    free_buffered(&out);
+    close(desc);
 }
 
 void free_sub_track(struct matroska_sub_track* track)
@@ -982,12 +1436,8 @@ void free_sub_track(struct matroska_sub_track* track)
         free(track->header);
     if (track->lang != NULL)
         free(track->lang);
-    for (int i = 0; i < track->sentence_count; i++)
-    {
-        struct matroska_sub_sentence* sentence = track->sentences[i];
-        free(sentence->text);
-        free(sentence);
-    }
+    // The sentences are in the store of the matroska_ctx
+    free(track->sentences);
     free(track);
 }
 
@@ -1008,6 +1458,15 @@ void matroska_free_all(struct matroska_ctx* mkv_ctx)
 {
     for (int i = 0; i < mkv_ctx->sub_tracks_count; i++)
         free_sub_track(mkv_ctx->sub_tracks[i]);
+    free(mkv_ctx->sub_tracks);
+    free(mkv_ctx->sub_clusters);
+    free(mkv_ctx->group_sentences);
+    while (mkv_ctx->store != NULL) {
+        struct matroska_store_chunk* next = mkv_ctx->store->next;
+        free(mkv_ctx->store);
+        mkv_ctx->store = next;
+    }
+    free_matroska_reader(&mkv_ctx->file);
     free(mkv_ctx);
 }
 
@@ -1017,8 +1476,8 @@ void matroska_parse(struct matroska_ctx* mkv_ctx)
 
     mprint("\n");
 
-    FILE* file = mkv_ctx->file;
-    while (!feof(file)) {
+    struct matroska_reader* file = &mkv_ctx->file;
+    while (!file->eof) {
         code <<= 8;
         code += mkv_read_byte(file);
         code_len++;
@@ -1049,10 +1508,6 @@ void matroska_parse(struct matroska_ctx* mkv_ctx)
         }
     }
 
-
-    // Close file stream
-    fclose(file);
-
     mprint("\n");
 }
 
@@ -1072,16 +1527,17 @@ int matroska_loop(struct lib_ccx_ctx *ctx)
     }
 
     // Don't need generated input file
-    // Will read bytes by FILE*
+    // Will read bytes through a window of its own
     close_input_file(ctx);
 
-    struct matroska_ctx *mkv_ctx = malloc(sizeof(struct matroska_ctx));
+    struct matroska_ctx *mkv_ctx = calloc(1, sizeof(struct matroska_ctx));
     mkv_ctx->ctx = ctx;
     mkv_ctx->sub_tracks_count = 0;
     mkv_ctx->sentence_count = 0;
     mkv_ctx->current_second = 0;
+    mkv_ctx->reported_percentage = -1;
     mkv_ctx->filename = ctx->inputfile[ctx->current_file];
-    mkv_ctx->file = create_file(ctx);
+    init_matroska_reader(&mkv_ctx->file, create_file(ctx));
     mkv_ctx->sub_tracks = malloc(sizeof(struct matroska_sub_track**));
 
     matroska_parse(mkv_ctx);
@@ -52,6 +52,11 @@
 #define MATROSKA_SEGMENT_CHAPTERS 0x1043A770
 #define MATROSKA_SEGMENT_TAGS 0x1254C367
 
+/* Segment seek head ids */
+#define MATROSKA_SEGMENT_SEEK 0x4DBB
+#define MATROSKA_SEGMENT_SEEK_ID 0x53AB
+#define MATROSKA_SEGMENT_SEEK_POSITION 0x53AC
+
 /* Segment info ids */
 #define MATROSKA_SEGMENT_INFO_SEGMENT_UID 0x73A4
 #define MATROSKA_SEGMENT_INFO_SEGMENT_FILENAME 0x7384
@@ -89,6 +94,18 @@
 #define MATROSKA_SEGMENT_CLUSTER_BLOCK_GROUP_SLICES 0x8E
 #define MATROSKA_SEGMENT_CLUSTER_BLOCK_GROUP_REFERENCE_FRAME 0xC8
 
+/* Segment cues ids */
+#define MATROSKA_SEGMENT_CUE_POINT 0xBB
+#define MATROSKA_SEGMENT_CUE_TIME 0xB3
+#define MATROSKA_SEGMENT_CUE_TRACK_POSITIONS 0xB7
+#define MATROSKA_SEGMENT_CUE_TRACK 0xF7
+#define MATROSKA_SEGMENT_CUE_CLUSTER_POSITION 0xF1
+#define MATROSKA_SEGMENT_CUE_RELATIVE_POSITION 0xF0
+#define MATROSKA_SEGMENT_CUE_DURATION 0xB2
+#define MATROSKA_SEGMENT_CUE_BLOCK_NUMBER 0x5378
+#define MATROSKA_SEGMENT_CUE_CODEC_STATE 0xEA
+#define MATROSKA_SEGMENT_CUE_REFERENCE 0xDB
+
 /* Segment tracks ids */
 #define MATROSKA_SEGMENT_TRACK_ENTRY 0xAE
 #define MATROSKA_SEGMENT_TRACK_TRACK_NUMBER 0xD7
@@ -137,6 +154,8 @@
 /* Other defines */
 #define MATROSKA_MAX_ID_LENGTH 4
 #define MAX_FILE_NAME_SIZE 260
+#define MATROSKA_READ_WINDOW (1 << 16)
+#define MATROSKA_SEEK_READ 4096
 
 /* Enums */
 enum matroska_track_entry_type {
@@ -149,6 +168,12 @@ enum matroska_track_entry_type {
     MATROSKA_TRACK_TYPE_CONTROL = 0x20,
 };
 
+enum matroska_cues_state {
+    MATROSKA_CUES_UNKNOWN = 0,      // Not read yet
+    MATROSKA_CUES_SUBTITLES,        // Every subtitle track is indexed, clusters without subtitle cues are skipped
+    MATROSKA_CUES_NOT_USED          // Every cluster is parsed
+};
+
 enum matroska_track_subtitle_codec_id {
     MATROSKA_TRACK_SUBTITLE_CODEC_ID_UTF8 = 0,
     MATROSKA_TRACK_SUBTITLE_CODEC_ID_SSA,
@@ -213,9 +238,33 @@ struct matroska_sub_track {
     enum matroska_track_subtitle_codec_id codec_id;
 
     int sentence_count;
+    int sentences_size;     // Allocated size of sentences
     struct matroska_sub_sentence** sentences;
 };
 
+/* The sentences, their text and block additions are kept until the tracks
+   are saved, so they are carved out of chunks freed all at once */
+#define MATROSKA_STORE_CHUNK_SIZE (64 * 1024)
+struct matroska_store_chunk {
+    struct matroska_store_chunk* next;
+    size_t size;
+    size_t used;
+    UBYTE data[];
+};
+
+/* Reads the file through a window, which is grown when a block is bigger */
+struct matroska_reader {
+    FILE* stream;
+    ULLONG file_size;
+    UBYTE* buffer;
+    size_t buffer_size;
+    size_t buffer_len;      // Bytes of the file in buffer
+    size_t buffer_pos;      // Next byte to read in buffer
+    ULLONG buffer_start;    // File position of buffer[0]
+    int seeked;             // The window was dropped by set_bytes(), see mkv_fill()
+    int eof;                // A read went past the end of the file, like feof()
+};
+
 struct matroska_ctx {
     struct matroska_sub_track** sub_tracks;
     struct lib_ccx_ctx* ctx;
@@ -224,36 +273,59 @@ struct matroska_ctx {
     int sentence_count;
     char* filename;
     ULLONG current_second;
-    FILE* file;
+    int reported_percentage;        // Last progress given to activity_progress()
+    ULLONG reported_second;
+    struct matroska_reader file;
+    ULLONG segment_start;           // Seek and cue positions are relative to it
+    ULLONG cues_position;           // From the seek head, 0 if unknown
+    enum matroska_cues_state cues_state;
+    ULLONG* sub_clusters;           // Sorted positions of the clusters with subtitle cues
+    int sub_clusters_count;
+    int sub_clusters_size;          // Allocated size of sub_clusters
+    struct matroska_store_chunk* store;
+    struct matroska_sub_sentence** group_sentences; // Of the block group being parsed
+    int group_sentences_size;
 };
 
 /* Bytestream and parser functions */
-void skip_bytes(FILE* file, ULLONG n);
-void set_bytes(FILE* file, ULLONG n);
-ULLONG get_current_byte(FILE* file);
-UBYTE* read_byte_block(FILE* file, ULLONG n);
-char* read_bytes_signed(FILE* file, ULLONG n);
-UBYTE mkv_read_byte(FILE* file);
-
-ULLONG read_vint_length(FILE* file);
-UBYTE* read_vint_block(FILE* file);
-char* read_vint_block_signed(FILE* file);
-ULLONG read_vint_block_int(FILE* file);
-char* read_vint_block_string(FILE* file);
-void read_vint_block_skip(FILE* file);
-
-void parse_ebml(FILE* file);
-void parse_segment_info(FILE* file);
+void init_matroska_reader(struct matroska_reader* file, FILE* stream);
+void free_matroska_reader(struct matroska_reader* file);
+void skip_bytes(struct matroska_reader* file, ULLONG n);
+void set_bytes(struct matroska_reader* file, ULLONG n);
+ULLONG get_current_byte(struct matroska_reader* file);
+UBYTE* read_byte_block(struct matroska_reader* file, ULLONG n);
+char* read_bytes_signed(struct matroska_reader* file, ULLONG n);
+void* mkv_store_alloc(struct matroska_ctx* mkv_ctx, size_t n);
+char* mkv_store_bytes_signed(struct matroska_ctx* mkv_ctx, ULLONG n);
+UBYTE* view_byte_block(struct matroska_reader* file, ULLONG n); // Valid until the next read, NULL if the file is too short
+UBYTE mkv_read_byte(struct matroska_reader* file);
+
+ULLONG read_vint_length(struct matroska_reader* file);
+UBYTE* read_vint_block(struct matroska_reader* file);
+char* read_vint_block_signed(struct matroska_reader* file);
+ULLONG read_vint_block_int(struct matroska_reader* file);
+char* read_vint_block_string(struct matroska_reader* file);
+void read_vint_block_skip(struct matroska_reader* file);
+
+void parse_ebml(struct matroska_reader* file);
+void parse_segment_info(struct matroska_reader* file);
 struct matroska_sub_sentence* parse_segment_cluster_block_group_block(struct matroska_ctx* mkv_ctx, ULLONG cluster_timecode);
 void parse_segment_cluster_block_group(struct matroska_ctx* mkv_ctx, ULLONG cluster_timecode);
 void parse_segment_cluster(struct matroska_ctx* mkv_ctx);
 void parse_segment_track_entry(struct matroska_ctx* mkv_ctx);
 void parse_segment_tracks(struct matroska_ctx* mkv_ctx);
+void parse_segment_seek_head_seek(struct matroska_ctx* mkv_ctx);
+void parse_segment_seek_head(struct matroska_ctx* mkv_ctx);
+void parse_segment_cue_track_positions(struct matroska_ctx* mkv_ctx, int* sub_track_cued);
+void parse_segment_cue_point(struct matroska_ctx* mkv_ctx, int* sub_track_cued);
+void parse_segment_cues(struct matroska_ctx* mkv_ctx);
+int matroska_skip_cluster(struct matroska_ctx* mkv_ctx, ULLONG position);
 void parse_segment(struct matroska_ctx* mkv_ctx);
 
 /* Writing and helper functions */
 char* generate_timestamp_utf8(ULLONG milliseconds);
 char* generate_timestamp_ass_ssa(ULLONG milliseconds);
+void matroska_progress(struct matroska_ctx* mkv_ctx);
 int find_sub_track_index(struct matroska_ctx* mkv_ctx, ULLONG track_number);
 char*   get_track_entry_type_description(enum matroska_track_entry_type type);
 enum matroska_track_subtitle_codec_id get_track_subtitle_codec_id(char* codec_id);
@@ -7,10 +7,16 @@
 #include <dirent.h>
 #include "ccx_encoders_helpers.h"
 #include "ocr.h"
+#include "ocr_cache.h"
+#include "ocr_pool.h"
+#include "ocr_prep.h"
 #undef OCR_DEBUG
 struct ocrCtx
 {
 	TessBaseAPI* api;
+	const char *lang; // Name of the .traineddata file in use, part of the OCR cache keys
+	int lang_index;   // What init_ocr() was called with, for the threads of the OCR pool
+	struct ocr_prep prep; // Bitmap being OCR'd, and the buffer of its gray image
 };
 
 struct transIntensity
@@ -76,6 +82,7 @@ void delete_ocr (void** arg)
 	struct ocrCtx* ctx = *arg;
 	TessBaseAPIEnd(ctx->api);
 	TessBaseAPIDelete(ctx->api);
+	ocr_prep_free(&ctx->prep);
 	freep(arg);
 }
 
@@ -88,6 +95,8 @@ void* init_ocr(int lang_index)
 	if(!ctx)
 		return NULL;
 	ctx->api = TessBaseAPICreate();
+	ctx->lang_index = lang_index;
+	ocr_prep_init(&ctx->prep);
 
 	/* if language was undefined use english */
 	if(lang_index == 0)
@@ -141,6 +150,7 @@ void* init_ocr(int lang_index)
 	char* pars_vec = strdup("debug_file");
 	char* pars_values = strdup("/dev/null");
 
+	ctx->lang = lang;
 	ret = TessBaseAPIInit4(ctx->api, tessdata_path, lang, ccx_options.ocr_oem, NULL, 0, &pars_vec,
 		&pars_values, 1, false);
 
@@ -158,124 +168,59 @@ fail:
 
 }
 
-BOX* ignore_alpha_at_edge(png_byte *alpha, unsigned char* indata, int w, int h, PIX *in, PIX **out)
-{
-	int i, j, index, start_y=0, end_y=0;
-	int find_end_x = CCX_FALSE;
-	BOX* cropWindow;
-	for (j = 1; j < w-1; j++)
-	{
-		for (i = 0; i < h; i++)
-		{
-			index = indata[i * w + (j)];
-			if(alpha[index] != 0)
-			{
-				if(find_end_x == CCX_FALSE)
-				{
-					start_y = j;
-					find_end_x = CCX_TRUE;
-				}
-				else
-				{
-					end_y = j;
-				}
-			}
-		}
-	}
-	cropWindow = boxCreate(start_y, 0, (w - (start_y + ( w - end_y) )), h - 1);
-	*out = pixClipRectangle(in, cropWindow, NULL);
-	//boxDestroy(&cropWindow);
-
-	return cropWindow;
-}
-
 char* ocr_bitmap(void* arg, png_color *palette,png_byte *alpha, unsigned char* indata,int w, int h, struct image_copy *copy)
 {
 	// uncomment the below lines to output raw image as debug.png iteratively
 	//save_spupng("debug.png", indata, w, h, palette, alpha, 16);
 
-	PIX	*pix = NULL;
-	PIX	*cpix = NULL;
-	PIX	*cpix_gs = NULL; // Grayscale version
-	PIX *color_pix = NULL;
+	PIX	*cpix_gs = NULL; // Grayscale version, cropped
 	PIX *color_pix_out = NULL;
 	char*text_out= NULL;
-	int i,j,index;
-	unsigned int wpl;
-	unsigned int *data,*ppixel;
 	BOOL tess_ret = FALSE;
 	struct ocrCtx* ctx = arg;
-	pix = pixCreate(w, h, 32);
-	color_pix = pixCreate(w, h, 32);
-	if(pix == NULL||color_pix == NULL)
-	{
+	struct ocr_prep_crop crop, crop_points;
+	uint8_t gray[256];
+	const uint8_t *gray_data;
+
+	// ocr_rect() has scanned indata into ctx->prep
+	ocr_prep_crop(&ctx->prep, alpha, copy->nb_colors, &crop);
+	// Where the words Tesseract finds are in the unquantized bitmap
+	ocr_prep_crop(&ctx->prep, copy->alpha, copy->nb_colors, &crop_points);
+	if (!crop.w)
 		return NULL;
-	}
-	wpl = pixGetWpl(pix);
-	data = pixGetData(pix);
-#if LEPTONICA_VERSION > 69
-	pixSetSpp(pix, 4);
-	pixSetSpp(color_pix, 4);
-#endif
-	for (i = 0; i < h; i++)
-	{
-		ppixel = data + i * wpl;
-		for (j = 0; j < w; j++)
-		{
-			index = indata[i * w + (j)];
-			composeRGBPixel(palette[index].red, palette[index].green,palette[index].blue, ppixel);
-			SET_DATA_BYTE(ppixel, L_ALPHA_CHANNEL,alpha[index]);
-			ppixel++;
-		}
-	}
-	ignore_alpha_at_edge(alpha, indata, w, h, pix, &cpix);
 
-	// For the unquantized bitmap
-	wpl = pixGetWpl(color_pix);
-	data = pixGetData(color_pix);
-	for (i = 0; i < h; i++)
-	{
-		ppixel = data + i * wpl;
-		for (j = 0; j < w; j++)
-		{
-			index = copy->data[i * w + (j)];
-			composeRGBPixel(copy->palette[index].red, copy->palette[index].green,copy->palette[index].blue, ppixel);
-			SET_DATA_BYTE(ppixel, L_ALPHA_CHANNEL,copy->alpha[index]);
-			ppixel++;
-		}
-	}
-	
-	BOX *crop_points = ignore_alpha_at_edge(copy->alpha, copy->data, w, h, color_pix, &color_pix_out);
+	// Abhinav95: Converting image to grayscale for OCR to avoid issues with transparency
+	ocr_prep_gray_lut((const uint8_t *)palette, copy->nb_colors, gray);
+	gray_data = ocr_prep_gray(&ctx->prep, indata, gray, &crop);
+	if (gray_data == NULL)
+		return NULL;
+	cpix_gs = pixCreateHeader(crop.w, crop.h, 8);
+	if (cpix_gs == NULL)
+		return NULL;
+	// Borrowed, taken back before pixDestroy()
+	pixSetData(cpix_gs, (l_uint32 *)gray_data);
 #ifdef OCR_DEBUG
 	{
 	char str[128] = "";
 	static int i = 0;
 	sprintf(str,"temp/file_c_%d.jpg",i);
 	printf("Writing file_c_%d.jpg\n", i);
-	pixWrite(str, pixConvertRGBToGray(cpix, 0.0, 0.0, 0.0), IFF_JFIF_JPEG);
+	pixWrite(str, cpix_gs, IFF_JFIF_JPEG);
 	i++;
 	}
 #endif
 
-	cpix_gs = pixConvertRGBToGray(cpix, 0.0, 0.0, 0.0); // Abhinav95: Converting image to grayscale for OCR to avoid issues with transparency
-	if (cpix_gs==NULL)
-		tess_ret=-1;
-	else
-	{
-		TessBaseAPISetImage2(ctx->api, cpix_gs);
-		color_pix_out = TessBaseAPIGetThresholdedImage(ctx->api);
-		tess_ret = TessBaseAPIRecognize(ctx->api, NULL);
-		if (tess_ret) {
-			mprint("\nIn ocr_bitmap: Failed to perform OCR. Skipped.\n");
-
-			pixDestroy(&pix);
-			pixDestroy(&cpix);
-			pixDestroy(&cpix_gs);
-			pixDestroy(&color_pix);
-			pixDestroy(&color_pix_out);
-		
-			return NULL;
-		}
+	TessBaseAPISetImage2(ctx->api, cpix_gs);
+	color_pix_out = TessBaseAPIGetThresholdedImage(ctx->api);
+	tess_ret = TessBaseAPIRecognize(ctx->api, NULL);
+	if (tess_ret) {
+		mprint("\nIn ocr_bitmap: Failed to perform OCR. Skipped.\n");
+
+		pixSetData(cpix_gs, NULL);
+		pixDestroy(&cpix_gs);
+		pixDestroy(&color_pix_out);
+
+		return NULL;
 	}
 
 	char *text_out_from_tes=TessBaseAPIGetUTF8Text(ctx->api);
@@ -346,8 +291,8 @@ char* ocr_bitmap(void* arg, png_color *palette,png_byte *alpha, unsigned char* i
 				{
 					for(int j=x1;j<=x2;j++)
 					{
-						if(copy->data[(crop_points->y+i)*w + (crop_points->x+j)]!=firstpixel)
-							histogram[copy->data[(crop_points->y+i)*w + (crop_points->x+j)]]++;
+						if(copy->data[(crop_points.y+i)*w + (crop_points.x+j)]!=firstpixel)
+							histogram[copy->data[(crop_points.y+i)*w + (crop_points.x+j)]]++;
 					}
 				}
 				/* sorted in increasing order of intensity */
@@ -592,12 +537,8 @@ char* ocr_bitmap(void* arg, png_color *palette,png_byte *alpha, unsigned char* i
 	}
 	// End Color Detection
 
-	// boxDestroy(crop_points);
-
-	pixDestroy(&pix);
-	pixDestroy(&cpix);
+	pixSetData(cpix_gs, NULL);
 	pixDestroy(&cpix_gs);
-	pixDestroy(&color_pix);
 	pixDestroy(&color_pix_out);
     
 	return text_out;
@@ -607,13 +548,12 @@ char* ocr_bitmap(void* arg, png_color *palette,png_byte *alpha, unsigned char* i
  * @param alpha out
  * @param intensity in
  * @param palette out should be already initialized
- * @param bitmap in
- * @param size in size of bitmap
+ * @param image_histogram in occurrences of each color in the bitmap
  * @param max_color in
  * @param nb_color in
  */
 static int quantize_map(png_byte *alpha, png_color *palette,
-		uint8_t *bitmap, int size, int max_color, int nb_color)
+		const uint32_t *image_histogram, int max_color, int nb_color)
 {
 	/*
 	 * occurrence of color in image
@@ -650,8 +590,6 @@ static int quantize_map(png_byte *alpha, png_color *palette,
 		goto end;
 	}
 
-	memset(histogram, 0, nb_color * sizeof(uint32_t));
-
 	/* initializing intensity  ordered table with serial order of unsorted color table */
 	for (int i = 0; i < nb_color; i++)
 	{
@@ -659,11 +597,8 @@ static int quantize_map(png_byte *alpha, png_color *palette,
 	}
 	memset(mcit, 0, nb_color * sizeof(uint32_t));
 
-	/* calculate histogram of image */
-	for (int i = 0; i < size; i++)
-	{
-		histogram[bitmap[i]]++;
-	}
+	/* histogram of image, counted by ocr_prep_scan() */
+	memcpy(histogram, image_histogram, nb_color * sizeof(uint32_t));
 	/* sorted in increasing order of intensity */
 	shell_sort((void*)iot, nb_color, sizeof(*iot), check_trans_tn_intensity, (void*)&ti);
 
@@ -752,10 +687,29 @@ static int quantize_map(png_byte *alpha, png_color *palette,
 
 int ocr_rect(void* arg, struct cc_bitmap *rect, char **str, int bgcolor, int ocr_quantmode)
 {
+	struct ocrCtx* ctx = arg;
 	int ret = 0;
 	png_color *palette = NULL;
 	png_byte *alpha = NULL;
-	
+	uint8_t cache_key[OCR_CACHE_KEY_LENGTH];
+
+	// Repeated display sets and region refreshes send the same bitmap again
+	ocr_cache_key(rect, bgcolor, ocr_quantmode, ctx->lang, cache_key);
+	if (!ocr_pool_is_worker())
+	{
+		if (ocr_cache_get(cache_key, str))
+		{
+			dbg_print(CCX_DMT_DVB, "ocr_rect(): OCR cache hit\n");
+			return 0;
+		}
+		// With -ocrthreads the text comes later, see ocr_reorder_next()
+		if (ocr_pool_submit(ctx->lang_index, rect, bgcolor, ocr_quantmode) == 0)
+		{
+			*str = NULL;
+			return 0;
+		}
+	}
+
 	struct image_copy *copy;
 	copy = (struct image_copy *)malloc(sizeof(struct image_copy));
 	copy->nb_colors = rect->nb_colors;
@@ -783,16 +737,16 @@ int ocr_rect(void* arg, struct cc_bitmap *rect, char **str, int bgcolor, int ocr
 		dbg_print(CCX_DMT_DVB, "ocr_rect(): Trying W*H (%d * %d) so size = %d\n",
 				rect->w, rect->h, size);
 
-		copy->data = (unsigned char *)malloc(sizeof(unsigned char)*size);
-		for(int i = 0; i < size; i++)
-		{
-			copy->data[i] = rect->data0[i];
-		}
+		// Only read, by the color detection
+		copy->data = rect->data0;
+
+		// Histogram for quantize_map() and crop of ocr_bitmap() in one pass
+		ocr_prep_scan(&ctx->prep, rect->data0, rect->w, rect->h);
 
 		switch (ocr_quantmode)
 		{
 			case 1:
-				quantize_map(alpha, palette, rect->data0, size, 3, rect->nb_colors);
+				quantize_map(alpha, palette, ctx->prep.histogram, 3, rect->nb_colors);
 				break;
 
 			// Case 2 reduces the color set of the image
@@ -813,13 +767,13 @@ int ocr_rect(void* arg, struct cc_bitmap *rect, char **str, int bgcolor, int ocr
 		}
 
 		*str = ocr_bitmap(arg, palette, alpha, rect->data0, rect->w, rect->h, copy);
+		ocr_cache_put(cache_key, *str);
 
 end:
 	freep(&palette);
 	freep(&alpha);
 	freep(&copy->palette);
 	freep(&copy->alpha);
-	freep(&copy->data);
 	freep(&copy);
 	return ret;
 
@@ -0,0 +1,303 @@
+#include "lib_ccx.h"
+#include "ccx_common_option.h"
+#include "list.h"
+#include "ocr_cache.h"
+#include "../lib_hash/sha2.h"
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#define OCR_CACHE_MAGIC "CCXOCRC1"
+
+struct ocr_cache_entry
+{
+	uint8_t key[OCR_CACHE_KEY_LENGTH];
+	char *text;                   // NULL when nothing was recognized
+	struct ocr_cache_entry *next; // Next entry in the same bucket
+	struct list_head lru;         // Most recently used first
+};
+
+struct ocr_cache
+{
+	struct ocr_cache_entry **buckets;
+	unsigned nb_buckets; // Power of two
+	unsigned nb_entries;
+	unsigned max_entries;
+	struct list_head lru;
+	unsigned long hits;
+	unsigned long misses;
+};
+
+static struct ocr_cache *cache;
+static int cache_disabled;
+#ifndef _WIN32
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_CACHE() pthread_mutex_lock(&cache_lock)
+#define UNLOCK_CACHE() pthread_mutex_unlock(&cache_lock)
+#else
+#define LOCK_CACHE()
+#define UNLOCK_CACHE()
+#endif
+
+void ocr_cache_key(struct cc_bitmap *rect, int bgcolor, int quantmode, const char *lang,
+		uint8_t key[OCR_CACHE_KEY_LENGTH])
+{
+	SHA256_CTX ctx;
+	char settings[128];
+
+	// Everything ocr_rect() gives a different text for, given the same bitmap
+	snprintf(settings, sizeof(settings), "%dx%d %d %d %d %d %d %d %s", rect->w, rect->h,
+			rect->nb_colors, bgcolor, quantmode, ccx_options.ocr_oem, tlt_config.nofontcolor,
+			ccx_options.write_format, lang ? lang : "");
+	SHA256_Init(&ctx);
+	SHA256_Update(&ctx, (uint8_t *) settings, strlen(settings) + 1);
+	SHA256_Update(&ctx, rect->data1, rect->nb_colors * sizeof(uint32_t));
+	SHA256_Update(&ctx, rect->data0, rect->w * rect->h);
+	SHA256_Final(key, &ctx);
+}
+
+static struct ocr_cache_entry **find_entry(const uint8_t *key)
+{
+	// The key is a hash already, any part of it does as bucket index
+	unsigned b = (key[0] | (key[1] << 8) | (key[2] << 16) | ((unsigned) key[3] << 24)) & (cache->nb_buckets - 1);
+	struct ocr_cache_entry **e;
+
+	for (e = &cache->buckets[b]; *e; e = &(*e)->next)
+		if (!memcmp((*e)->key, key, OCR_CACHE_KEY_LENGTH))
+			break;
+	return e;
+}
+
+static void free_entry(struct ocr_cache_entry *e)
+{
+	free(e->text);
+	free(e);
+}
+
+static void insert_entry(const uint8_t *key, const char *text, size_t len)
+{
+	struct ocr_cache_entry **pe = find_entry(key);
+	struct ocr_cache_entry *e = *pe;
+
+	if (e)
+	{
+		list_move(&e->lru, &cache->lru);
+		return;
+	}
+	if (cache->nb_entries == cache->max_entries)
+	{
+		struct ocr_cache_entry *old = list_entry(cache->lru.prev, struct ocr_cache_entry, lru);
+		struct ocr_cache_entry **po = find_entry(old->key);
+
+		*po = old->next;
+		list_del(&old->lru);
+		free_entry(old);
+		cache->nb_entries--;
+		pe = find_entry(key); // The evicted entry could have been before it in the bucket
+	}
+
+	e = malloc(sizeof(struct ocr_cache_entry));
+	if (!e)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_cache_put: Out of memory.");
+	memcpy(e->key, key, OCR_CACHE_KEY_LENGTH);
+	e->text = NULL;
+	if (text)
+	{
+		e->text = malloc(len + 1);
+		if (!e->text)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_cache_put: Out of memory.");
+		memcpy(e->text, text, len);
+		e->text[len] = 0;
+	}
+	e->next = NULL;
+	*pe = e;
+	list_add(&e->lru, &cache->lru);
+	cache->nb_entries++;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* File: OCR_CACHE_MAGIC, then the entries from the least recently used, each
+ * with the key, the length of the text (0xffffffff for NULL) and the text. */
+static void load_cache(const char *filename)
+{
+	uint8_t head[OCR_CACHE_KEY_LENGTH + 4];
+	char magic[sizeof(OCR_CACHE_MAGIC) - 1];
+	char *text = NULL;
+	unsigned loaded = 0;
+	FILE *f = fopen(filename, "rb");
+
+	if (!f)
+		return; // First run, the file is created on exit
+	if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, OCR_CACHE_MAGIC, sizeof(magic)))
+	{
+		mprint("Warning: %s is not an OCR cache file, ignoring it.\n", filename);
+		fclose(f);
+		return;
+	}
+	while (fread(head, 1, sizeof(head), f) == sizeof(head))
+	{
+		uint32_t len = get_u32(head + OCR_CACHE_KEY_LENGTH);
+
+		if (len == 0xffffffff)
+			insert_entry(head, NULL, 0);
+		else
+		{
+			char *t = realloc(text, len + 1);
+			if (!t)
+				break;
+			text = t;
+			if (fread(text, 1, len, f) != len)
+				break;
+			insert_entry(head, text, len);
+		}
+		loaded++;
+	}
+	free(text);
+	fclose(f);
+	mprint("OCR cache: %u entries loaded from %s\n", loaded, filename);
+}
+
+static void save_cache(const char *filename)
+{
+	struct list_head *pos;
+	char *tmpname = malloc(strlen(filename) + 32);
+	FILE *f;
+	int ok;
+
+	if (!tmpname)
+		return;
+	// Written aside and renamed, so that -jobs children don't mix their caches
+	sprintf(tmpname, "%s.%d.tmp", filename, (int) getpid());
+	f = fopen(tmpname, "wb");
+	if (!f)
+	{
+		mprint("Warning: Unable to write the OCR cache to %s.\n", tmpname);
+		free(tmpname);
+		return;
+	}
+	ok = fwrite(OCR_CACHE_MAGIC, 1, sizeof(OCR_CACHE_MAGIC) - 1, f) == sizeof(OCR_CACHE_MAGIC) - 1;
+	for (pos = cache->lru.prev; pos != &cache->lru; pos = pos->prev)
+	{
+		struct ocr_cache_entry *e = list_entry(pos, struct ocr_cache_entry, lru);
+		uint8_t head[OCR_CACHE_KEY_LENGTH + 4];
+		uint32_t len = e->text ? strlen(e->text) : 0xffffffff;
+
+		memcpy(head, e->key, OCR_CACHE_KEY_LENGTH);
+		put_u32(head + OCR_CACHE_KEY_LENGTH, len);
+		ok = ok && fwrite(head, 1, sizeof(head), f) == sizeof(head);
+		if (e->text)
+			ok = ok && fwrite(e->text, 1, len, f) == len;
+	}
+	ok = !fclose(f) && ok;
+#ifdef _WIN32
+	if (ok)
+		remove(filename);
+#endif
+	if (!ok || rename(tmpname, filename))
+	{
+		mprint("Warning: Unable to write the OCR cache to %s.\n", filename);
+		remove(tmpname);
+	}
+	free(tmpname);
+}
+
+// Create the cache when first used, with the cache lock held
+static int open_cache(void)
+{
+	if (cache)
+		return 1;
+	if (cache_disabled || ccx_options.ocr_cache_size <= 0)
+	{
+		cache_disabled = 1;
+		return 0;
+	}
+
+	cache = malloc(sizeof(struct ocr_cache));
+	if (!cache)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_cache: Out of memory.");
+	cache->max_entries = ccx_options.ocr_cache_size;
+	for (cache->nb_buckets = 64; cache->nb_buckets < cache->max_entries; cache->nb_buckets <<= 1)
+		;
+	cache->buckets = calloc(cache->nb_buckets, sizeof(struct ocr_cache_entry *));
+	if (!cache->buckets)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_cache: Out of memory.");
+	cache->nb_entries = 0;
+	INIT_LIST_HEAD(&cache->lru);
+	cache->hits = 0;
+	cache->misses = 0;
+
+	if (ccx_options.ocr_cache_file)
+		load_cache(ccx_options.ocr_cache_file);
+	return 1;
+}
+
+int ocr_cache_get(const uint8_t key[OCR_CACHE_KEY_LENGTH], char **text)
+{
+	struct ocr_cache_entry *e;
+	int hit = 0;
+
+	LOCK_CACHE();
+	if (open_cache())
+	{
+		e = *find_entry(key);
+		if (e)
+		{
+			list_move(&e->lru, &cache->lru);
+			*text = e->text ? strdup(e->text) : NULL;
+			cache->hits++;
+			hit = 1;
+		}
+		else
+			cache->misses++;
+	}
+	UNLOCK_CACHE();
+	return hit;
+}
+
+void ocr_cache_put(const uint8_t key[OCR_CACHE_KEY_LENGTH], const char *text)
+{
+	LOCK_CACHE();
+	if (open_cache())
+		insert_entry(key, text, text ? strlen(text) : 0);
+	UNLOCK_CACHE();
+}
+
+void ocr_cache_close(void)
+{
+	struct ocr_cache_entry *e, *e1;
+
+	LOCK_CACHE();
+	if (!cache)
+	{
+		UNLOCK_CACHE();
+		return;
+	}
+
+	if (cache->hits + cache->misses)
+		mprint("OCR cache: %lu hits, %lu misses (%.1f%% hits), %u entries\n", cache->hits, cache->misses,
+				100.0 * cache->hits / (cache->hits + cache->misses), cache->nb_entries);
+	if (ccx_options.ocr_cache_file)
+		save_cache(ccx_options.ocr_cache_file);
+
+	list_for_each_entry_safe(e, e1, &cache->lru, lru, struct ocr_cache_entry)
+		free_entry(e);
+	free(cache->buckets);
+	freep(&cache);
+	UNLOCK_CACHE();
+}
@@ -0,0 +1,39 @@
+#ifndef OCR_CACHE_H
+#define OCR_CACHE_H
+
+#include "ccx_decoders_structs.h"
+
+/**
+ * Cache of OCR results, keyed by a SHA-256 hash of the bitmap, its palette
+ * and the settings the text depends on. DVB and DVD streams send the same
+ * bitmap over and over, each hit saves a Tesseract call.
+ *
+ * The cache holds up to ccx_options.ocr_cache_size entries (0 disables it),
+ * evicting the least recently used. With ccx_options.ocr_cache_file it is
+ * loaded from that file when first used and written back to it by
+ * ocr_cache_close(). It can be used from several threads.
+ */
+
+#define OCR_CACHE_KEY_LENGTH 32
+
+void ocr_cache_key(struct cc_bitmap *rect, int bgcolor, int quantmode, const char *lang,
+		uint8_t key[OCR_CACHE_KEY_LENGTH]);
+
+/**
+ * @param text out: a copy of the cached text to be freed by the caller,
+ *                  NULL if nothing was recognized in the bitmap
+ * @return 1 on a hit, 0 on a miss
+ */
+int ocr_cache_get(const uint8_t key[OCR_CACHE_KEY_LENGTH], char **text);
+
+/**
+ * @param text NULL if nothing was recognized in the bitmap
+ */
+void ocr_cache_put(const uint8_t key[OCR_CACHE_KEY_LENGTH], const char *text);
+
+/**
+ * Print the hit and miss counters, save the cache if it has a file and free it.
+ */
+void ocr_cache_close(void);
+
+#endif
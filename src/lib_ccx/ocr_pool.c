@@ -0,0 +1,501 @@
+#include "lib_ccx.h"
+#include "ccx_common_option.h"
+#ifdef ENABLE_OCR
+#include "list.h"
+#include "ocr.h"
+#include "ocr_pool.h"
+#include "ccx_metrics.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+/* Bitmaps waiting for a thread, per thread, before ocr_pool_submit() blocks */
+#define OCR_POOL_QUEUE_PER_THREAD 4
+/* Subtitles in a reorder buffer, per thread, before the encoder waits for the first */
+#define OCR_REORDER_PER_THREAD 4
+
+struct ocr_job
+{
+	struct cc_bitmap rect; // Own copy of the bitmap
+	int bgcolor;
+	int quantmode;
+	int lang_index;
+	struct timespec deadline; // Only with ccx_options.ocr_max_latency
+	char *text;
+	int done;
+	int refs;                 // The rect it was queued for, and the pool until done
+	struct ocr_job *next;     // Queue
+	struct list_head list;    // All the jobs not freed yet
+};
+
+struct ocr_pool
+{
+	pthread_t *threads;
+	int nb_threads;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;  // Queue not empty, or stop
+	pthread_cond_t done_cond;  // A job is done
+	pthread_cond_t space_cond; // Room in the queue
+	struct ocr_job *head;
+	struct ocr_job *tail;
+	int queued;
+	int max_queued;
+	int stop;
+	struct list_head jobs;
+	unsigned long given_up;
+};
+
+struct ocr_reorder
+{
+	struct cc_subtitle *head; // In timestamp order, linked through next and prev
+	struct cc_subtitle *tail;
+	int count;
+	int max_count;
+};
+
+static struct ocr_pool *pool;
+static int pool_failed;
+static pthread_mutex_t pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static CCX_THREAD_LOCAL int is_worker;
+
+int ocr_pool_is_worker(void)
+{
+	return is_worker;
+}
+
+// With the pool lock held
+static void unref_job(struct ocr_job *job)
+{
+	if (--job->refs)
+		return;
+	list_del(&job->list);
+	free(job->text);
+	free(job->rect.data0);
+	free(job->rect.data1);
+	free(job);
+}
+
+static void *ocr_worker_main(void *arg)
+{
+	// Tesseract instances of this thread, made for a language when first needed
+	void *ocr_ctx[NB_LANGUAGE] = { NULL };
+	struct ocr_job *job;
+	char *text;
+
+	is_worker = 1;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (!pool->head && !pool->stop)
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		if (!pool->head)
+			break;
+		job = pool->head;
+		pool->head = job->next;
+		if (!pool->head)
+			pool->tail = NULL;
+		pool->queued--;
+		pthread_cond_signal(&pool->space_cond);
+
+		if (job->refs == 1)
+		{
+			// Nobody waits for it any more
+			job->done = 1;
+			unref_job(job);
+			continue;
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		text = NULL;
+		if (!ocr_ctx[job->lang_index])
+			ocr_ctx[job->lang_index] = init_ocr(job->lang_index);
+		if (ocr_ctx[job->lang_index])
+			ocr_rect(ocr_ctx[job->lang_index], &job->rect, &text, job->bgcolor, job->quantmode);
+
+		pthread_mutex_lock(&pool->lock);
+		job->text = text;
+		job->done = 1;
+		pthread_cond_broadcast(&pool->done_cond);
+		unref_job(job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < NB_LANGUAGE; i++)
+	{
+		if (ocr_ctx[i])
+			delete_ocr(&ocr_ctx[i]);
+	}
+	return NULL;
+}
+
+// Start the pool when first needed, NULL if it isn't wanted or can't start
+static struct ocr_pool *get_pool(void)
+{
+	struct ocr_pool *p;
+
+	pthread_mutex_lock(&pool_init_lock);
+	if (pool || pool_failed || ccx_options.ocr_threads <= 0)
+	{
+		pthread_mutex_unlock(&pool_init_lock);
+		return pool;
+	}
+
+	p = malloc(sizeof(struct ocr_pool));
+	if (!p)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_pool: Out of memory.");
+	p->threads = malloc(ccx_options.ocr_threads * sizeof(pthread_t));
+	if (!p->threads)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_pool: Out of memory.");
+	p->nb_threads = 0;
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->work_cond, NULL);
+	pthread_cond_init(&p->done_cond, NULL);
+	pthread_cond_init(&p->space_cond, NULL);
+	p->head = p->tail = NULL;
+	p->queued = 0;
+	p->max_queued = ccx_options.ocr_threads * OCR_POOL_QUEUE_PER_THREAD;
+	p->stop = 0;
+	INIT_LIST_HEAD(&p->jobs);
+	p->given_up = 0;
+	pool = p;
+
+	for (int i = 0; i < ccx_options.ocr_threads; i++)
+	{
+		if (pthread_create(&p->threads[p->nb_threads], NULL, ocr_worker_main, NULL))
+		{
+			mprint("Warning: Unable to start OCR thread %d.\n", i + 1);
+			break;
+		}
+		p->nb_threads++;
+	}
+	if (!p->nb_threads)
+	{
+		mprint("Warning: OCR will be done on the decoding thread.\n");
+		pool_failed = 1;
+		pool = NULL;
+		free(p->threads);
+		free(p);
+	}
+	pthread_mutex_unlock(&pool_init_lock);
+	return pool;
+}
+
+int ocr_pool_submit(int lang_index, struct cc_bitmap *rect, int bgcolor, int ocr_quantmode)
+{
+	struct ocr_pool *p = get_pool();
+	struct ocr_job *job;
+	int size = rect->w * rect->h;
+
+	rect->ocr_job = NULL;
+	if (!p || lang_index < 0 || lang_index >= NB_LANGUAGE)
+		return -1;
+
+	job = malloc(sizeof(struct ocr_job));
+	if (!job)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_pool_submit: Out of memory.");
+	job->rect = *rect;
+	job->rect.data0 = malloc(size);
+	job->rect.data1 = malloc(rect->nb_colors * sizeof(uint32_t));
+	if (!job->rect.data0 || !job->rect.data1)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_pool_submit: Out of memory.");
+	memcpy(job->rect.data0, rect->data0, size);
+	memcpy(job->rect.data1, rect->data1, rect->nb_colors * sizeof(uint32_t));
+	job->rect.ocr_text = NULL;
+	job->rect.ocr_job = NULL;
+	job->bgcolor = bgcolor;
+	job->quantmode = ocr_quantmode;
+	job->lang_index = lang_index;
+	if (ccx_options.ocr_max_latency)
+	{
+		clock_gettime(CLOCK_REALTIME, &job->deadline);
+		job->deadline.tv_sec += ccx_options.ocr_max_latency / 1000;
+		job->deadline.tv_nsec += (ccx_options.ocr_max_latency % 1000) * 1000000L;
+		if (job->deadline.tv_nsec >= 1000000000L)
+		{
+			job->deadline.tv_sec++;
+			job->deadline.tv_nsec -= 1000000000L;
+		}
+	}
+	job->text = NULL;
+	job->done = 0;
+	job->refs = 2;
+	job->next = NULL;
+
+	pthread_mutex_lock(&p->lock);
+	// Backpressure: decoding can't get further ahead of OCR than the queue
+	while (p->queued >= p->max_queued)
+		pthread_cond_wait(&p->space_cond, &p->lock);
+	list_add_tail(&job->list, &p->jobs);
+	if (p->tail)
+		p->tail->next = job;
+	else
+		p->head = job;
+	p->tail = job;
+	p->queued++;
+	ccx_metrics_queue_depth(CCX_QUEUE_OCR, p->queued);
+	pthread_cond_signal(&p->work_cond);
+	pthread_mutex_unlock(&p->lock);
+
+	rect->ocr_job = job;
+	return 0;
+}
+
+struct ocr_reorder *ocr_reorder_init(void)
+{
+	struct ocr_reorder *rb;
+
+	if (ccx_options.ocr_threads <= 0)
+		return NULL;
+
+	rb = malloc(sizeof(struct ocr_reorder));
+	if (!rb)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_reorder_init: Out of memory.");
+	rb->head = rb->tail = NULL;
+	rb->count = 0;
+	rb->max_count = ccx_options.ocr_threads * OCR_REORDER_PER_THREAD;
+	return rb;
+}
+
+// With the pool lock held
+static int sub_ocr_done(struct cc_subtitle *sub)
+{
+	struct cc_bitmap *rect = sub->data;
+
+	for (int i = 0; i < sub->nb_data; i++, rect++)
+	{
+		if (rect->ocr_job && !rect->ocr_job->done)
+			return 0;
+	}
+	return 1;
+}
+
+// With the pool lock held: 1 once a bitmap of sub is past ccx_options.ocr_max_latency
+static int sub_ocr_late(struct cc_subtitle *sub)
+{
+	struct cc_bitmap *rect = sub->data;
+	struct timespec now;
+
+	if (!ccx_options.ocr_max_latency)
+		return 0;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	for (int i = 0; i < sub->nb_data; i++, rect++)
+	{
+		struct ocr_job *job = rect->ocr_job;
+
+		if (job && !job->done && (now.tv_sec > job->deadline.tv_sec ||
+				(now.tv_sec == job->deadline.tv_sec && now.tv_nsec >= job->deadline.tv_nsec)))
+			return 1;
+	}
+	return 0;
+}
+
+int ocr_reorder_add(struct ocr_reorder *rb, struct cc_subtitle *sub)
+{
+	struct cc_bitmap *rect = sub->data;
+	struct cc_subtitle *node;
+	struct cc_subtitle *after;
+	int i;
+
+	if (!rb || sub->type != CC_BITMAP)
+		return 0;
+
+	// Even once done, the text is only fetched by ocr_reorder_next()
+	for (i = 0; i < sub->nb_data && !rect[i].ocr_job; i++);
+	if (!rb->count && i == sub->nb_data)
+		return 0;
+
+	node = malloc(sizeof(struct cc_subtitle));
+	if (!node)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In ocr_reorder_add: Out of memory.");
+	*node = *sub;
+	sub->data = NULL;
+	sub->nb_data = 0;
+
+	// Subtitles come in timestamp order, but for the odd one out
+	for (after = rb->tail; after && after->start_time > node->start_time; after = after->prev);
+	node->prev = after;
+	node->next = after ? after->next : rb->head;
+	if (after)
+		after->next = node;
+	else
+		rb->head = node;
+	if (node->next)
+		node->next->prev = node;
+	else
+		rb->tail = node;
+	rb->count++;
+	ccx_metrics_queue_depth(CCX_QUEUE_OCR_REORDER, rb->count);
+	return 1;
+}
+
+struct cc_subtitle *ocr_reorder_next(struct ocr_reorder *rb, int flush)
+{
+	struct cc_subtitle *sub;
+	struct cc_bitmap *rect;
+
+	if (!rb || !rb->head)
+		return NULL;
+	sub = rb->head;
+	rect = sub->data;
+
+	pthread_mutex_lock(&pool->lock);
+	// Backpressure: decoding can't get further ahead of the output than the buffer
+	if (!flush && rb->count <= rb->max_count && !sub_ocr_done(sub) && !sub_ocr_late(sub))
+	{
+		pthread_mutex_unlock(&pool->lock);
+		return NULL;
+	}
+	for (int i = 0; i < sub->nb_data; i++, rect++)
+	{
+		struct ocr_job *job = rect->ocr_job;
+		int timed_out = 0;
+
+		if (!job)
+			continue;
+		while (!job->done && !timed_out)
+		{
+			if (ccx_options.ocr_max_latency)
+				timed_out = pthread_cond_timedwait(&pool->done_cond, &pool->lock, &job->deadline) == ETIMEDOUT;
+			else
+				pthread_cond_wait(&pool->done_cond, &pool->lock);
+		}
+		if (job->done)
+		{
+			rect->ocr_text = job->text;
+			job->text = NULL;
+		}
+		else
+		{
+			dbg_print(CCX_DMT_DVB, "ocr_reorder_next(): OCR took longer than %d ms, subtitle left without text\n",
+					ccx_options.ocr_max_latency);
+			pool->given_up++;
+		}
+		rect->ocr_job = NULL;
+		unref_job(job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	rb->head = sub->next;
+	if (rb->head)
+		rb->head->prev = NULL;
+	else
+		rb->tail = NULL;
+	rb->count--;
+	ccx_metrics_queue_depth(CCX_QUEUE_OCR_REORDER, rb->count);
+	sub->next = NULL;
+	return sub;
+}
+
+void ocr_reorder_free(struct ocr_reorder **rb)
+{
+	struct cc_subtitle *sub;
+	struct cc_subtitle *next;
+
+	if (!*rb)
+		return;
+
+	for (sub = (*rb)->head; sub; sub = next)
+	{
+		struct cc_bitmap *rect = sub->data;
+
+		next = sub->next;
+		for (int i = 0; i < sub->nb_data; i++, rect++)
+		{
+			ocr_pool_release(rect);
+			freep(&rect->data0);
+			freep(&rect->data1);
+		}
+		freep(&sub->data);
+		free(sub);
+	}
+	freep(rb);
+}
+
+void ocr_pool_release(struct cc_bitmap *rect)
+{
+	if (!pool || !rect->ocr_job)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	unref_job(rect->ocr_job);
+	rect->ocr_job = NULL;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void ocr_pool_close(void)
+{
+	struct ocr_job *job, *job1;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 0; i < pool->nb_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	if (pool->given_up)
+		mprint("OCR: %lu subtitles left without text, OCR took longer than -ocrlatency\n", pool->given_up);
+
+	// Jobs of subtitles that were never encoded
+	list_for_each_entry_safe(job, job1, &pool->jobs, list, struct ocr_job)
+	{
+		job->refs = 1;
+		unref_job(job);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->space_cond);
+	free(pool->threads);
+	freep(&pool);
+}
+
+#else
+
+int ocr_pool_submit(int lang_index, struct cc_bitmap *rect, int bgcolor, int ocr_quantmode)
+{
+	rect->ocr_job = NULL;
+	return -1;
+}
+
+struct ocr_reorder *ocr_reorder_init(void)
+{
+	return NULL;
+}
+
+int ocr_reorder_add(struct ocr_reorder *rb, struct cc_subtitle *sub)
+{
+	return 0;
+}
+
+struct cc_subtitle *ocr_reorder_next(struct ocr_reorder *rb, int flush)
+{
+	return NULL;
+}
+
+void ocr_reorder_free(struct ocr_reorder **rb)
+{
+}
+
+void ocr_pool_release(struct cc_bitmap *rect)
+{
+}
+
+int ocr_pool_is_worker(void)
+{
+	return 0;
+}
+
+void ocr_pool_close(void)
+{
+}
+
+#endif // _WIN32
+#endif // ENABLE_OCR
@@ -0,0 +1,77 @@
+#ifndef OCR_POOL_H
+#define OCR_POOL_H
+
+#include "ccx_decoders_structs.h"
+
+/**
+ * -ocrthreads: bitmaps are OCR'd by a pool of threads, each with its own
+ * Tesseract instances from init_ocr(), instead of on the decoding thread.
+ *
+ * ocr_rect() hands the bitmap over with ocr_pool_submit() and returns at
+ * once. The text is only needed when the subtitle is encoded: encode_sub()
+ * moves a subtitle whose bitmaps are still being OCR'd into the reorder
+ * buffer of its encoder, and encodes the subtitles of the buffer in timestamp
+ * order as their text comes in. Several subtitles of a stream are OCR'd at
+ * the same time while the output is the same as without the pool.
+ *
+ * Not available on Windows, where OCR stays synchronous.
+ */
+
+/**
+ * Queue rect for OCR. Its bitmap is copied, so it can be freed or changed
+ * once this returns. Blocks while the queue is full.
+ *
+ * @return 0 if queued, -1 if there is no pool and the caller has to do the OCR
+ */
+int ocr_pool_submit(int lang_index, struct cc_bitmap *rect, int bgcolor, int ocr_quantmode);
+
+/**
+ * Subtitles of one encoder waiting for the OCR of their bitmaps.
+ */
+struct ocr_reorder;
+
+/**
+ * @return a new reorder buffer, NULL without -ocrthreads
+ */
+struct ocr_reorder *ocr_reorder_init(void);
+
+/**
+ * Move sub into rb if some of its bitmaps went to the pool or subtitles
+ * before it are still in rb. sub is left without data.
+ *
+ * @return 1 if sub was moved, 0 if it can be encoded now
+ */
+int ocr_reorder_add(struct ocr_reorder *rb, struct cc_subtitle *sub);
+
+/**
+ * Take the first subtitle of rb, in timestamp order, with the ocr_text of its
+ * rects filled in. It is only taken once its OCR is done, unless rb holds too
+ * many subtitles, in which case this waits for it, or flush is set, which
+ * also waits. With ccx_options.ocr_max_latency, a bitmap that isn't OCR'd
+ * within that many ms of being queued is given up and gets no text.
+ *
+ * @return the subtitle, to free() once encoded, or NULL
+ */
+struct cc_subtitle *ocr_reorder_next(struct ocr_reorder *rb, int flush);
+
+/**
+ * Free rb and any subtitle left in it.
+ */
+void ocr_reorder_free(struct ocr_reorder **rb);
+
+/**
+ * Forget about the OCR of rect, which is freed without being encoded.
+ */
+void ocr_pool_release(struct cc_bitmap *rect);
+
+/**
+ * 1 on the threads of the pool.
+ */
+int ocr_pool_is_worker(void);
+
+/**
+ * Stop the threads, once everything queued is done.
+ */
+void ocr_pool_close(void);
+
+#endif
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "ocr_prep.h"
+
+/* pshufb maps 16 indexes at once. Built for any x86 CPU with GCC and clang,
+ * and only used if the CPU has it. */
+#if defined(__SSSE3__) || (defined(_MSC_VER) && defined(__AVX__))
+#include <tmmintrin.h>
+#define OCR_PREP_SSSE3
+#define SSSE3_TARGET
+#define have_ssse3() 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define OCR_PREP_SSSE3
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define have_ssse3() __builtin_cpu_supports("ssse3")
+#endif
+
+// L_RED_WEIGHT, L_GREEN_WEIGHT and L_BLUE_WEIGHT of Leptonica
+#define RED_WEIGHT 0.3f
+#define GREEN_WEIGHT 0.5f
+#define BLUE_WEIGHT 0.2f
+
+void ocr_prep_init(struct ocr_prep *prep)
+{
+	memset(prep, 0, sizeof(struct ocr_prep));
+}
+
+void ocr_prep_free(struct ocr_prep *prep)
+{
+	free(prep->gray);
+	prep->gray = NULL;
+	prep->gray_size = 0;
+}
+
+void ocr_prep_scan(struct ocr_prep *prep, const uint8_t *bitmap, int w, int h)
+{
+	int x, y, v;
+
+	prep->w = w;
+	prep->h = h;
+	memset(prep->histogram, 0, sizeof(prep->histogram));
+	memset(prep->interior, 0, sizeof(prep->interior));
+	for (v = 0; v < 256; v++)
+	{
+		prep->first_col[v] = INT_MAX;
+		prep->last_col[v] = -1;
+	}
+
+	// A row at a time, the crop used to be searched a column at a time
+	for (y = 0; y < h && w > 0; y++)
+	{
+		const uint8_t *row = bitmap + (size_t) y * w;
+
+		prep->histogram[row[0]]++;
+		if (w > 1)
+			prep->histogram[row[w - 1]]++;
+		for (x = 1; x < w - 1; x++)
+		{
+			v = row[x];
+			prep->interior[v]++;
+			if (x < prep->first_col[v])
+				prep->first_col[v] = x;
+			if (x > prep->last_col[v])
+				prep->last_col[v] = x;
+		}
+	}
+
+	prep->max_index = 0;
+	for (v = 0; v < 256; v++)
+	{
+		prep->histogram[v] += prep->interior[v];
+		if (prep->histogram[v])
+			prep->max_index = v;
+	}
+}
+
+void ocr_prep_crop(const struct ocr_prep *prep, const uint8_t *alpha, int nb_colors, struct ocr_prep_crop *crop)
+{
+	uint32_t hits = 0;
+	int first = INT_MAX, last = 0;
+
+	for (int v = 0; v < nb_colors && v < 256; v++)
+	{
+		if (!alpha[v] || !prep->interior[v])
+			continue;
+		hits += prep->interior[v];
+		if (prep->first_col[v] < first)
+			first = prep->first_col[v];
+		if (prep->last_col[v] > last)
+			last = prep->last_col[v];
+	}
+
+	/* Column by column, the first pixel found gave the start and every other
+	 * one the end, so a single pixel left the end at 0. */
+	crop->x = hits ? first : 0;
+	crop->y = 0;
+	crop->w = (hits > 1 ? last : 0) - crop->x;
+	crop->h = prep->h - 1;
+	if (crop->w <= 0 || crop->h <= 0)
+		crop->w = crop->h = 0;
+}
+
+void ocr_prep_gray_lut(const uint8_t *rgb, int nb_colors, uint8_t lut[256])
+{
+	int i;
+
+	for (i = 0; i < nb_colors && i < 256; i++, rgb += 3)
+		lut[i] = (int) (RED_WEIGHT * rgb[0] + GREEN_WEIGHT * rgb[1] + BLUE_WEIGHT * rgb[2] + 0.5);
+	for (; i < 256; i++)
+		lut[i] = 0;
+}
+
+/* A word of 4 pixels, the first in the most significant byte whatever the
+ * byte order, which is how Leptonica stores them. */
+static void gray_row_scalar(const uint8_t *src, uint8_t *dst, int n, const uint8_t *lut)
+{
+	uint32_t *out = (uint32_t *) dst;
+	int x;
+
+	for (x = 0; x + 4 <= n; x += 4)
+		*out++ = ((uint32_t) lut[src[x]] << 24) | (lut[src[x + 1]] << 16) | (lut[src[x + 2]] << 8) | lut[src[x + 3]];
+	if (x < n)
+	{
+		uint32_t word = 0;
+		for (int shift = 24; x < n; x++, shift -= 8)
+			word |= (uint32_t) lut[src[x]] << shift;
+		*out = word;
+	}
+}
+
+#ifdef OCR_PREP_SSSE3
+// x86 is little endian, the bytes of each word are swapped before the lookup
+SSSE3_TARGET static void gray_row_ssse3(const uint8_t *src, uint8_t *dst, int n, const uint8_t *lut)
+{
+	const __m128i table = _mm_loadu_si128((const __m128i *) lut);
+	const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + x)), swap);
+		_mm_storeu_si128((__m128i *) (dst + x), _mm_shuffle_epi8(table, v));
+	}
+	gray_row_scalar(src + x, dst + x, n - x, lut);
+}
+#endif
+
+const uint8_t *ocr_prep_gray(struct ocr_prep *prep, const uint8_t *bitmap, const uint8_t lut[256],
+		const struct ocr_prep_crop *crop)
+{
+	void (*gray_row)(const uint8_t *src, uint8_t *dst, int n, const uint8_t *lut) = gray_row_scalar;
+	size_t size;
+
+	prep->stride = (crop->w + 3) & ~3;
+	size = (size_t) prep->stride * crop->h;
+	if (size > prep->gray_size || !prep->gray)
+	{
+		uint8_t *gray = realloc(prep->gray, size ? size : 4);
+		if (!gray)
+			return NULL;
+		prep->gray = gray;
+		prep->gray_size = size;
+	}
+
+#ifdef OCR_PREP_SSSE3
+	// The 16 bytes table only holds indexes 0 to 15
+	if (prep->max_index < 16 && have_ssse3())
+		gray_row = gray_row_ssse3;
+#endif
+	for (int y = 0; y < crop->h; y++)
+		gray_row(bitmap + (size_t) (crop->y + y) * prep->w + crop->x, prep->gray + (size_t) y * prep->stride, crop->w, lut);
+	return prep->gray;
+}
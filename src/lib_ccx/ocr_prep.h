@@ -0,0 +1,75 @@
+#ifndef OCR_PREP_H
+#define OCR_PREP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Preparation of the image Tesseract gets from a subtitle bitmap of palette
+ * indexes: the edge crop and the grayscale conversion of ocr_bitmap(), done
+ * straight on the indexes instead of on 32 bpp Leptonica images.
+ *
+ * ocr_prep_scan() goes over the bitmap once and keeps what the rest needs:
+ * the histogram quantize_map() works on, and where each index is, from which
+ * ocr_prep_crop() finds the crop for any alpha table. ocr_prep_gray() then
+ * maps the indexes of the crop to gray through a 256 entry table (16 bytes at
+ * a time with SSSE3 when the bitmap has at most 16 colors), into a buffer
+ * that is reused from one bitmap to the next.
+ */
+
+struct ocr_prep
+{
+	// Filled by ocr_prep_scan()
+	int w;
+	int h;
+	int max_index;           // Highest palette index in the bitmap
+	uint32_t histogram[256]; // Pixels of each index
+	uint32_t interior[256];  // Pixels of each index, leaving out the first and last column
+	int first_col[256];      // First and last of these columns each index is in
+	int last_col[256];
+
+	// Filled by ocr_prep_gray()
+	uint8_t *gray;
+	size_t gray_size; // Allocated
+	int stride;       // Bytes from a row to the next, a multiple of 4
+};
+
+struct ocr_prep_crop
+{
+	int x;
+	int y;
+	int w; // 0 with h when there is nothing to crop to
+	int h;
+};
+
+void ocr_prep_init(struct ocr_prep *prep);
+void ocr_prep_free(struct ocr_prep *prep);
+
+void ocr_prep_scan(struct ocr_prep *prep, const uint8_t *bitmap, int w, int h);
+
+/**
+ * The crop ignore_alpha_at_edge() used to make: from the first to the last
+ * column with an index whose alpha isn't 0, leaving out the first and last
+ * column of the bitmap, and the last row.
+ */
+void ocr_prep_crop(const struct ocr_prep *prep, const uint8_t *alpha, int nb_colors, struct ocr_prep_crop *crop);
+
+/**
+ * Gray levels of a palette, as pixConvertRGBToGray() with its default weights.
+ *
+ * @param rgb nb_colors red, green, blue triplets, such as png_color
+ * @param lut out, 0 past nb_colors
+ */
+void ocr_prep_gray_lut(const uint8_t *rgb, int nb_colors, uint8_t lut[256]);
+
+/**
+ * Map the crop of the bitmap given to ocr_prep_scan() to gray. The rows are
+ * prep->stride bytes apart and each 32 bit word holds 4 pixels from its most
+ * significant byte on, as the data of an 8 bpp Leptonica PIX.
+ *
+ * @return prep->gray, valid until the next call, NULL if out of memory
+ */
+const uint8_t *ocr_prep_gray(struct ocr_prep *prep, const uint8_t *bitmap, const uint8_t lut[256],
+		const struct ocr_prep_crop *crop);
+
+#endif
@@ -5,13 +5,201 @@
 #include <io.h>
 #else
 #include <unistd.h>
+#include <sys/uio.h>
+#include <pthread.h>
 #endif
 
+/* Every allocated output buffer, so what they hold is written out when
+   exit() is called before the files are closed: by fatal() or on SIGINT */
+static LIST_HEAD(buffered_outputs);
+static int flush_at_exit_registered;
+#ifndef _WIN32
+static pthread_mutex_t buffered_outputs_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_OUTPUTS() pthread_mutex_lock(&buffered_outputs_lock)
+#define TRYLOCK_OUTPUTS() (pthread_mutex_trylock(&buffered_outputs_lock) == 0)
+#define UNLOCK_OUTPUTS() pthread_mutex_unlock(&buffered_outputs_lock)
+#else
+#define LOCK_OUTPUTS()
+#define TRYLOCK_OUTPUTS() 1
+#define UNLOCK_OUTPUTS()
+#endif
+
+static int write_all(int fh, const unsigned char *data, size_t len)
+{
+	int ret;
+
+	while (len > 0)
+	{
+		ret = write(fh, data, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		data += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/* Write what is buffered. Returns -1 and drops it if it can't be written */
+int flush_buffered(struct ccx_s_write *wb)
+{
+	int ret = 0;
+
+	if (!wb->buffer_used)
+		return 0;
+	if (write_all(wb->fh, wb->buffer, wb->buffer_used) < 0)
+	{
+		mprint("WARNING: Loss of data, unable to write to the output file\n");
+		ret = -1;
+	}
+	wb->buffer_used = 0;
+	return ret;
+}
+
+static void flush_all_buffered(void)
+{
+	struct ccx_s_write *wb;
+
+	// Not waiting: exit() may come from a thread that holds the lock
+	if (!TRYLOCK_OUTPUTS())
+		return;
+	list_for_each_entry(wb, &buffered_outputs, buffered, struct ccx_s_write)
+	{
+		if (wb->fh >= 0)
+			flush_buffered(wb);
+	}
+	UNLOCK_OUTPUTS();
+}
+
+/* Write out what is buffered and free the buffer */
+void free_buffered(struct ccx_s_write *wb)
+{
+	if (!wb->buffer)
+		return;
+	if (wb->fh >= 0)
+		flush_buffered(wb);
+	LOCK_OUTPUTS();
+	list_del(&wb->buffered);
+	UNLOCK_OUTPUTS();
+	freep(&wb->buffer);
+	wb->buffer_used = 0;
+}
+
+/* Same as write() on wb->fh, except that data is kept in the buffer until it
+   is full or flush_buffered() is called. An error in writing data out only
+   shows later, with a warning */
+int write_buffered(struct ccx_s_write *wb, const void *data, size_t len)
+{
+	if (!wb->buffer_size || wb->fh < 0)
+		return write(wb->fh, data, len);
+	if (!wb->buffer)
+	{
+		wb->buffer = malloc(wb->buffer_size);
+		if (!wb->buffer)
+		{
+			wb->buffer_size = 0;
+			return write(wb->fh, data, len);
+		}
+		LOCK_OUTPUTS();
+		if (!flush_at_exit_registered)
+		{
+			atexit(flush_all_buffered);
+			flush_at_exit_registered = 1;
+		}
+		list_add(&wb->buffered, &buffered_outputs);
+		UNLOCK_OUTPUTS();
+	}
+
+	if (wb->buffer_used + len <= wb->buffer_size)
+	{
+		memcpy(wb->buffer + wb->buffer_used, data, len);
+		wb->buffer_used += len;
+		return len;
+	}
+	if (len < wb->buffer_size)
+	{
+		flush_buffered(wb);
+		memcpy(wb->buffer, data, len);
+		wb->buffer_used = len;
+		return len;
+	}
+
+	// Too large to buffer, write it out together with what is buffered
+#ifndef _WIN32
+	if (wb->buffer_used)
+	{
+		struct iovec iov[2];
+		ssize_t ret;
+
+		iov[0].iov_base = wb->buffer;
+		iov[0].iov_len = wb->buffer_used;
+		iov[1].iov_base = (void *) data;
+		iov[1].iov_len = len;
+		do
+			ret = writev(wb->fh, iov, 2);
+		while (ret < 0 && errno == EINTR);
+		if (ret < 0)
+			return flush_buffered(wb) < 0 ? -1 : write(wb->fh, data, len);
+		if ((size_t) ret < wb->buffer_used)
+		{
+			memmove(wb->buffer, wb->buffer + ret, wb->buffer_used - ret);
+			wb->buffer_used -= ret;
+			ret = 0;
+			if (flush_buffered(wb) < 0)
+				return -1;
+		}
+		else
+		{
+			ret -= wb->buffer_used;
+			wb->buffer_used = 0;
+		}
+		if (write_all(wb->fh, (const unsigned char *) data + ret, len - ret) < 0)
+			return -1;
+		return len;
+	}
+#else
+	if (flush_buffered(wb) < 0)
+		return -1;
+#endif
+	return write_all(wb->fh, data, len) < 0 ? -1 : len;
+}
+
+/* fdprintf() for ccx_s_write */
+void printf_buffered(struct ccx_s_write *wb, const char *fmt, ...)
+{
+	va_list ap;
+	char small[256];
+	char *p = small;
+	int n;
+
+	if (wb->fh < 0)
+		return;
+	va_start(ap, fmt);
+	n = vsnprintf(p, sizeof(small), fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if (n >= sizeof(small))
+	{
+		p = malloc(n + 1);
+		if (!p)
+			return;
+		va_start(ap, fmt);
+		vsnprintf(p, n + 1, fmt, ap);
+		va_end(ap);
+	}
+	write_buffered(wb, p, n);
+	if (p != small)
+		free(p);
+}
+
 void dinit_write(struct ccx_s_write *wb)
 {
 #ifdef PYTHON_API
 	return;
 #else
+        free_buffered(wb);
         if (wb->fh > 0)
             close(wb->fh);
         freep(&wb->filename);
@@ -23,6 +211,7 @@ void dinit_write(struct ccx_s_write *wb)
 
 int temporarily_close_output(struct ccx_s_write *wb)
 {
+	flush_buffered(wb);
 	close(wb->fh);
 	wb->fh = -1;
 	wb->temporarily_closed = 1;
@@ -62,6 +251,7 @@ int init_write (struct ccx_s_write *wb, char *filename, int with_semaphore)
         
 	wb->with_semaphore = with_semaphore;
 	wb->append_mode = ccx_options.enc_cfg.append_mode;
+	wb->buffer_size = ccx_options.enc_cfg.output_buffer_size;
 	if(!(wb->append_mode))
 		wb->fh = open (filename, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, S_IREAD | S_IWRITE);
 	else
@@ -8,6 +8,7 @@
 #include "utility.h"
 #include "activity.h"
 #include "ccx_encoders_helpers.h"
+#include "ccx_metrics.h"
 #include "ccx_common_common.h"
 #include "ccx_decoders_708.h"
 #include "compile_info.h"
@@ -298,6 +299,8 @@ void set_input_format (struct ccx_s_options *opt, const char *format)
 		opt->demux_cfg.auto_stream = CCX_SM_MKV;
 	else if (strcmp(format, "mxf") == 0)
 		opt->demux_cfg.auto_stream = CCX_SM_MXF;
+	else if (strcmp(format, "fmp4") == 0)
+		opt->demux_cfg.auto_stream = CCX_SM_FMP4;
 #ifdef WTV_DEBUG
 	else if (strcmp (format,"hex")==0)
 		opt->demux_cfg.auto_stream = CCX_SM_HEX_DUMP;
@@ -344,7 +347,24 @@ void print_usage (void)
 	mprint ("until there are no more files.\n");
 	mprint ("Output will be one single file (either raw or srt). Use this if you made your\n");
 	mprint ("recording in several cuts (to skip commercials for example) but you want one\n");
-	mprint ("subtitle file with contiguous timing.\n\n");
+	mprint ("subtitle file with contiguous timing.\n");
+	mprint ("       -jobs --jobs N: Process the input files as independent jobs instead, up\n");
+	mprint ("                       to N at the same time, each one to its own output file\n");
+	mprint ("                       as if CCExtractor was run once for each. Only the\n");
+	mprint ("                       overall progress is shown. Not available on Windows.\n\n");
+	mprint ("Pipeline metrics:\n");
+	mprint ("        -metrics file: Write to this file the time spent in each processing\n");
+	mprint ("                       stage (read, TS, PES, each decoder, each output\n");
+	mprint ("                       format), the packets, bytes and continuity errors\n");
+	mprint ("                       of each TS PID and the depth of the queues between\n");
+	mprint ("                       threads. The file is replaced every -metricsinterval\n");
+	mprint ("                       seconds, at the end and on SIGUSR2. Without -metrics,\n");
+	mprint ("                       SIGUSR2 writes them to stderr.\n");
+	mprint ("  -metricsinterval s: Seconds between writes of the -metrics file, 0 to\n");
+	mprint ("                       write it only at the end and on SIGUSR2. Default 10.\n");
+	mprint ("                       Only at the end on Windows.\n");
+	mprint ("    -metricsformat f: json (default) or prometheus (text exposition format,\n");
+	mprint ("                       for the textfile collector of node_exporter).\n\n");
 	mprint ("Output file segmentation:\n");
 	mprint ("    -outinterval x output in interval of x seconds\n");
 	mprint ("   --segmentonkeyonly -key: When segmenting files, do it only after a I frame\n");
@@ -360,6 +380,13 @@ void print_usage (void)
 	mprint ("                              port) instead of reading a file. Host and src can be a\n");
 	mprint ("                              hostname or IPv4 address. If host is not specified\n");
 	mprint ("                              then listens on the local host.\n\n");
+	mprint ("    -udprcvbuf bytes: Size of the socket buffer asked to the kernel for -udp,\n");
+	mprint ("                       for high rate streams. Linux caps it at\n");
+	mprint ("                       net.core.rmem_max. Default: system default.\n");
+	mprint ("          -udpring mb: Size of the buffer a receive thread reads -udp\n");
+	mprint ("                       datagrams to, so they aren't lost while captions\n");
+	mprint ("                       are being decoded. 0 reads the socket directly.\n");
+	mprint ("                       Default 16, not available on Windows.\n\n");
 	mprint ("            -sendto host[:port]: Sends data in BIN format to the server\n");
 	mprint ("                                 according to the CCExtractor's protocol over\n");
 	mprint ("                                 TCP. For IPv6 use [address]:port\n");
@@ -411,6 +438,9 @@ void print_usage (void)
 	mprint ("                       m2ts -> BDAV MPEG-2 Transport Stream\n"); 
 	mprint ("                       mkv  -> Matroska container and WebM.\n");
 	mprint ("                       mxf  -> Material Exchange Format (MXF).\n");
+	mprint ("                       fmp4 -> Fragmented MP4 (fMP4, CMAF), read one fragment\n");
+	mprint ("                               at a time. Used for MP4 on stdin, the network\n");
+	mprint ("                               or with --stream, where mp4 doesn't work.\n");
 #ifdef WTV_DEBUG
 	mprint ("                       hex  -> Hexadecimal dump as generated by wtvccdump.\n");
 #endif
@@ -495,6 +525,11 @@ void print_usage (void)
 	mprint ("                       -autoprogram (see below) is used.\n");
 	mprint ("         -autoprogram: If there's more than one program in the stream, just use\n");
 	mprint ("                       the first one we find that contains a suitable stream.\n");
+	mprint ("      -programthreads: With -multiprogram, decode and write each program in a\n");
+	mprint ("                       thread of its own while the input is demuxed. Not\n");
+	mprint ("                       available on Windows, with -outinterval or with\n");
+	mprint ("                       -out=bin and -out=dvdraw, whose writers are shared\n");
+	mprint ("                       by all the programs.\n");
 	mprint ("             -datapid: Don't try to find out the stream for caption/teletext\n");
 	mprint ("                       data, just use this one instead.\n");
 	mprint ("      -datastreamtype: Instead of selecting the stream by its PID, select it\n");
@@ -635,12 +670,27 @@ void print_usage (void)
 	mprint ("                       0: OEM_TESSERACT_ONLY - default value, the fastest mode.\n");
 	mprint ("                       1: OEM_LSTM_ONLY - use LSTM algorithm for recognition.\n");
 	mprint ("                       2: OEM_TESSERACT_LSTM_COMBINED - both algorithms.\n");
+	mprint ("          -ocrcache n: Keep the OCR results of the last n distinct bitmaps\n");
+	mprint ("                       and reuse them when a bitmap is sent again instead of\n");
+	mprint ("                       calling Tesseract. Default 1024, 0 disables the cache.\n");
+	mprint ("   -ocrcachefile file: Load the OCR cache from this file and save it back on\n");
+	mprint ("                       exit, so that runs on the same channel reuse it.\n");
+	mprint ("        -ocrthreads n: OCR bitmaps with n threads while decoding goes on,\n");
+	mprint ("                       instead of on the decoding thread. The output is the\n");
+	mprint ("                       same. Not available on Windows.\n");
+	mprint ("      -ocrlatency ms: With -ocrthreads, output a subtitle without text if its\n");
+	mprint ("                       OCR isn't done within ms milliseconds, so that live\n");
+	mprint ("                       output doesn't fall behind. Default 0: no limit.\n");
 	mprint ("             -mkvlang: For MKV subtitles, select which language's caption\n");
 	mprint ("                       stream will be processed. e.g. 'eng' for English.\n");
 	mprint ("                       Language codes can be either the 3 letters bibliographic\n");
 	mprint ("                       ISO-639-2 form (like \"fre\" for french) or a language\n");
 	mprint ("                       code followed by a dash and a country code for specialities\n");
 	mprint ("                       in languages (like \"fre-ca\" for Canadian French).\n");
+	mprint ("     -mkvskipclusters: Skip the clusters of MKV files that the Cues show have\n");
+	mprint ("                       no subtitles. Faster, but Matroska doesn't require every\n");
+	mprint ("                       subtitle block to be in the Cues, so subtitles the muxer\n");
+	mprint ("                       didn't index are lost.\n");
 	mprint ("          -nospupngocr When processing DVB don't use the OCR to write the text as\n");
 	mprint ("                       comments in the XML file.\n");
 	mprint ("                -font: Specify the full path of the font that is to be used when\n");
@@ -653,12 +703,22 @@ void print_usage (void)
 
 	mprint ("    -bi --bufferinput: Forces input buffering.\n");
 	mprint (" -nobi -nobufferinput: Disables input buffering.\n");
+	mprint ("    -mmap --mmapinput: Map input files into memory instead of reading them.\n");
+	mprint ("                       Packets are then handed out straight from the mapping,\n");
+	mprint ("                       in windows of the -bs size. Only for regular files,\n");
+	mprint ("                       ignored for stdin, network input and live streams.\n");
 	mprint (" -bs --buffersize val: Specify a size for reading, in bytes (suffix with K or\n");
 	mprint ("                       or M for kilobytes and megabytes). Default is 16M.\n");
 	mprint ("                 -koc: keep-output-close. If used then CCExtractor will close\n");
 	mprint ("                       the output file after writing each subtitle frame and\n");
 	mprint ("                       attempt to create it again when needed.\n");
 	mprint ("     -ff --forceflush: Flush the file buffer whenever content is written.\n");
+	mprint ("  -outbufsize --outputbuffersize val: Output is written to the output file\n");
+	mprint ("                       once this much is pending (suffix with K or M for\n");
+	mprint ("                       kilobytes and megabytes), default is 64K. With -ff,\n");
+	mprint ("                       live streams and input other than files, it is also\n");
+	mprint ("                       written after every subtitle. 0 writes every piece\n");
+	mprint ("                       of each subtitle as soon as it is ready.\n");
 	mprint ("\n");
 
 	mprint ("Options that affect the built-in 608 closed caption decoder:\n");
@@ -753,6 +813,10 @@ void print_usage (void)
 	mprint ("\n");
 
 	mprint ("Options that affect debug data:\n");
+#ifdef CCX_NO_VERBOSE_DEBUG
+	mprint ("(This build was made without the output of -debug, -vides, -cbraw,\n");
+	mprint (" -parsedebug, -deblev and -dumpdef.)\n");
+#endif
 
 	mprint ("               -debug: Show lots of debugging output.\n");
 	mprint ("                 -608: Print debug traces from the EIA-608 decoder.\n");
@@ -789,6 +853,14 @@ void print_usage (void)
 	mprint ("          -tpage page: Use this page for subtitles (if this parameter\n");
 	mprint ("                       is not used, try to autodetect). In Spain the\n");
 	mprint ("                       page is always 888, may vary in other countries.\n");
+	mprint ("                       Pages go from 100 to 899.\n");
+	mprint ("-tpage page1,page2,...:\n");
+	mprint ("                       Extract several pages in one pass. The first one\n");
+	mprint ("                       goes to the usual output file, each other one to\n");
+	mprint ("                       a file of its own with _p<page> added to the name,\n");
+	mprint ("                       for example output_p889.srt. Pass \"all\" to\n");
+	mprint ("                       extract every page flagged as subtitles, the\n");
+	mprint ("                       first one seen goes to the usual output file.\n");
 	mprint ("            -tverbose: Enable verbose mode in the teletext decoder.\n\n");
 	mprint ("            -teletext: Force teletext mode even if teletext is not detected.\n");
 	mprint ("                       If used, you should also pass -datapid to specify\n");
@@ -836,6 +908,16 @@ void print_usage (void)
 	mprint ("Sharing extracted captions via TCP:\n");
 	mprint ("      -enable-sharing: Enables real-time sharing of extracted captions\n");
 	mprint ("         -sharing-url: Set url for sharing service in nanomsg format. Default: \"tcp://*:3269\"\n");
+	mprint ("                       A %%d in the url is replaced by the program number, to\n");
+	mprint ("                       share each program on a socket of its own.\n");
+	mprint ("     -sharing-batch n: Send up to n captions per message, each after its\n");
+	mprint ("                       length as a varint. A message that isn't full is\n");
+	mprint ("                       sent -sharing-wait ms after its first caption, as\n");
+	mprint ("                       the next captions come, and at the end of the stream.\n");
+	mprint ("                       Default 1: a single caption per message.\n");
+	mprint ("     -sharing-wait ms: Time given to subscribers to connect before the first\n");
+	mprint ("                       caption is sent, and to a -sharing-batch message to\n");
+	mprint ("                       fill up. Default 1000.\n");
 	mprint ("\n");
 
 	mprint ("CCTranslate application integration:\n");
@@ -1096,6 +1178,46 @@ int atoi_hex (char *s)
 	}
 }
 
+static int parse_tlt_page(char *s)
+{
+	int page = atoi_hex(s);
+
+	if (page < 100 || page > 899)
+		fatal (EXIT_MALFORMED_PARAMETER, "-tpage: Teletext pages go from 100 to 899.\n");
+	return page;
+}
+
+// -tpage page, -tpage page1,page2,... or -tpage all
+void parse_tlt_pages(char *s)
+{
+	char *c;
+
+	if (strcmp(s, "all") == 0)
+	{
+		tlt_config.all_pages = 1;
+		return;
+	}
+	tlt_config.page = parse_tlt_page(s);
+	tlt_config.user_page = tlt_config.page;
+	tlt_config.num_extra_pages = 0;
+	for (c = strchr(s, ','); c; c = strchr(c + 1, ','))
+	{
+		int page = parse_tlt_page(c + 1);
+
+		if (tlt_config.num_extra_pages == CCX_TLT_MAX_EXTRA_PAGES)
+			fatal (EXIT_MALFORMED_PARAMETER, "-tpage accepts up to %d pages.\n", CCX_TLT_MAX_EXTRA_PAGES + 1);
+		// Each page gets an output file named after it
+		if (page == tlt_config.page)
+			fatal (EXIT_MALFORMED_PARAMETER, "-tpage: Page %d is given twice.\n", page);
+		for (int i = 0; i < tlt_config.num_extra_pages; i++)
+		{
+			if (page == tlt_config.extra_pages[i])
+				fatal (EXIT_MALFORMED_PARAMETER, "-tpage: Page %d is given twice.\n", page);
+		}
+		tlt_config.extra_pages[tlt_config.num_extra_pages++] = page;
+	}
+}
+
 void mkvlang_params_check(char* lang){
 	int initial=0, present=0;
 	for(int char_index=0; char_index < strlen(lang);char_index++){
@@ -1369,11 +1491,23 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			opt->buffer_input = 0;
 			continue;
 		}
+		if (strcmp (argv[i],"-mmap")==0 ||
+				strcmp (argv[i],"--mmapinput")==0)
+		{
+			opt->mmap_input = 1;
+			continue;
+		}
 		if (strcmp(argv[i], "-koc") == 0)
 		{
 			opt->keep_output_closed = 1;
 			continue;
 		}
+		if ((strcmp(argv[i], "-outbufsize") == 0 || strcmp(argv[i], "--outputbuffersize") == 0) && i<argc-1)
+		{
+			opt->enc_cfg.output_buffer_size = atol_size(argv[i+1]);
+			i++;
+			continue;
+		}
 		if (strcmp(argv[i], "-ff") == 0 || strcmp(argv[i], "--forceflush") == 0)
 		{
 			opt->force_flush = 1;
@@ -1538,6 +1672,37 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			continue;
 		}
 
+		if (strcmp(argv[i], "-ocrcache") == 0 && i < argc - 1)
+		{
+			i++;
+			opt->ocr_cache_size = atoi(argv[i]);
+			if (opt->ocr_cache_size < 0)
+				fatal(EXIT_MALFORMED_PARAMETER, "-ocrcache must be 0 or more\n");
+			continue;
+		}
+		if (strcmp(argv[i], "-ocrthreads") == 0 && i < argc - 1)
+		{
+			i++;
+			opt->ocr_threads = atoi(argv[i]);
+			if (opt->ocr_threads < 0)
+				fatal(EXIT_MALFORMED_PARAMETER, "-ocrthreads must be 0 or more\n");
+			continue;
+		}
+		if (strcmp(argv[i], "-ocrlatency") == 0 && i < argc - 1)
+		{
+			i++;
+			opt->ocr_max_latency = atoi(argv[i]);
+			if (opt->ocr_max_latency < 0)
+				fatal(EXIT_MALFORMED_PARAMETER, "-ocrlatency must be 0 or more\n");
+			continue;
+		}
+		if (strcmp(argv[i], "-ocrcachefile") == 0 && i < argc - 1)
+		{
+			i++;
+			opt->ocr_cache_file = argv[i];
+			continue;
+		}
+
 		if(strcmp(argv[i],"-mkvlang")==0 && i < argc-1)
 		{
 			i++;
@@ -1547,6 +1712,12 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			continue;
 		}
 
+		if (strcmp(argv[i], "-mkvskipclusters") == 0)
+		{
+			opt->mkv_skip_clusters = 1;
+			continue;
+		}
+
 		/* Output file formats */
 		if (strcmp (argv[i],"-srt")==0 ||
 				strcmp (argv[i],"-dvdraw")==0 ||
@@ -1783,6 +1954,19 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			opt->demux_cfg.ts_allprogram = CCX_TRUE;
 			continue;
 		}
+		if ((strcmp (argv[i],"-jobs")==0 || strcmp (argv[i],"--jobs")==0) && i<argc-1)
+		{
+			opt->jobs = atoi(argv[i+1]);
+			if (opt->jobs < 1)
+				fatal (EXIT_MALFORMED_PARAMETER, "-jobs needs a number of jobs greater than 0.\n");
+			i++;
+			continue;
+		}
+		if (strcmp (argv[i],"-programthreads")==0)
+		{
+			opt->program_threads = 1;
+			continue;
+		}
 		if (strcmp (argv[i],"--stream")==0 ||
 				strcmp (argv[i],"-s")==0)
 		{
@@ -2104,8 +2288,7 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 		/* Teletext stuff */
 		if (strcmp (argv[i],"-tpage")==0 && i<argc-1)
 		{
-			tlt_config.page = atoi_hex(argv[i+1]);
-			tlt_config.user_page = tlt_config.page;
+			parse_tlt_pages(argv[i+1]);
 			i++;
 			continue;
 		}
@@ -2288,6 +2471,47 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			i++;
 			continue;
 		}
+		if (strcmp(argv[i], "-udprcvbuf") == 0 && i < argc - 1)
+		{
+			opt->udp_rcvbuf = atoi(argv[i + 1]);
+			if (opt->udp_rcvbuf < 0)
+				fatal(EXIT_MALFORMED_PARAMETER, "-udprcvbuf must be 0 or more\n");
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "-metrics") == 0 && i < argc - 1)
+		{
+			opt->metrics_file = argv[i + 1];
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "-metricsinterval") == 0 && i < argc - 1)
+		{
+			opt->metrics_interval = atoi(argv[i + 1]);
+			if (opt->metrics_interval < 0 || opt->metrics_interval > 86400)
+				fatal(EXIT_MALFORMED_PARAMETER, "-metricsinterval must be between 0 and 86400\n");
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "-metricsformat") == 0 && i < argc - 1)
+		{
+			if (strcmp(argv[i + 1], "json") == 0)
+				opt->metrics_format = CCX_METRICS_JSON;
+			else if (strcmp(argv[i + 1], "prometheus") == 0)
+				opt->metrics_format = CCX_METRICS_PROMETHEUS;
+			else
+				fatal(EXIT_MALFORMED_PARAMETER, "-metricsformat must be json or prometheus\n");
+			i++;
+			continue;
+		}
+		if (strcmp(argv[i], "-udpring") == 0 && i < argc - 1)
+		{
+			opt->udp_ring_size = atoi(argv[i + 1]);
+			if (opt->udp_ring_size < 0 || opt->udp_ring_size > 1024)
+				fatal(EXIT_MALFORMED_PARAMETER, "-udpring must be between 0 and 1024\n");
+			i++;
+			continue;
+		}
 
 		if (strcmp (argv[i],"-sendto")==0 && i<argc-1)
 		{
@@ -2383,6 +2607,20 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 			i++;
 			continue;
 		}
+		if (!strcmp(argv[i], "-sharing-batch") && i < argc - 1) {
+			opt->sharing_batch = atoi(argv[i + 1]);
+			if (opt->sharing_batch < 1)
+				fatal(EXIT_MALFORMED_PARAMETER, "-sharing-batch must be 1 or more\n");
+			i++;
+			continue;
+		}
+		if (!strcmp(argv[i], "-sharing-wait") && i < argc - 1) {
+			opt->sharing_wait = atoi(argv[i + 1]);
+			if (opt->sharing_wait < 0)
+				fatal(EXIT_MALFORMED_PARAMETER, "-sharing-wait must be 0 or more\n");
+			i++;
+			continue;
+		}
 		if (!strcmp(argv[i], "-translate") && i < argc - 1) {
 			opt->translate_enabled = 1;
 			opt->sharing_enabled = 1;
@@ -2403,7 +2641,8 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 
 	if(opt->demux_cfg.auto_stream ==CCX_SM_MP4 && opt->input_source == CCX_DS_STDIN)
 	{
-		fatal (EXIT_INCOMPATIBLE_PARAMETERS, "MP4 requires an actual file, it's not possible to read from a stream, including stdin.\n");
+		fatal (EXIT_INCOMPATIBLE_PARAMETERS, "MP4 requires an actual file, it's not possible to read from a stream, including stdin.\n"
+				"Fragmented MP4 can be read from a stream with -in=fmp4.\n");
 	}
 
 	if(opt->extract_chapters)
@@ -2452,6 +2691,18 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 		print_error(opt->gui_mode_reports, "Teletext page number could not be lower than 100 or higher than 899\n");
 		return EXIT_NOT_CLASSIFIED;
 	}
+	for (int p = 0; p < tlt_config.num_extra_pages; p++)
+	{
+		if ((tlt_config.extra_pages[p] < 100) || (tlt_config.extra_pages[p] > 899)) {
+			print_error(opt->gui_mode_reports, "Teletext page number could not be lower than 100 or higher than 899\n");
+			return EXIT_NOT_CLASSIFIED;
+		}
+	}
+	if ((tlt_config.num_extra_pages || tlt_config.all_pages) && (opt->cc_to_stdout || opt->send_to_srv))
+	{
+		print_error(opt->gui_mode_reports, "Several teletext pages are written to a file each, -stdout and -sendto can't be used.\n");
+		return EXIT_INCOMPATIBLE_PARAMETERS;
+	}
 
 	if (opt->num_input_files == 0 && opt->input_source  == CCX_DS_FILE)
 	{
@@ -2462,6 +2713,28 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 		print_error(opt->gui_mode_reports, "Live stream mode accepts only one input file.\n");
 		return EXIT_TOO_MANY_INPUT_FILES;
 	}
+	if (opt->jobs > 1)
+	{
+#ifdef _WIN32
+		print_error(opt->gui_mode_reports, "-jobs is not available on Windows.\n");
+		return EXIT_INCOMPATIBLE_PARAMETERS;
+#endif
+		if (opt->input_source != CCX_DS_FILE || opt->live_stream)
+		{
+			print_error(opt->gui_mode_reports, "-jobs only works with input files that are complete.\n");
+			return EXIT_INCOMPATIBLE_PARAMETERS;
+		}
+		if (opt->output_filename || opt->cc_to_stdout)
+		{
+			print_error(opt->gui_mode_reports, "-jobs writes each input file to its own output, -o and -stdout can't be used.\n");
+			return EXIT_INCOMPATIBLE_PARAMETERS;
+		}
+	}
+	if (opt->program_threads && (opt->write_format == CCX_OF_RCWT || opt->write_format == CCX_OF_DVDRAW))
+	{
+		print_error(opt->gui_mode_reports, "-programthreads can't be used with -out=bin or -out=dvdraw, all the programs share one writer.\n");
+		return EXIT_INCOMPATIBLE_PARAMETERS;
+	}
 	if (opt->num_input_files && opt->input_source == CCX_DS_NETWORK)
 	{
 		print_error(opt->gui_mode_reports, "UDP mode is not compatible with input files.\n");
@@ -2531,6 +2804,8 @@ int parse_parameters (struct ccx_s_options *opt, int argc, char *argv[])
 	opt->enc_cfg.millis_separator = opt->millis_separator;
 	opt->enc_cfg.no_font_color = opt->nofontcolor;
 	opt->enc_cfg.force_flush = opt->force_flush;
+	// Whoever reads a live stream's output wants each subtitle as soon as it is done
+	opt->enc_cfg.flush_each_sub = opt->force_flush || opt->live_stream || opt->input_source != CCX_DS_FILE;
 	opt->enc_cfg.append_mode = opt->append_mode;
 	opt->enc_cfg.ucla = opt->ucla;
 	opt->enc_cfg.no_type_setting = opt->notypesetting;
@@ -1,6 +1,8 @@
 #include "lib_ccx.h"
 #include "ccx_common_option.h"
 #include "teletext.h"
+#include "udp_receiver.h"
+#include "ccx_metrics.h"
 
 #include "ccx_decoders_708.h"
 
@@ -32,6 +34,19 @@ void params_dump(struct lib_ccx_ctx *ctx)
 			break;
 	}
 	mprint ("\n");
+	if (ccx_options.input_source == CCX_DS_NETWORK)
+	{
+		mprint ("[UDP receive buffer: ");
+		if (ccx_options.udp_rcvbuf)
+			mprint ("%d bytes", ccx_options.udp_rcvbuf);
+		else
+			mprint ("System default");
+		mprint ("] [UDP ring: ");
+		if (ccx_options.udp_ring_size)
+			mprint ("%d MB]\n", ccx_options.udp_ring_size);
+		else
+			mprint ("No]\n");
+	}
 	mprint ("[Extract: %d] ", ccx_options.extract);
 	mprint ("[Stream mode: ");
 
@@ -102,9 +117,14 @@ void params_dump(struct lib_ccx_ctx *ctx)
 	}
 	mprint ("] ");
 	mprint ("[Debug: %s] ", (ccx_options.debug_mask & CCX_DMT_VERBOSE) ? "Yes": "No");
-	mprint ("[Buffer input: %s]\n", ccx_options.buffer_input ? "Yes": "No");
+	mprint ("[Buffer input: %s] ", ccx_options.buffer_input ? "Yes": "No");
+	mprint ("[Memory mapped input: %s]\n", ccx_options.mmap_input ? "Yes": "No");
 	mprint ("[Use pic_order_cnt_lsb for H.264: %s] ", ccx_options.usepicorder ? "Yes": "No");
 	mprint("[Print CC decoder traces: %s]\n", (ccx_options.debug_mask & CCX_DMT_DECODER_608) ? "Yes" : "No");
+	if (ccx_options.metrics_file)
+		mprint ("[Metrics: %s, %s, every %d s]\n", ccx_options.metrics_file,
+				ccx_options.metrics_format == CCX_METRICS_PROMETHEUS ? "Prometheus" : "JSON",
+				ccx_options.metrics_interval);
 	mprint ("[Target format: %s] ",ctx->extension);
 	mprint ("[Encoding: ");
 	switch (ccx_options.enc_cfg.encoding)
@@ -162,10 +182,23 @@ void params_dump(struct lib_ccx_ctx *ctx)
 	}
 	mprint ("] [Clock frequency: %d]\n",MPEG_CLOCK_FREQ);
 	mprint ("[Teletext page: ");
-	if (tlt_config.page)
-		mprint ("%d]\n",tlt_config.page);
+	if (tlt_config.all_pages)
+		mprint ("All]\n");
+	else if (tlt_config.page)
+	{
+		mprint ("%d",tlt_config.page);
+		for (int i = 0; i < tlt_config.num_extra_pages; i++)
+			mprint (",%d",tlt_config.extra_pages[i]);
+		mprint ("]\n");
+	}
 	else
 		mprint ("Autodetect]\n");
+#ifdef ENABLE_SHARING
+	if (ccx_options.sharing_enabled)
+		mprint ("[Sharing: %s, %d captions per message at most, %d ms for subscribers]\n",
+				ccx_options.sharing_url ? ccx_options.sharing_url : "tcp://*:3269",
+				ccx_options.sharing_batch, ccx_options.sharing_wait);
+#endif //ENABLE_SHARING
 	mprint ("[Start credits text: %s]\n",
 			ccx_options.enc_cfg.start_credits_text?ccx_options.enc_cfg.start_credits_text:"None");
 	if (ccx_options.enc_cfg.start_credits_text)
@@ -205,6 +238,20 @@ void params_dump(struct lib_ccx_ctx *ctx)
 			mprint("Reduced color palette]\n");
 			break;
 	}
+	mprint("[OCR cache: ");
+	if (ccx_options.ocr_cache_size)
+		mprint("%d entries%s%s]\n", ccx_options.ocr_cache_size,
+				ccx_options.ocr_cache_file ? ", file " : "",
+				ccx_options.ocr_cache_file ? ccx_options.ocr_cache_file : "");
+	else
+		mprint("No]\n");
+	if (ccx_options.ocr_threads)
+	{
+		mprint("[OCR threads: %d", ccx_options.ocr_threads);
+		if (ccx_options.ocr_max_latency)
+			mprint(", max latency %d ms", ccx_options.ocr_max_latency);
+		mprint("]\n");
+	}
 }
 
 #define Y_N(cond) ((cond) ? "Yes" : "No")
@@ -267,6 +314,19 @@ void print_file_report(struct lib_ccx_ctx *ctx)
 			printf("network\n");
 			break;
 	}
+	if (demux_ctx->udp_receiver)
+	{
+		struct udp_receiver_stats stats;
+
+		udp_receiver_get_stats(demux_ctx->udp_receiver, &stats);
+		printf("UDP Datagrams: %llu\n", stats.datagrams);
+		if (stats.kernel_drops_known)
+			printf("UDP Datagrams Lost In The Kernel: %lu\n", stats.kernel_drops);
+		printf("UDP Datagrams Lost With The Ring Full: %llu\n", stats.ring_drops);
+		if (stats.truncated)
+			printf("UDP Datagrams Truncated: %llu\n", stats.truncated);
+		printf("UDP Ring Peak: %zu of %zu bytes\n", stats.ring_peak, stats.ring_size);
+	}
 
 	struct cap_info* program;
 	printf("Stream Mode: ");
@@ -324,6 +384,9 @@ void print_file_report(struct lib_ccx_ctx *ctx)
 		case CCX_SM_MP4:
 			printf("MP4\n");
 			break;
+		case CCX_SM_FMP4:
+			printf("Fragmented MP4\n");
+			break;
 		case CCX_SM_MCPOODLESRAW:
 			printf("McPoodle's raw\n");
 			break;
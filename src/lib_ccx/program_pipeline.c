@@ -0,0 +1,455 @@
+#include "program_pipeline.h"
+#include "ccx_metrics.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+
+/* Must be a power of two */
+#define PIPELINE_QUEUE_SIZE 256
+/* A sleeping worker is only woken up once this much work is queued for it */
+#define PIPELINE_WAKE_BATCH 8
+
+struct program_work
+{
+	struct encoder_ctx *enc_ctx;
+	int pid; // -1 if general_loop() has no data node for the program
+	int is_best_data;
+	int last;
+	/* Run this instead, see program_pipeline_call() */
+	void (*call)(struct lib_cc_decode *dec_ctx, void *arg);
+	void *call_arg;
+	enum ccx_bufferdata_type bufferdatatype;
+	LLONG pts;
+	uint64_t private1_min_pts;
+	uint64_t audio_min_pts;
+	unsigned char *data; // Kept with the queue slot and reused
+	size_t len;
+	size_t size;
+};
+
+struct program_worker
+{
+	struct program_pipeline *pl;
+	struct lib_cc_decode *dec_ctx;
+	pthread_t thread;
+
+	struct program_work queue[PIPELINE_QUEUE_SIZE];
+	unsigned tail;       // Next free slot, only written by general_loop()
+	unsigned unfinished; // Work queued and not done yet, slots in use
+	int stop;
+
+	/* Only used to sleep, the queue itself is lock free */
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	int worker_waiting;
+	int producer_waiting;
+
+	int caps;
+
+	/* Last min PTS sent, so unchanged ones aren't queued every iteration */
+	int sent_min_pts;
+	uint64_t sent_private1_min_pts;
+	uint64_t sent_audio_min_pts;
+};
+
+struct encoder_owner
+{
+	struct encoder_ctx *enc_ctx;
+	struct program_worker *worker;
+};
+
+struct program_pipeline
+{
+	struct program_worker *workers[MAX_PROGRAM];
+	int nb_workers;
+
+	/* Data left over by process_data() for each PID, like general_loop()
+	   leaves it in datalist, and the worker allowed to touch it */
+	struct demuxer_data *pid_data[MAX_PSI_PID + 1];
+	struct program_worker *pid_owner[MAX_PSI_PID + 1];
+
+	struct encoder_owner enc_owner[MAX_PROGRAM];
+	int nb_enc_owner;
+
+	/* Until a teletext page is known, tlt_config.page is written by the first
+	   program to find one, and only this worker may look for it */
+	struct program_worker *tlt_owner;
+	int tlt_page_known;
+};
+
+static void wake_worker(struct program_worker *w)
+{
+	if (__atomic_load_n(&w->worker_waiting, __ATOMIC_SEQ_CST))
+	{
+		pthread_mutex_lock(&w->lock);
+		pthread_cond_signal(&w->work_cond);
+		pthread_mutex_unlock(&w->lock);
+	}
+}
+
+/* Wait until no more than max_unfinished works are queued for w */
+static void wait_for_worker(struct program_worker *w, unsigned max_unfinished)
+{
+	if (__atomic_load_n(&w->unfinished, __ATOMIC_SEQ_CST) <= max_unfinished)
+		return;
+
+	wake_worker(w); // It may be sleeping on less than a batch
+	pthread_mutex_lock(&w->lock);
+	__atomic_store_n(&w->producer_waiting, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&w->unfinished, __ATOMIC_SEQ_CST) > max_unfinished)
+		pthread_cond_wait(&w->done_cond, &w->lock);
+	__atomic_store_n(&w->producer_waiting, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void run_program_work(struct program_worker *w, struct program_work *work)
+{
+	struct program_pipeline *pl = w->pl;
+	struct demuxer_data *node = NULL;
+
+	if (work->call)
+	{
+		work->call(w->dec_ctx, work->call_arg);
+		return;
+	}
+
+	if (work->pid >= 0)
+	{
+		node = pl->pid_data[work->pid];
+		if (!node)
+		{
+			node = alloc_demuxer_data();
+			if (!node)
+				fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for the program pipeline");
+			node->stream_pid = work->pid;
+			pl->pid_data[work->pid] = node;
+		}
+		if (work->len > 0)
+		{
+			if (node->len + work->len >= BUFSIZE)
+			{
+				fatal(CCX_COMMON_EXIT_BUG_BUG,
+					"PES data packet (%ld) larger than remaining buffer (%lld).\n"
+					"Please send bug report!",
+					(long) work->len, BUFSIZE - node->len);
+			}
+			memcpy(node->buffer + node->len, work->data, work->len);
+			node->len += work->len;
+		}
+		node->pts = work->pts;
+		node->bufferdatatype = work->bufferdatatype;
+		// get_data_stream() only returns a node with data
+		if (!work->is_best_data && node->len == 0)
+			node = NULL;
+	}
+
+	if (process_program_data(work->enc_ctx, w->dec_ctx, node,
+				work->private1_min_pts, work->audio_min_pts, work->last))
+		w->caps = 1;
+}
+
+static void *program_worker_main(void *arg)
+{
+	struct program_worker *w = arg;
+	unsigned head = 0;
+
+	for (;;)
+	{
+		if (head == __atomic_load_n(&w->tail, __ATOMIC_SEQ_CST))
+		{
+			pthread_mutex_lock(&w->lock);
+			__atomic_store_n(&w->worker_waiting, 1, __ATOMIC_SEQ_CST);
+			while (head == __atomic_load_n(&w->tail, __ATOMIC_SEQ_CST) &&
+					!__atomic_load_n(&w->stop, __ATOMIC_SEQ_CST))
+				pthread_cond_wait(&w->work_cond, &w->lock);
+			__atomic_store_n(&w->worker_waiting, 0, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&w->lock);
+			if (head == __atomic_load_n(&w->tail, __ATOMIC_SEQ_CST))
+				break; // Stopped with nothing left to do
+		}
+
+		run_program_work(w, &w->queue[head & (PIPELINE_QUEUE_SIZE - 1)]);
+		head++;
+
+		__atomic_sub_fetch(&w->unfinished, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&w->producer_waiting, __ATOMIC_SEQ_CST))
+		{
+			pthread_mutex_lock(&w->lock);
+			pthread_cond_signal(&w->done_cond);
+			pthread_mutex_unlock(&w->lock);
+		}
+	}
+	return NULL;
+}
+
+static struct program_worker *get_worker(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx)
+{
+	struct program_worker *w;
+	int i;
+
+	for (i = 0; i < pl->nb_workers; i++)
+	{
+		if (pl->workers[i]->dec_ctx == dec_ctx)
+			return pl->workers[i];
+	}
+	if (pl->nb_workers == MAX_PROGRAM)
+		fatal(CCX_COMMON_EXIT_BUG_BUG, "In get_worker: More decoders than programs.\n");
+
+	w = calloc(1, sizeof(struct program_worker));
+	if (!w)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for the program pipeline");
+	w->pl = pl;
+	w->dec_ctx = dec_ctx;
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->work_cond, NULL);
+	pthread_cond_init(&w->done_cond, NULL);
+	if (pthread_create(&w->thread, NULL, program_worker_main, w))
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "Unable to start a program decoding thread");
+	pl->workers[pl->nb_workers++] = w;
+	dbg_print(CCX_DMT_VERBOSE, "Decoding program %d in its own thread.\n", dec_ctx->program_number);
+	return w;
+}
+
+/* Make w the only worker allowed to use a resource once its owner is done */
+static void claim(struct program_worker **owner, struct program_worker *w)
+{
+	if (*owner && *owner != w)
+		wait_for_worker(*owner, 0);
+	*owner = w;
+}
+
+static void claim_encoder(struct program_pipeline *pl, struct encoder_ctx *enc_ctx, struct program_worker *w)
+{
+	int i;
+
+	for (i = 0; i < pl->nb_enc_owner; i++)
+	{
+		if (pl->enc_owner[i].enc_ctx == enc_ctx)
+		{
+			claim(&pl->enc_owner[i].worker, w);
+			return;
+		}
+	}
+	if (pl->nb_enc_owner == MAX_PROGRAM)
+		fatal(CCX_COMMON_EXIT_BUG_BUG, "In claim_encoder: More encoders than programs.\n");
+	pl->enc_owner[pl->nb_enc_owner].enc_ctx = enc_ctx;
+	pl->enc_owner[pl->nb_enc_owner].worker = w;
+	pl->nb_enc_owner++;
+}
+
+/* Teletext work goes to one worker at a time until a page is known */
+static void claim_tlt_page(struct program_pipeline *pl, struct program_worker *w)
+{
+	if (pl->tlt_page_known || pl->tlt_owner == w)
+		return;
+	if (pl->tlt_owner)
+		wait_for_worker(pl->tlt_owner, 0);
+	// No worker can be writing tlt_config.page now
+	if (tlt_config.page)
+		pl->tlt_page_known = 1;
+	else
+		pl->tlt_owner = w;
+}
+
+static struct program_work *get_free_slot(struct program_worker *w)
+{
+	wait_for_worker(w, PIPELINE_QUEUE_SIZE - 1);
+	return &w->queue[w->tail & (PIPELINE_QUEUE_SIZE - 1)];
+}
+
+static void push_work(struct program_worker *w, int urgent)
+{
+	unsigned unfinished = __atomic_add_fetch(&w->unfinished, 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&w->tail, w->tail + 1, __ATOMIC_SEQ_CST);
+	ccx_metrics_queue_depth(CCX_QUEUE_PROGRAM, unfinished);
+	if (urgent || unfinished >= PIPELINE_WAKE_BATCH)
+		wake_worker(w);
+}
+
+struct program_pipeline *init_program_pipeline(struct lib_ccx_ctx *ctx)
+{
+	struct program_pipeline *pl = calloc(1, sizeof(struct program_pipeline));
+
+	if (!pl)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for the program pipeline");
+	pl->tlt_page_known = tlt_config.page != 0;
+	return pl;
+}
+
+void program_pipeline_submit(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		struct encoder_ctx *enc_ctx, struct demuxer_data *data_node, int is_best_data,
+		uint64_t private1_min_pts, uint64_t audio_min_pts, int last)
+{
+	struct program_worker *w = get_worker(pl, dec_ctx);
+	struct program_work *work;
+	int pid = -1;
+
+	if (data_node)
+	{
+		pid = data_node->stream_pid;
+		if (pid < 0 || pid > MAX_PSI_PID)
+			fatal(CCX_COMMON_EXIT_BUG_BUG, "In program_pipeline_submit: Invalid PID %d.\n", pid);
+		claim(&pl->pid_owner[pid], w);
+		/* general_loop() would go over data left over by process_data() again,
+		   but that can't get any further without new data */
+		if (!is_best_data && data_node->len == 0)
+			pid = -1;
+	}
+	if (enc_ctx)
+		claim_encoder(pl, enc_ctx, w);
+	if (dec_ctx->codec == CCX_CODEC_TELETEXT)
+		claim_tlt_page(pl, w);
+
+	if (pid < 0 && w->sent_min_pts &&
+			w->sent_private1_min_pts == private1_min_pts && w->sent_audio_min_pts == audio_min_pts)
+		return; // Nothing for the worker to do
+
+	work = get_free_slot(w);
+	work->enc_ctx = enc_ctx;
+	work->pid = pid;
+	work->is_best_data = is_best_data;
+	work->last = last;
+	work->call = NULL;
+	work->private1_min_pts = private1_min_pts;
+	work->audio_min_pts = audio_min_pts;
+	work->len = 0;
+	if (pid >= 0)
+	{
+		work->bufferdatatype = data_node->bufferdatatype;
+		work->pts = data_node->pts;
+		if (data_node->len > work->size)
+		{
+			work->data = realloc(work->data, data_node->len);
+			if (!work->data)
+				fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory for the program pipeline");
+			work->size = data_node->len;
+		}
+		memcpy(work->data, data_node->buffer, data_node->len);
+		work->len = data_node->len;
+		data_node->len = 0;
+	}
+	push_work(w, last);
+
+	w->sent_min_pts = 1;
+	w->sent_private1_min_pts = private1_min_pts;
+	w->sent_audio_min_pts = audio_min_pts;
+}
+
+void program_pipeline_call(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		void (*fn)(struct lib_cc_decode *dec_ctx, void *arg), void *arg)
+{
+	struct program_work *work;
+	int i;
+
+	for (i = 0; pl && i < pl->nb_workers; i++)
+	{
+		if (pl->workers[i]->dec_ctx == dec_ctx)
+		{
+			work = get_free_slot(pl->workers[i]);
+			work->call = fn;
+			work->call_arg = arg;
+			push_work(pl->workers[i], 1);
+			wait_for_worker(pl->workers[i], 0);
+			return;
+		}
+	}
+	fn(dec_ctx, arg);
+}
+
+int program_pipeline_end_file(struct program_pipeline *pl)
+{
+	struct program_worker *w;
+	int caps = 0;
+	int i;
+
+	for (i = 0; i < pl->nb_workers; i++)
+	{
+		w = pl->workers[i];
+		wait_for_worker(w, 0);
+		caps |= w->caps;
+		w->caps = 0;
+		w->sent_min_pts = 0;
+	}
+	for (i = 0; i <= MAX_PSI_PID; i++)
+	{
+		if (pl->pid_data[i])
+			delete_demuxer_data(pl->pid_data[i]);
+		pl->pid_data[i] = NULL;
+	}
+	return caps;
+}
+
+void program_pipeline_forget_tlt_page(struct program_pipeline *pl)
+{
+	if (!pl)
+		return;
+	for (int i = 0; i < pl->nb_workers; i++)
+		wait_for_worker(pl->workers[i], 0);
+	pl->tlt_owner = NULL;
+	pl->tlt_page_known = 0;
+}
+
+void dinit_program_pipeline(struct program_pipeline **arg)
+{
+	struct program_pipeline *pl = *arg;
+	struct program_worker *w;
+	int i;
+
+	for (i = 0; i < pl->nb_workers; i++)
+	{
+		w = pl->workers[i];
+		pthread_mutex_lock(&w->lock);
+		__atomic_store_n(&w->stop, 1, __ATOMIC_SEQ_CST);
+		pthread_cond_signal(&w->work_cond);
+		pthread_mutex_unlock(&w->lock);
+		pthread_join(w->thread, NULL);
+
+		for (int j = 0; j < PIPELINE_QUEUE_SIZE; j++)
+			free(w->queue[j].data);
+		pthread_mutex_destroy(&w->lock);
+		pthread_cond_destroy(&w->work_cond);
+		pthread_cond_destroy(&w->done_cond);
+		free(w);
+	}
+	for (i = 0; i <= MAX_PSI_PID; i++)
+	{
+		if (pl->pid_data[i])
+			delete_demuxer_data(pl->pid_data[i]);
+	}
+	freep(arg);
+}
+
+#else // _WIN32
+
+struct program_pipeline *init_program_pipeline(struct lib_ccx_ctx *ctx)
+{
+	return NULL;
+}
+
+void program_pipeline_submit(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		struct encoder_ctx *enc_ctx, struct demuxer_data *data_node, int is_best_data,
+		uint64_t private1_min_pts, uint64_t audio_min_pts, int last)
+{
+}
+
+void program_pipeline_call(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		void (*fn)(struct lib_cc_decode *dec_ctx, void *arg), void *arg)
+{
+	fn(dec_ctx, arg);
+}
+
+int program_pipeline_end_file(struct program_pipeline *pl)
+{
+	return 0;
+}
+
+void program_pipeline_forget_tlt_page(struct program_pipeline *pl)
+{
+}
+
+void dinit_program_pipeline(struct program_pipeline **arg)
+{
+}
+
+#endif
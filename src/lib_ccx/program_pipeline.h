@@ -0,0 +1,65 @@
+#ifndef PROGRAM_PIPELINE_H
+#define PROGRAM_PIPELINE_H
+
+#include "lib_ccx.h"
+
+/**
+ * -multiprogram -programthreads: the demuxer keeps running in general_loop()
+ * while every program is decoded and encoded by a worker thread of its own.
+ * The workers are kept for the whole run, like the decoders, so the state
+ * they keep in thread local globals goes on from one input file to the next.
+ * Work for a worker goes through a single producer/single consumer queue, in
+ * the same order general_loop() would have done it.
+ */
+struct program_pipeline;
+
+/**
+ * Return NULL if threads aren't available on this platform, in which case
+ * general_loop() decodes the programs itself.
+ */
+struct program_pipeline *init_program_pipeline(struct lib_ccx_ctx *ctx);
+
+/**
+ * Queue for the worker owning dec_ctx what general_loop() would do for one
+ * program in one iteration, see process_program_data().
+ *
+ * @param data_node node of datalist chosen for the program. Its data is
+ *                  moved to the worker, so len is 0 on return.
+ * @param is_best_data data_node came from get_best_data(), which general_loop()
+ *                  processes even when empty, instead of get_data_stream().
+ */
+void program_pipeline_submit(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		struct encoder_ctx *enc_ctx, struct demuxer_data *data_node, int is_best_data,
+		uint64_t private1_min_pts, uint64_t audio_min_pts, int last);
+
+/**
+ * Run fn(dec_ctx, arg) in the thread of the worker owning dec_ctx once it is
+ * done with everything queued, and wait for it, so fn sees the decoding state
+ * that worker keeps in thread local globals. fn is called right away if pl is
+ * NULL or no worker owns dec_ctx.
+ */
+void program_pipeline_call(struct program_pipeline *pl, struct lib_cc_decode *dec_ctx,
+		void (*fn)(struct lib_cc_decode *dec_ctx, void *arg), void *arg);
+
+/**
+ * Wait for the workers to finish everything queued for the current input
+ * file and drop the data left over, as general_loop() does with its datalist.
+ * The workers are kept for the next file.
+ *
+ * @return 1 if any worker found captions in the file, as general_loop()
+ *         reports it.
+ */
+int program_pipeline_end_file(struct program_pipeline *pl);
+
+/**
+ * Wait for the workers to be done with tlt_config.page, so it can be reset
+ * when the PAT changes. Does nothing if pl is NULL.
+ */
+void program_pipeline_forget_tlt_page(struct program_pipeline *pl);
+
+/**
+ * Stop the workers, once done with everything queued.
+ */
+void dinit_program_pipeline(struct program_pipeline **pl);
+
+#endif
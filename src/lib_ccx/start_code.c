@@ -0,0 +1,143 @@
+#include "start_code.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define START_CODE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define START_CODE_NEON
+#endif
+
+/* Built for any x86 CPU with GCC and clang, and only used if the CPU has it */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define START_CODE_AVX2
+#define AVX2_TARGET
+#define have_avx2() 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define START_CODE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define have_avx2() __builtin_cpu_supports("avx2")
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static int lowest_bit(uint32_t v)
+{
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return (int) i;
+}
+#else
+#define lowest_bit(v) __builtin_ctz(v)
+#endif
+
+static const uint8_t *find_scalar(const uint8_t *p, const uint8_t *end)
+{
+	// Looking at the third byte first: unless it is 0 no prefix starts at
+	// p + 1 or p + 2, and unless it is 1 none starts at p
+	while (p + 2 < end)
+	{
+		if (p[2] > 1)
+			p += 3;
+		else if (p[2] == 0)
+			p++;
+		else if (p[1] == 0 && p[0] == 0)
+			return p;
+		else
+			p += 3;
+	}
+	return NULL;
+}
+
+#ifdef START_CODE_SSE2
+static const uint8_t *find_sse2(const uint8_t *p, const uint8_t *end)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+
+	// Lane i of the three loads holds bytes i, i + 1 and i + 2 of p
+	for (; end - p >= 18; p += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) p);
+		__m128i b = _mm_loadu_si128((const __m128i *) (p + 1));
+		__m128i c = _mm_loadu_si128((const __m128i *) (p + 2));
+		__m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(b, zero)),
+				_mm_cmpeq_epi8(c, one));
+		int mask = _mm_movemask_epi8(m);
+		if (mask)
+			return p + lowest_bit(mask);
+	}
+	return find_scalar(p, end);
+}
+#endif
+
+#ifdef START_CODE_NEON
+static const uint8_t *find_neon(const uint8_t *p, const uint8_t *end)
+{
+	const uint8x16_t zero = vdupq_n_u8(0);
+	const uint8x16_t one = vdupq_n_u8(1);
+
+	for (; end - p >= 18; p += 16)
+	{
+		uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), zero), vceqq_u8(vld1q_u8(p + 1), zero)),
+				vceqq_u8(vld1q_u8(p + 2), one));
+		// 4 bits for each lane
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+		if (mask)
+			return p + (__builtin_ctzll(mask) >> 2);
+	}
+	return find_scalar(p, end);
+}
+#endif
+
+#ifdef START_CODE_AVX2
+AVX2_TARGET static const uint8_t *find_avx2(const uint8_t *p, const uint8_t *end)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+
+	for (; end - p >= 34; p += 32)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *) p);
+		__m256i b = _mm256_loadu_si256((const __m256i *) (p + 1));
+		__m256i c = _mm256_loadu_si256((const __m256i *) (p + 2));
+		__m256i m = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, zero), _mm256_cmpeq_epi8(b, zero)),
+				_mm256_cmpeq_epi8(c, one));
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(m);
+		if (mask)
+			return p + lowest_bit(mask);
+	}
+	return find_scalar(p, end);
+}
+#endif
+
+const uint8_t *find_start_code(const uint8_t *buf, const uint8_t *end)
+{
+#ifdef START_CODE_AVX2
+	if (have_avx2())
+		return find_avx2(buf, end);
+#endif
+#if defined(START_CODE_SSE2)
+	return find_sse2(buf, end);
+#elif defined(START_CODE_NEON)
+	return find_neon(buf, end);
+#else
+	return find_scalar(buf, end);
+#endif
+}
+
+size_t find_start_codes(const uint8_t *buf, size_t len, size_t *offsets, size_t max)
+{
+	const uint8_t *end = buf + len;
+	const uint8_t *p = buf;
+	size_t n = 0;
+
+	while (n < max && (p = find_start_code(p, end)) != NULL)
+	{
+		offsets[n++] = p - buf;
+		p += 3;
+	}
+	return n;
+}
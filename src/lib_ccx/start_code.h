@@ -0,0 +1,36 @@
+#ifndef START_CODE_H
+#define START_CODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Search for the 00 00 01 prefix of MPEG-2 video and H.264 start codes.
+ *
+ * The loops it replaces stopped at every zero byte with memchr() and looked
+ * at the next two, which is slow on video data, full of zeros. This compares
+ * 16 bytes at a time with SSE2 or NEON, 32 with AVX2 when the CPU has it,
+ * and otherwise looks at every third byte unless it is a 0 or 1.
+ */
+
+/**
+ * Find the first start code prefix that ends before end.
+ *
+ * @return the position of its first 0x00, NULL if there is none. The byte
+ *         after the prefix, the start code value, is at the returned + 3
+ *         and may be end.
+ */
+const uint8_t *find_start_code(const uint8_t *buf, const uint8_t *end);
+
+/**
+ * Find the start code prefixes in buf at once, as find_start_code() one
+ * after the other would.
+ *
+ * @param offsets filled with the offsets of their first 0x00, up to max of
+ *                them. If it is full, go on from the last one + 3.
+ *
+ * @return how many were found.
+ */
+size_t find_start_codes(const uint8_t *buf, size_t len, size_t *offsets, size_t max);
+
+#endif
@@ -117,6 +117,9 @@ void detect_stream_type (struct ccx_demuxer *ctx)
 		{
 			// We had at least one box (or multiple) at the end to "claim" this is MP4. A single valid box at the end is doubtful...
 			ctx->stream_mode = CCX_SM_MP4;
+			// GPAC needs the whole file, a stream or a file still being written is read fragment by fragment
+			if (ccx_options.input_source != CCX_DS_FILE || ccx_options.live_stream)
+				ctx->stream_mode = CCX_SM_FMP4;
 		}
 	}
 
@@ -145,6 +148,7 @@ void detect_stream_type (struct ccx_demuxer *ctx)
 					ctx->startbytes_pos=i;
 					ctx->stream_mode=CCX_SM_TRANSPORT;
 					ctx->m2ts = 0;
+					ctx->ts_packet_size = 188;
 					break;
 				}
 			}
@@ -168,6 +172,7 @@ void detect_stream_type (struct ccx_demuxer *ctx)
 					ctx->startbytes_pos = i;
 					ctx->stream_mode = CCX_SM_TRANSPORT;
 					ctx->m2ts = 1;
+					ctx->ts_packet_size = 188;
 					break;
 				}
 			}
@@ -178,6 +183,30 @@ void detect_stream_type (struct ccx_demuxer *ctx)
 				return;
 			}
 
+			// Check for TS with 204 byte packets (16 bytes of Reed-Solomon parity each)
+			for (unsigned i = 0; i<204 && ctx->startbytes_avail > 204*9; i++)
+			{
+				if (ctx->startbytes[i] == 0x47 && ctx->startbytes[i + 204] == 0x47 &&
+						ctx->startbytes[i + 204 * 2] == 0x47 && ctx->startbytes[i + 204 * 3] == 0x47 &&
+						ctx->startbytes[i + 204 * 4] == 0x47 && ctx->startbytes[i + 204 * 5] == 0x47 &&
+						ctx->startbytes[i + 204 * 6] == 0x47 && ctx->startbytes[i + 204 * 7] == 0x47
+				   )
+				{
+					// Eight sync bytes, that's good enough
+					ctx->startbytes_pos = i;
+					ctx->stream_mode = CCX_SM_TRANSPORT;
+					ctx->m2ts = 0;
+					ctx->ts_packet_size = 204;
+					break;
+				}
+			}
+			if (ctx->stream_mode == CCX_SM_TRANSPORT)
+			{
+				dbg_print(CCX_DMT_PARSE, "detect_stream_type: detected as TS with 204 byte packets\n");
+				return_to_buffer (ctx, ctx->startbytes, (unsigned int)ctx->startbytes_avail);
+				return;
+			}
+
 			// Now check for PS (Needs PACK header)
 			for (unsigned i=0;
 					i < (unsigned) (ctx->startbytes_avail<50000?ctx->startbytes_avail-3:49997);
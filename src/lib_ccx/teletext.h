@@ -39,27 +39,22 @@ typedef enum
 } data_unit_t;
 
 
-struct TeletextCtx
+// G0 character set of one page, selected by its header, its X/28 and the M/29
+// of its magazine
+struct TeletextCharset
 {
-	short int seen_sub_page[MAX_TLT_PAGES];
-	uint8_t verbose : 1; // should telxcc be verbose?
-	uint16_t page; // teletext page containing cc we want to filter
-	uint16_t tid; // 13-bit packet ID for teletext stream
-	double offset; // time offset in seconds
-	uint8_t bom : 1; // print UTF-8 BOM characters at the beginning of output
-	uint8_t nonempty : 1; // produce at least one (dummy) frame
-						  // uint8_t se_mode : 1; // search engine compatible mode => Uses CCExtractor's write_format
-						  // uint64_t utc_refvalue; // UTC referential value => Moved to ccx_decoders_common, so can be used for other decoders (608/xds) too
-	uint16_t user_page; // Page selected by user, which MIGHT be different to 'page' depending on autodetection stuff
-	int levdistmincnt, levdistmaxpct; // Means 2 fails or less is "the same", 10% or less is also "the same"
-	struct ccx_boundary_time extraction_start, extraction_end; // Segment we actually process
-	enum ccx_output_format write_format; // 0=Raw, 1=srt, 2=SMI
-	int gui_mode_reports; // If 1, output in stderr progress updates so the GUI can grab them
-	enum ccx_output_date_format date_format;
-	int noautotimeref; // Do NOT set time automatically?
-	unsigned send_to_srv;
-	char millis_separator;
-	uint32_t global_timestamp;
+	uint8_t g0; // G0 character set, LATIN, CYRILLIC1...
+	uint8_t current; // Latin National Subset in use
+	uint8_t g0_m29;
+	uint8_t g0_x28;
+	uint16_t latin[96]; // Latin G0 Primary Set with the current National Subset
+};
+
+// State of one teletext page being extracted
+struct TeletextPageCtx
+{
+	uint16_t page; // BCD page number, e.g. 0x888
+	struct TeletextCharset charset;
 
 	// Current and previous page buffers. This is the output written to file when
 	// the time comes.
@@ -81,6 +76,34 @@ struct TeletextCtx
 	// Buffer timestamp
 	uint64_t prev_hide_timestamp;
 	uint64_t prev_show_timestamp;
+	// flag indicating if incoming data should be processed or ignored
+	uint8_t receiving_data;
+	int de_ctr; // keeps count of packets with flag subtitle ON and data packets
+	int new_sentence;
+};
+
+struct TeletextCtx
+{
+	short int seen_sub_page[MAX_TLT_PAGES];
+	uint8_t verbose : 1; // should telxcc be verbose?
+	uint16_t page; // teletext page containing cc we want to filter
+	uint16_t tid; // 13-bit packet ID for teletext stream
+	double offset; // time offset in seconds
+	uint8_t bom : 1; // print UTF-8 BOM characters at the beginning of output
+	uint8_t nonempty : 1; // produce at least one (dummy) frame
+						  // uint8_t se_mode : 1; // search engine compatible mode => Uses CCExtractor's write_format
+						  // uint64_t utc_refvalue; // UTC referential value => Moved to ccx_decoders_common, so can be used for other decoders (608/xds) too
+	uint16_t user_page; // Page selected by user, which MIGHT be different to 'page' depending on autodetection stuff
+	int levdistmincnt, levdistmaxpct; // Means 2 fails or less is "the same", 10% or less is also "the same"
+	struct ccx_boundary_time extraction_start, extraction_end; // Segment we actually process
+	enum ccx_output_format write_format; // 0=Raw, 1=srt, 2=SMI
+	int gui_mode_reports; // If 1, output in stderr progress updates so the GUI can grab them
+	enum ccx_output_date_format date_format;
+	int noautotimeref; // Do NOT set time automatically?
+	unsigned send_to_srv;
+	char millis_separator;
+	uint32_t global_timestamp;
+
 	// subtitle type pages bitmap, 2048 bits = 2048 possible pages in teletext (excl. subpages)
 	uint8_t cc_map[256];
 	// last timestamp computed
@@ -90,15 +113,17 @@ struct TeletextCtx
 	uint32_t tlt_packet_counter;
 	// teletext transmission mode
 	transmission_mode_t transmission_mode;
-	// flag indicating if incoming data should be processed or ignored
-	uint8_t receiving_data;
+
+	// Pages being extracted. The first one is always tlt_config.page, the others
+	// come from -tpage p1,p2,... or, with -tpage all, from every subtitle page seen.
+	struct TeletextPageCtx *pages;
+	int num_pages;
 
 	uint8_t using_pts;
 	int64_t delta;
 	uint32_t t0;
 
 	int sentence_cap;//Set to 1 if -sc is passed
-	int new_sentence;
 	int splitbysentence;
 };
 
@@ -49,8 +49,7 @@ int _CRT_fmode = _O_BINARY;
 #include <commctrl.h>
 #endif
 
-uint64_t last_pes_pts = 0; // PTS of last PES packet (debug purposes)
-static int de_ctr = 0; // a keeps count of packets with flag subtitle ON and data packets
+CCX_THREAD_LOCAL uint64_t last_pes_pts = 0; // PTS of last PES packet (debug purposes)
 static const char* TTXT_COLOURS[8] = {
 	//black,   red,       green,     yellow,    blue,      magenta,   cyan,      white
 	"#000000", "#ff0000", "#00ff00", "#ffff00", "#0000ff", "#ff00ff", "#00ffff", "#ffffff"
@@ -75,15 +74,6 @@ struct ccx_s_teletext_config tlt_config = { 0};
 // macro -- output only when increased verbosity was turned on
 #define VERBOSE_ONLY if (tlt_config.verbose == YES)
 
-// current charset (charset can be -- and always is -- changed during transmission)
-struct s_primary_charset {
-	uint8_t current;
-	uint8_t g0_m29;
-	uint8_t g0_x28;
-} primary_charset = {
-	0x00, UNDEFINED, UNDEFINED
-};
-
 // entities, used in colour mode, to replace unsafe HTML tag chars
 struct {
 	uint16_t character;
@@ -113,14 +103,12 @@ typedef enum
 	HEBREW
 } g0_charsets_type;
 
-g0_charsets_type default_g0_charset;
-
 // Note: All characters are encoded in UCS-2
 
 // --- G0 ----------------------------------------------------------------------
 
-// G0 charsets
-uint16_t G0[5][96] = {
+// G0 charsets, the national subset of Latin is applied to the copy in each page's TeletextCharset
+static const uint16_t G0[5][96] = {
 	{ // Latin G0 Primary Set
 		0x0020, 0x0021, 0x0022, 0x00a3, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
 		0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
@@ -347,7 +335,7 @@ const uint16_t G2_ACCENTS[15][52] = {
 		0x0000, 0x0000, 0x0000, 0x017e
 	}
 };
-void page_buffer_add_string (struct TeletextCtx *ctx, const char *s)
+void page_buffer_add_string (struct TeletextPageCtx *ctx, const char *s)
 {
 	if(ctx->page_buffer_cur_size < (ctx->page_buffer_cur_used + strlen (s)+1))
 	{
@@ -362,7 +350,7 @@ void page_buffer_add_string (struct TeletextCtx *ctx, const char *s)
 	ctx->page_buffer_cur[ctx->page_buffer_cur_used]=0;
 }
 
-void ucs2_buffer_add_char (struct TeletextCtx *ctx, uint64_t c)
+void ucs2_buffer_add_char (struct TeletextPageCtx *ctx, uint64_t c)
 {
 	if (ctx->ucs2_buffer_cur_size<(ctx->ucs2_buffer_cur_used+2))
 	{
@@ -376,7 +364,7 @@ void ucs2_buffer_add_char (struct TeletextCtx *ctx, uint64_t c)
 	ctx->ucs2_buffer_cur[ctx->ucs2_buffer_cur_used]=0;
 }
 
-void page_buffer_add_char (struct TeletextCtx *ctx, char c)
+void page_buffer_add_char (struct TeletextPageCtx *ctx, char c)
 {
 	char t[2];
 	t[0]=c;
@@ -384,64 +372,39 @@ void page_buffer_add_char (struct TeletextCtx *ctx, char c)
 	page_buffer_add_string (ctx, t);
 }
 
-// ETS 300 706, chapter 8.2
-uint8_t unham_8_4(uint8_t a)
+// Every page starts with the Latin set and its first National Subset
+static void init_charset(struct TeletextCharset *cs)
 {
-	uint8_t r = UNHAM_8_4[a];
-	if (r == 0xff) {
-		dbg_print (CCX_DMT_TELETEXT, "- Unrecoverable data error; UNHAM8/4(%02x)\n", a);
-	}
-	return (r & 0x0f);
-}
-
-// ETS 300 706, chapter 8.3
-uint32_t unham_24_18(uint32_t a)
-{
-	uint8_t test = 0;
-
-	//Tests A-F correspond to bits 0-6 respectively in 'test'.
-	for (uint8_t i = 0; i < 23; i++) test ^= ((a >> i) & 0x01) * (i + 33);
-	//Only parity bit is tested for bit 24
-	test ^= ((a >> 23) & 0x01) * 32;
-
-	if ((test & 0x1f) != 0x1f)
-	{
-		//Not all tests A-E correct
-		if ((test & 0x20) == 0x20)
-		{
-			//F correct: Double error
-			return 0xffffffff;
-		}
-		//Test F incorrect: Single error
-		a ^= 1 << (30 - test);
-	}
-
-	return (a & 0x000004) >> 2 | (a & 0x000070) >> 3 | (a & 0x007f00) >> 4 | (a & 0x7f0000) >> 5;
+	cs->g0 = LATIN;
+	cs->current = 0x00;
+	cs->g0_m29 = UNDEFINED;
+	cs->g0_x28 = UNDEFINED;
+	memcpy(cs->latin, G0[LATIN], sizeof(cs->latin));
 }
 
 //Default G0 Character Set
-void set_g0_charset(uint32_t triplet)
+static void set_g0_charset(struct TeletextCharset *cs, uint32_t triplet)
 {
 	// ETS 300 706, Table 32
 	if((triplet & 0x3c00) == 0x1000)
 	{
 		if((triplet & 0x0380) == 0x0000)
-			default_g0_charset = CYRILLIC1;
+			cs->g0 = CYRILLIC1;
 		else if((triplet & 0x0380) == 0x0200)
-			default_g0_charset = CYRILLIC2;
+			cs->g0 = CYRILLIC2;
 		else if((triplet & 0x0380) == 0x0280)
-			default_g0_charset = CYRILLIC3;
+			cs->g0 = CYRILLIC3;
 		else
-			default_g0_charset = LATIN;
+			cs->g0 = LATIN;
 	}
 	else
-		default_g0_charset = LATIN;
+		cs->g0 = LATIN;
 }
 
 // Latin National Subset Selection
-void remap_g0_charset(uint8_t c)
+static void remap_g0_charset(struct TeletextCharset *cs, uint8_t c)
 {
-	if (c != primary_charset.current)
+	if (c != cs->current)
 	{
 		uint8_t m = G0_LATIN_NATIONAL_SUBSETS_MAP[c];
 		if (m == 0xff)
@@ -451,9 +414,9 @@ void remap_g0_charset(uint8_t c)
 		else
 		{
 			for (uint8_t j = 0; j < 13; j++)
-				G0[LATIN][G0_LATIN_NATIONAL_SUBSETS_POSITIONS[j]] = G0_LATIN_NATIONAL_SUBSETS[m].characters[j];
+				cs->latin[G0_LATIN_NATIONAL_SUBSETS_POSITIONS[j]] = G0_LATIN_NATIONAL_SUBSETS[m].characters[j];
 			VERBOSE_ONLY fprintf(stderr, "- Using G0 Latin National Subset ID 0x%1x.%1x (%s)\n", (c >> 3), (c & 0x7), G0_LATIN_NATIONAL_SUBSETS[m].language);
-			primary_charset.current = c;
+			cs->current = c;
 		}
 	}
 }
@@ -483,19 +446,50 @@ void ucs2_to_utf8(char *r, uint16_t ch)
 	r[3] = 0;
 }
 
+// translate a 7 bit teletext character into ucs2
+static uint16_t g0_to_ucs2(const struct TeletextCharset *cs, uint8_t c)
+{
+	uint16_t r = c;
+	if (r >= 0x20)
+		r = cs->g0 == LATIN ? cs->latin[r - 0x20] : G0[cs->g0][r - 0x20];
+	return r;
+}
+
 // check parity and translate any reasonable teletext character into ucs2
-uint16_t telx_to_ucs2(uint8_t c)
+static uint16_t telx_to_ucs2(const struct TeletextCharset *cs, uint8_t c)
 {
 	if (PARITY_8[c] == 0)
 	{
 		dbg_print (CCX_DMT_TELETEXT,  "- Unrecoverable data error; PARITY(%02x)\n", c);
 		return 0x20;
 	}
+	return g0_to_ucs2(cs, c & 0x7f);
+}
 
-	uint16_t r = c & 0x7f;
-	if (r >= 0x20)
-		r = G0[default_g0_charset][r - 0x20];
-	return r;
+// Convert the raw rows of a page to UCS-2 before processing, the parity of a row is checked at once
+static void page_to_ucs2(const struct TeletextCharset *cs, teletext_page_t *page)
+{
+	uint8_t raw[40];
+	uint8_t chars[40];
+
+	for (uint8_t yt = 1; yt <= 23; ++yt)
+	{
+		for (uint8_t it = 0; it < 40; it++)
+			raw[it] = (uint8_t) page->text[yt][it];
+		odd_parity_block(raw, chars, 40);
+		for (uint8_t it = 0; it < 40; it++)
+		{
+			if (page->text[yt][it] == 0x00 || page->g2_char_present[yt][it] != 0)
+				continue;
+			if (chars[it] == PARITY_ERROR)
+			{
+				dbg_print (CCX_DMT_TELETEXT,  "- Unrecoverable data error; PARITY(%02x)\n", raw[it]);
+				page->text[yt][it] = 0x20;
+			}
+			else
+				page->text[yt][it] = g0_to_ucs2(cs, chars[it]);
+		}
+	}
 }
 
 uint16_t bcd_page_to_int (uint16_t bcd)
@@ -503,7 +497,7 @@ uint16_t bcd_page_to_int (uint16_t bcd)
 	return ((bcd&0xf00)>>8)*100 + ((bcd&0xf0)>>4)*10 + (bcd&0xf);
 }
 
-void telx_case_fix (struct TeletextCtx *context)
+void telx_case_fix (struct TeletextPageCtx *context)
 {
 	//Capitalizing first letter of every sentence
 	int line_len = strlen(context->page_buffer_cur);
@@ -535,34 +529,57 @@ void telx_case_fix (struct TeletextCtx *context)
 	telx_correct_case(context->page_buffer_cur);
 }
 
-void telxcc_dump_prev_page (struct TeletextCtx *ctx, struct cc_subtitle *sub)
+// Subtitles carry the number of their page. The ones of the pages after the
+// first are flagged so the encoder writes them to a file of their own.
+static void add_page_sub_text(struct TeletextCtx *ctx, struct TeletextPageCtx *tp, struct cc_subtitle *sub,
+		char *str, uint64_t show_timestamp, uint64_t hide_timestamp)
 {
 	char info[4];
-	if (!ctx->page_buffer_prev)
+	if (str == NULL || strlen(str) == 0)
+		return;
+
+	snprintf(info, 4, "%.3u", bcd_page_to_int(tp->page));
+	if (add_cc_sub_text(sub, str, show_timestamp, hide_timestamp, info, "TLT", CCX_ENC_UTF_8) < 0)
+		return;
+	if (tp != ctx->pages)
+	{
+		for (; sub->next; sub = sub->next);
+		sub->flags |= SUB_TLT_EXTRA_PAGE;
+	}
+}
+
+static void dump_prev_page (struct TeletextCtx *ctx, struct TeletextPageCtx *tp, struct cc_subtitle *sub)
+{
+	if (!tp->page_buffer_prev)
 		return;
 
-	snprintf(info, 4, "%.3u", bcd_page_to_int(tlt_config.page));
-	add_cc_sub_text(sub, ctx->page_buffer_prev, ctx->prev_show_timestamp,
-		ctx->prev_hide_timestamp, info, "TLT", CCX_ENC_UTF_8);
+	add_page_sub_text(ctx, tp, sub, tp->page_buffer_prev, tp->prev_show_timestamp,
+		tp->prev_hide_timestamp);
 
-	if (ctx->page_buffer_prev)
-		free (ctx->page_buffer_prev);
-	if (ctx->ucs2_buffer_prev)
-		free (ctx->ucs2_buffer_prev);
+	if (tp->page_buffer_prev)
+		free (tp->page_buffer_prev);
+	if (tp->ucs2_buffer_prev)
+		free (tp->ucs2_buffer_prev);
 	// Switch "dump" buffers
-	ctx->page_buffer_prev_used=ctx->page_buffer_cur_used;
-	ctx->page_buffer_prev_size=ctx->page_buffer_cur_size;
-	ctx->page_buffer_prev=ctx->page_buffer_cur;
-	ctx->page_buffer_cur_size=0;
-	ctx->page_buffer_cur_used=0;
-	ctx->page_buffer_cur=NULL;
+	tp->page_buffer_prev_used=tp->page_buffer_cur_used;
+	tp->page_buffer_prev_size=tp->page_buffer_cur_size;
+	tp->page_buffer_prev=tp->page_buffer_cur;
+	tp->page_buffer_cur_size=0;
+	tp->page_buffer_cur_used=0;
+	tp->page_buffer_cur=NULL;
 	// Also switch compare buffers
-	ctx->ucs2_buffer_prev_used=ctx->ucs2_buffer_cur_used;
-	ctx->ucs2_buffer_prev_size=ctx->ucs2_buffer_cur_size;
-	ctx->ucs2_buffer_prev=ctx->ucs2_buffer_cur;
-	ctx->ucs2_buffer_cur_size=0;
-	ctx->ucs2_buffer_cur_used=0;
-	ctx->ucs2_buffer_cur=NULL;
+	tp->ucs2_buffer_prev_used=tp->ucs2_buffer_cur_used;
+	tp->ucs2_buffer_prev_size=tp->ucs2_buffer_cur_size;
+	tp->ucs2_buffer_prev=tp->ucs2_buffer_cur;
+	tp->ucs2_buffer_cur_size=0;
+	tp->ucs2_buffer_cur_used=0;
+	tp->ucs2_buffer_cur=NULL;
+}
+
+void telxcc_dump_prev_page (struct TeletextCtx *ctx, struct cc_subtitle *sub)
+{
+	for (int i = 0; i < ctx->num_pages; i++)
+		dump_prev_page(ctx, &ctx->pages[i], sub);
 }
 
 // Note: c1 and c2 are just used for debug output, not for the actual comparison
@@ -583,7 +600,7 @@ int fuzzy_memcmp (const char *c1, const char *c2, const uint64_t *ucs2_buf1, uns
 	return res;
 }
 
-void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subtitle *sub)
+void process_page(struct TeletextCtx *ctx, struct TeletextPageCtx *tp, teletext_page_t *page, struct cc_subtitle *sub)
 {
 	if ((tlt_config.extraction_start.set && page->hide_timestamp < tlt_config.extraction_start.time_in_ms) ||
 		(tlt_config.extraction_end.set && page->show_timestamp > tlt_config.extraction_end.time_in_ms) ||
@@ -698,13 +715,13 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 			switch (tlt_config.write_format)
 			{
 				case CCX_OF_TRANSCRIPT:
-					page_buffer_add_string(ctx, " ");
+					page_buffer_add_string(tp, " ");
 					break;
 				case CCX_OF_SMPTETT:
-					page_buffer_add_string(ctx, "<br/>");
+					page_buffer_add_string(tp, "<br/>");
 					break;
 				default:
-					page_buffer_add_string(ctx, "\r\n");
+					page_buffer_add_string(tp, "\r\n");
 			}
 		}
 
@@ -741,7 +758,7 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 				if ((foreground_color != 0x7) && !tlt_config.nofontcolor)
 				{
 					sprintf (c_tempb, "<font color=\"%s\">", TTXT_COLOURS[foreground_color]);
-					page_buffer_add_string (ctx, c_tempb);
+					page_buffer_add_string (tp, c_tempb);
 					font_tag_opened = YES;
 				}
 			}
@@ -756,17 +773,17 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 					{
 						if (font_tag_opened == YES)
 						{
-							page_buffer_add_string (ctx, "</font>");
+							page_buffer_add_string (tp, "</font>");
 							font_tag_opened = NO;
 						}
                                                 
-						page_buffer_add_string(ctx, " ");
+						page_buffer_add_string(tp, " ");
 						// black is considered as white for telxcc purpose
 						// telxcc writes <font/> tags only when needed
 						if ((v > 0x0) && (v < 0x7))
 						{
 							sprintf (c_tempb, "<font color=\"%s\">", TTXT_COLOURS[v]);
-							page_buffer_add_string (ctx, c_tempb);
+							page_buffer_add_string (tp, c_tempb);
 							font_tag_opened = YES;
 						}
 					}
@@ -778,7 +795,7 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 				{
 					ucs2_to_utf8(u, v);
 					uint64_t ucs2_char=(u[0]<<24) | (u[1]<<16) | (u[2]<<8) | u[3];
-					ucs2_buffer_add_char(ctx, ucs2_char);
+					ucs2_buffer_add_char(tp, ucs2_char);
 
 					// translate some chars into entities, if in colour mode
 					if (!tlt_config.nofontcolor && !tlt_config.nohtmlescape)
@@ -786,7 +803,7 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 						for (uint8_t i = 0; i < array_length(ENTITIES); i++)
 							if (v == ENTITIES[i].character)
 							{
-								page_buffer_add_string (ctx, ENTITIES[i].entity);
+								page_buffer_add_string (tp, ENTITIES[i].entity);
 								// v < 0x20 won't be printed in next block
 								v = 0;
 								break;
@@ -795,7 +812,7 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 				}
 				if (v >= 0x20)
 				{
-					page_buffer_add_string (ctx, u);
+					page_buffer_add_string (tp, u);
 					if (tlt_config.gui_mode_reports) // For now we just handle the easy stuff
 						fprintf (stderr,"%s",u);
 				}
@@ -805,7 +822,7 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 		// no tag will left opened!
 		if ((!tlt_config.nofontcolor) && (font_tag_opened == YES))
 		{
-			page_buffer_add_string (ctx, "</font>");
+			page_buffer_add_string (tp, "</font>");
 			font_tag_opened = NO;
 		}
 
@@ -817,90 +834,264 @@ void process_page(struct TeletextCtx *ctx, teletext_page_t *page, struct cc_subt
 	time_reported=0;
 
 	if (ctx->sentence_cap)
-		telx_case_fix(ctx);
+		telx_case_fix(tp);
 
 	switch (tlt_config.write_format)
 	{
 		case CCX_OF_TRANSCRIPT:
 		case CCX_OF_SRT:
-			if (ctx->page_buffer_prev_used == 0)
-				ctx->prev_show_timestamp = page->show_timestamp;
-			if (ctx->page_buffer_prev_used == 0 ||
+			if (tp->page_buffer_prev_used == 0)
+				tp->prev_show_timestamp = page->show_timestamp;
+			if (tp->page_buffer_prev_used == 0 ||
 				(tlt_config.dolevdist && 
-				fuzzy_memcmp (ctx->page_buffer_prev, ctx->page_buffer_cur,
-						ctx->ucs2_buffer_prev, ctx->ucs2_buffer_prev_used,
-						ctx->ucs2_buffer_cur, ctx->ucs2_buffer_cur_used
+				fuzzy_memcmp (tp->page_buffer_prev, tp->page_buffer_cur,
+						tp->ucs2_buffer_prev, tp->ucs2_buffer_prev_used,
+						tp->ucs2_buffer_cur, tp->ucs2_buffer_cur_used
 						) == 0))
 			{
 				// If empty previous buffer, we just start one with the
 				// current page and do nothing. Wait until we see more.
-				if (ctx->page_buffer_prev)
-					free (ctx->page_buffer_prev);
-
-				ctx->page_buffer_prev_used	= ctx->page_buffer_cur_used;
-				ctx->page_buffer_prev_size	= ctx->page_buffer_cur_size;
-				ctx->page_buffer_prev	= ctx->page_buffer_cur;
-				ctx->page_buffer_cur_size	= 0;
-				ctx->page_buffer_cur_used	= 0;
-				ctx->page_buffer_cur		= NULL;
-
-				if (ctx->ucs2_buffer_prev)
-					free (ctx->ucs2_buffer_prev);
-				ctx->ucs2_buffer_prev_used	= ctx->ucs2_buffer_cur_used;
-				ctx->ucs2_buffer_prev_size	= ctx->ucs2_buffer_cur_size;
-				ctx->ucs2_buffer_prev	= ctx->ucs2_buffer_cur;
-				ctx->ucs2_buffer_cur_size	= 0;
-				ctx->ucs2_buffer_cur_used	= 0;
-				ctx->ucs2_buffer_cur		= NULL;
-				ctx->prev_hide_timestamp	= page->hide_timestamp;
+				if (tp->page_buffer_prev)
+					free (tp->page_buffer_prev);
+
+				tp->page_buffer_prev_used	= tp->page_buffer_cur_used;
+				tp->page_buffer_prev_size	= tp->page_buffer_cur_size;
+				tp->page_buffer_prev	= tp->page_buffer_cur;
+				tp->page_buffer_cur_size	= 0;
+				tp->page_buffer_cur_used	= 0;
+				tp->page_buffer_cur		= NULL;
+
+				if (tp->ucs2_buffer_prev)
+					free (tp->ucs2_buffer_prev);
+				tp->ucs2_buffer_prev_used	= tp->ucs2_buffer_cur_used;
+				tp->ucs2_buffer_prev_size	= tp->ucs2_buffer_cur_size;
+				tp->ucs2_buffer_prev	= tp->ucs2_buffer_cur;
+				tp->ucs2_buffer_cur_size	= 0;
+				tp->ucs2_buffer_cur_used	= 0;
+				tp->ucs2_buffer_cur		= NULL;
+				tp->prev_hide_timestamp	= page->hide_timestamp;
 				break;
 			}
 			else
 			{
 				// OK, the old and new buffer don't match. So write the old
-				telxcc_dump_prev_page(ctx, sub);
-				ctx->prev_hide_timestamp = page->hide_timestamp;
-				ctx->prev_show_timestamp = page->show_timestamp;
+				dump_prev_page(ctx, tp, sub);
+				tp->prev_hide_timestamp = page->hide_timestamp;
+				tp->prev_show_timestamp = page->show_timestamp;
 			}
 			break;
 		default:
-			add_cc_sub_text(sub, ctx->page_buffer_cur, page->show_timestamp,
-				page->hide_timestamp + 1, NULL, "TLT", CCX_ENC_UTF_8);
+			add_page_sub_text(ctx, tp, sub, tp->page_buffer_cur, page->show_timestamp,
+				page->hide_timestamp + 1);
 	}
 
 	// Also update GUI...
 
-	ctx->page_buffer_cur_used=0;
-	if (ctx->page_buffer_cur)
-		ctx->page_buffer_cur[0]=0;
+	tp->page_buffer_cur_used=0;
+	if (tp->page_buffer_cur)
+		tp->page_buffer_cur[0]=0;
 	if (tlt_config.gui_mode_reports)
 		fflush (stderr);
 }
 
+static struct TeletextPageCtx *find_page(struct TeletextCtx *ctx, uint16_t page)
+{
+	for (int n = 0; n < ctx->num_pages; n++)
+	{
+		if (ctx->pages[n].page == page)
+			return &ctx->pages[n];
+	}
+	return NULL;
+}
+
+static void add_page(struct TeletextCtx *ctx, uint16_t page)
+{
+	struct TeletextPageCtx *tp;
+
+	ctx->pages = realloc(ctx->pages, (ctx->num_pages + 1) * sizeof(struct TeletextPageCtx));
+	if (!ctx->pages)
+		fatal (EXIT_NOT_ENOUGH_MEMORY, "Not enough memory to process teletext page.\n");
+	tp = &ctx->pages[ctx->num_pages++];
+	memset(tp, 0, sizeof(struct TeletextPageCtx));
+	tp->page = page;
+	tp->receiving_data = NO;
+	init_charset(&tp->charset);
+}
+
+// Is one of the pages we extract in magazine m (and being received, if receiving is YES)?
+static int magazine_selected(struct TeletextCtx *ctx, uint8_t m, uint8_t receiving)
+{
+	for (int n = 0; n < ctx->num_pages; n++)
+	{
+		if ((m == MAGAZINE(ctx->pages[n].page)) && (receiving == NO || ctx->pages[n].receiving_data == YES))
+			return YES;
+	}
+	return NO;
+}
+
+// ETS 300 706, chapter 12.3.2: X/26 definition
+static void process_telx_x26(struct TeletextPageCtx *tp, const uint32_t *triplets)
+{
+	uint8_t x26_row = 0;
+	uint8_t x26_col = 0;
+
+	for (uint8_t j = 0; j < 13; j++)
+	{
+		uint8_t data;
+		uint8_t mode;
+		uint8_t address;
+		uint8_t row_address_group;
+		// invalid data (HAM24/18 uncorrectable error detected), skip group
+		if (triplets[j] == 0xffffffff)
+		{
+			dbg_print (CCX_DMT_TELETEXT, "- Unrecoverable data error; UNHAM24/18()=%04x\n", triplets[j]);
+			continue;
+		}
+
+		data = (triplets[j] & 0x3f800) >> 11;
+		mode = (triplets[j] & 0x7c0) >> 6;
+		address = triplets[j] & 0x3f;
+		row_address_group = (address >= 40) && (address <= 63);
+
+		// ETS 300 706, chapter 12.3.1, table 27: set active position
+		if ((mode == 0x04) && (row_address_group == YES))
+		{
+			x26_row = address - 40;
+			if (x26_row == 0) x26_row = 24;
+			x26_col = 0;
+		}
+
+		// ETS 300 706, chapter 12.3.1, table 27: termination marker
+		if ((mode >= 0x11) && (mode <= 0x1f) && (row_address_group == YES)) break;
+
+		// ETS 300 706, chapter 12.3.1, table 27: character from G2 set
+		if ((mode == 0x0f) && (row_address_group == NO))
+		{
+			x26_col = address;
+			if (data > 31)
+			{
+				tp->page_buffer.text[x26_row][x26_col] = G2[0][data - 0x20];
+				tp->page_buffer.g2_char_present[x26_row][x26_col] = 1;
+			}
+		}
+
+		// ETS 300 706 v1.2.1, chapter 12.3.4, Table 29: G0 character without diacritical mark (display '@' instead of '*')
+		if ((mode == 0x10) && (row_address_group == NO))
+		{
+			x26_col = address;
+			if (data == 64) // check for @ symbol
+			{
+				remap_g0_charset(&tp->charset, 0);
+				tp->page_buffer.text[x26_row][x26_col] = 0x40;
+			}
+
+		}
+
+		// ETS 300 706, chapter 12.3.1, table 27: G0 character with diacritical mark
+		if ((mode >= 0x11) && (mode <= 0x1f) && (row_address_group == NO))
+		{
+			x26_col = address;
+
+			// A - Z
+			if ((data >= 65) && (data <= 90))
+				tp->page_buffer.text[x26_row][x26_col] = G2_ACCENTS[mode - 0x11][data - 65];
+			// a - z
+			else if ((data >= 97) && (data <= 122))
+				tp->page_buffer.text[x26_row][x26_col] = G2_ACCENTS[mode - 0x11][data - 71];
+			// other
+			else
+				tp->page_buffer.text[x26_row][x26_col] = telx_to_ucs2(&tp->charset, data);
+
+			tp->page_buffer.g2_char_present[x26_row][x26_col] = 1;
+		}
+	}
+}
+
+// Page header received: terminates the transmission of the page tp, or starts it
+static void process_telx_header(struct TeletextCtx *ctx, struct TeletextPageCtx *tp, data_unit_t data_unit_id,
+		uint8_t m, uint16_t page_number, uint8_t flag_subtitle, uint8_t charset, uint64_t timestamp, struct cc_subtitle *sub)
+{
+	uint8_t c;
+
+	// FIXME: Well, this is not ETS 300 706 kosher, however we are interested in DATA_UNIT_EBU_TELETEXT_SUBTITLE only
+	if ((ctx->transmission_mode == TRANSMISSION_MODE_PARALLEL) && (data_unit_id != DATA_UNIT_EBU_TELETEXT_SUBTITLE) && !(tp->de_ctr && flag_subtitle && tp->receiving_data == YES)) return;
+
+	if ((tp->receiving_data == YES) && (
+		((ctx->transmission_mode == TRANSMISSION_MODE_SERIAL) && (PAGE(page_number) != PAGE(tp->page))) ||
+		((ctx->transmission_mode == TRANSMISSION_MODE_PARALLEL) && (PAGE(page_number) != PAGE(tp->page)) && (m == MAGAZINE(tp->page)))))
+	{
+		tp->receiving_data = NO;
+		if(!(tp->de_ctr && flag_subtitle))
+		  return;
+	}
+
+	// Page transmission is terminated, however now we are waiting for our new page
+	if (page_number != tp->page && !(tp->de_ctr && flag_subtitle && tp->receiving_data == YES))
+		return;
+
+
+	// Now we have the begining of page transmission; if there is page_buffer pending, process it
+	if (tp->page_buffer.tainted == YES)
+	{
+		page_to_ucs2(&tp->charset, &tp->page_buffer);
+		// it would be nice, if subtitle hides on previous video frame, so we contract 40 ms (1 frame @25 fps)
+		tp->page_buffer.hide_timestamp = timestamp - 40;
+		if (tp->page_buffer.hide_timestamp > timestamp)
+		{
+			tp->page_buffer.hide_timestamp = 0;
+		}
+		process_page(ctx, tp, &tp->page_buffer, sub);
+		tp->de_ctr = 0;
+	}
+
+	tp->page_buffer.show_timestamp = timestamp;
+	tp->page_buffer.hide_timestamp = 0;
+	memset(tp->page_buffer.text, 0x00, sizeof(tp->page_buffer.text));
+	memset(tp->page_buffer.g2_char_present, 0x00, sizeof(tp->page_buffer.g2_char_present));
+	tp->page_buffer.tainted = NO;
+	tp->receiving_data = YES;
+	if(tp->charset.g0 == LATIN) // G0 Character National Option Sub-sets selection required only for Latin Character Sets
+	{
+		tp->charset.g0_x28 = UNDEFINED;
+		c = (tp->charset.g0_m29 != UNDEFINED) ? tp->charset.g0_m29 : charset;
+		remap_g0_charset(&tp->charset, c);
+	}
+	/*
+	// I know -- not needed; in subtitles we will never need disturbing teletext page status bar
+	// displaying tv station name, current time etc.
+	if (flag_suppress_header == NO) {
+		for (uint8_t i = 14; i < 40; i++) page_buffer.text[y][i] = telx_to_ucs2(packet->data[i]);
+		//page_buffer.tainted = YES;
+	}
+	*/
+}
+
 void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, teletext_packet_payload_t *packet, uint64_t timestamp, struct cc_subtitle *sub)
 {
 	// variable names conform to ETS 300 706, chapter 7.1.2
-	uint8_t address, m, y, designation_code;
-	address = (unham_8_4(packet->address[1]) << 4) | unham_8_4(packet->address[0]);
-	m = address & 0x7;
-	if (m == 0) m = 8;
-	y = (address >> 3) & 0x1f;
-	designation_code = (y > 25) ? unham_8_4(packet->data[0]) : 0x00;
-	uint8_t flag_subtitle;
+	struct telx_decoded_packet dp;
+	uint8_t m, y, designation_code;
+	// Hamming protected bytes of the packet are all decoded here
+	if (telx_decode_packet(packet->address, packet->data, &dp) > 0)
+		dbg_print (CCX_DMT_TELETEXT, "- Unrecoverable data error; %d bytes in packet X/%u\n", dp.errors, dp.row);
+	m = dp.magazine;
+	y = dp.row;
+	designation_code = dp.designation;
+	// The first page follows tlt_config.page, it can be autodetected or forgotten
+	ctx->pages[0].page = tlt_config.page;
 	if (y == 0)
 	{
 
 		// CC map
-		uint8_t i = (unham_8_4(packet->data[1]) << 4) | unham_8_4(packet->data[0]);
-		uint8_t flag_subtitle = (unham_8_4(packet->data[5]) & 0x08) >> 3;
+		uint8_t i = (dp.header[1] << 4) | dp.header[0];
+		uint8_t flag_subtitle = (dp.header[5] & 0x08) >> 3;
 		uint16_t page_number;
 		uint8_t charset;
-		uint8_t c;
 		ctx->cc_map[i] |= flag_subtitle << (m - 1);
 
 		if ((flag_subtitle == YES) && (i < 0xff))
 		{
-			int thisp= (m << 8) | (unham_8_4(packet->data[1]) << 4) | unham_8_4(packet->data[0]);
+			int thisp= (m << 8) | i;
 			char t1[10];
 			sprintf (t1,"%x",thisp); // Example: 1928 -> 788
 			thisp=atoi (t1);
@@ -912,15 +1103,22 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 		}
 		if ((tlt_config.page == 0) && (flag_subtitle == YES) && (i < 0xff))
 		{
-			tlt_config.page = (m << 8) | (unham_8_4(packet->data[1]) << 4) | unham_8_4(packet->data[0]);
+			tlt_config.page = (m << 8) | i;
 			mprint ("- No teletext page specified, first received suitable page is %03x, not guaranteed\n", tlt_config.page);
+			ctx->pages[0].page = tlt_config.page;
         }
+		if (tlt_config.all_pages && (tlt_config.page != 0) && (flag_subtitle == YES) && (i < 0xff) &&
+			!find_page(ctx, (m << 8) | i))
+		{
+			add_page(ctx, (m << 8) | i);
+			mprint ("- Teletext page %03x is extracted too\n", (m << 8) | i);
+		}
 
 		// Page number and control bits
-		page_number = (m << 8) | (unham_8_4(packet->data[1]) << 4) | unham_8_4(packet->data[0]);
-		charset = ((unham_8_4(packet->data[7]) & 0x08) | (unham_8_4(packet->data[7]) & 0x04) | (unham_8_4(packet->data[7]) & 0x02)) >> 1;
-		//uint8_t flag_suppress_header = unham_8_4(packet->data[6]) & 0x01;
-		//uint8_t flag_inhibit_display = (unham_8_4(packet->data[6]) & 0x08) >> 3;
+		page_number = (m << 8) | i;
+		charset = (dp.header[7] & 0x0e) >> 1;
+		//uint8_t flag_suppress_header = dp.header[6] & 0x01;
+		//uint8_t flag_inhibit_display = (dp.header[6] & 0x08) >> 3;
 
 		// ETS 300 706, chapter 9.3.1.3:
 		// When set to '1' the service is designated to be in Serial mode and the transmission of a page is terminated
@@ -930,164 +1128,41 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 		// The same setting shall be used for all page headers in the service.
 		// ETS 300 706, chapter 7.2.1: Page is terminated by and excludes the next page header packet
 		// having the same magazine address in parallel transmission mode, or any magazine address in serial transmission mode.
-		ctx->transmission_mode = (transmission_mode_t) (unham_8_4(packet->data[7]) & 0x01);
-
-		// FIXME: Well, this is not ETS 300 706 kosher, however we are interested in DATA_UNIT_EBU_TELETEXT_SUBTITLE only
-		if ((ctx->transmission_mode == TRANSMISSION_MODE_PARALLEL) && (data_unit_id != DATA_UNIT_EBU_TELETEXT_SUBTITLE) && !(de_ctr && flag_subtitle && ctx->receiving_data == YES)) return;
-
-		if ((ctx->receiving_data == YES) && (
-			((ctx->transmission_mode == TRANSMISSION_MODE_SERIAL) && (PAGE(page_number) != PAGE(tlt_config.page))) ||
-			((ctx->transmission_mode == TRANSMISSION_MODE_PARALLEL) && (PAGE(page_number) != PAGE(tlt_config.page)) && (m == MAGAZINE(tlt_config.page)))))
-		{
-			ctx->receiving_data = NO;
-			if(!(de_ctr && flag_subtitle))
-			  return;
-		}
-
-		// Page transmission is terminated, however now we are waiting for our new page
-		if (page_number != tlt_config.page && !(de_ctr && flag_subtitle && ctx->receiving_data == YES))
-			return;
-
+		ctx->transmission_mode = (transmission_mode_t) (dp.header[7] & 0x01);
 
-		// Now we have the begining of page transmission; if there is page_buffer pending, process it
-		if (ctx->page_buffer.tainted == YES)
-		{
-			// Convert telx to UCS-2 before processing
-			for(uint8_t yt = 1; yt <= 23; ++yt)
-			{
-				for(uint8_t it = 0; it < 40; it++)
-				{
-					if (ctx->page_buffer.text[yt][it] != 0x00 && ctx->page_buffer.g2_char_present[yt][it] == 0)
-						ctx->page_buffer.text[yt][it] = telx_to_ucs2(ctx->page_buffer.text[yt][it]);
-				}
-			}
-			// it would be nice, if subtitle hides on previous video frame, so we contract 40 ms (1 frame @25 fps)
-			ctx->page_buffer.hide_timestamp = timestamp - 40;
-			if (ctx->page_buffer.hide_timestamp > timestamp)
-			{
-				ctx->page_buffer.hide_timestamp = 0;
-			}
-			process_page(ctx, &ctx->page_buffer, sub);
-			de_ctr = 0;
-		}
-
-		ctx->page_buffer.show_timestamp = timestamp;
-		ctx->page_buffer.hide_timestamp = 0;
-		memset(ctx->page_buffer.text, 0x00, sizeof(ctx->page_buffer.text));
-		memset(ctx->page_buffer.g2_char_present, 0x00, sizeof(ctx->page_buffer.g2_char_present));
-		ctx->page_buffer.tainted = NO;
-		ctx->receiving_data = YES;
-		if(default_g0_charset == LATIN) // G0 Character National Option Sub-sets selection required only for Latin Character Sets
-		{
-			primary_charset.g0_x28 = UNDEFINED;
-			c = (primary_charset.g0_m29 != UNDEFINED) ? primary_charset.g0_m29 : charset;
-			remap_g0_charset(c);
-		}
-		/*
-		// I know -- not needed; in subtitles we will never need disturbing teletext page status bar
-		// displaying tv station name, current time etc.
-		if (flag_suppress_header == NO) {
-			for (uint8_t i = 14; i < 40; i++) page_buffer.text[y][i] = telx_to_ucs2(packet->data[i]);
-			//page_buffer.tainted = YES;
-		}
-		*/
+		for (int n = 0; n < ctx->num_pages; n++)
+			process_telx_header(ctx, &ctx->pages[n], data_unit_id, m, page_number, flag_subtitle, charset, timestamp, sub);
 	}
-	else if ((m == MAGAZINE(tlt_config.page)) && (y >= 1) && (y <= 23) && (ctx->receiving_data == YES))
+	else if ((y >= 1) && (y <= 23))
 	{
-		// ETS 300 706, chapter 9.4.1: Packets X/26 at presentation Levels 1.5, 2.5, 3.5 are used for addressing
-		// a character location and overwriting the existing character defined on the Level 1 page
-		// ETS 300 706, annex B.2.2: Packets with Y = 26 shall be transmitted before any packets with Y = 1 to Y = 25;
-		// so page_buffer.text[y][i] may already contain any character received
-		// in frame number 26, skip original G0 character
-		for (uint8_t i = 0; i < 40; i++)
+		for (int n = 0; n < ctx->num_pages; n++)
 		{
-			if (ctx->page_buffer.text[y][i] == 0x00)
-				ctx->page_buffer.text[y][i] = packet->data[i];
+			struct TeletextPageCtx *tp = &ctx->pages[n];
+			if ((m != MAGAZINE(tp->page)) || (tp->receiving_data == NO))
+				continue;
+			// ETS 300 706, chapter 9.4.1: Packets X/26 at presentation Levels 1.5, 2.5, 3.5 are used for addressing
+			// a character location and overwriting the existing character defined on the Level 1 page
+			// ETS 300 706, annex B.2.2: Packets with Y = 26 shall be transmitted before any packets with Y = 1 to Y = 25;
+			// so page_buffer.text[y][i] may already contain any character received
+			// in frame number 26, skip original G0 character
+			for (uint8_t i = 0; i < 40; i++)
+			{
+				if (tp->page_buffer.text[y][i] == 0x00)
+					tp->page_buffer.text[y][i] = packet->data[i];
+			}
+			tp->page_buffer.tainted = YES;
+			--tp->de_ctr;
 		}
-		ctx->page_buffer.tainted = YES;
-		--de_ctr;
 	}
-	else if ((m == MAGAZINE(tlt_config.page)) && (y == 26) && (ctx->receiving_data == YES))
+	else if (y == 26)
 	{
-		// ETS 300 706, chapter 12.3.2: X/26 definition
-		uint8_t x26_row = 0;
-		uint8_t x26_col = 0;
-
-		uint32_t triplets[13] = { 0 };
-		for (uint8_t i = 1, j = 0; i < 40; i += 3, j++) triplets[j] = unham_24_18((packet->data[i + 2] << 16) | (packet->data[i + 1] << 8) | packet->data[i]);
-
-		for (uint8_t j = 0; j < 13; j++)
+		for (int n = 0; n < ctx->num_pages; n++)
 		{
-			uint8_t data;
-			uint8_t mode;
-			uint8_t address;
-			uint8_t row_address_group;
-			// invalid data (HAM24/18 uncorrectable error detected), skip group
-			if (triplets[j] == 0xffffffff)
-			{
-				dbg_print (CCX_DMT_TELETEXT, "- Unrecoverable data error; UNHAM24/18()=%04x\n", triplets[j]);
-				continue;
-			}
-
-			data = (triplets[j] & 0x3f800) >> 11;
-			mode = (triplets[j] & 0x7c0) >> 6;
-			address = triplets[j] & 0x3f;
-			row_address_group = (address >= 40) && (address <= 63);
-
-			// ETS 300 706, chapter 12.3.1, table 27: set active position
-			if ((mode == 0x04) && (row_address_group == YES))
-			{
-				x26_row = address - 40;
-				if (x26_row == 0) x26_row = 24;
-				x26_col = 0;
-			}
-
-			// ETS 300 706, chapter 12.3.1, table 27: termination marker
-			if ((mode >= 0x11) && (mode <= 0x1f) && (row_address_group == YES)) break;
-
-			// ETS 300 706, chapter 12.3.1, table 27: character from G2 set
-			if ((mode == 0x0f) && (row_address_group == NO))
-			{
-				x26_col = address;
-				if (data > 31)
-				{
-					ctx->page_buffer.text[x26_row][x26_col] = G2[0][data - 0x20];
-					ctx->page_buffer.g2_char_present[x26_row][x26_col] = 1;
-				}
-			}
-
-			// ETS 300 706 v1.2.1, chapter 12.3.4, Table 29: G0 character without diacritical mark (display '@' instead of '*')
-			if ((mode == 0x10) && (row_address_group == NO))
-			{
-				x26_col = address;
-				if (data == 64) // check for @ symbol
-				{
-					remap_g0_charset(0);
-					ctx->page_buffer.text[x26_row][x26_col] = 0x40;
-				}
-
-			}
-
-			// ETS 300 706, chapter 12.3.1, table 27: G0 character with diacritical mark
-			if ((mode >= 0x11) && (mode <= 0x1f) && (row_address_group == NO))
-			{
-				x26_col = address;
-
-				// A - Z
-				if ((data >= 65) && (data <= 90))
-					ctx->page_buffer.text[x26_row][x26_col] = G2_ACCENTS[mode - 0x11][data - 65];
-				// a - z
-				else if ((data >= 97) && (data <= 122))
-					ctx->page_buffer.text[x26_row][x26_col] = G2_ACCENTS[mode - 0x11][data - 71];
-				// other
-				else
-					ctx->page_buffer.text[x26_row][x26_col] = telx_to_ucs2(data);
-
-				ctx->page_buffer.g2_char_present[x26_row][x26_col] = 1;
-			}
+			if ((m == MAGAZINE(ctx->pages[n].page)) && (ctx->pages[n].receiving_data == YES))
+				process_telx_x26(&ctx->pages[n], dp.triplets);
 		}
 	}
-	else if ((m == MAGAZINE(tlt_config.page)) && (y == 28) && (ctx->receiving_data == YES))
+	else if ((y == 28) && magazine_selected(ctx, m, YES))
 	{
 		// TODO:
 		//   ETS 300 706, chapter 9.4.7: Packet X/28/4
@@ -1096,7 +1171,7 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 		{
 			// ETS 300 706, chapter 9.4.2: Packet X/28/0 Format 1
 			// ETS 300 706, chapter 9.4.7: Packet X/28/4
-			uint32_t triplet0 = unham_24_18((packet->data[3] << 16) | (packet->data[2] << 8) | packet->data[1]);
+			uint32_t triplet0 = dp.triplets[0];
 
 			if (triplet0 == 0xffffffff)
 			{
@@ -1109,17 +1184,24 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 				if ((triplet0 & 0x0f) == 0x00)
 				{
 					// ETS 300 706, Table 32
-					set_g0_charset(triplet0); // Deciding G0 Character Set
-					if(default_g0_charset == LATIN)
+					// X/28 belongs to the page being received on the magazine
+					for (int n = 0; n < ctx->num_pages; n++)
 					{
-						primary_charset.g0_x28 = (triplet0 & 0x3f80) >> 7;
-						remap_g0_charset(primary_charset.g0_x28);
+						struct TeletextCharset *cs = &ctx->pages[n].charset;
+						if ((m != MAGAZINE(ctx->pages[n].page)) || (ctx->pages[n].receiving_data != YES))
+							continue;
+						set_g0_charset(cs, triplet0); // Deciding G0 Character Set
+						if(cs->g0 == LATIN)
+						{
+							cs->g0_x28 = (triplet0 & 0x3f80) >> 7;
+							remap_g0_charset(cs, cs->g0_x28);
+						}
 					}
 				}
 			}
 		}
 	}
-	else if ((m == MAGAZINE(tlt_config.page)) && (y == 29))
+	else if ((y == 29) && magazine_selected(ctx, m, NO))
 	{
 		// TODO:
 		//   ETS 300 706, chapter 9.5.1 Packet M/29/0
@@ -1128,7 +1210,7 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 		{
 			// ETS 300 706, chapter 9.5.1: Packet M/29/0
 			// ETS 300 706, chapter 9.5.3: Packet M/29/4
-			uint32_t triplet0 = unham_24_18((packet->data[3] << 16) | (packet->data[2] << 8) | packet->data[1]);
+			uint32_t triplet0 = dp.triplets[0];
 
 			if (triplet0 == 0xffffffff)
 			{
@@ -1141,14 +1223,21 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 				// ETS 300 706, table 13: Coding of Packet M/29/4
 				if ((triplet0 & 0xff) == 0x00)
 				{
-					set_g0_charset(triplet0);
-					if(default_g0_charset == LATIN)
+					// M/29 applies to every page of the magazine
+					for (int n = 0; n < ctx->num_pages; n++)
 					{
-						primary_charset.g0_m29 = (triplet0 & 0x3f80) >> 7;
-						// X/28 takes precedence over M/29
-						if (primary_charset.g0_x28 == UNDEFINED)
+						struct TeletextCharset *cs = &ctx->pages[n].charset;
+						if (m != MAGAZINE(ctx->pages[n].page))
+							continue;
+						set_g0_charset(cs, triplet0);
+						if(cs->g0 == LATIN)
 						{
-							remap_g0_charset(primary_charset.g0_m29);
+							cs->g0_m29 = (triplet0 & 0x3f80) >> 7;
+							// X/28 takes precedence over M/29
+							if (cs->g0_x28 == UNDEFINED)
+							{
+								remap_g0_charset(cs, cs->g0_m29);
+							}
 						}
 					}
 				}
@@ -1161,7 +1250,7 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 		if (ctx->states.programme_info_processed == NO)
 		{
 			// ETS 300 706, chapter 9.8.1: Packet 8/30 Format 1
-			if (unham_8_4(packet->data[0]) < 2)
+			if (designation_code < 2)
 			{
 				uint32_t t = 0;
 				time_t t0;
@@ -1169,7 +1258,7 @@ void process_telx_packet(struct TeletextCtx *ctx, data_unit_t data_unit_id, tele
 				for (uint8_t i = 20; i < 40; i++)
 				{
 					char u[4] = { 0, 0, 0, 0 };
-					uint8_t c = telx_to_ucs2(packet->data[i]);
+					uint8_t c = telx_to_ucs2(&ctx->pages[0].charset, packet->data[i]);
 					// strip any control codes from PID, eg. TVP station
 					if (c < 0x20) continue;
 
@@ -1502,36 +1591,23 @@ void* telxcc_init(void)
 	memset (ctx->seen_sub_page, 0, MAX_TLT_PAGES * sizeof(short int));
 	memset (ctx->cc_map, 0, 256);
 
-	ctx->page_buffer_prev = NULL;
-	ctx->page_buffer_cur = NULL;
-	ctx->page_buffer_cur_size = 0;
-	ctx->page_buffer_cur_used = 0;
-	ctx->page_buffer_prev_size = 0;
-	ctx->page_buffer_prev_used = 0;
-	// Current and previous page compare strings. This is plain text (no colors,
-	// tags, etc) in UCS2 (fixed length), so we can compare easily.
-	ctx->ucs2_buffer_prev = NULL;
-	ctx->ucs2_buffer_cur = NULL;
-	ctx->ucs2_buffer_cur_size = 0;
-	ctx->ucs2_buffer_cur_used = 0;
-	ctx->ucs2_buffer_prev_size = 0;
-	ctx->ucs2_buffer_prev_used = 0;
-
-	// Buffer timestamp
+	ctx->pages = NULL;
+	ctx->num_pages = 0;
+	add_page(ctx, tlt_config.page);
+	for (int i = 0; i < tlt_config.num_extra_pages; i++)
+		add_page(ctx, tlt_config.extra_pages[i]);
+
 	ctx->last_timestamp = 0;
-	memset(&ctx->page_buffer, 0, sizeof(teletext_page_t));
 	ctx->states.programme_info_processed = NO;
 	ctx->states.pts_initialized = NO;
 	ctx->tlt_packet_counter = 0;
 	ctx->transmission_mode = TRANSMISSION_MODE_SERIAL;
-	ctx->receiving_data = NO;
 
 	ctx->using_pts = UNDEFINED;
 	ctx->delta = 0;
 	ctx->t0 = 0;
 
 	ctx->sentence_cap = 0;
-	ctx->new_sentence = 0;
 	ctx->splitbysentence = 0;
 
 	return ctx;
@@ -1552,29 +1628,27 @@ void telxcc_close(void **ctx, struct cc_subtitle *sub)
 		return;
 
 	mprint ( "\nTeletext decoder: %"PRIu32" packets processed \n", ttext->tlt_packet_counter);
-	if (tlt_config.write_format != CCX_OF_RCWT && sub)
+	for (int n = 0; n < ttext->num_pages; n++)
 	{
-		// output any pending close caption
-		if (ttext->page_buffer.tainted == YES)
+		struct TeletextPageCtx *tp = &ttext->pages[n];
+		if (tlt_config.write_format != CCX_OF_RCWT && sub)
 		{
-			// Convert telx to UCS-2 before processing
-			for(uint8_t yt = 1; yt <= 23; ++yt)
+			// output any pending close caption
+			if (tp->page_buffer.tainted == YES)
 			{
-				for(uint8_t it = 0; it < 40; it++)
-				{
-					if (ttext->page_buffer.text[yt][it] != 0x00 && ttext->page_buffer.g2_char_present[yt][it] == 0)
-						ttext->page_buffer.text[yt][it] = telx_to_ucs2(ttext->page_buffer.text[yt][it]);
-				}
+				page_to_ucs2(&tp->charset, &tp->page_buffer);
+				// this time we do not subtract any frames, there will be no more frames
+				tp->page_buffer.hide_timestamp = ttext->last_timestamp;
+				process_page(ttext, tp, &tp->page_buffer, sub);
 			}
-			// this time we do not subtract any frames, there will be no more frames
-			ttext->page_buffer.hide_timestamp = ttext->last_timestamp;
-			process_page(ttext, &ttext->page_buffer, sub);
-		}
-
-		telxcc_dump_prev_page(ttext, sub);
 
+			dump_prev_page(ttext, tp, sub);
+		}
+		freep(&tp->ucs2_buffer_cur);
+		freep(&tp->page_buffer_cur);
+		freep(&tp->ucs2_buffer_prev);
+		freep(&tp->page_buffer_prev);
 	}
-	freep(&ttext->ucs2_buffer_cur);
-	freep(&ttext->page_buffer_cur);
+	freep(&ttext->pages);
 	freep(ctx);
 }
@@ -6,6 +6,7 @@
 #include "dvb_subtitle_decoder.h"
 #include "ccx_decoders_isdb.h"
 #include "file_buffer.h"
+#include "ccx_metrics.h"
 
 #ifdef DEBUG_SAVE_TS_PACKETS
 #include <sys/types.h>
@@ -14,7 +15,7 @@
 
 #define RAI_MASK 0x40 //byte mask to check if RAI bit is set (random access indicator)
 
-unsigned char tspacket[188]; // Current packet
+unsigned char *tspacket = NULL; // Current packet, in the file buffer or in the batch staging
 
 //struct ts_payload payload;
 
@@ -186,84 +187,11 @@ void init_ts(struct ccx_demuxer *ctx)
 }
 
 
-// Return 1 for successfully read ts packet
-int ts_readpacket(struct ccx_demuxer* ctx, struct ts_payload *payload)
+/* Parse the header of the 188 byte packet into payload */
+static void ts_parse_packet(struct ccx_demuxer *ctx, unsigned char *packet, struct ts_payload *payload)
 {
 	unsigned int adaptation_field_length = 0;
 	unsigned int adaptation_field_control;
-	long long result;
-	if (ctx->m2ts)
-	{
-		/* M2TS just adds 4 bytes to each packet (so size goes from 188 to 192)
-		   The 4 bytes are not important to us, so just skip
-		// TP_extra_header {
-		Copy_permission_indicator 2  unimsbf
-		Arrival_time_stamp 30 unimsbf
-		} */
-		unsigned char tp_extra_header[4];
-		result = buffered_read(ctx, tp_extra_header, 4);
-		ctx->past += result;
-		if (result != 4)
-		{
-			if (result>0)
-				mprint("Premature end of file (incomplete TS packer header, expected 4 bytes to skip M2TS extra bytes, got %lld).\n",result);
-			return CCX_EOF;
-		}
-	}
-
-	result = buffered_read(ctx, tspacket, 188);
-	ctx->past += result;
-	if (result != 188)
-	{
-		if (result > 0)
-			mprint("Premature end of file - Transport Stream packet is incomplete (expected 188 bytes, got %lld).\n", result);
-		return CCX_EOF;
-	}
-
-	int printtsprob = 1;
-	while (tspacket[0]!=0x47)
-	{
-		if (printtsprob)
-		{
-			dbg_print(CCX_DMT_DUMPDEF,"\nProblem: No TS header mark (filepos=%lld). Received bytes:\n", ctx->past);
-			dump(CCX_DMT_DUMPDEF, tspacket, 4, 0, 0);
-
-			dbg_print(CCX_DMT_DUMPDEF, "Skip forward to the next TS header mark.\n");
-			printtsprob = 0;
-		}
-
-		unsigned char *tstemp;
-		// The amount of bytes read into tspacket
-		int tslen = 188;
-
-		// Check for 0x47 in the remaining bytes of tspacket
-		tstemp = (unsigned char *) memchr (tspacket+1, 0x47, tslen-1);
-		if (tstemp != NULL )
-		{
-			// Found it
-			int atpos = tstemp-tspacket;
-
-			memmove (tspacket,tstemp,(size_t)(tslen-atpos));
-			result = buffered_read(ctx, tspacket+(tslen-atpos), atpos);
-			ctx->past+=result;
-			if (result!=atpos)
-			{
-				mprint("Premature end of file!\n");
-				return CCX_EOF;
-			}
-		}
-		else
-		{
-			// Read the next 188 bytes.
-			result = buffered_read(ctx, tspacket, tslen);
-			ctx->past+=result;
-			if (result!=tslen)
-			{
-				mprint("Premature end of file!\n");
-				return CCX_EOF;
-			}
-		}
-	}
 
 #ifdef DEBUG_SAVE_TS_PACKETS
 	// quick & dirty way to save packets so we reproduce issues that only
@@ -276,47 +204,49 @@ int ts_readpacket(struct ccx_demuxer* ctx, struct ts_payload *payload)
 	savepacket=fopen (spfn, "ab");
 	if (savepacket)
 	{
-		fwrite (tspacket,188,1,savepacket);
+		fwrite (packet,188,1,savepacket);
 		fclose (savepacket);
 	}
 #endif
 
-	payload->transport_error = (tspacket[1]&0x80)>>7;
-	payload->pesstart =  (tspacket[1] & 0x40) >> 6;
-	// unsigned transport_priority = (tspacket[1]&0x20)>>5;
-	payload->pid = (((tspacket[1] & 0x1F) << 8) | tspacket[2]) & 0x1FFF;
-	// unsigned transport_scrambling_control = (tspacket[3]&0xC0)>>6;
-	adaptation_field_control = (tspacket[3]&0x30)>>4;
-	payload->counter = tspacket[3] & 0xF;
+	payload->packet = packet;
+	payload->transport_error = (packet[1]&0x80)>>7;
+	payload->pesstart =  (packet[1] & 0x40) >> 6;
+	// unsigned transport_priority = (packet[1]&0x20)>>5;
+	payload->pid = (((packet[1] & 0x1F) << 8) | packet[2]) & 0x1FFF;
+	// unsigned transport_scrambling_control = (packet[3]&0xC0)>>6;
+	adaptation_field_control = (packet[3]&0x30)>>4;
+	payload->counter = packet[3] & 0xF;
 
 	if (payload->transport_error)
 	{
 		dbg_print(CCX_DMT_DUMPDEF, "Warning: Defective (error indicator on) TS packet (filepos=%lld):\n", ctx->past);
-		dump(CCX_DMT_DUMPDEF, tspacket, 188, 0, 0);
+		dump(CCX_DMT_DUMPDEF, packet, 188, 0, 0);
 	}
 
-	payload->start = tspacket + 4;
+	payload->start = packet + 4;
 	payload->length = 188 - 4;
+	payload->have_pcr = 0;
 	if (adaptation_field_control & 2)
 	{
 		// Take the PCR (Program Clock Reference) from here, in case PTS is not available (copied from telxcc).
-		adaptation_field_length = tspacket[4];
+		adaptation_field_length = packet[4];
 
-		payload->have_pcr = (tspacket[5] & 0x10) >> 4;
+		payload->have_pcr = (packet[5] & 0x10) >> 4;
 		if (payload->have_pcr)
 		{
 			payload->pcr = 0;
-			payload->pcr |= (tspacket[6] << 25);
-			payload->pcr |= (tspacket[7] << 17);
-			payload->pcr |= (tspacket[8] << 9);
-			payload->pcr |= (tspacket[9] << 1);
-			payload->pcr |= (tspacket[10] >> 7);
+			payload->pcr |= (packet[6] << 25);
+			payload->pcr |= (packet[7] << 17);
+			payload->pcr |= (packet[8] << 9);
+			payload->pcr |= (packet[9] << 1);
+			payload->pcr |= (packet[10] >> 7);
 			/* Ignore 27 Mhz clock since we dont deal in nanoseconds*/
-			// payload->pcr = ((tspacket[10] & 0x01) << 8);
-			// payload->pcr |= tspacket[11];
+			// payload->pcr = ((packet[10] & 0x01) << 8);
+			// payload->pcr |= packet[11];
 		}
 
-		payload->has_random_access_indicator = (tspacket[5] & RAI_MASK) != 0;
+		payload->has_random_access_indicator = (packet[5] & RAI_MASK) != 0;
 
 		// Catch bad packages with adaptation_field_length > 184 and
 		// the unsigned nature of payload_length leading to huge numbers.
@@ -335,6 +265,9 @@ int ts_readpacket(struct ccx_demuxer* ctx, struct ts_payload *payload)
 	else
 		payload->has_random_access_indicator = 0;
 
+	ccx_metrics_ts_packet(payload->pid, payload->counter, payload->length, adaptation_field_control & 1,
+			(adaptation_field_control & 2) && adaptation_field_length && (packet[5] & 0x80));
+
 	dbg_print(CCX_DMT_PARSE, "TS pid: %d  PES start: %d  counter: %u  payload length: %u  adapt length: %d\n",
 			payload->pid, payload->start, payload->counter, payload->length,
 			(int) (adaptation_field_length));
@@ -343,7 +276,131 @@ int ts_readpacket(struct ccx_demuxer* ctx, struct ts_payload *payload)
 	{
 		dbg_print(CCX_DMT_PARSE, "  No payload in package.\n");
 	}
-	// Store packet information
+}
+
+/* Check the sync bytes of all the packets in data and parse the good ones
+   into batch. Packets are size bytes apart, with the 0x47 marker hdr bytes
+   into each (M2TS TP_extra_header, not important to us). When the marker is
+   lost we skip forward to the next one. Returns the number of bytes used,
+   an incomplete packet at the end is left alone. */
+static size_t ts_scan_batch(struct ccx_demuxer *ctx, struct ts_batch *batch, unsigned char *data, size_t len,
+		unsigned hdr, unsigned size)
+{
+	size_t off = 0;
+	int printtsprob = 1;
+
+	while (off + size <= len && batch->count < TS_BATCH_PACKETS)
+	{
+		size_t n = (len - off) / size;
+		size_t good = 0;
+		unsigned char *tstemp;
+
+		if (n > (size_t) (TS_BATCH_PACKETS - batch->count))
+			n = TS_BATCH_PACKETS - batch->count;
+		// Validate the whole window first, so parsing doesn't have to
+		while (good < n && data[off + good * size + hdr] == 0x47)
+			good++;
+		for (size_t i = 0; i < good; i++)
+			ts_parse_packet(ctx, data + off + i * size + hdr, &batch->payload[batch->count++]);
+		off += good * size;
+		if (good == n)
+			break;
+
+		if (printtsprob)
+		{
+			dbg_print(CCX_DMT_DUMPDEF,"\nProblem: No TS header mark (filepos=%lld). Received bytes:\n", ctx->past);
+			dump(CCX_DMT_DUMPDEF, data + off + hdr, 4, 0, 0);
+
+			dbg_print(CCX_DMT_DUMPDEF, "Skip forward to the next TS header mark.\n");
+			printtsprob = 0;
+		}
+		tstemp = (unsigned char *) memchr (data + off + hdr + 1, 0x47, len - off - hdr - 1);
+		if (tstemp != NULL)
+			off = tstemp - data - hdr;
+		else
+			off = len - hdr;
+	}
+	return off;
+}
+
+/* Read the next window of packets into batch. They are used straight from
+   the file buffer when possible and copied into the batch staging otherwise. */
+static int ts_read_batch(struct ccx_demuxer *ctx, struct ts_batch *batch)
+{
+	unsigned hdr = ctx->m2ts ? 4 : 0;
+	unsigned size = hdr + ctx->ts_packet_size;
+	unsigned char *data;
+	size_t avail, used;
+	size_t result;
+
+	batch->count = 0;
+	batch->next = 0;
+	while (!batch->count)
+	{
+		if (batch->eof)
+		{
+			// A short read already hit the end of input, reading again would
+			// make buffered_read_opt() move on to the next file (or reopen stdin)
+			if (batch->staged_len > 0)
+				mprint("Premature end of file - Transport Stream packet is incomplete (expected %u bytes, got %u).\n",
+						size, batch->staged_len);
+			batch->staged_len = 0;
+			return CCX_EOF;
+		}
+		if (batch->staged_len == 0)
+		{
+			data = buffered_peek(ctx, TS_BATCH_PACKETS * size, &avail);
+			if (avail >= size)
+			{
+				used = ts_scan_batch(ctx, batch, data, avail, hdr, size);
+				buffered_skip(ctx, (unsigned) used);
+				ctx->past += used;
+				continue;
+			}
+			// Not even one whole packet buffered, read a full window
+			result = buffered_read(ctx, batch->staging, TS_BATCH_PACKETS * size);
+			if (result < TS_BATCH_PACKETS * size)
+				batch->eof = 1;
+		}
+		else
+		{
+			// Left over from a resync, complete just that packet so
+			// we can go back to using the file buffer directly
+			memmove(batch->staging, batch->staging + batch->staged_pos, batch->staged_len);
+			result = buffered_read(ctx, batch->staging + batch->staged_len, size - batch->staged_len);
+		}
+		ctx->past += result;
+		avail = batch->staged_len + result;
+		batch->staged_pos = 0;
+		batch->staged_len = 0;
+		if (avail < size)
+		{
+			if (avail > 0)
+				mprint("Premature end of file - Transport Stream packet is incomplete (expected %u bytes, got %u).\n",
+						size, (unsigned) avail);
+			return CCX_EOF;
+		}
+		used = ts_scan_batch(ctx, batch, batch->staging, avail, hdr, size);
+		batch->staged_pos = used;
+		batch->staged_len = avail - used;
+	}
+	return CCX_OK;
+}
+
+// Return CCX_OK for successfully read ts packet
+int ts_readpacket(struct ccx_demuxer* ctx, struct ts_payload *payload)
+{
+	struct ts_batch *batch = &ctx->tsbatch;
+	int ret;
+
+	if (batch->next == batch->count)
+	{
+		ret = ts_read_batch(ctx, batch);
+		if (ret != CCX_OK)
+			return ret;
+	}
+	*payload = batch->payload[batch->next++];
+	tspacket = payload->packet;
 	return CCX_OK;
 }
 
@@ -372,6 +429,13 @@ void delete_demuxer_data_node_by_pid(struct demuxer_data **data, int pid)
 {
 	struct demuxer_data *ptr;
 	struct demuxer_data *sptr = NULL;
+	struct demuxer_data_index *index;
+
+	if (!*data)
+		return;
+	index = (*data)->index;
+	if (!index->by_pid[pid])
+		return;
 
 	ptr = *data;
 	while (ptr)
@@ -379,11 +443,19 @@ void delete_demuxer_data_node_by_pid(struct demuxer_data **data, int pid)
 		if(ptr->stream_pid == pid)
 		{
 			if (sptr == NULL)
+			{
 				*data = ptr->next_stream;
+				if (*data)
+					(*data)->index = index;
+			}
 			else
 				sptr->next_stream = ptr->next_stream;
 
-			delete_demuxer_data(ptr);
+			index->by_pid[pid] = NULL;
+			index->best_valid = 0;
+			ptr->index = NULL;
+			ptr->next_stream = index->pool;
+			index->pool = ptr;
 			ptr = NULL;
 		}
 		else
@@ -393,43 +465,68 @@ void delete_demuxer_data_node_by_pid(struct demuxer_data **data, int pid)
 		}
 	}
 
+	if (!*data)
+	{
+		// Nothing left to hang the index on
+		while (index->pool)
+		{
+			ptr = index->pool;
+			index->pool = ptr->next_stream;
+			delete_demuxer_data(ptr);
+		}
+		free(index);
+	}
 }
 
 struct demuxer_data *search_or_alloc_demuxer_data_node_by_pid(struct demuxer_data **data, int pid)
 {
 	struct demuxer_data *ptr;
 	struct demuxer_data *sptr;
+	struct demuxer_data_index *index;
+
 	if (!*data)
 	{
-		*data = alloc_demuxer_data();
-		(*data)->program_number = -1;
-		(*data)->stream_pid = pid;
-		(*data)->bufferdatatype = CCX_UNKNOWN;
-		(*data)->len = 0;
-		(*data)->next_program = NULL;
-		(*data)->next_stream = NULL;
-		return *data;
+		index = calloc(1, sizeof(struct demuxer_data_index));
+		if (!index)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory to index the demuxer data by PID");
 	}
-	ptr = *data;
-
-	do
+	else
 	{
-		if(ptr->stream_pid == pid)
-		{
-			return ptr;
-		}
-		sptr = ptr;
-		ptr = ptr->next_stream;
-	} while(ptr);
+		index = (*data)->index;
+		if (index->by_pid[pid])
+			return index->by_pid[pid];
+	}
 
-	sptr->next_stream = alloc_demuxer_data();
-	ptr = sptr->next_stream;
+	// Reuse a node deleted earlier before allocating one
+	ptr = index->pool;
+	if (ptr)
+	{
+		index->pool = ptr->next_stream;
+		reset_demuxer_data(ptr);
+	}
+	else
+	{
+		ptr = alloc_demuxer_data();
+		if (!ptr)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory to store demuxer data");
+	}
 	ptr->program_number = -1;
 	ptr->stream_pid = pid;
 	ptr->bufferdatatype = CCX_UNKNOWN;
-	ptr->len = 0;
-	ptr->next_program = NULL;
-	ptr->next_stream = NULL;
+
+	if (!*data)
+	{
+		ptr->index = index;
+		*data = ptr;
+	}
+	else
+	{
+		for (sptr = *data; sptr->next_stream; sptr = sptr->next_stream)
+			;
+		sptr->next_stream = ptr;
+	}
+	index->by_pid[pid] = ptr;
+	index->best_valid = 0;
 
 	return ptr;
 }
@@ -438,6 +535,11 @@ struct demuxer_data *get_best_data(struct demuxer_data *data)
 {
 	struct demuxer_data *ret = NULL;
 	struct demuxer_data *ptr = data;
+
+	// Only changes when a stream is added, deleted or changes codec
+	if (data && data->index && data->index->best_valid)
+		return data->index->best;
+
 	for(ptr = data; ptr; ptr = ptr->next_stream)
 	{
 		if(ptr->codec == CCX_CODEC_TELETEXT)
@@ -473,6 +575,11 @@ struct demuxer_data *get_best_data(struct demuxer_data *data)
 		}
 	}
 end:
+	if (data && data->index)
+	{
+		data->index->best = ret;
+		data->index->best_valid = 1;
+	}
 
 	return ret;
 }
@@ -487,7 +594,11 @@ int copy_capbuf_demux_data(struct ccx_demuxer *ctx, struct demuxer_data **data,
 
 	ptr = search_or_alloc_demuxer_data_node_by_pid(data, cinfo->pid);
 	ptr->program_number = cinfo->program_number;
-	ptr->codec = cinfo->codec;
+	if (ptr->codec != cinfo->codec)
+	{
+		ptr->codec = cinfo->codec;
+		(*data)->index->best_valid = 0;
+	}
 	ptr->bufferdatatype = get_buffer_type(cinfo);
 
 	if(!cinfo->capbuf || !cinfo->capbuflen)
@@ -590,11 +701,11 @@ void cinfo_cremation(struct ccx_demuxer *ctx, struct demuxer_data **data)
 	list_for_each_entry(iter, &ctx->cinfo_tree.all_stream, all_stream, struct cap_info)
 	{
 		copy_capbuf_demux_data(ctx, data, iter);
-		freep(&iter->capbuf);
+		capbuf_release(ctx, iter);
 	}
 }
 
-int copy_payload_to_capbuf(struct cap_info *cinfo, struct ts_payload *payload)
+int copy_payload_to_capbuf(struct ccx_demuxer *ctx, struct cap_info *cinfo, struct ts_payload *payload)
 {
 	int newcapbuflen;
 
@@ -620,12 +731,8 @@ int copy_payload_to_capbuf(struct cap_info *cinfo, struct ts_payload *payload)
 
 	// copy payload to capbuf
 	newcapbuflen = cinfo->capbuflen + payload->length;
-	if ( newcapbuflen > cinfo->capbufsize) {
-		cinfo->capbuf = (unsigned char*)realloc(cinfo->capbuf, newcapbuflen);
-		if (!cinfo->capbuf)
-			return -1;
-		cinfo->capbufsize = newcapbuflen;
-	}
+	if (capbuf_reserve(ctx, cinfo, newcapbuflen) < 0)
+		return -1;
 	memcpy(cinfo->capbuf + cinfo->capbuflen, payload->start, payload->length);
 	cinfo->capbuflen = newcapbuflen;
 
@@ -747,11 +854,10 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 	int ret = CCX_EAGAIN;
 	struct program_info *pinfo = NULL;
 	struct cap_info *cinfo;
-	struct ts_payload payload;
+	struct ts_batch *batch = &ctx->tsbatch;
+	struct ts_payload *payload;
 	int j;
 
-	memset(&payload, 0, sizeof(payload));
-
 	/*if (ctx->got_important_streams_min_pts[VIDEO] == UINT64_MAX)
 		ctx->got_important_streams_min_pts[VIDEO] = get_video_min_pts(ctx);*/
 
@@ -760,47 +866,52 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 		pcount++;
 
 		// Exit the loop at EOF
-		ret = ts_readpacket(ctx, &payload);
-		if ( ret != CCX_OK)
-			break;
+		if (batch->next == batch->count)
+		{
+			ret = ts_read_batch(ctx, batch);
+			if ( ret != CCX_OK)
+				break;
+		}
+		payload = &batch->payload[batch->next++];
+		tspacket = payload->packet; // For the PSI and EPG parsers
 
 		// Skip damaged packets, they could do more harm than good
-		if (payload.transport_error)
+		if (payload->transport_error)
 		{
 			dbg_print(CCX_DMT_VERBOSE, "Packet (pid %u) skipped - transport error.\n",
-				payload.pid);
+				payload->pid);
 			continue;
 		}
 
 		// Check for PAT
-		if( payload.pid == 0) // This is a PAT
+		if( payload->pid == 0) // This is a PAT
 		{
 			ts_buffer_psi_packet(ctx);
-			if(ctx->PID_buffers[payload.pid]!=NULL && ctx->PID_buffers[payload.pid]->buffer_length>0)
+			if(ctx->PID_buffers[payload->pid]!=NULL && ctx->PID_buffers[payload->pid]->buffer_length>0)
 				parse_PAT(ctx); // Returns 1 if there was some data in the buffer already
 			continue;
 		}
 
-		if( ccx_options.xmltv >= 1 && payload.pid == 0x11) {// This is SDT (or BAT)
+		if( ccx_options.xmltv >= 1 && payload->pid == 0x11) {// This is SDT (or BAT)
 			ts_buffer_psi_packet(ctx);
-			if(ctx->PID_buffers[payload.pid]!=NULL && ctx->PID_buffers[payload.pid]->buffer_length>0)
+			if(ctx->PID_buffers[payload->pid]!=NULL && ctx->PID_buffers[payload->pid]->buffer_length>0)
 				parse_SDT(ctx);
 		}
 
-		if( ccx_options.xmltv >= 1 && payload.pid == 0x12) // This is DVB EIT
+		if( ccx_options.xmltv >= 1 && payload->pid == 0x12) // This is DVB EIT
 			parse_EPG_packet(ctx->parent);
-		if( ccx_options.xmltv >= 1 && payload.pid >= 0x1000) // This may be ATSC EPG packet
+		if( ccx_options.xmltv >= 1 && payload->pid >= 0x1000) // This may be ATSC EPG packet
 			parse_EPG_packet(ctx->parent);
 
 
 		for (j = 0; j < ctx->nb_program; j++)
 		{
 			if (ctx->pinfo[j].analysed_PMT_once == CCX_TRUE &&
-				ctx->pinfo[j].pcr_pid == payload.pid &&
-				payload.have_pcr)
+				ctx->pinfo[j].pcr_pid == payload->pid &&
+				payload->have_pcr)
 			{
 				ctx->last_global_timestamp = ctx->global_timestamp;
-				ctx->global_timestamp = (uint32_t) payload.pcr / 90;
+				ctx->global_timestamp = (uint32_t) payload->pcr / 90;
 				if (!ctx->global_timestamp_inited)
 				{
 					ctx->min_global_timestamp = ctx->global_timestamp;
@@ -813,50 +924,50 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 				}
 
 			}
-			if (ctx->pinfo[j].pid == payload.pid)
+			if (ctx->pinfo[j].pid == payload->pid)
 			{
-				if (!ctx->PIDs_seen[payload.pid])
-					dbg_print(CCX_DMT_PAT, "This PID (%u) is a PMT for program %u.\n",payload.pid, ctx->pinfo[j].program_number);
+				if (!ctx->PIDs_seen[payload->pid])
+					dbg_print(CCX_DMT_PAT, "This PID (%u) is a PMT for program %u.\n",payload->pid, ctx->pinfo[j].program_number);
 				pinfo = ctx->pinfo + j;
 				break;
 			}
 		}
 		if (j != ctx->nb_program)
 		{
-			ctx->PIDs_seen[payload.pid]=2;
+			ctx->PIDs_seen[payload->pid]=2;
 			ts_buffer_psi_packet(ctx);
-			if(ctx->PID_buffers[payload.pid]!=NULL && ctx->PID_buffers[payload.pid]->buffer_length>0)
- 				if(parse_PMT(ctx, ctx->PID_buffers[payload.pid]->buffer+1, ctx->PID_buffers[payload.pid]->buffer_length-1, pinfo))
+			if(ctx->PID_buffers[payload->pid]!=NULL && ctx->PID_buffers[payload->pid]->buffer_length>0)
+ 				if(parse_PMT(ctx, ctx->PID_buffers[payload->pid]->buffer+1, ctx->PID_buffers[payload->pid]->buffer_length-1, pinfo))
 					gotpes=1; // Signals that something changed and that we must flush the buffer
 			continue;
 		}
 
-		switch (ctx->PIDs_seen[payload.pid])
+		switch (ctx->PIDs_seen[payload->pid])
 		{
 			case 0: // First time we see this PID
-				if (ctx->PIDs_programs[payload.pid])
+				if (ctx->PIDs_programs[payload->pid])
 				{
-					dbg_print(CCX_DMT_PARSE, "\nNew PID found: %u (%s), belongs to program: %u\n", payload.pid,
-						desc[ctx->PIDs_programs[payload.pid]->printable_stream_type],
-						ctx->PIDs_programs[payload.pid]->program_number);
-					ctx->PIDs_seen[payload.pid]=2;
+					dbg_print(CCX_DMT_PARSE, "\nNew PID found: %u (%s), belongs to program: %u\n", payload->pid,
+						desc[ctx->PIDs_programs[payload->pid]->printable_stream_type],
+						ctx->PIDs_programs[payload->pid]->program_number);
+					ctx->PIDs_seen[payload->pid]=2;
 				}
 				else
 				{
-					dbg_print(CCX_DMT_PARSE, "\nNew PID found: %u, program number still unknown\n", payload.pid);
-					ctx->PIDs_seen[payload.pid]=1;
+					dbg_print(CCX_DMT_PARSE, "\nNew PID found: %u, program number still unknown\n", payload->pid);
+					ctx->PIDs_seen[payload->pid]=1;
 				}
-				ctx->have_PIDs[ctx->num_of_PIDs] = payload.pid;
+				ctx->have_PIDs[ctx->num_of_PIDs] = payload->pid;
 				ctx->num_of_PIDs++;
 				break;
 			case 1: // Saw it before but we didn't know what program it belonged to. Luckier now?
-				if (ctx->PIDs_programs[payload.pid])
+				if (ctx->PIDs_programs[payload->pid])
 				{
-					dbg_print(CCX_DMT_PARSE, "\nProgram for PID: %u (previously unknown) is: %u (%s)\n", payload.pid,
-						ctx->PIDs_programs[payload.pid]->program_number,
-						desc[ctx->PIDs_programs[payload.pid]->printable_stream_type]
+					dbg_print(CCX_DMT_PARSE, "\nProgram for PID: %u (previously unknown) is: %u (%s)\n", payload->pid,
+						ctx->PIDs_programs[payload->pid]->program_number,
+						desc[ctx->PIDs_programs[payload->pid]->printable_stream_type]
 						);
-					ctx->PIDs_seen[payload.pid]=2;
+					ctx->PIDs_seen[payload->pid]=2;
 				}
 				break;
 			case 2: // Already seen and reported with correct program
@@ -866,23 +977,23 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 		}
 
 		//PTS calculation
-		if (payload.pesstart) //if there is PES Header data in the payload and we didn't get the first pts of that stream
+		if (payload->pesstart) //if there is PES Header data in the payload and we didn't get the first pts of that stream
 		{
 			// Packetized Elementary Stream (PES) 32-bit start code
-			uint64_t pes_prefix = (payload.start[0] << 16) | (payload.start[1] << 8) | payload.start[2];
-			uint8_t pes_stream_id = payload.start[3];
+			uint64_t pes_prefix = (payload->start[0] << 16) | (payload->start[1] << 8) | payload->start[2];
+			uint8_t pes_stream_id = payload->start[3];
 
 			uint64_t pts = 0;
 
 			// check for PES header
 			if (pes_prefix == 0x000001)
 			{
-				pts = get_pts(payload.start);
+				pts = get_pts(payload->start);
 				//keep in mind we already checked if we have this stream id
 				//we find the index of the packet PID in the have_PIDs array
 				int pid_index;
 				for (int i = 0; i < ctx->num_of_PIDs; i++)
-					if (payload.pid == ctx->have_PIDs[i])
+					if (payload->pid == ctx->have_PIDs[i])
 						pid_index = i;
 				ctx->stream_id_of_each_pid[pid_index] = pes_stream_id;
 				if (pts < ctx->min_pts[pid_index])
@@ -890,27 +1001,27 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 			}
 		}
 
-		if (payload.pid == 8191) // Null packet
+		if (payload->pid == 8191) // Null packet
 			continue;
-		if (payload.pid==1003 && !ctx->hauppauge_warning_shown && !ccx_options.hauppauge_mode)
+		if (payload->pid==1003 && !ctx->hauppauge_warning_shown && !ccx_options.hauppauge_mode)
 		{
 			// TODO: Change this very weak test for something more decent such as size.
 			mprint ("\n\nNote: This TS could be a recording from a Hauppage card. If no captions are detected, try --hauppauge\n\n");
 			ctx->hauppauge_warning_shown=1;
 		}
 
-		if (ccx_options.hauppauge_mode && payload.pid==HAUPPAGE_CCPID)
+		if (ccx_options.hauppauge_mode && payload->pid==HAUPPAGE_CCPID)
 		{
 			// Haup packets processed separately, because we can't mix payloads. So they go in their own buffer
 			// copy payload to capbuf
-			int haup_newcapbuflen = haup_capbuflen + payload.length;
+			int haup_newcapbuflen = haup_capbuflen + payload->length;
 			if ( haup_newcapbuflen > haup_capbufsize) {
 				haup_capbuf = (unsigned char*)realloc(haup_capbuf, haup_newcapbuflen);
 				if (!haup_capbuf)
 					fatal(EXIT_NOT_ENOUGH_MEMORY, "Not enough memory to store hauppauge packets");
 				haup_capbufsize = haup_newcapbuflen;
 			}
-			memcpy(haup_capbuf+haup_capbuflen, payload.start, payload.length);
+			memcpy(haup_capbuf+haup_capbuflen, payload->start, payload->length);
 			haup_capbuflen = haup_newcapbuflen;
 
 		}
@@ -918,21 +1029,21 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 		// Skip packets with no payload.  This also fixes the problems
 		// with the continuity counter not being incremented in empty
 		// packets.
-		if ( !payload.length )
+		if ( !payload->length )
 		{
 				dbg_print(CCX_DMT_VERBOSE, "Packet (pid %u) skipped - no payload.\n",
-						payload.pid);
+						payload->pid);
 				continue;
 		}
 
-		cinfo = get_cinfo(ctx, payload.pid);
+		cinfo = get_cinfo(ctx, payload->pid);
 		if(cinfo == NULL)
 		{
 			if (!packet_analysis_mode)
 				dbg_print(CCX_DMT_PARSE, "Packet (pid %u) skipped - no stream with captions identified yet.\n",
-					   payload.pid);
+					   payload->pid);
 			else
-				look_for_caption_data (ctx, &payload);
+				look_for_caption_data (ctx, payload);
 			continue;
 		}
 		else if (cinfo->ignore == CCX_TRUE &&
@@ -958,8 +1069,7 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 
 			if (cinfo->capbuflen > 0)
 			{
-				freep(&cinfo->capbuf);
-				cinfo->capbufsize = 0;
+				capbuf_release(ctx, cinfo);
 				cinfo->capbuflen = 0;
 				delete_demuxer_data_node_by_pid(data, cinfo->pid);
 			}
@@ -967,10 +1077,10 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 		}
 
 		// Video PES start
-		if (payload.pesstart)
+		if (payload->pesstart)
 		{
 			cinfo->saw_pesstart = 1;
-			cinfo->prev_counter = payload.counter - 1;
+			cinfo->prev_counter = payload->counter - 1;
 		}
 
 		// Discard packets when no pesstart was found.
@@ -978,26 +1088,28 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 			continue;
 
 
-		if ( (cinfo->prev_counter == 15 ? 0 : cinfo->prev_counter + 1) != payload.counter )
+		if ( (cinfo->prev_counter == 15 ? 0 : cinfo->prev_counter + 1) != payload->counter )
 		{
 			mprint("TS continuity counter not incremented prev/curr %u/%u\n",
-					cinfo->prev_counter, payload.counter);
+					cinfo->prev_counter, payload->counter);
 		}
-		cinfo->prev_counter = payload.counter;
+		cinfo->prev_counter = payload->counter;
 
 		// If the buffer is empty we just started this function
-		if (payload.pesstart && cinfo->capbuflen > 0)
+		if (payload->pesstart && cinfo->capbuflen > 0)
 		{
 			dbg_print(CCX_DMT_PARSE, "\nPES finished (%ld bytes/%ld PES packets/%ld total packets)\n",
 					cinfo->capbuflen, pespcount, pcount);
 
 			// Keep the data from capbuf to be worked on
+			ccx_metrics_enter(CCX_STAGE_PES);
 			ret = copy_capbuf_demux_data(ctx, data, cinfo);
+			ccx_metrics_leave(cinfo->capbuflen);
 			cinfo->capbuflen = 0;
 			gotpes = 1;
 		}
 
-		copy_payload_to_capbuf(cinfo, &payload);
+		copy_payload_to_capbuf(ctx, cinfo, payload);
 		if(ret < 0)
 		{
 			if(errno == EINVAL)
@@ -1055,10 +1167,13 @@ long ts_readstream(struct ccx_demuxer *ctx, struct demuxer_data **data)
 int ts_get_more_data(struct lib_ccx_ctx *ctx, struct demuxer_data **data)
 {
 	int ret = CCX_OK;
+	LLONG past = ctx->demux_ctx->past;
 
+	ccx_metrics_enter(CCX_STAGE_TS);
 	do {
 		ret = ts_readstream(ctx->demux_ctx, data);
 	} while(ret == CCX_EAGAIN);
+	ccx_metrics_leave(ctx->demux_ctx->past > past ? (size_t) (ctx->demux_ctx->past - past) : 0);
 
 	return ret;
 }
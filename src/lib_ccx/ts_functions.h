@@ -3,6 +3,7 @@
 
 struct ts_payload
 {
+	unsigned char *packet; // The whole 188 byte packet, in the input buffer
 	unsigned char *start; // Payload start
 	unsigned length;      // Payload length
 	unsigned pesstart;    // PES or PSI start
@@ -12,9 +13,22 @@ struct ts_payload
 	int has_random_access_indicator; //1 = start of new GOP (Set when the stream may be decoded without errors from this point)
 	int have_pcr;
 	int64_t pcr;
-	unsigned char section_buf[4098];
-	int section_index;
-	int section_size;
+};
+
+#define TS_BATCH_PACKETS 64
+#define TS_MAX_PACKET_SIZE 208 // 204 byte packets (with Reed-Solomon parity) + M2TS header
+
+/* A window of consecutive packets read in one go. The payloads point into the
+   file buffer when the packets are there in one piece, into staging otherwise. */
+struct ts_batch
+{
+	struct ts_payload payload[TS_BATCH_PACKETS];
+	int count; // Packets in payload[]
+	int next;  // Next packet to hand out
+	unsigned char staging[TS_BATCH_PACKETS * TS_MAX_PACKET_SIZE];
+	unsigned staged_pos; // Bytes in staging not used by the batch yet, start here...
+	unsigned staged_len; // ...and are this long
+	int eof; // Last read into staging came up short
 };
 
 struct PAT_entry
@@ -33,12 +47,29 @@ struct PMT_entry
 	unsigned printable_stream_type;
 };
 
+/* Longest section (4096 bytes, EIT), after a pointer_field and the end of
+   a previous section, each up to a packet long */
+#define PSI_BUFFER_SIZE (4096 + 2 * 184)
+#define PSI_SECTION_CACHE_SIZE 64 // Power of two
+
+/* A section parsed already, see psi_section_unchanged() */
+struct psi_section_key
+{
+	uint32_t crc;
+	uint16_t table_id_extension;
+	uint8_t table_id;
+	uint8_t version_number;
+	uint8_t section_number;
+	uint8_t used;
+};
+
 struct PSI_buffer
 {
 	uint32_t prev_ccounter;
-	uint8_t *buffer;
+	uint8_t *buffer; // PSI_BUFFER_SIZE bytes from the first packet on, reused
 	uint32_t buffer_length;
 	uint32_t ccounter;
+	struct psi_section_key *cache; // PSI_SECTION_CACHE_SIZE entries, NULL until a section is parsed
 };
 
 struct EPG_rating
@@ -67,12 +98,16 @@ struct EPG_event
 	uint16_t service_id;
 	long long int count; //incremented by one each time the event is updated
 	uint8_t live_output; //boolean flag, true if this event has been output
+	uint8_t dirty; //boolean flag, true if this event changed since it was last written to _epg.xml
+	uint8_t written; //boolean flag, true if _epg.xml has a copy of this event
 };
 
 #define EPG_MAX_EVENTS 60*24*7
+#define EPG_ID_HASH_BITS 14 // Must have room for EPG_MAX_EVENTS
 struct EIT_program
 {
 	uint32_t array_len;
 	struct EPG_event epg_events[EPG_MAX_EVENTS];
+	uint16_t id_hash[1 << EPG_ID_HASH_BITS]; // Index+1 in epg_events of each id, 0 if the slot is free
 };
 #endif
@@ -141,12 +141,34 @@ int get_best_stream(struct ccx_demuxer *ctx)
 struct demuxer_data *get_data_stream(struct demuxer_data *data, int pid)
 {
 	struct demuxer_data *ptr = data;
+
+	if (data && data->index)
+	{
+		if (pid < 0 || pid > MAX_PSI_PID)
+			return NULL;
+		ptr = data->index->by_pid[pid];
+		return ptr && ptr->len > 0 ? ptr : NULL;
+	}
 	for(ptr = data; ptr; ptr = ptr->next_stream)
 		if(ptr->stream_pid == pid && ptr->len > 0)
 			return ptr;
 
 	return NULL;
 }
+/* Like get_data_stream(), but also return the node if it has no data */
+struct demuxer_data *get_data_node_by_pid(struct demuxer_data *data, int pid)
+{
+	struct demuxer_data *ptr;
+
+	if (data && data->index)
+		return (pid < 0 || pid > MAX_PSI_PID) ? NULL : data->index->by_pid[pid];
+	for(ptr = data; ptr; ptr = ptr->next_stream)
+		if(ptr->stream_pid == pid)
+			return ptr;
+
+	return NULL;
+}
+
 int need_cap_info_for_pid(struct ccx_demuxer *ctx, int pid)
 {
 	struct cap_info* iter;
@@ -210,7 +232,6 @@ int update_capinfo(struct ccx_demuxer *ctx, int pid, enum ccx_stream_type stream
 
 				tmp->saw_pesstart = 0;
 				tmp->capbuflen = 0;
-				tmp->capbufsize = 0;
 				tmp->ignore = 0;
 				if(private_data)
 					tmp->codec_private_data = private_data;
@@ -267,7 +288,7 @@ void dinit_cap (struct ccx_demuxer *ctx)
 	{
 		iter = list_entry(ctx->cinfo_tree.all_stream.next, struct cap_info, all_stream);
 		list_del(&iter->all_stream);
-		freep(&iter->capbuf);
+		capbuf_release(ctx, iter);
 		free(iter);
 	}
 	INIT_LIST_HEAD(&ctx->cinfo_tree.all_stream);
@@ -275,6 +296,164 @@ void dinit_cap (struct ccx_demuxer *ctx)
 	INIT_LIST_HEAD(&ctx->cinfo_tree.pg_stream);
 }
 
+/* Header in front of every capture buffer handed out by the arena */
+struct capbuf_block
+{
+	struct capbuf_block *next_free;
+	int size_class; // CAPBUF_CLASSES for buffers too big for any class
+	int in_region;
+	size_t size;    // Usable bytes after the header
+};
+
+static int capbuf_size_class(size_t size)
+{
+	int size_class = 0;
+	size_t class_size = CAPBUF_MIN_SIZE;
+
+	while (class_size < size && size_class < CAPBUF_CLASSES)
+	{
+		class_size <<= 1;
+		size_class++;
+	}
+	return size_class;
+}
+
+static struct capbuf_block *capbuf_get_block(struct capbuf_arena *arena, size_t size)
+{
+	struct capbuf_block *block;
+	int size_class = capbuf_size_class(size);
+	size_t total;
+
+	arena->requests++;
+	if (size_class < CAPBUF_CLASSES)
+	{
+		if (arena->free_list[size_class])
+		{
+			block = arena->free_list[size_class];
+			arena->free_list[size_class] = block->next_free;
+			arena->reused++;
+			return block;
+		}
+		size = (size_t)CAPBUF_MIN_SIZE << size_class;
+	}
+	total = sizeof(struct capbuf_block) + size;
+
+	if (!arena->region)
+	{
+		arena->region = malloc(CAPBUF_REGION_SIZE);
+		if (arena->region)
+		{
+			arena->bytes_reserved += CAPBUF_REGION_SIZE;
+			arena->system_allocs++;
+		}
+	}
+	if (arena->region && size_class < CAPBUF_CLASSES && total <= CAPBUF_REGION_SIZE - arena->region_used)
+	{
+		block = (struct capbuf_block *) (arena->region + arena->region_used);
+		arena->region_used += total;
+		block->in_region = 1;
+	}
+	else
+	{
+		block = malloc(total);
+		if (!block)
+			return NULL;
+		arena->bytes_reserved += total;
+		arena->system_allocs++;
+		block->in_region = 0;
+	}
+	block->size_class = size_class;
+	block->size = size;
+	return block;
+}
+
+static void capbuf_put_block(struct capbuf_arena *arena, struct capbuf_block *block)
+{
+	if (block->size_class == CAPBUF_CLASSES)
+	{
+		arena->bytes_reserved -= sizeof(struct capbuf_block) + block->size;
+		free(block);
+		return;
+	}
+	block->next_free = arena->free_list[block->size_class];
+	arena->free_list[block->size_class] = block;
+}
+
+/**
+ * Make room for at least size bytes in cinfo->capbuf, keeping the first
+ * capbuflen bytes. Return 0 on success or -1 if out of memory, in which
+ * case the old buffer is left as it was.
+ */
+int capbuf_reserve(struct ccx_demuxer *ctx, struct cap_info *cinfo, long size)
+{
+	struct capbuf_arena *arena = &ctx->capbuf_arena;
+	struct capbuf_block *block;
+	unsigned char *buf;
+
+	if (size <= cinfo->capbufsize)
+		return 0;
+	// Grow geometrically, a PES is received one TS packet at a time
+	if (size < cinfo->capbufsize * 2)
+		size = cinfo->capbufsize * 2;
+
+	block = capbuf_get_block(arena, size);
+	if (!block)
+		return -1;
+	buf = (unsigned char *) (block + 1);
+	if (cinfo->capbuf && cinfo->capbuflen > 0)
+		memcpy(buf, cinfo->capbuf, cinfo->capbuflen);
+	capbuf_release(ctx, cinfo);
+
+	cinfo->capbuf = buf;
+	cinfo->capbufsize = block->size;
+	arena->bytes_allocated += block->size;
+	if (arena->bytes_allocated > arena->peak_bytes_allocated)
+		arena->peak_bytes_allocated = arena->bytes_allocated;
+	return 0;
+}
+
+/* Give cinfo->capbuf back to the arena. capbuflen is left alone. */
+void capbuf_release(struct ccx_demuxer *ctx, struct cap_info *cinfo)
+{
+	struct capbuf_block *block;
+
+	if (!cinfo->capbuf)
+		return;
+	block = (struct capbuf_block *) cinfo->capbuf - 1;
+	ctx->capbuf_arena.bytes_allocated -= block->size;
+	capbuf_put_block(&ctx->capbuf_arena, block);
+	cinfo->capbuf = NULL;
+	cinfo->capbufsize = 0;
+}
+
+void capbuf_arena_report(struct capbuf_arena *arena)
+{
+	dbg_print(CCX_DMT_VERBOSE, "Capture buffers: %lu requests (%lu reused), %lu system allocations, "
+			"%zu bytes in use, %zu peak, %zu reserved.\n",
+			arena->requests, arena->reused, arena->system_allocs,
+			arena->bytes_allocated, arena->peak_bytes_allocated, arena->bytes_reserved);
+}
+
+/* All buffers must have been released before */
+void dinit_capbuf_arena(struct capbuf_arena *arena)
+{
+	struct capbuf_block *block;
+	int i;
+
+	for (i = 0; i < CAPBUF_CLASSES; i++)
+	{
+		while (arena->free_list[i])
+		{
+			block = arena->free_list[i];
+			arena->free_list[i] = block->next_free;
+			if (!block->in_region)
+				free(block);
+		}
+	}
+	freep(&arena->region);
+	memset(arena, 0, sizeof(struct capbuf_arena));
+}
+
 
 struct cap_info * get_cinfo(struct ccx_demuxer *ctx, int pid)
 {
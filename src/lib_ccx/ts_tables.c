@@ -1,4 +1,5 @@
 #include "lib_ccx.h"
+#include "program_pipeline.h"
 #include "ccx_common_option.h"
 #include "dvb_subtitle_decoder.h"
 #include "ccx_decoders_isdb.h"
@@ -156,6 +157,11 @@ int parse_PMT (struct ccx_demuxer *ctx, unsigned char *buf, int len,  struct pro
 		return 0; //We don't have the full section yet. We will parse again when we have it.
 	}
 
+	// Same section as last time, nothing to look at
+	if (pinfo->analysed_PMT_once == CCX_TRUE && pinfo->pid > 0 && pinfo->pid < MAX_PSI_PID &&
+			psi_section_unchanged(ctx->PID_buffers[pinfo->pid], buf, len))
+		return 0;
+
 	program_number = ((buf[3] << 8)	| buf[4]);
 	version_number = (buf[5] & 0x3E) >> 1;
 
@@ -164,7 +170,7 @@ int parse_PMT (struct ccx_demuxer *ctx, unsigned char *buf, int len,  struct pro
 	if (!current_next_indicator && pinfo->version!=0xFF) // 0xFF means we don't have one yet
 		return 0;
 
-	memcpy (pinfo->saved_section, buf, len);
+	memcpy (pinfo->saved_section, buf, len < sizeof(pinfo->saved_section) ? len : sizeof(pinfo->saved_section));
 
 	if (pinfo->analysed_PMT_once == CCX_TRUE && pinfo->version == version_number)
 	{
@@ -463,6 +469,110 @@ int parse_PMT (struct ccx_demuxer *ctx, unsigned char *buf, int len,  struct pro
 	return must_flush;
 }
 
+/* Adds a TS packet payload to the sections assembled in psi, from scratch if
+   payload_start_indicator is set.
+   Returns: CCX_FALSE if the packet doesn't follow the previous one */
+int psi_buffer_add(struct PSI_buffer *psi, unsigned char *payload_start, unsigned payload_length,
+		unsigned payload_start_indicator, unsigned ccounter)
+{
+	if (payload_length > 184)
+		payload_length = 0;
+	if (psi->buffer == NULL)
+	{
+		psi->buffer = (uint8_t *) malloc(PSI_BUFFER_SIZE);
+		if (psi->buffer == NULL)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "In psi_buffer_add: Not enough memory for PSI sections.\n");
+		psi->buffer_length = 0;
+	}
+
+	if (payload_start_indicator)
+	{
+		psi->ccounter = 0;
+		psi->buffer_length = 0;
+	}
+	else if (!(ccounter == psi->prev_ccounter + 1 || (psi->prev_ccounter == 0x0f && ccounter == 0)))
+		return CCX_FALSE;
+	psi->prev_ccounter = ccounter;
+
+	if (payload_length > PSI_BUFFER_SIZE - psi->buffer_length)
+	{
+		dbg_print(CCX_DMT_GENERIC_NOTICES, "\rWarning: PSI data longer than a section, %u bytes dropped.\n",
+				payload_length - (PSI_BUFFER_SIZE - psi->buffer_length));
+		payload_length = PSI_BUFFER_SIZE - psi->buffer_length;
+	}
+	memcpy(psi->buffer + psi->buffer_length, payload_start, payload_length);
+	psi->buffer_length += payload_length;
+	psi->ccounter++;
+	return CCX_TRUE;
+}
+
+/* Tables repeat unchanged every 100 ms or so. A section of psi (len bytes
+   available from section on) is looked up by table_id, table_id_extension,
+   section_number, version_number and CRC among the sections parsed last
+   time, and remembered if its CRC is right.
+   Returns: CCX_TRUE if it was parsed already, CCX_FALSE if it must be parsed,
+   or is incomplete or has no CRC */
+int psi_section_unchanged(struct PSI_buffer *psi, unsigned char *section, unsigned len)
+{
+	struct psi_section_key key, *entry;
+	unsigned section_length, slot;
+
+	if (psi == NULL || psi->buffer == NULL || section < psi->buffer ||
+			section > psi->buffer + psi->buffer_length ||
+			len > (unsigned) (psi->buffer + psi->buffer_length - section) || len < 8)
+		return CCX_FALSE;
+	if (!(section[1] & 0x80)) // No section_syntax_indicator, no version nor CRC
+		return CCX_FALSE;
+	section_length = ((section[1] & 0x0F) << 8) | section[2];
+	if (section_length < 9 || section_length + 3 > len)
+		return CCX_FALSE;
+
+	key.table_id = section[0];
+	key.table_id_extension = (section[3] << 8) | section[4];
+	key.version_number = (section[5] & 0x3E) >> 1;
+	key.section_number = section[6];
+	key.crc = ((uint32_t) section[section_length - 1] << 24) | (section[section_length] << 16) |
+		(section[section_length + 1] << 8) | section[section_length + 2];
+	key.used = 1;
+
+	slot = (key.table_id * 8 + key.table_id_extension * 37 + key.section_number) & (PSI_SECTION_CACHE_SIZE - 1);
+	if (psi->cache != NULL)
+	{
+		entry = psi->cache + slot;
+		if (entry->used && entry->crc == key.crc && entry->table_id == key.table_id &&
+				entry->table_id_extension == key.table_id_extension &&
+				entry->version_number == key.version_number && entry->section_number == key.section_number)
+			return CCX_TRUE;
+	}
+
+	if (verify_crc32(section, section_length + 3) == CCX_FALSE)
+		return CCX_FALSE;
+	if (psi->cache == NULL)
+	{
+		psi->cache = (struct psi_section_key *) calloc(PSI_SECTION_CACHE_SIZE, sizeof(struct psi_section_key));
+		if (psi->cache == NULL)
+			return CCX_FALSE;
+	}
+	psi->cache[slot] = key;
+	return CCX_FALSE;
+}
+
+/* Forgets the sections assembled and parsed, for a new stream */
+void psi_buffer_reset(struct PSI_buffer *psi)
+{
+	psi->buffer_length = 0;
+	psi->ccounter = 0;
+	psi->prev_ccounter = 0xff;
+	freep(&psi->cache);
+}
+
+void psi_buffer_free(struct PSI_buffer *psi)
+{
+	freep(&psi->buffer);
+	freep(&psi->cache);
+	psi->buffer_length = 0;
+}
+
 void ts_buffer_psi_packet(struct ccx_demuxer *ctx)
 {
 	unsigned char *payload_start = tspacket + 4;
@@ -486,10 +596,13 @@ void ts_buffer_psi_packet(struct ccx_demuxer *ctx)
 	if(ctx->PID_buffers[pid]==NULL)
 	{//First packet for this pid. Creat a buffer
 		ctx->PID_buffers[pid] = malloc(sizeof(struct PSI_buffer));
+		if (ctx->PID_buffers[pid] == NULL)
+			fatal(EXIT_NOT_ENOUGH_MEMORY, "In ts_buffer_psi_packet: Not enough memory for PSI sections.\n");
 		ctx->PID_buffers[pid]->buffer=NULL;
 		ctx->PID_buffers[pid]->buffer_length=0;
 		ctx->PID_buffers[pid]->ccounter=0;
 		ctx->PID_buffers[pid]->prev_ccounter=0xff;
+		ctx->PID_buffers[pid]->cache=NULL;
 	}
 
 	//skip the packet if the adaptation field legnth or payload length are out of bounds or broken
@@ -499,34 +612,8 @@ void ts_buffer_psi_packet(struct ccx_demuxer *ctx)
 
 	}
 
-	if(payload_start_indicator)
-	{
-		if(ctx->PID_buffers[pid]->ccounter>0)
-		{
-			ctx->PID_buffers[pid]->ccounter=0;
-		}
-		ctx->PID_buffers[pid]->prev_ccounter = ccounter;
-
-		if(ctx->PID_buffers[pid]->buffer!=NULL)
-			free(ctx->PID_buffers[pid]->buffer);
-		else
-		{
-			// must be first packet for PID
-		}
-		ctx->PID_buffers[pid]->buffer = (uint8_t *)malloc(payload_length);
-		memcpy(ctx->PID_buffers[pid]->buffer, payload_start, payload_length);
-		ctx->PID_buffers[pid]->buffer_length=payload_length;
-		ctx->PID_buffers[pid]->ccounter++;
-	}
-	else if(ccounter==ctx->PID_buffers[pid]->prev_ccounter+1 || (ctx->PID_buffers[pid]->prev_ccounter==0x0f && ccounter==0))
-	{
-		ctx->PID_buffers[pid]->prev_ccounter = ccounter;
-		ctx->PID_buffers[pid]->buffer = (uint8_t *)realloc(ctx->PID_buffers[pid]->buffer, ctx->PID_buffers[pid]->buffer_length+payload_length);
-		memcpy(ctx->PID_buffers[pid]->buffer+ctx->PID_buffers[pid]->buffer_length, payload_start, payload_length);
-		ctx->PID_buffers[pid]->ccounter++;
-		ctx->PID_buffers[pid]->buffer_length+=payload_length;
-	}
-	else if(ctx->PID_buffers[pid]->prev_ccounter<= 0x0f)
+	if (!psi_buffer_add(ctx->PID_buffers[pid], payload_start, payload_length, payload_start_indicator, ccounter) &&
+			ctx->PID_buffers[pid]->prev_ccounter <= 0x0f)
 	{
 		dbg_print (CCX_DMT_GENERIC_NOTICES, "\rWarning: Out of order packets detected for PID: %u.\n\
        ctx->PID_buffers[pid]->prev_ccounter:%" PRIu32 " ctx->ctx->PID_buffers[pid]->ccounter:%" PRIu32 "\n",pid, ctx->PID_buffers[pid]->prev_ccounter, ctx->PID_buffers[pid]->ccounter);
@@ -552,6 +639,9 @@ int parse_PAT (struct ccx_demuxer *ctx)
 	payload_start = ctx->PID_buffers[0]->buffer + pointer_field + 1;
 	payload_length = ctx->PID_buffers[0]->buffer_length - (pointer_field + 1);
 
+	if (psi_section_unchanged(ctx->PID_buffers[0], payload_start, payload_length))
+		return 0;
+
 	section_number = payload_start[6];
 	last_section_number = payload_start[7];
 
@@ -590,11 +680,19 @@ int parse_PAT (struct ccx_demuxer *ctx)
 	if (ctx->last_pat_payload != NULL)
 	{
 		mprint ("Notice: PAT changed, clearing all variables.\n");
+		// Sections parsed with the former programs, and the former PATs, which
+		// have to be taken as changes again if they come back
+		for (unsigned i = 0; i < MAX_PSI_PID; i++)
+			if (ctx->PID_buffers[i])
+				freep(&ctx->PID_buffers[i]->cache);
 		dinit_cap(ctx);
 		clear_PMT_array(ctx);
 		memset (ctx->PIDs_seen,0,sizeof (int) *65536); // Forget all we saw
 		if (!tlt_config.user_page) // If the user didn't select a page...
+		{
+			program_pipeline_forget_tlt_page(((struct lib_ccx_ctx *) ctx->parent)->pipeline);
 			tlt_config.page=0; // ..forget whatever we detected.
+		}
 
 		gotpes=1;
 	}
@@ -857,6 +955,9 @@ void parse_SDT(struct ccx_demuxer *ctx)
 	payload_start = ctx->PID_buffers[0x11]->buffer + pointer_field + 1;
 	payload_length = ctx->PID_buffers[0x11]->buffer_length - (pointer_field + 1);
 
+	if (psi_section_unchanged(ctx->PID_buffers[0x11], payload_start, payload_length))
+		return;
+
 	//section_number = payload_start[6];
 	//last_section_number = payload_start[7];
 
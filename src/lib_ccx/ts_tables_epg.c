@@ -285,20 +285,59 @@ void EPG_output_live(struct lib_ccx_ctx *ctx)
 	free(finalfilename);
 }
 
+static char *EPG_filename(struct lib_ccx_ctx *ctx)
+{
+	char *filename = malloc(strlen(ctx->basefilename) + 9);
+	if(filename == NULL)
+		return NULL;
+
+	memcpy(filename, ctx->basefilename, strlen(ctx->basefilename)+1);
+	strcat(filename, "_epg.xml");
+	return filename;
+}
+
+// Hash of what EPG_output() writes for the channels, and of which program the
+// events of each eit_programs[] entry belong to.
+static uint32_t EPG_channels_hash(struct lib_ccx_ctx *ctx)
+{
+	uint32_t hash = 2166136261u ^ ctx->demux_ctx->nb_program;
+	char *c;
+	int i;
+
+	for(i=0; i<ctx->demux_ctx->nb_program; i++)
+	{
+		hash = (hash ^ ctx->demux_ctx->pinfo[i].program_number) * 16777619u;
+		for(c = ctx->demux_ctx->pinfo[i].name; *c; c++)
+			hash = (hash ^ (uint8_t) *c) * 16777619u;
+		hash = (hash ^ 0xff) * 16777619u;
+	}
+	return hash;
+}
+
+// Entries of eit_programs[] whose events EPG_output() prints in full
+static void EPG_output_range(struct lib_ccx_ctx *ctx, int *first, int *last)
+{
+	if(ctx->demux_ctx->nb_program==0)
+		*first = *last = TS_PMT_MAP_SIZE;
+	else
+	{
+		*first = 0;
+		*last = ctx->demux_ctx->nb_program - 1;
+	}
+}
+
 // Creates fills and closes a new XMLTV file for full output mode.
 // File should include all events in memory.
 void EPG_output(struct lib_ccx_ctx *ctx)
 {
 	FILE *f;
 	char *filename;
-	int i,j, ce;
+	int i,j, ce, first, last;
 
-	filename = malloc(strlen(ctx->basefilename) + 9);
+	filename = EPG_filename(ctx);
 	if(filename == NULL)
 		return;
 
-	memcpy(filename, ctx->basefilename, strlen(ctx->basefilename)+1);
-	strcat(filename, "_epg.xml");
 	f = fopen(filename, "w");
 	if(!f)
 	{
@@ -320,6 +359,7 @@ void EPG_output(struct lib_ccx_ctx *ctx)
 		fprintf(f, "</display-name>\n");
 		fprintf(f, "  </channel>\n");
 	}
+	ctx->epg_written_events = 0;
 	if(ccx_options.xmltvonlycurrent==0)
 	{ // print all events
 		for(i=0; i<ctx->demux_ctx->nb_program; i++)
@@ -331,6 +371,18 @@ void EPG_output(struct lib_ccx_ctx *ctx)
 		if(ctx->demux_ctx->nb_program==0) //Stream has no PMT, fall back to unordered events
 			for(j=0; j<ctx->eit_programs[TS_PMT_MAP_SIZE].array_len; j++)
 				EPG_print_event(&ctx->eit_programs[TS_PMT_MAP_SIZE].epg_events[j], ctx->eit_programs[TS_PMT_MAP_SIZE].epg_events[j].service_id, f);
+
+		// Every event EPG_output_changes() looks at is in the file now
+		EPG_output_range(ctx, &first, &last);
+		for(i=first; i<=last; i++)
+		{
+			for(j=0; j<ctx->eit_programs[i].array_len; j++)
+			{
+				ctx->eit_programs[i].epg_events[j].dirty = false;
+				ctx->eit_programs[i].epg_events[j].written = true;
+			}
+			ctx->epg_written_events += ctx->eit_programs[i].array_len;
+		}
 	}
 	else
 	{ // print current events only
@@ -346,6 +398,72 @@ void EPG_output(struct lib_ccx_ctx *ctx)
 	}
 	fprintf(f, "</tv>");
 	fclose(f);
+
+	ctx->epg_written = true;
+	ctx->epg_appended = false;
+	ctx->epg_stale_events = 0;
+	ctx->epg_channels_hash = EPG_channels_hash(ctx);
+}
+
+// Brings _epg.xml up to date after EPG_add_event() reported changes. Rather
+// than writing every event again, the changed ones are appended before the
+// closing </tv>. Old copies of updated events stay behind until the file is
+// written in full, which happens once they are half of it, when the channels
+// change and at the end, see EPG_compact_output(). The file is a valid XMLTV
+// file in between.
+void EPG_output_changes(struct lib_ccx_ctx *ctx)
+{
+	FILE *f;
+	char *filename;
+	int i, j, first, last;
+	struct EPG_event *event;
+
+	if(!ctx->epg_written || ccx_options.xmltvonlycurrent || ctx->epg_stale_events * 2 > ctx->epg_written_events
+		|| ctx->epg_channels_hash != EPG_channels_hash(ctx))
+	{
+		EPG_output(ctx);
+		return;
+	}
+
+	filename = EPG_filename(ctx);
+	if(filename == NULL)
+		return;
+	f = fopen(filename, "r+");
+	freep(&filename);
+	if(!f || fseek(f, -(long) strlen("</tv>"), SEEK_END))
+	{
+		if(f)
+			fclose(f);
+		EPG_output(ctx);
+		return;
+	}
+
+	EPG_output_range(ctx, &first, &last);
+	for(i=first; i<=last; i++)
+	{
+		for(j=0; j<ctx->eit_programs[i].array_len; j++)
+		{
+			event = &ctx->eit_programs[i].epg_events[j];
+			if(!event->dirty)
+				continue;
+			EPG_print_event(event, i==TS_PMT_MAP_SIZE ? event->service_id : ctx->demux_ctx->pinfo[i].program_number, f);
+			if(event->written)
+				ctx->epg_stale_events++;
+			event->dirty = false;
+			event->written = true;
+			ctx->epg_written_events++;
+		}
+	}
+	fprintf(f, "</tv>");
+	fclose(f);
+	ctx->epg_appended = true;
+}
+
+// Write _epg.xml in full if EPG_output_changes() left old copies of events in it
+void EPG_compact_output(struct lib_ccx_ctx *ctx)
+{
+	if(ctx->epg_appended)
+		EPG_output(ctx);
 }
 
 // Free all memory allocated for given event
@@ -373,31 +491,50 @@ int EPG_event_cmp(struct EPG_event *e1, struct EPG_event *e2)
 	return true;
 }
 
+static inline uint32_t EPG_id_hash(uint32_t id)
+{
+	return (id * 2654435761u) >> (32 - EPG_ID_HASH_BITS);
+}
+
 // Add given event to array of events.
 // Return FALSE if nothing changed, TRUE if this is a new or updated event.
 int EPG_add_event(struct lib_ccx_ctx *ctx, int32_t pmt_map, struct EPG_event *event)
 {
-	int isnew=true, j;
-	
-	for(j=0; j<ctx->eit_programs[pmt_map].array_len; j++)
+	struct EIT_program *program = &ctx->eit_programs[pmt_map];
+	struct EPG_event *stored;
+	uint32_t slot;
+
+	for(slot = EPG_id_hash(event->id); program->id_hash[slot]; slot = (slot + 1) & ((1 << EPG_ID_HASH_BITS) - 1))
 	{
-		if(ctx->eit_programs[pmt_map].epg_events[j].id==event->id)
+		stored = &program->epg_events[program->id_hash[slot] - 1];
+		if(stored->id==event->id)
 		{
-			if(EPG_event_cmp(event, &ctx->eit_programs[pmt_map].epg_events[j]))
+			if(EPG_event_cmp(event, stored))
 				return false; //event already in array, nothing to do
 			else
 			{ //event with this id is already in the array but something has changed. Update it.
-				event->count=ctx->eit_programs[pmt_map].epg_events[j].count;
-				EPG_free_event(&ctx->eit_programs[pmt_map].epg_events[j]);
-				memcpy(&ctx->eit_programs[pmt_map].epg_events[j], event, sizeof(struct EPG_event));
+				event->count=stored->count;
+				event->written=stored->written;
+				event->dirty=true;
+				EPG_free_event(stored);
+				memcpy(stored, event, sizeof(struct EPG_event));
 				return true;
 			}
 		}
 	}
 	// id not in array. Add new event;
+	if(program->array_len == EPG_MAX_EVENTS)
+	{
+		dbg_print (CCX_DMT_GENERIC_NOTICES, "\rWarning: Too many EPG events, ignoring event %u.\n", event->id);
+		EPG_free_event(event);
+		return false;
+	}
 	event->count=0;
-	memcpy(&ctx->eit_programs[pmt_map].epg_events[ctx->eit_programs[pmt_map].array_len], event, sizeof(struct EPG_event));
-	ctx->eit_programs[pmt_map].array_len++;
+	event->written=false;
+	event->dirty=true;
+	memcpy(&program->epg_events[program->array_len], event, sizeof(struct EPG_event));
+	program->array_len++;
+	program->id_hash[slot] = program->array_len;
 	return true;
 }
 
@@ -827,7 +964,7 @@ void EPG_ATSC_decode_EIT(struct lib_ccx_ctx *ctx, uint8_t *payload_start, uint32
 		offset += 12 + descriptors_loop_length + title_length;
 	}
 	if((ccx_options.xmltv==1 || ccx_options.xmltv==3) && ccx_options.xmltvoutputinterval==0 && hasnew)
-		EPG_output(ctx);
+		EPG_output_changes(ctx);
 #undef CHECK_OFFSET
 }
 
@@ -978,7 +1115,7 @@ void EPG_DVB_decode_EIT(struct lib_ccx_ctx *ctx, uint8_t *payload_start, uint32_
 	}
 	
 	if((ccx_options.xmltv==1 || ccx_options.xmltv==3) && ccx_options.xmltvoutputinterval==0 && hasnew)
-		EPG_output(ctx);
+		EPG_output_changes(ctx);
 }
 	//handle outputing to xml files
 void EPG_handle_output(struct lib_ccx_ctx *ctx)
@@ -1005,12 +1142,25 @@ void EPG_handle_output(struct lib_ccx_ctx *ctx)
 	}
 }
 
+/* Events go to the program of their service, so sections decoded before it
+   was known are decoded again, and so are those of another program list or
+   channel map (VCT) */
+static void EPG_forget_sections(struct lib_ccx_ctx *ctx, struct PSI_buffer *keep)
+{
+	for (int x = 0; x <= 0xfff; x++)
+		if (&ctx->epg_buffers[x] != keep)
+			freep(&ctx->epg_buffers[x].cache);
+}
+
 //determine table type and call the correct function to handle it
-void EPG_parse_table(struct lib_ccx_ctx *ctx, uint8_t *b, uint32_t size)
+void EPG_parse_table(struct lib_ccx_ctx *ctx, struct PSI_buffer *psi)
 {
+	uint8_t *b = psi->buffer;
+	uint32_t size = psi->buffer_length;
 	uint8_t pointer_field = b[0];
 	uint8_t *payload_start;
 	uint8_t table_id;
+	uint32_t programs;
 
 	//XXX hack, should accumulate data
 	if(pointer_field + 2 > size) {
@@ -1018,17 +1168,31 @@ void EPG_parse_table(struct lib_ccx_ctx *ctx, uint8_t *b, uint32_t size)
 	}
 	payload_start = &b[pointer_field + 1];
 	table_id = payload_start[0];
-	switch (table_id) {
-	case 0x0cb:
-		EPG_ATSC_decode_EIT(ctx, payload_start, size - (payload_start - b));
-		break;
-	case 0xc8:
-		EPG_ATSC_decode_VCT(ctx, payload_start, size - (payload_start - b));
-		break;
-	default:
-		if (table_id>=0x4e && table_id<=0x6f)
-			EPG_DVB_decode_EIT(ctx, payload_start, size - (payload_start - b));
-		break;
+	programs = ctx->demux_ctx->nb_program;
+	for (int i = 0; i < ctx->demux_ctx->nb_program; i++)
+		programs = programs * 31 + ctx->demux_ctx->pinfo[i].program_number;
+	if (programs != ctx->epg_programs)
+	{
+		EPG_forget_sections(ctx, NULL);
+		ctx->epg_programs = programs;
+	}
+
+	// Events of a section decoded already are known
+	if (!psi_section_unchanged(psi, payload_start, size - (payload_start - b)))
+	{
+		switch (table_id) {
+		case 0x0cb:
+			EPG_ATSC_decode_EIT(ctx, payload_start, size - (payload_start - b));
+			break;
+		case 0xc8:
+			EPG_ATSC_decode_VCT(ctx, payload_start, size - (payload_start - b));
+			EPG_forget_sections(ctx, psi);
+			break;
+		default:
+			if (table_id>=0x4e && table_id<=0x6f)
+				EPG_DVB_decode_EIT(ctx, payload_start, size - (payload_start - b));
+			break;
+		}
 	}
 	EPG_handle_output(ctx);
 }
@@ -1060,39 +1224,14 @@ void parse_EPG_packet(struct lib_ccx_ctx *ctx)
 	if(pid!=0x12)
 		buffer_map = pid-0x1000;
 
-	if(payload_start_indicator)
+	if(payload_start_indicator && ctx->epg_buffers[buffer_map].ccounter>0)
 	{
-		if(ctx->epg_buffers[buffer_map].ccounter>0) {
-			ctx->epg_buffers[buffer_map].ccounter=0;
-			EPG_parse_table(ctx, ctx->epg_buffers[buffer_map].buffer, ctx->epg_buffers[buffer_map].buffer_length);
-		}
-
-
-		ctx->epg_buffers[buffer_map].prev_ccounter = ccounter;
-		
-		if(ctx->epg_buffers[buffer_map].buffer!=NULL)
-			free(ctx->epg_buffers[buffer_map].buffer);
-		else {
-			// must be first EIT packet
-		}
-		ctx->epg_buffers[buffer_map].buffer = (uint8_t *)malloc(payload_length);
-		memcpy(ctx->epg_buffers[buffer_map].buffer, payload_start, payload_length);
-		ctx->epg_buffers[buffer_map].buffer_length=payload_length;
-		ctx->epg_buffers[buffer_map].ccounter++;
-		
+		ctx->epg_buffers[buffer_map].ccounter=0;
+		EPG_parse_table(ctx, &ctx->epg_buffers[buffer_map]);
 	}
-	else if(ccounter==ctx->epg_buffers[buffer_map].prev_ccounter+1 || (ctx->epg_buffers[buffer_map].prev_ccounter==0x0f && ccounter==0))
-	{
-		ctx->epg_buffers[buffer_map].prev_ccounter = ccounter;
-		ctx->epg_buffers[buffer_map].buffer = (uint8_t *)realloc(ctx->epg_buffers[buffer_map].buffer, ctx->epg_buffers[buffer_map].buffer_length+payload_length);
-		memcpy(ctx->epg_buffers[buffer_map].buffer+ctx->epg_buffers[buffer_map].buffer_length, payload_start, payload_length);
-		ctx->epg_buffers[buffer_map].ccounter++;
-		ctx->epg_buffers[buffer_map].buffer_length+=payload_length;
-	}
-	else
-	{
+
+	if (!psi_buffer_add(&ctx->epg_buffers[buffer_map], payload_start, payload_length, payload_start_indicator, ccounter))
 		dbg_print (CCX_DMT_GENERIC_NOTICES, "\rWarning: Out of order EPG packets detected.\n");
-	}
 }
 
 // Free all memory used for EPG parsing
@@ -1100,6 +1239,7 @@ void EPG_free(struct lib_ccx_ctx *ctx)
 {	
 	if(ctx->epg_inited)
 	{
+		EPG_compact_output(ctx);
 		if(ccx_options.xmltv==2 || ccx_options.xmltv==3 || ccx_options.send_to_srv)
 		{
 			if (ccx_options.send_to_srv)
@@ -1108,6 +1248,9 @@ void EPG_free(struct lib_ccx_ctx *ctx)
 				EPG_output_live(ctx);
 		}
 	}
+	if (ctx->epg_buffers)
+		for (int x = 0; x <= 0xfff; x++)
+			psi_buffer_free(&ctx->epg_buffers[x]);
 	free(ctx->epg_buffers);
 	free(ctx->eit_programs);
 	free(ctx->eit_current_events);
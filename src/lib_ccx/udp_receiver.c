@@ -0,0 +1,354 @@
+#ifdef __linux__
+#define _GNU_SOURCE // recvmmsg()
+#endif
+#include "lib_ccx.h"
+#include "ccx_common_option.h"
+#include "udp_receiver.h"
+#include "ccx_metrics.h"
+
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+/* Datagrams taken by a recvmmsg() call at most */
+#define UDP_RECEIVER_BATCH 32
+/* How long the thread and the reader wait before checking if they must stop */
+#define UDP_RECEIVER_POLL_MS 100
+
+struct udp_receiver
+{
+	int fd;
+	pthread_t thread;
+
+	unsigned char *ring;
+	size_t size;   // Power of two
+	size_t head;   // Bytes written since the start, only written by the thread
+	size_t tail;   // Bytes read since the start, only written by the reader
+	int stop;
+	int error;     // errno of the last failed read of the socket, the thread has ended
+
+	/* Only used to sleep, the ring itself is lock free */
+	pthread_mutex_t lock;
+	pthread_cond_t data_cond;
+	int reader_waiting;
+
+	/* Counted by the thread, read with __atomic too */
+	unsigned long long datagrams;
+	unsigned long long bytes;
+	unsigned long long ring_drops;
+	unsigned long long truncated;
+	unsigned long kernel_drops;
+	int kernel_drops_known;
+	size_t ring_peak;
+};
+
+static void ring_write(struct udp_receiver *r, size_t head, const unsigned char *data, size_t len)
+{
+	size_t pos = head & (r->size - 1);
+	size_t first = r->size - pos < len ? r->size - pos : len;
+
+	memcpy(r->ring + pos, data, first);
+	memcpy(r->ring, data + first, len - first);
+}
+
+/* Datagrams are written whole or not at all, a TS packet cut at the end of
+ * one would only get the demuxer out of sync. */
+static void push_datagrams(struct udp_receiver *r, unsigned char **data, size_t *len, int n)
+{
+	size_t head = r->head;
+	size_t used = head - __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST);
+
+	for (int i = 0; i < n; i++)
+	{
+		if (len[i] > r->size - used)
+		{
+			__atomic_store_n(&r->ring_drops, r->ring_drops + 1, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		ring_write(r, head, data[i], len[i]);
+		head += len[i];
+		used += len[i];
+		__atomic_store_n(&r->bytes, r->bytes + len[i], __ATOMIC_SEQ_CST);
+	}
+	__atomic_store_n(&r->datagrams, r->datagrams + n, __ATOMIC_SEQ_CST);
+	if (used > r->ring_peak)
+		__atomic_store_n(&r->ring_peak, used, __ATOMIC_SEQ_CST);
+	if (head == r->head)
+		return;
+
+	__atomic_store_n(&r->head, head, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&r->reader_waiting, __ATOMIC_SEQ_CST))
+	{
+		pthread_mutex_lock(&r->lock);
+		pthread_cond_signal(&r->data_cond);
+		pthread_mutex_unlock(&r->lock);
+	}
+}
+
+static void *receiver_main(void *arg)
+{
+	struct udp_receiver *r = arg;
+	unsigned char *buffers = malloc((size_t) UDP_RECEIVER_BATCH * UDP_RECEIVER_MAX_DATAGRAM);
+	unsigned char *data[UDP_RECEIVER_BATCH];
+	size_t len[UDP_RECEIVER_BATCH];
+#ifdef __linux__
+	struct mmsghdr msgs[UDP_RECEIVER_BATCH];
+	struct iovec iov[UDP_RECEIVER_BATCH];
+	union
+	{
+		char buf[CMSG_SPACE(sizeof(uint32_t))];
+		struct cmsghdr align;
+	} control[UDP_RECEIVER_BATCH];
+#endif
+
+	if (!buffers)
+	{
+		__atomic_store_n(&r->error, ENOMEM, __ATOMIC_SEQ_CST);
+		return NULL;
+	}
+	for (int i = 0; i < UDP_RECEIVER_BATCH; i++)
+		data[i] = buffers + (size_t) i * UDP_RECEIVER_MAX_DATAGRAM;
+
+	while (!__atomic_load_n(&r->stop, __ATOMIC_SEQ_CST))
+	{
+		int n;
+#ifdef __linux__
+		memset(msgs, 0, sizeof(msgs));
+		for (int i = 0; i < UDP_RECEIVER_BATCH; i++)
+		{
+			iov[i].iov_base = data[i];
+			iov[i].iov_len = UDP_RECEIVER_MAX_DATAGRAM;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = control[i].buf;
+			msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+		}
+		// Waits for the first datagram only, then takes what else is there
+		n = recvmmsg(r->fd, msgs, UDP_RECEIVER_BATCH, MSG_WAITFORONE, NULL);
+#else
+		ssize_t got = recv(r->fd, data[0], UDP_RECEIVER_MAX_DATAGRAM, 0);
+		n = got < 0 ? -1 : 1;
+		if (got >= 0)
+			len[0] = got;
+#endif
+		if (n < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				continue; // SO_RCVTIMEO, time to check stop
+			__atomic_store_n(&r->error, errno ? errno : EIO, __ATOMIC_SEQ_CST);
+			break;
+		}
+#ifdef __linux__
+		for (int i = 0; i < n; i++)
+		{
+			struct cmsghdr *cmsg;
+
+			len[i] = msgs[i].msg_len;
+			if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+				__atomic_store_n(&r->truncated, r->truncated + 1, __ATOMIC_SEQ_CST);
+			for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+			{
+#ifdef SO_RXQ_OVFL
+				if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+				{
+					uint32_t drops;
+					memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+					__atomic_store_n(&r->kernel_drops, drops, __ATOMIC_SEQ_CST);
+				}
+#endif
+			}
+		}
+#endif
+		push_datagrams(r, data, len, n);
+	}
+
+	free(buffers);
+	// A reader waiting for data that will never come
+	pthread_mutex_lock(&r->lock);
+	pthread_cond_signal(&r->data_cond);
+	pthread_mutex_unlock(&r->lock);
+	return NULL;
+}
+
+struct udp_receiver *udp_receiver_start(int fd)
+{
+	struct udp_receiver *r;
+	struct timeval timeout;
+	size_t size = 1;
+	int on = 1;
+
+	if (ccx_options.udp_ring_size <= 0)
+		return NULL;
+	while (size < (size_t) ccx_options.udp_ring_size * 1024 * 1024)
+		size <<= 1;
+
+	r = calloc(1, sizeof(struct udp_receiver));
+	if (!r)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In udp_receiver_start: Not enough memory for the UDP receiver.\n");
+	r->ring = malloc(size);
+	if (!r->ring)
+		fatal(EXIT_NOT_ENOUGH_MEMORY, "In udp_receiver_start: Not enough memory for a %zu bytes UDP ring.\n", size);
+	r->fd = fd;
+	r->size = size;
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = UDP_RECEIVER_POLL_MS * 1000;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+		mprint("UDP receiver: can't set SO_RCVTIMEO (%s), it will only stop on the next datagram.\n", strerror(errno));
+#ifdef SO_RXQ_OVFL
+	// The counter only comes with datagrams once something was dropped
+	if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+		dbg_print(CCX_DMT_VERBOSE, "UDP receiver: no SO_RXQ_OVFL (%s), kernel drops won't be counted.\n", strerror(errno));
+	else
+		r->kernel_drops_known = 1;
+#else
+	(void) on;
+#endif
+
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->data_cond, NULL);
+	if (pthread_create(&r->thread, NULL, receiver_main, r))
+	{
+		mprint("UDP receiver: can't create the thread, reading the socket directly.\n");
+		pthread_mutex_destroy(&r->lock);
+		pthread_cond_destroy(&r->data_cond);
+		free(r->ring);
+		free(r);
+		return NULL;
+	}
+	dbg_print(CCX_DMT_VERBOSE, "UDP receiver started, %zu bytes ring.\n", size);
+	return r;
+}
+
+int udp_receiver_read(struct udp_receiver *r, unsigned char *buf, size_t len)
+{
+	size_t tail = r->tail, avail, pos, first;
+
+	avail = __atomic_load_n(&r->head, __ATOMIC_SEQ_CST) - tail;
+	if (!avail)
+	{
+		pthread_mutex_lock(&r->lock);
+		__atomic_store_n(&r->reader_waiting, 1, __ATOMIC_SEQ_CST);
+		while (!(avail = __atomic_load_n(&r->head, __ATOMIC_SEQ_CST) - tail) &&
+				!__atomic_load_n(&r->error, __ATOMIC_SEQ_CST) && !terminate_asap)
+		{
+			// Timed, terminate_asap is set by a signal handler
+			struct timespec until;
+			clock_gettime(CLOCK_REALTIME, &until);
+			until.tv_nsec += UDP_RECEIVER_POLL_MS * 1000000L;
+			if (until.tv_nsec >= 1000000000L)
+			{
+				until.tv_sec++;
+				until.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&r->data_cond, &r->lock, &until);
+		}
+		__atomic_store_n(&r->reader_waiting, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&r->lock);
+		if (!avail)
+		{
+			if (terminate_asap)
+				return 0;
+			errno = __atomic_load_n(&r->error, __ATOMIC_SEQ_CST);
+			return -1;
+		}
+	}
+
+	ccx_metrics_queue_depth(CCX_QUEUE_UDP, (long) avail);
+	if (len > avail)
+		len = avail;
+	if (len > INT_MAX)
+		len = INT_MAX;
+	pos = tail & (r->size - 1);
+	first = r->size - pos < len ? r->size - pos : len;
+	memcpy(buf, r->ring + pos, first);
+	memcpy(buf + first, r->ring, len - first);
+	__atomic_store_n(&r->tail, tail + len, __ATOMIC_SEQ_CST);
+	return (int) len;
+}
+
+void udp_receiver_get_stats(struct udp_receiver *r, struct udp_receiver_stats *stats)
+{
+	stats->datagrams = __atomic_load_n(&r->datagrams, __ATOMIC_SEQ_CST);
+	stats->bytes = __atomic_load_n(&r->bytes, __ATOMIC_SEQ_CST);
+	stats->ring_drops = __atomic_load_n(&r->ring_drops, __ATOMIC_SEQ_CST);
+	stats->truncated = __atomic_load_n(&r->truncated, __ATOMIC_SEQ_CST);
+	stats->kernel_drops = __atomic_load_n(&r->kernel_drops, __ATOMIC_SEQ_CST);
+	stats->kernel_drops_known = __atomic_load_n(&r->kernel_drops_known, __ATOMIC_SEQ_CST);
+	stats->ring_peak = __atomic_load_n(&r->ring_peak, __ATOMIC_SEQ_CST);
+	stats->ring_size = r->size;
+}
+
+void udp_receiver_stop(struct udp_receiver **receiver)
+{
+	struct udp_receiver *r = *receiver;
+	struct udp_receiver_stats stats;
+
+	if (!r)
+		return;
+	__atomic_store_n(&r->stop, 1, __ATOMIC_SEQ_CST);
+	pthread_join(r->thread, NULL);
+
+	udp_receiver_get_stats(r, &stats);
+	if (stats.ring_drops || stats.truncated || stats.kernel_drops)
+		mprint("UDP input: %llu datagrams received, lost %lu in the kernel, %llu with the ring full, %llu truncated.\n",
+				stats.datagrams, stats.kernel_drops, stats.ring_drops, stats.truncated);
+	dbg_print(CCX_DMT_VERBOSE, "UDP receiver: %llu datagrams, %llu bytes, ring peak %zu of %zu bytes.\n",
+			stats.datagrams, stats.bytes, stats.ring_peak, stats.ring_size);
+
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->data_cond);
+	free(r->ring);
+	free(r);
+	*receiver = NULL;
+}
+
+#else
+
+struct udp_receiver *udp_receiver_start(int fd)
+{
+	return NULL;
+}
+
+int udp_receiver_read(struct udp_receiver *r, unsigned char *buf, size_t len)
+{
+	return -1;
+}
+
+void udp_receiver_get_stats(struct udp_receiver *r, struct udp_receiver_stats *stats)
+{
+	memset(stats, 0, sizeof(struct udp_receiver_stats));
+}
+
+void udp_receiver_stop(struct udp_receiver **receiver)
+{
+}
+
+#endif
+
+void udp_set_rcvbuf(int fd, int size)
+{
+	int got = 0;
+	socklen_t got_len = sizeof(got);
+
+	if (size <= 0)
+		return;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *) &size, sizeof(size)) < 0)
+	{
+		mprint("Can't set the UDP receive buffer to %d bytes: %s\n", size, strerror(errno));
+		return;
+	}
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *) &got, &got_len) < 0)
+		return;
+#ifdef __linux__
+	got /= 2; // The kernel doubles what it is given, for its bookkeeping
+#endif
+	if (got < size)
+		mprint("The UDP receive buffer is %d bytes instead of %d, see net.core.rmem_max.\n", got, size);
+}
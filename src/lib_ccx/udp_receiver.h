@@ -0,0 +1,60 @@
+#ifndef UDP_RECEIVER_H
+#define UDP_RECEIVER_H
+
+#include <stddef.h>
+
+/**
+ * -udp input read by a thread of its own. The thread drains the socket with
+ * recvmmsg() (recvfrom() where it isn't available) into a single producer,
+ * single consumer ring that buffered_read_opt() reads from. Decoding can
+ * then fall behind for a while without the socket buffer of the kernel
+ * overflowing, and the datagrams lost anyway are counted: by the kernel
+ * (SO_RXQ_OVFL, Linux) and with the ring full.
+ *
+ * The ring holds ccx_options.udp_ring_size MB, 0 reads the socket on the
+ * decoding thread as before. Not available on Windows.
+ */
+struct udp_receiver;
+
+#define UDP_RECEIVER_MAX_DATAGRAM 65536
+
+struct udp_receiver_stats
+{
+	unsigned long long datagrams;
+	unsigned long long bytes;
+	unsigned long long ring_drops;   // Datagrams that didn't fit in the ring
+	unsigned long long truncated;    // Datagrams larger than UDP_RECEIVER_MAX_DATAGRAM
+	unsigned long kernel_drops;      // Last counter of the kernel, if kernel_drops_known
+	int kernel_drops_known;
+	size_t ring_peak;                // Most bytes waiting in the ring
+	size_t ring_size;
+};
+
+/**
+ * Set the size of the socket buffer of the kernel, in bytes, and warn if
+ * the kernel gave less.
+ */
+void udp_set_rcvbuf(int fd, int size);
+
+/**
+ * @return NULL if there is no ring, in which case the caller reads fd itself
+ */
+struct udp_receiver *udp_receiver_start(int fd);
+
+/**
+ * Copy up to len bytes of the datagrams received, waiting for some if there
+ * are none.
+ *
+ * @return the number of bytes, 0 if terminate_asap was set while waiting,
+ *         -1 if the socket can't be read any more
+ */
+int udp_receiver_read(struct udp_receiver *r, unsigned char *buf, size_t len);
+
+void udp_receiver_get_stats(struct udp_receiver *r, struct udp_receiver_stats *stats);
+
+/**
+ * Stop the thread and print what was lost, if anything.
+ */
+void udp_receiver_stop(struct udp_receiver **r);
+
+#endif